@@ -0,0 +1,153 @@
+#define PA_IMPLEMENTATION
+#include "../patchy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Benchmark for the hash used by the dictionary and table. Compares the
+ * throughput and the distribution of pa_hash() with the bitwise CRC32 used
+ * before, on the kind of keys the framework actually hashes.
+ */
+
+#define KEY_NUM         4096
+#define KEY_SIZE        32
+#define ROUNDS          200
+#define BUCKETS         256
+
+static char *properties[] = {
+        "width", "height", "min-width", "max-width", "min-height",
+        "max-height", "margin", "margin-top", "margin-right", "margin-bottom",
+        "margin-left", "padding", "padding-top", "padding-right",
+        "padding-bottom", "padding-left", "border", "border-width",
+        "border-color", "color", "background", "background-color", "display",
+        "position", "top", "right", "bottom", "left", "overflow", "visibility",
+        "z-index", "font-size", "text-align", "vertical-align", "flex",
+        "flex-direction", "flex-grow", "flex-shrink", "flex-basis", "gap"
+};
+
+static char *tags[] = {
+        "body", "div", "span", "p", "h1", "h2", "h3", "text", "input",
+        "button", "ul", "ol", "li", "table", "tr", "td", "img", "a", "br",
+        "hr", "label", "select", "option", "textarea", "form", "header",
+        "footer", "nav", "section", "article"
+};
+
+struct key_set {
+        char *name;
+        char keys[KEY_NUM][KEY_SIZE];
+        s32 num;
+};
+
+/* The bitwise CRC32 previously used by dct_hash() and tbl_hash() */
+static u16 crc_hash(char *key, s32 size)
+{
+        u32 byte;
+        u32 crc;
+        u32 mask;
+        s32 i;
+        s32 j;
+
+        crc = 0xFFFFFFFF;
+        for(i = 0; i < size; i++) {
+                byte = (u8)key[i];
+                crc = crc ^ byte;
+                for (j = 7; j >= 0; j--) {
+                        mask = -(crc & 1);
+                        crc = (crc >> 1) ^ (0xEDB88320 & mask);
+                }
+        }
+        return (~crc) % 0xFFFF;
+}
+
+static u16 new_hash(char *key, s32 size)
+{
+        return pa_hash(key, size) & 0xFFFF;
+}
+
+static void fill_words(struct key_set *set, char *name, char **words, s32 num)
+{
+        s32 i;
+
+        set->name = name;
+        set->num = KEY_NUM;
+        for(i = 0; i < KEY_NUM; i++) {
+                if(i < num)
+                        sprintf(set->keys[i], "%s", words[i]);
+                else
+                        sprintf(set->keys[i], "%s-%ld", words[i % num],
+                                        (long)(i / num));
+        }
+}
+
+static void fill_ids(struct key_set *set)
+{
+        s32 i;
+
+        set->name = "element-ids";
+        set->num = KEY_NUM;
+        for(i = 0; i < KEY_NUM; i++)
+                sprintf(set->keys[i], "element%ld", (long)i);
+}
+
+static void bench(struct key_set *set, char *name,
+                u16 (*fnc)(char *key, s32 size))
+{
+        s32 buckets[BUCKETS];
+        s32 lens[KEY_NUM];
+        s32 i, r, max = 0;
+        f64 bytes = 0, chi = 0, expect, secs;
+        u32 sink = 0;
+        clock_t start;
+
+        for(i = 0; i < set->num; i++)
+                lens[i] = strlen(set->keys[i]);
+
+        start = clock();
+        for(r = 0; r < ROUNDS; r++) {
+                for(i = 0; i < set->num; i++) {
+                        sink += fnc(set->keys[i], lens[i]);
+                        bytes += lens[i];
+                }
+        }
+        secs = (f64)(clock() - start) / CLOCKS_PER_SEC;
+
+        /* Distribution over the buckets as a chi-squared value */
+        memset(buckets, 0, sizeof(buckets));
+        for(i = 0; i < set->num; i++)
+                buckets[fnc(set->keys[i], lens[i]) % BUCKETS]++;
+
+        expect = (f64)set->num / BUCKETS;
+        for(i = 0; i < BUCKETS; i++) {
+                chi += (buckets[i] - expect) * (buckets[i] - expect) / expect;
+                if(buckets[i] > max)
+                        max = buckets[i];
+        }
+
+        printf("%-12s %-6s %8.1f MB/s  chi2 %7.1f  max-chain %3ld  (%u)\n",
+                        set->name, name, secs > 0 ? bytes / secs / 1e6 : 0.0,
+                        chi, (long)max, sink & 1);
+}
+
+int main(void)
+{
+        static struct key_set sets[3];
+        s32 i;
+
+        fill_words(&sets[0], "properties", properties,
+                        sizeof(properties) / sizeof(properties[0]));
+        fill_words(&sets[1], "tags", tags, sizeof(tags) / sizeof(tags[0]));
+        fill_ids(&sets[2]);
+
+        printf("%d keys, %d buckets (expected chi2 ~%d)\n", KEY_NUM, BUCKETS,
+                        BUCKETS - 1);
+
+        for(i = 0; i < 3; i++) {
+                bench(&sets[i], "crc32", crc_hash);
+                bench(&sets[i], "xxh32", new_hash);
+        }
+
+        return 0;
+}
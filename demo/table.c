@@ -0,0 +1,164 @@
+#define PA_IMPLEMENTATION
+#include "../patchy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Benchmark report for the dictionary and table. Fills both with the kind of
+ * keys the framework uses, looks up every key and as many missing ones, and
+ * prints the timing together with the bucket statistics, so changes to the
+ * hashing or the bucket-layout can be compared run by run.
+ */
+
+#define KEY_NUM         4096
+#define KEY_SIZE        32
+#define ROUNDS          50
+
+static char *properties[] = {
+        "width", "height", "min-width", "max-width", "min-height",
+        "max-height", "margin", "margin-top", "margin-right", "margin-bottom",
+        "margin-left", "padding", "padding-top", "padding-right",
+        "padding-bottom", "padding-left", "border", "border-width",
+        "border-color", "color", "background", "background-color", "display",
+        "position", "top", "right", "bottom", "left", "overflow", "visibility",
+        "z-index", "font-size", "text-align", "vertical-align", "flex",
+        "flex-direction", "flex-grow", "flex-shrink", "flex-basis", "gap"
+};
+
+struct key_set {
+        char *name;
+        char keys[KEY_NUM][KEY_SIZE];
+        char miss[KEY_NUM][KEY_SIZE];
+        s32 num;
+};
+
+static void fill_set(struct key_set *set, char *name, s32 num)
+{
+        s32 count = sizeof(properties) / sizeof(properties[0]);
+        s32 i;
+
+        set->name = name;
+        set->num = num;
+        for(i = 0; i < num; i++) {
+                sprintf(set->keys[i], "%s-%ld", properties[i % count],
+                                (long)(i / count));
+                sprintf(set->miss[i], "%s+%ld", properties[i % count],
+                                (long)(i / count));
+        }
+}
+
+static void print_stats(char *name, struct pa_hash_stats *stats, f64 secs,
+                s32 lookups)
+{
+        s32 i;
+
+        printf("%-18s %6ld entries %6ld buckets  load %5.2f  "
+                        "%7.1f ns/lookup\n", name, (long)stats->entries,
+                        (long)stats->buckets, stats->load,
+                        secs * 1e9 / lookups);
+        printf("%18s probe hit %5.2f  miss %5.2f  longest %3ld  "
+                        "collisions %ld\n", "", stats->probe_hit,
+                        stats->probe_miss, (long)stats->longest,
+                        (long)stats->collisions);
+        printf("%18s hits %lu  misses %lu  filter %lu/%lu\n", "",
+                        (unsigned long)stats->hits,
+                        (unsigned long)stats->misses,
+                        (unsigned long)stats->filter_rejects,
+                        (unsigned long)stats->filter_checks);
+        printf("%18s chains", "");
+        for(i = 0; i < PA_STATS_CHAINS; i++)
+                printf(" %ld%s", (long)stats->chains[i],
+                                i == PA_STATS_CHAINS - 1 ? "+" : "");
+        printf("\n");
+}
+
+static void bench_dictionary(struct pa_memory *mem, struct key_set *set,
+                f32 rate)
+{
+        struct pa_dictionary dct;
+        struct pa_hash_stats stats;
+        char name[32];
+        s32 i, r, value;
+        clock_t start;
+
+        paInitDictionary(&dct, mem, sizeof(s32), 8);
+        if(rate > 0)
+                paEnableDictionaryFilter(&dct, rate);
+
+        for(i = 0; i < set->num; i++)
+                paSetDictionary(&dct, set->keys[i], &i);
+
+        paResetDictionaryStats(&dct);
+        start = clock();
+        for(r = 0; r < ROUNDS; r++) {
+                for(i = 0; i < set->num; i++) {
+                        paGetDictionary(&dct, set->keys[i], &value);
+                        paGetDictionary(&dct, set->miss[i], &value);
+                }
+        }
+
+        paGetDictionaryStats(&dct, &stats);
+        sprintf(name, "dictionary%s", rate > 0 ? "+bloom" : "");
+        print_stats(name, &stats, (f64)(clock() - start) / CLOCKS_PER_SEC,
+                        ROUNDS * set->num * 2);
+
+        paDestroyDictionary(&dct);
+}
+
+static void bench_table(struct pa_memory *mem, struct key_set *set, f32 rate)
+{
+        struct pa_table tbl;
+        struct pa_hash_stats stats;
+        char name[32];
+        s32 i, r, value;
+        clock_t start;
+
+        paInitTable(&tbl, mem, KEY_SIZE, sizeof(s32), 8);
+        if(rate > 0)
+                paEnableTableFilter(&tbl, rate);
+
+        for(i = 0; i < set->num; i++)
+                paSetTable(&tbl, set->keys[i], &i);
+
+        paResetTableStats(&tbl);
+        start = clock();
+        for(r = 0; r < ROUNDS; r++) {
+                for(i = 0; i < set->num; i++) {
+                        paGetTable(&tbl, set->keys[i], &value);
+                        paGetTable(&tbl, set->miss[i], &value);
+                }
+        }
+
+        paGetTableStats(&tbl, &stats);
+        sprintf(name, "table%s", rate > 0 ? "+bloom" : "");
+        print_stats(name, &stats, (f64)(clock() - start) / CLOCKS_PER_SEC,
+                        ROUNDS * set->num * 2);
+
+        paDestroyTable(&tbl);
+}
+
+int main(void)
+{
+        static struct key_set sets[3];
+        struct pa_memory mem;
+        s32 sizes[3] = {40, 512, KEY_NUM};
+        s32 i;
+
+        pa_mem_init_default(&mem);
+
+        for(i = 0; i < 3; i++) {
+                fill_set(&sets[i], "properties", sizes[i]);
+                printf("--- %ld keys, half of the lookups miss ---\n",
+                                (long)sets[i].num);
+
+                bench_dictionary(&mem, &sets[i], 0);
+                bench_dictionary(&mem, &sets[i], 0.01f);
+                bench_table(&mem, &sets[i], 0);
+                bench_table(&mem, &sets[i], 0.01f);
+        }
+
+        return 0;
+}
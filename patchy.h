@@ -70,7 +70,8 @@ typedef double                  f64;
 enum pa_memory_mode {
         PA_MEM_UDEF     = -1,
         PA_DYNAMIC      =  0,
-        PA_FIXED        =  1
+        PA_FIXED        =  1,
+        PA_MAPPED       =  2
 };
 
 enum pa_tag_type {
@@ -83,6 +84,12 @@ enum pa_tag_type {
         PA_CUSTOM       = 6
 };
 
+enum pa_number_type {
+        PA_UNSIGNED     = 0,
+        PA_SIGNED       = 1,
+        PA_FLOAT        = 2
+};
+
 /* 
  * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
  *
@@ -538,2564 +545,9385 @@ PA_API void paApplyList(struct pa_list *lst, pa_list_func fnc, void *pass);
 PA_API void paApplyListBack(struct pa_list *lst, pa_list_func fnc, void *pass);
 
 /*
- * -----------------------------------------------------------------------------
- *
- *      Dictionary
+ * The compare-function used to order entries. It should return a negative
+ * number if a comes before b, a positive number if a comes after b and 0 if
+ * they're equal.
+ */
+typedef s32 (*pa_list_compare)(void *a, void *b);
+
+/*
+ * Sort all entries in the list using introsort. The entries are ordered using
+ * quicksort, which falls back to heapsort if the recursion gets too deep and
+ * uses insertion sort for small ranges. The sorting is not stable.
  *
- * When pushing a new key-value-pair into the dictionary, the key is hashed and
- * the new entry consisting of the key and value memory is pushed with a next
- * value into the dictionary-buffer. The entry will then be put into one of the
- * buckets depending on the hash and attached to the last entry in the bucket by
- * updating it's next value.
+ * @lst: Pointer to the list
+ * @cmp: The compare-function
+ */
+PA_API void paSortList(struct pa_list *lst, pa_list_compare cmp);
+
+/*
+ * Sort all entries in the list by an integer-key stored in every entry using
+ * an in-place radix sort. The key is read from the given offset in the entry,
+ * and has to be 1, 2, 4 or 8 bytes wide. No compare-function is needed, so
+ * this is a lot faster than paSortList() for integer-keys.
  *
- * The dictionary-buffer looks like this:
+ * Example on how to sort elements by the parent-index:
+ * ...
+ * paSortListKey(&lst, offsetof(struct pa_element, parent), 2, 1);
+ * ...
  *
- *   ... <next><hash><key><value> <next><hash><key><value> ...
+ * @lst: Pointer to the list
+ * @off: The offset of the key in the entry in bytes
+ * @size: The size of the key in bytes
+ * @sign: 1 if the key is a signed integer and 0 if not
  *
- * The next-value is a short, the hash is an unsigned short, the key is defined
- * via PA_DICT_KEY_SIZE and the value-size is set during initialization.
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSortListKey(struct pa_list *lst, s16 off, s16 size, s8 sign);
+
+/*
+ * Find the first entry in the sorted list, which does not come before the key.
  *
- * To mark a entry-slot as not-used the next is set to -1. To identify the
- * end of the bucket, the next is set to -(bucket_number + 2).
+ * @lst: Pointer to the sorted list
+ * @key: Pointer to an entry to compare against
+ * @cmp: The compare-function
  *
- * To search for an entry in the dictionary, we again hash the key, determine
- * the right bucket and then jump from entry to entry to find the right one like
- * in a linked list.
+ * Returns: The index of the entry or the number of entries if all entries
+ *          come before the key
  */
+PA_API s16 paLowerBoundList(struct pa_list *lst, void *key,
+                pa_list_compare cmp);
 
-#define PA_DICT_NEXT_SIZE 2
-#define PA_DICT_HASH_SIZE 2
-#define PA_DICT_KEY_SIZE  32
-#define PA_DICT_HEAD_SIZE (PA_DICT_NEXT_SIZE+PA_DICT_HASH_SIZE+PA_DICT_KEY_SIZE)
-#define PA_DICT_BUCKETS   8
-
-struct pa_dictionary {
-        struct pa_memory *memory;
-        enum pa_memory_mode mode;
+/*
+ * Find the first entry in the sorted list, which comes after the key.
+ *
+ * @lst: Pointer to the sorted list
+ * @key: Pointer to an entry to compare against
+ * @cmp: The compare-function
+ *
+ * Returns: The index of the entry or the number of entries if no entry comes
+ *          after the key
+ */
+PA_API s16 paUpperBoundList(struct pa_list *lst, void *key,
+                pa_list_compare cmp);
 
-        s32 value_size; /* The size of the value-part in bytes */
-        s32 entry_size; /* The size of the header and value */
+/*
+ * Insert an entry into the sorted list, so the list stays sorted. The entry
+ * will be inserted after all equal entries.
+ *
+ * @lst: Pointer to the sorted list
+ * @src: Pointer to the entry to insert
+ * @cmp: The compare-function
+ *
+ * Returns: The index of the new entry or -1 if an error occurred
+ */
+PA_API s16 paInsertListSorted(struct pa_list *lst, void *src,
+                pa_list_compare cmp);
 
-        s16 number;   /* Number of active entries in the dictionary */
-        s16 alloc;    /* Number of slots of entries in the dictionary */  
-        u8 *buffer;   /* Memory-buffer to store the entries */
+/*
+ * Merge two sorted lists and append the result to the destination-list. All
+ * three lists need to have the same entry-size and the destination-list has to
+ * be a different list than the sources. If the destination-list is configured
+ * as static, only as many entries are written as fit into the list.
+ *
+ * @dst: Pointer to the destination-list
+ * @a: Pointer to the first sorted list
+ * @b: Pointer to the second sorted list
+ * @cmp: The compare-function
+ *
+ * Returns: The number of entries written or -1 if an error occurred
+ */
+PA_API s16 paMergeList(struct pa_list *dst, struct pa_list *a,
+                struct pa_list *b, pa_list_compare cmp);
 
-        /* 
-         * All buckets containing the index for their first entry in the
-         * dictionary-buffer.
-         */
-        s16 buckets[PA_DICT_BUCKETS];
-};
+/*
+ * Find the first entry equal to the key, starting from the given index. For
+ * entries with a size of 1, 2, 4 or 8 bytes, SIMD-instructions are used if
+ * available. All other entries are compared byte by byte.
+ *
+ * @lst: Pointer to the list
+ * @key: Pointer to an entry to look for
+ * @start: The index to start searching from
+ *
+ * Returns: The index of the first matching entry or -1 if there is none
+ */
+PA_API s16 paFindList(struct pa_list *lst, void *key, s16 start);
 
-struct pa_dictionary_entry {
-        char key[PA_DICT_KEY_SIZE];
-        void *value;
-};
+/*
+ * Find all entries equal to the key and push their indices as shorts to the
+ * output-list.
+ *
+ * @lst: Pointer to the list
+ * @key: Pointer to an entry to look for
+ * @out: Pointer to a list with an entry-size of 2 bytes
+ *
+ * Returns: The number of matching entries or -1 if an error occurred
+ */
+PA_API s16 paFindListAll(struct pa_list *lst, void *key, struct pa_list *out);
 
 /*
- * Initialize the dictionary, link to the memory-manager and preallocate the
- * specified number of entries.
+ * Count all entries in the list equal to the key.
  *
- * @dct: Pointer to the dictionary
- * @mem: Pointer to the memory-manager
- * @size: The size of the value-part in bytes
- * @alloc: The number of entries to preallocate
+ * @lst: Pointer to the list
+ * @key: Pointer to an entry to look for
  *
- * Returns: 0 on success or -1 if an error occurred
+ * Returns: The number of matching entries
  */
-PA_API s8 paInitDictionary(struct pa_dictionary *dct, struct pa_memory *mem,
-                s32 size, s16 alloc);
+PA_API s16 paCountList(struct pa_list *lst, void *key);
 
 /*
- * Initialize the dictionary using static memory, and prepare the
- * dictionary-buffer.
+ * Set a range of entries to the given value. If the range reaches past the end
+ * of the list, the list will grow to fit the range, if configured as dynamic.
  *
- * @dic: Pointer to the dictionary
- * @buffer: The buffer to use to store the entries
- * @buf_sz: The size of the buffer in bytes
- * @value_sz: The size of the value-part in bytes
+ * @lst: Pointer to the list
+ * @src: Pointer to the value to write to every entry
+ * @start: The index of the first entry
+ * @num: The number of entries to set, use PA_ALL to fill all entries from
+ *       start to the end of the list
  *
- * Returns: 0 on success or -1 if an error occurred
+ * Returns: The number of entries set or -1 if an error occurred
  */
-PA_API s8 paInitDictionaryFixed(struct pa_dictionary *dct, void *buffer,
-                s32 buf_sz, s32 value_sz);
+PA_API s16 paFillList(struct pa_list *lst, void *src, s16 start, s16 num);
 
 /*
- * Destroy the dictionary, reset all attributes and if configured as dynamic,
- * free the allocated memory.
+ * Find the smallest and the biggest entry in a list of numbers. Integers can
+ * be 1, 2, 4 or 8 bytes wide, floats 4 or 8 bytes.
  *
- * @dct: Pointer to the dictionary
+ * @lst: Pointer to the list
+ * @type: The type of the numbers in the list
+ * @[min]: A pointer to write the smallest entry to
+ * @[max]: A pointer to write the biggest entry to
+ *
+ * Returns: 0 on success or -1 if the list is empty or the entry-size is not
+ *          supported
  */
-PA_API void paDestroyDictionary(struct pa_dictionary *dct);
+PA_API s8 paMinMaxList(struct pa_list *lst, enum pa_number_type type,
+                void *min, void *max);
 
 /*
- * Set a key-value-pair in the dictionary. If the key already exists then
- * overwrite it. If it does not yet exist, create it. This function will copy
- * over the memory into the buffer.
+ * -----------------------------------------------------------------------------
  *
- * @dct: Pointer to the dictionary
- * @key: Pointer to the key
- * @value: Pointer to the value
+ *      SMALL-LIST
  *
- * Returns: Either 0 on success or -1 if an error occurred
+ * The small-list is a list with an inline buffer of PA_SMALL_LIST_SIZE bytes
+ * embedded into the struct. As long as the entries fit into the inline buffer,
+ * no memory will be allocated. Only once the inline buffer overflows, the
+ * entries are moved to memory allocated from the memory-manager and the list
+ * behaves like a normal dynamic list.
+ *
+ * The wrapped list can be passed to all list-functions which don't add entries,
+ * like paIterateList(), paPeekList() or paSortList(). Use the small-list
+ * functions to add entries, so the list can spill to the heap.
+ *
+ * As the list points into its own struct, a small-list must not be copied or
+ * moved after initialization!
  */
-PA_API s8 paSetDictionary(struct pa_dictionary *dct, char *key, void *value);
+
+#ifndef PA_SMALL_LIST_SIZE
+#define PA_SMALL_LIST_SIZE      64
+#endif
+
+struct pa_small_list {
+        struct pa_list list;            /* The wrapped list */
+        struct pa_memory *spill;        /* Memory-manager used on overflow */
+
+        /* The inline buffer, aligned by the union */
+        union {
+                u8      bytes[PA_SMALL_LIST_SIZE];
+                f64     align_f64;
+                void    *align_ptr;
+                s64     align_s64;
+        } inline_buffer;
+};
 
 /*
- * Retrieve an entry from the dictionary by searching for the key. To do so, the
- * key will be hashed and the proper bucket determined. Then the function will
- * go through all entries in the bucked until the requested entry is found.
+ * Initialize the small-list on top of the inline buffer. No memory will be
+ * allocated. If no memory-manager is given, the list will never spill and just
+ * stop accepting entries once the inline buffer is full.
  *
- * @dct: Pointer to the dictionary
- * @key: Pointer to the key to look for
- * @dst: A pointer to write the entry for the key to
+ * @lst: Pointer to the small-list
+ * @[mem]: Pointer to the memory-manager used once the inline buffer overflows
+ * @size: The size of a single entry in bytes
  *
- * Returns: 1 if the entry has been found, 0 if not and -1 if an error occurred
+ * Returns: 0 on success or -1 if an error occurred
  */
-PA_API s8 paGetDictionary(struct pa_dictionary *dct, char *key, void *out);
+PA_API s8 paInitSmallList(struct pa_small_list *lst, struct pa_memory *mem,
+                s16 size);
 
 /*
- * Remove an entry from the dictionary and open up the slot. The memory in the
- * entry will be lost!
+ * Destroy the small-list and free the memory, if the list has spilled.
  *
- * @dct: Pointer to the dictionary
- * @key: The key of the entry
+ * @lst: Pointer to the small-list
  */
-PA_API void paRemoveDictionary(struct pa_dictionary *dct, char *key);
+PA_API void paDestroySmallList(struct pa_small_list *lst);
 
 /*
- * This function allows the iteration of every entry in every bucket. The basic
- * principal is passing a pointer to the current entry and getting the
- * entry-data and pointer for the next entry. Note that this function goes from
- * bucket to bucket, so it will not return the entries in respect to when they
- * have been added.
+ * Remove all entries from the small-list. If the list has spilled, the
+ * allocated memory will be kept.
  *
- * Here's an example of how to use the function:
- * ...
- * struct pa_dictionary dict;
- * struct pa_dictionary_entry ent;
- * void *ptr = NULL;
- * ...
- * while((ptr = paIterateDictionary(&dict, ptr, &ent))) {
- *      ..Do something with the entry...
- * }
- * ...
+ * @lst: Pointer to the small-list
+ */
+PA_API void paClearSmallList(struct pa_small_list *lst);
+
+/*
+ * Append entries to the end of the small-list. Works like paPushList(), but
+ * the list will spill to the heap if the inline buffer is full.
  *
- * @dct: Pointer to the dictionary
- * @ptr: The runing pointer used to iterate(pass NULL at the start)
- * @ent: A pointer to write the entry data to
+ * @lst: Pointer to the small-list
+ * @src: Pointer to the data to write to the list
+ * @num: The number of entries to push to the list
  *
- * Returns: The pointer for the current entry in the dictionary-buffer or NULL
- *          if this is the last entry in the dictionary
+ * Returns: The number of entries written to the list or -1 if an error occurred
  */
-PA_API void *paIterateDictionary(struct pa_dictionary *dct, void *ptr, 
-                struct pa_dictionary_entry *ent);
+PA_API s16 paPushSmallList(struct pa_small_list *lst, void *src, s16 num);
 
 /*
- * Iterate through all entries in a bucket.
+ * Pop entries from the end of the small-list. Works like paPopList().
  *
- * Here's an example of how to use the function to iterate through bucket 2:
- * ...
- * struct pa_dictionary dict;
- * struct pa_dictionary_entry ent;
- * void *ptr = NULL;
- * ...
- * while((ptr = paIterateDictionaryBucket(&dict, 2, ptr, &ent))) {
- *      ..Do something with the entry...
- * }
- * ...
+ * @lst: Pointer to the small-list
+ * @dst: A pointer to write the entries to
+ * @num: The number of entries to pop from the list
  *
- * @dct: Pointer to the dictionary
- * @bucket: The bucket to iterate through
- * @ptr: The running pointer used to iterate(pass NULL at start)
- * @ent: A pointer to write the entry data to
+ * Returns: The number of entries popped from the list or -1 if an error
+ *          occurred
+ */
+PA_API s16 paPopSmallList(struct pa_small_list *lst, void *dst, s16 num);
+
+/*
+ * Insert entries into the small-list at a certain position. Works like
+ * paInsertList(), but the list will spill to the heap if the inline buffer is
+ * full.
  *
- * Returns: The pointer for the current entry in the dictionary-buffer or NULL
- *          if this is the last entry in the bucket
+ * @lst: Pointer to the small-list
+ * @src: Pointer to copy the entries from
+ * @start: The starting index to insert the entries to
+ * @num: The number of entries to insert
+ *
+ * Returns: The number of entries written to the list or -1 if an error occurred
  */
-PA_API void *paIterateDictionaryBucket(struct pa_dictionary *dct, s16 bucket,
-                void *ptr, struct pa_dictionary_entry *ent);
+PA_API s16 paInsertSmallList(struct pa_small_list *lst, void *src, s16 start,
+                s16 num);
 
 /*
- * -----------------------------------------------------------------------------
+ * Get a pointer to the next entry in the small-list. Works like
+ * paIterateList().
  *
- *      TABLE
+ * @lst: Pointer to the small-list
+ * @ptr: The current pointer, pass NULL for the first step
  *
- * When pushing a new key-value-pair into the table, the key is hashed and
- * the new entry consisting of the key and value memory is pushed with a next
- * value into the table-buffer. The entry will then be put into one of the
- * buckets depending on the hash and attached to the last entry in the bucket by
- * updating it's next value.
+ * Returns: A pointer to the next entry or NULL if there are no more entries
+ */
+PA_API void *paIterateSmallList(struct pa_small_list *lst, void *ptr);
+
+/*
+ * -----------------------------------------------------------------------------
  *
- * The table-buffer looks like this:
+ *      COLUMN-LIST
  *
- *   ... <next><hash><key><value> <next><hash><key><value> ...
+ * The column-list stores every field of an entry in its own column instead of
+ * storing whole entries one after another(structure of arrays). Iterating over
+ * a single field then only touches the memory of that field. All columns share
+ * the same count and capacity and live in a single memory-buffer:
  *
- * The next-value is a short, the hash is an unsigned short, the key and the 
- * value-size is set during initialization.
+ *   <column 0: field 0 of all rows> <column 1: field 1 of all rows> ...
  *
- * To mark a entry-slot as not-used the next is set to -1. To identify the
- * end of the bucket, the next is set to -(bucket_number + 2).
+ * Every column starts at an address aligned to PA_COLUMN_ALIGN bytes, so
+ * the columns can be processed using SIMD-instructions.
  *
- * To search for an entry in the dictionary, we again hash the key, determine
- * the right bucket and then jump from entry to entry to find the right one like
- * in a linked list.
+ * Rows are passed in and out as packed rows, where the fields are written
+ * one after another in the order of the columns without any padding.
  */
 
+#define PA_COLUMNS_MAX          16
+#define PA_COLUMN_ALIGN         16
 
-#define PA_TBL_NEXT_SIZE 2
-#define PA_TBL_HASH_SIZE 2
-#define PA_TBL_HEAD_SIZE (PA_TBL_NEXT_SIZE+PA_TBL_HASH_SIZE)
-#define PA_TBL_BUCKETS   8
-
-struct pa_table {
+struct pa_column_list {
         struct pa_memory *memory;
         enum pa_memory_mode mode;
 
-        s32 key_size;   /* The size of the key in bytes */
-        s32 value_size; /* The size of the value-part in bytes */
-        s32 entry_size; /* The size of the header, key and value in bytes */
-
-        s16 number;   /* Number of active entries in the table */
-        s16 alloc;    /* Number of slots of entries in the table */  
-        u8 *buffer;   /* Memory-buffer to store the entries */
+        u8 *buffer;     /* The buffer containing all columns */
+        s32 buffer_size;/* The size of the buffer in bytes */
 
-        /* 
-         * All buckets containing the index for their first entry in the
-         * table-buffer.
-         */
-        s16 buckets[PA_TBL_BUCKETS];
-};
+        s16 columns;                    /* The number of columns */
+        s16 sizes[PA_COLUMNS_MAX];      /* The size of a field in bytes */
+        u8 *data[PA_COLUMNS_MAX];       /* Pointers to the columns */
+        s16 row_size;   /* The size of a packed row in bytes */
 
-struct pa_table_entry {
-        void *key;
-        void *value;
+        s16 count;  /* Number of used rows */
+        s16 alloc;  /* Number of allocated rows */
 };
 
 /*
- * Initialize the table, link to the memory-manager and preallocate the
- * specified number of entries.
+ * Initialize the column-list and preallocate the requested number of rows.
+ * The list will scale to fit all new rows. After use call
+ * paDestroyColumnList() to prevent memory leaks.
  *
- * @tbl: Pointer to the table
+ * Example on how to store the parent and the name of elements:
+ * ...
+ * struct pa_column_list lst;
+ * s16 sizes[2] = {sizeof(s16), PA_ELEMENT_NAME_MAX};
+ * paInitColumnList(&lst, &mem, sizes, 2, 128);
+ * ...
+ *
+ * @lst: Pointer to the column-list
  * @mem: Pointer to the memory-manager
- * @key_sz: The size of the key in bytes
- * @value_sz: The size of the value in bytes
- * @alloc: The number of entries to preallocate
+ * @sizes: The size of the field in every column in bytes
+ * @columns: The number of columns
+ * @alloc: The initial number of rows to preallocate
  *
  * Returns: 0 on success or -1 if an error occurred
  */
-PA_API s8 paInitTable(struct pa_table *tbl, struct pa_memory *mem,
-                s32 key_sz, s32 value_sz, s16 alloc);
+PA_API s8 paInitColumnList(struct pa_column_list *lst, struct pa_memory *mem,
+                s16 *sizes, s16 columns, s16 alloc);
 
 /*
- * Initialize the table using static memory, and prepare the
- * table-buffer.
- *
- * @dic: Pointer to the table
- * @buffer: The buffer to use to store the entries
- * @buf_sz: The size of the buffer in bytes
- * @value_sz: The size of the value-part in bytes
+ * Create a static column-list on top of the given buffer. The number of rows
+ * is calculated from the size of the buffer.
+ * After use call paDestroyColumnList() and then free the memory yourself.
+ *
+ * @lst: Pointer to the column-list
+ * @sizes: The size of the field in every column in bytes
+ * @columns: The number of columns
+ * @buf: The buffer to store the columns in
+ * @buf_sz: The size of the given buffer in bytes
  *
  * Returns: 0 on success or -1 if an error occurred
  */
-PA_API s8 paInitTableFixed(struct pa_table *tbl, void *buffer,
-                s32 buf_sz, s32 key_sz, s32 value_sz);
+PA_API s8 paInitColumnListFixed(struct pa_column_list *lst, s16 *sizes,
+                s16 columns, void *buf, s32 buf_sz);
 
 /*
- * Destroy the table, reset all attributes and if configured as dynamic,
- * free the allocated memory.
+ * Destroy the column-list and free the allocated memory.
  *
- * @tbl: Pointer to the table
+ * @lst: Pointer to the column-list
  */
-PA_API void paDestroyTable(struct pa_table *tbl);
+PA_API void paDestroyColumnList(struct pa_column_list *lst);
 
 /*
- * Set a key-value-pair in the table. If the key already exists then
- * overwrite it. If it does not yet exist, create it. This function will copy
- * over the memory into the buffer.
- *
- * @tbl: Pointer to the table
- * @key: Pointer to the key
- * @value: Pointer to the value
+ * Remove all rows from the column-list. This will not free memory.
  *
- * Returns: Either 0 on success or -1 if an error occurred
+ * @lst: Pointer to the column-list
  */
-PA_API s8 paSetTable(struct pa_table *tbl, void *key, void *value);
+PA_API void paClearColumnList(struct pa_column_list *lst);
 
 /*
- * Retrieve an entry from the table by searching for the key. To do so, the
- * key will be hashed and the proper bucket determined. Then the function will
- * go through all entries in the bucked until the requested entry is found.
+ * Append a packed row to the end of the column-list. If the list is configured
+ * as dynamic, it will scale to fit the new row. Note that this will move the
+ * columns, so pointers from paGetColumn() become invalid.
  *
- * @tbl: Pointer to the table
- * @key: Pointer to the buffer containing the key
- * @dst: A pointer to write the entry for the key to
+ * @lst: Pointer to the column-list
+ * @src: Pointer to the packed row
  *
- * Returns: 1 if the entry has been found, 0 if not and -1 if an error occurred
+ * Returns: 1 if the row has been written and 0 if the list is full
  */
-PA_API s8 paGetTable(struct pa_table *tbl, void *key, void *out);
+PA_API s8 paPushColumnList(struct pa_column_list *lst, void *src);
 
 /*
- * Remove an entry from the table and open up the slot. The memory in the
- * entry will be lost!
+ * Pop the last row from the column-list and write it to the given pointer as
+ * a packed row.
  *
- * @tbl: Pointer to the table
- * @key: Pointer to a buffer containing the key
+ * @lst: Pointer to the column-list
+ * @[dst]: A pointer to write the packed row to
+ *
+ * Returns: 1 if a row has been popped and 0 if the list is empty
  */
-PA_API void paRemoveTable(struct pa_table *tbl, void *key);
+PA_API s8 paPopColumnList(struct pa_column_list *lst, void *dst);
 
 /*
- * This function allows the iteration of every entry in every bucket. The basic
- * principal is passing a pointer to the current entry and getting the
- * entry-data and pointer for the next entry. Note that this function goes from
- * bucket to bucket, so it will not return the entries in respect to when they
- * have been added.
- *
- * Here's an example of how to use the function:
- * ...
- * struct pa_table tbl;
- * struct pa_table_entry ent;
- * void *ptr = NULL;
- * ...
- * while((ptr = paIterateTable(&tbl, ptr, &ent))) {
- *      ..Do something with the entry...
- * }
- * ...
+ * Remove a row from the column-list by moving the last row into the gap. This
+ * is O(1) but it will change the order of the rows.
  *
- * @tbl: Pointer to the table
- * @ptr: The runing pointer used to iterate(pass NULL at the start)
- * @ent: A pointer to write the entry data to
+ * @lst: Pointer to the column-list
+ * @idx: The index of the row to remove
+ * @[dst]: A pointer to write the packed row to
  *
- * Returns: The pointer for the current entry in the table-buffer or NULL
- *          if this is the last entry in the table
+ * Returns: 1 if the row has been removed and 0 if the index is out of range
  */
-PA_API void *paIterateTable(struct pa_table *tbl, void *ptr, 
-                struct pa_table_entry *ent);
+PA_API s8 paRemoveColumnList(struct pa_column_list *lst, s16 idx, void *dst);
 
 /*
- * Iterate through all entries in a bucket.
- *
- * Here's an example of how to use the function to iterate through bucket 2:
- * ...
- * struct pa_table tbl;
- * struct pa_table_entry ent;
- * void *ptr = NULL;
- * ...
- * while((ptr = paIterateTableBucket(&tbl, 2, ptr, &ent))) {
- *      ..Do something with the entry...
- * }
- * ...
+ * Copy a whole row from the column-list without removing it.
  *
- * @tbl: Pointer to the table
- * @bucket: The bucket to iterate through
- * @ptr: The running pointer used to iterate(pass NULL at start)
- * @ent: A pointer to write the entry data to
+ * @lst: Pointer to the column-list
+ * @dst: A pointer to write the packed row to
+ * @idx: The index of the row
  *
- * Returns: The pointer for the current entry in the table-buffer or NULL
- *          if this is the last entry in the bucket
+ * Returns: 1 if the row has been copied and 0 if the index is out of range
  */
-PA_API void *paIterateTableBucket(struct pa_table *tbl, s16 bucket,
-                void *ptr, struct pa_table_entry *ent);
+PA_API s8 paPeekColumnList(struct pa_column_list *lst, void *dst, s16 idx);
 
 /*
- * -----------------------------------------------------------------------------
+ * Overwrite a whole row in the column-list.
  *
- *      FLEX
+ * @lst: Pointer to the column-list
+ * @src: Pointer to the packed row
+ * @idx: The index of the row
  *
- * The flex-helper is used to parse mathematical expressions for size like for
- * example "3px * 4 - 5em" and create flex-terms. A single parser is needed to
- * parse and process any amount of terms as it's just used for providing the
- * necessary resources for parsing and processing. A single flex-term is just a
- * container for an instance of a size-expression.
+ * Returns: 1 if the row has been written and 0 if the index is out of range
  */
-
-#define PA_FLX_READ_BUFFER_SIZE        64
+PA_API s8 paWriteColumnList(struct pa_column_list *lst, void *src, s16 idx);
 
 /*
- * ----  CODE-TABLE  ----
+ * Get a pointer to the beginning of a column. The fields of all rows are
+ * stored one after another, so the column can be used like an array. The
+ * pointer is valid until the list scales to fit new rows.
  *
- * OPERATOR
- * 	
- * 	0x01	(	
- * 	0x02	)
- * 	0x03	*
- * 	0x04	+
- * 	0x05	-
- * 	0x06	/
+ * @lst: Pointer to the column-list
+ * @col: The index of the column
  *
- * OPERAND
+ * Returns: A pointer to the column or NULL if the column doesn't exist
+ */
+PA_API void *paGetColumn(struct pa_column_list *lst, s16 col);
+
+/*
+ * -----------------------------------------------------------------------------
  *
- * 	0x11    const	     12	  Constant value
- * 	0x12	PIXEL	    9px	  Pixel value, works like const
- * 	0x13	PERCENT	  10pct	  Pct. used to scale with size value
- * 	0x14	EM	    4em	  Faktor multp. with text size
+ *      WORKER-POOL
  *
- * ----------------------
+ * The worker-pool is used to call a callback-function on the entries of a list
+ * in parallel. The list is split into one range per thread and every thread
+ * processes its range in pieces of grain entries. Once a thread is done with
+ * its own range, it steals the back half of the biggest range left, so uneven
+ * callbacks are balanced out. Every entry is passed to exactly one call.
+ *
+ * Threads are only used if the framework is compiled with PA_PTHREADS defined
+ * and linked against pthreads. Otherwise the pool has no threads and all
+ * functions will just work serially.
  */
-struct pa_flex_token {
-        u8                      code;
-        f32                     value;
-};
 
-struct pa_flex_helper {
-        struct pa_list          tokens;
-        struct pa_list          swap;
-        struct pa_list          values;
-};
+#define PA_WORKER_GRAIN         64
 
-struct pa_flex {
-        struct pa_flex_helper   *helper;
-        struct pa_list          tokens;
-};
+struct pa_worker_pool {
+        struct pa_memory *memory;
 
-struct pa_flex_reference {
-        s32 relative;      /* Width/Height of the reference */
-        s32 font;          /* Font-Size */
+        s16 number;     /* The number of worker threads */
+        s32 grain;      /* The number of entries to process in one piece */
+
+        void *state;    /* Internal state shared with the threads */
 };
 
 /*
- * Initialize a flex-helper using the dynamic funcitionalities of the
- * framework and preallocate the requeste number of tokens.
+ * Initialize the worker-pool and start the requested number of threads. The
+ * calling thread will also take part in the work, so for N cores request N-1
+ * threads.
  *
- * @hlp: Pointer to the flex-helper
+ * @pool: Pointer to the worker-pool
  * @mem: Pointer to the memory-manager
- * @token: The initial number of token to preallocate
+ * @threads: The number of worker threads to start
  *
  * Returns: 0 on success or -1 if an error occurred
  */
-PA_API s8 paInitFlexHelper(struct pa_flex_helper *hlp, struct pa_memory *mem,
-                s16 tokens);
+PA_API s8 paInitWorkerPool(struct pa_worker_pool *pool, struct pa_memory *mem,
+                s16 threads);
 
 /*
- * Initialize a flex-helper using a static buffer. The flex-helper will then
- * calculate the maximum number of tokens that can be stored in the given
- * buffer. Any attempt to push tokens into the flex-helper when it has already
- * reached its limit will be ignored. Usually the token- and swap-buffers should
- * be the same size!
- *
- * @hlp: Pointer to the flex-helper
- * @tok_buf: Pointer to the buffer to use for storing tokens
- * @tok_buf_sz: The size of the given buffer
- * @swp_buf: The swap-buffer used when parsing the input-string
- * @swp_buf_sz: The size of the swap-buffer in bytes
- * @val_buf: The value-buffer used when processing a flex-term
- * @val_buf_sz: The size of the value-buffer in bytes
+ * Stop all threads and free the allocated memory.
  *
- * Returns: 0 on success or -1 if an error occurred
+ * @pool: Pointer to the worker-pool
  */
-PA_API s8 paInitFlexHelperFixed(struct pa_flex_helper *hlp, 
-                void *tok_buf, s32 tok_buf_sz, 
-                void *swp_buf, s32 swp_buf_sz, 
-                void *val_buf, s32 val_buf_sz);
+PA_API void paDestroyWorkerPool(struct pa_worker_pool *pool);
 
 /*
- * Destroy a flex-helper, reset all attributes and, if configured as dynamic,
- * free. the allocated memory. Use this function after use, even if the
- * flex-helper is configured as static.
+ * Call a callback-function on every entry in the list using all threads of the
+ * worker-pool. The order of the calls is undefined and calls happen at the same
+ * time, so the callback-function must only modify the entry it's given. If the
+ * callback-function returns 1, no new pieces will be started, but pieces
+ * already in progress are finished. Otherwise the callback-function should
+ * always return 0. The function returns once all calls are done.
  *
- * @hlp: Pointer to the flex-helper
+ * @lst: Pointer to the list
+ * @pool: Pointer to the worker-pool
+ * @fnc: The callback function
+ * @pass: A pointer that will be passed onto every function-call
  */
-PA_API void paDestroyFlexHelper(struct pa_flex_helper *hlp);
+PA_API void paApplyListParallel(struct pa_list *lst,
+                struct pa_worker_pool *pool, pa_list_func fnc, void *pass);
 
 /*
- * Clear all contents of a flex-helper and reset all internal lists. Everything
- * in the flex-helper will be lost!
+ * -----------------------------------------------------------------------------
  *
- * @hlp: Pointer to the flex-helper
+ *      CHUNK-LIST
+ *
+ * The chunk-list stores its entries in fixed-size chunks instead of a single
+ * buffer. If more memory is needed, a new chunk is appended, so the existing
+ * entries never have to be moved and pointers to them stay valid until they're
+ * removed from the list.
+ *
+ * The pointers to the chunks are kept in a list:
+ *
+ *   chunks: <chunk 0><chunk 1><chunk 2>...
+ *
+ * Every chunk holds the same number of entries. The entry with the index i
+ * therefore lives in chunk (i / chunk_entries) at slot (i % chunk_entries).
+ * Chunks are never freed when removing entries, they're reused instead.
  */
-PA_API void paClearFlexHelper(struct pa_flex_helper *hlp);
+
+struct pa_chunk_list {
+        struct pa_memory *memory;
+        enum pa_memory_mode mode;
+
+        struct pa_list chunks;  /* Pointers to all allocated chunks */
+
+        s16 entry_size;    /* The size of a slot in bytes */
+        s16 chunk_entries; /* The number of slots in a single chunk */
+
+        s16 count;         /* Number of used slots */
+};
 
 /*
- * Dynamically initialize an expression into the flex-term using the
- * flex-helper. The requested number of token slots will be allocated during
- * initialization and if necessary the flex-term will scale to fit new tokens
- * beyond its original limits.
+ * Initialize the chunk-list and preallocate enough chunks to fit the requested
+ * number of entries. The list will append new chunks to fit all new entries.
+ * After use call paDestroyChunkList() to prevent memory leaks.
  *
- * @flx: Pointer to the flex-term
- * @hlp: Pointer to the flex-helper using for parsing and processing
+ * @lst: Pointer to the chunk-list
  * @mem: Pointer to the memory-manager
- * @tokens: The number of token-slots to preallocate during initialization
+ * @size: The size of a single entry in bytes
+ * @chunk: The number of entries in a single chunk
+ * @alloc: The initial number of entries to preallocate
  *
  * Returns: 0 on success or -1 if an error occurred
  */
-PA_API s8 paInitFlex(struct pa_flex *flx, struct pa_flex_helper *hlp,
-                struct pa_memory *mem, s16 tokens);
+PA_API s8 paInitChunkList(struct pa_chunk_list *lst, struct pa_memory *mem,
+                s16 size, s16 chunk, s16 alloc);
 
 /*
- * Statically create a flex-term on top of the given memory buffer. The maximum
- * number of tokens is calculated from the size of the given buffer. If the
- * limit has been reached, all new incoming tokens will be ignored.
+ * Create a static chunk-list on top of the given buffer. The buffer will be
+ * split up into as many chunks as fit, and no more chunks will be added once
+ * all of them are full.
+ * After use call paDestroyChunkList() and then free the memory yourself.
  *
- * @flx: Pointer to the flex-term
- * @hlp: Pointer to the flex-helper using for parsing and processing
- * @tok_buf: The token-buffer to store the tokens in
- * @tok_buf_sz: The size of the token-buffer in bytes
+ * @lst: Pointer to the chunk-list
+ * @size: The size of a single entry in bytes
+ * @chunk: The number of entries in a single chunk
+ * @buf: The buffer to store the chunks in
+ * @buf_sz: The size of the given buffer in bytes
  *
  * Returns: 0 on success or -1 if an error occurred
  */
-PA_API s8 paInitFlexFixed(struct pa_flex *flx, struct pa_flex_helper *hlp,
-                void *tok_buf, s32 tok_buf_sz);
+PA_API s8 paInitChunkListFixed(struct pa_chunk_list *lst, s16 size, s16 chunk,
+                void *buf, s32 buf_sz);
 
 /*
- * Destroy a flex-term and if allocated dynamically free the allocated memory.
- * Call this function even if the flex-term has been created with static memory,
- * but don't forget to free the provided buffer yourself.
+ * Destroy the chunk-list and free all allocated chunks.
  *
- * @flx: Pointer to the flex-term
+ * @lst: Pointer to the chunk-list
  */
-PA_API void paDestroyFlex(struct pa_flex *flx);
+PA_API void paDestroyChunkList(struct pa_chunk_list *lst);
 
 /*
- * Clear the internal memory of the flex-term without freeing it. This will lose
- * all data contained in the flex-term, so use with caution.
+ * Remove all entries from the chunk-list. The chunks will be kept for reuse.
  *
- * @flx: Pointer to the flex-term
+ * @lst: Pointer to the chunk-list
  */
-PA_API void paClearFlex(struct pa_flex *flx);
+PA_API void paClearChunkList(struct pa_chunk_list *lst);
 
 /*
- * IMPORTANT: Using this function will overwrite everything already in the
- * flex-term! Also check that both the parser and the term have both already
- * been initialized!
- *
- *
- * Parse an input-term by first tokenizing the input and then converting it to
- * postfix-notation using Dijkstra's shunting yard algortihm.
- * If the flex-handler is configured as static, the function will only write as
- * many tokens to the flex-handler, as the limit allows. If the flex-handler is
- * configured as dynamic, the token-list will be scaled according the the
- * incoming number of tokens.
+ * Append entries to the end of the chunk-list. If the list is configured as
+ * dynamic, new chunks will be allocated to fit all entries. The entries already
+ * in the list will not be moved.
  *
- * @hlp: Pointer to the the flex-helper
- * @str: A null-terminated string containing the size-expression
- * @flx: Pointer to the flex-term to parse into
+ * @lst: Pointer to the chunk-list
+ * @src: Pointer to the data to write to the list
+ * @num: The number of entries to push to the list
  *
- * Returns: The number of written tokens or -1 if an error occurred
+ * Returns: The number of entries written to the list or -1 if an error occurred
  */
-PA_API s16 paParseFlex(struct pa_flex *flx, char *str);
+PA_API s16 paPushChunkList(struct pa_chunk_list *lst, void *src, s16 num);
 
 /*
- * Process the flex-term using the given set of references.
+ * Pop entries from the end of the chunk-list and write them to the given
+ * pointer.
  *
- * @flx: Pointer to the flex
- * @ref: Pointer to the set of references
+ * @lst: Pointer to the chunk-list
+ * @dst: A pointer to write the entries to
+ * @num: The number of entries to pop from the list
  *
- * Returns: The resulting value of the expression
+ * Returns: The number of entries popped from the list or -1 if an error
+ *          occurred
  */
-PA_API s32 paProcessFlex(struct pa_flex *flx, struct pa_flex_reference *ref);
+PA_API s16 paPopChunkList(struct pa_chunk_list *lst, void *dst, s16 num);
 
-/* 
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+/*
+ * Get a pointer to the entry at the given index. The pointer stays valid until
+ * the entry is popped from the list.
  *
- *              RESOURCES
+ * @lst: Pointer to the chunk-list
+ * @idx: The index of the entry
  *
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
- */ 
+ * Returns: A pointer to the entry or NULL if the index is out of range
+ */
+PA_API void *paIndexChunkList(struct pa_chunk_list *lst, s16 idx);
 
 /*
- * Contains all resources for the patchy-instance like textures, fonts and
- * icons.
+ * Get a pointer to the beginning of a chunk and the number of used entries in
+ * it. The entries in a chunk are contiguous, so this can be used to process the
+ * list chunk by chunk.
+ *
+ * @lst: Pointer to the chunk-list
+ * @chunk: The number of the chunk
+ * @num: A pointer to write the number of used entries in the chunk to
+ *
+ * Returns: A pointer to the first entry in the chunk or NULL if the chunk is
+ *          empty
  */
-struct pa_context {
-        char placeholder;
-};
-
+PA_API void *paSpanChunkList(struct pa_chunk_list *lst, s16 chunk, s16 *num);
 
-/* 
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+/*
+ * Get a pointer to the next entry in the chunk-list. As the chunks are not
+ * contiguous, the handle is used to keep track of the position. Before the
+ * first step, set the pointer of the handle to NULL.
+ * Example on how to iterate through the whole list:
+ * ...
+ * struct pa_chunk_list lst;
+ * struct pa_handle hdl;
+ * void *ptr;
+ * ...
+ * hdl.pointer = NULL;
+ * while((ptr = paIterateChunkList(&lst, &hdl))) {
+ *      ..Do something with ptr..
+ * }
+ * ...
  *
- *              STYLE
+ * @lst: Pointer to the chunk-list
+ * @hdl: The handle used to keep track of the position
  *
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ * Returns: A pointer to the next entry or NULL if there are no more entries
  */
+PA_API void *paIterateChunkList(struct pa_chunk_list *lst,
+                struct pa_handle *hdl);
 
 /*
- * A single style-attribute.
+ * Call a callback-function on every entry in the chunk-list. If the
+ * callback-function returns 1 the loop will stop. Otherwise the
+ * callback-function should always return 0.
+ *
+ * @lst: Pointer to the chunk-list
+ * @fnc: The callback function
+ * @pass: A pointer that will be passed onto every function-call
  */
-struct pa_style_attribute { 
-        char placeholder; 
-};
-
+PA_API void paApplyChunkList(struct pa_chunk_list *lst, pa_list_func fnc,
+                void *pass);
 
 /*
- * 
+ * -----------------------------------------------------------------------------
+ *
+ *      SLOTMAP
+ *
+ * The slotmap hands out stable handles for entries, which stay valid no matter
+ * how many other entries are inserted or removed. The entries themselves are
+ * kept densely packed in a list, so iterating over them is as fast as for a
+ * normal list.
+ *
+ * Internally there are three lists:
+ *
+ *   data:  <entry><entry><entry>...          The dense entries
+ *   slots: <index><generation>...            One slot per handed out handle
+ *   owner: <slot><slot><slot>...             The slot for every dense entry
+ *
+ * A used slot contains the index of the entry in the data-list. A free slot
+ * contains the index of the next free slot, or -1 for the end of the
+ * free-list. The generation of a slot is incremented every time the slot is
+ * used or freed, so used slots have an odd generation and free slots an even
+ * one. Old handles to a slot can therefore be detected as stale.
+ *
+ * Entries are removed by moving the last entry into the gap, so removing is
+ * O(1), but pointers to the entries might change. Keep the handles instead!
  */
-struct pa_stylesheet {
-        char placeholder;
-};
 
+#define PA_SLOT_SIZE    4
 
-/*
- * 
- */
-struct pa_style {
-        char placeholder;
+struct pa_slot {
+        s16     index;          /* Index of the entry or next free slot */
+        u16     generation;     /* Incremented every time the slot is freed */
 };
 
-
-/*
- * A class is a bundle of different style-attributes applies to all elements
- * tagged with the class-name.
- */
-struct pa_class_style {
-        char placeholder;
+struct pa_slot_handle {
+        s16     index;          /* The index of the slot */
+        u16     generation;     /* The generation of the slot */
 };
 
-/*
- * The typeclass is a bundle of different style-attributes applied to all
- * elements with a given type.
- */
-struct pa_type_style {
-        char placeholder;
+struct pa_slotmap {
+        struct pa_list data;    /* The dense entries */
+        struct pa_list slots;   /* The slots referenced by handles */
+        struct pa_list owner;   /* The slot-index for every dense entry */
+
+        s16 free_head;  /* The first slot in the free-list or -1 */
 };
 
-/* 
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+/*
+ * Initialize the slotmap and preallocate the requested number of entries. The
+ * slotmap will scale to fit all new entries. After use call paDestroySlotMap()
+ * to prevent memory leaks.
  *
- *              EVENT
+ * @map: Pointer to the slotmap
+ * @mem: Pointer to the memory-manager
+ * @size: The size of a single entry in bytes
+ * @alloc: The initial number of entries to preallocate
  *
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ * Returns: 0 on success or -1 if an error occurred
  */
+PA_API s8 paInitSlotMap(struct pa_slotmap *map, struct pa_memory *mem,
+                s16 size, s16 alloc);
 
-/*  */
-struct pa_event {
-        char placeholder;
-};
-
-typedef s8 (*pa_event_callback)(struct pa_event evt, void *data);
-
-/*  */
-struct pa_event_handler {
-        char placeholder;
-};
-
-
-PA_API void paEventBegin(void);
-PA_API void paEventEnd(void);
-
-PA_API void paEventKey(void);
-PA_API void paEventMotion(void);
-PA_API void paEventButton(void);
-PA_API void paEventScroll(void);
-
-/* 
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+/*
+ * Create a static slotmap on top of the given buffer. The buffer will be split
+ * up between the entries, the slots and the owner-indices, so every entry
+ * needs (size + PA_SLOT_SIZE + 2) bytes.
+ * After use call paDestroySlotMap() and then free the memory yourself.
  *
- *              ELEMENT
+ * @map: Pointer to the slotmap
+ * @size: The size of a single entry in bytes
+ * @buf: The buffer to store the slotmap in
+ * @buf_sz: The size of the given buffer in bytes
  *
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ * Returns: 0 on success or -1 if an error occurred
  */
-
-#define PA_ELEMENT_NAME_MAX     128
+PA_API s8 paInitSlotMapFixed(struct pa_slotmap *map, s16 size, void *buf,
+                s32 buf_sz);
 
 /*
- * 
+ * Destroy the slotmap and free the allocated memory.
+ *
+ * @map: Pointer to the slotmap
  */
-struct pa_element {
-        /*  */
-        char    name[PA_ELEMENT_NAME_MAX];
-
-        /*  */
-        s16     parent;
-
-        /*  */
-        s16     sibling_next;
-
-        /*  */
-        s16     children_number;
-        s16     children_start;
-
-        /*  */
-        s16     broadsearch_next;
-
-        /*  */
-        s16     pipe_next;
-};
-
-
-#define PA_ELEMENT_TREE_MIN     128
+PA_API void paDestroySlotMap(struct pa_slotmap *map);
 
 /*
- * 
+ * Remove all entries from the slotmap. All handles given out so far will be
+ * invalid afterwards. This will not free memory.
+ *
+ * @map: Pointer to the slotmap
  */
-struct pa_element_tree {
-        /* A list containing all elements */
-        struct pa_list          elements;
-
-        /* The z-index pipeline to handle overlap */
-        s16                     pipe_start;
-};
-
+PA_API void paClearSlotMap(struct pa_slotmap *map);
 
-/* 
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+/*
+ * Copy a new entry into the slotmap and write the handle for it to the given
+ * pointer.
  *
- *              BATCHING
+ * @map: Pointer to the slotmap
+ * @src: Pointer to the data of the entry
+ * @[out]: A pointer to write the handle to
  *
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ * Returns: 0 on success or -1 if an error occurred
  */
+PA_API s8 paInsertSlotMap(struct pa_slotmap *map, void *src,
+                struct pa_slot_handle *out);
 
 /*
- * A patch is a representation of the final rendering instructions and contains
- * information about size, position and possible references to required
- * resources from the context.
+ * Remove the entry referenced by the handle and copy the data to the given
+ * pointer. The last entry will be moved into the gap.
+ *
+ * @map: Pointer to the slotmap
+ * @hdl: The handle of the entry
+ * @[dst]: A pointer to write the entry to
+ *
+ * Returns: 1 if the entry has been removed, 0 if the handle is stale and -1 if
+ *          an error occurred
  */
-struct pa_patch {
-        char placeholder;
-};
+PA_API s8 paRemoveSlotMap(struct pa_slotmap *map, struct pa_slot_handle hdl,
+                void *dst);
 
 /*
- * A batch contains multiple patches using the same material, ie. the same
- * transparency/opaquenes, same resources, same color, etc.
- */
-struct pa_batch {
-        char placeholder;
-};
-
-
-/* 
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ * Get a pointer to the entry referenced by the handle. The pointer is only
+ * valid until the next insert or remove, so don't store it.
  *
- *              DOCUMENT
+ * @map: Pointer to the slotmap
+ * @hdl: The handle of the entry
  *
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ * Returns: A pointer to the entry or NULL if the handle is stale
  */
+PA_API void *paLookupSlotMap(struct pa_slotmap *map, struct pa_slot_handle hdl);
 
 /*
- * General wrapper for a patchy-instance containing all necessary modules and
- * parts.
- * Use one per window.
+ * Get the handle of an entry from its index in the dense data-list. This is
+ * useful when iterating through the slotmap.
+ *
+ * @map: Pointer to the slotmap
+ * @idx: The index of the entry in the data-list
+ * @out: A pointer to write the handle to
+ *
+ * Returns: 0 on success or -1 if an error occurred
  */
-struct pa_document {
-        /*
-         * Memory manager to handle alloc, realloc, free, etc.
-         * For now it relies on the default allocation functions, but in the
-         * future it will be adapted to work with static memory and custom
-         * allocation functions.
-         */
-        struct pa_memory        memory;
-
-        struct pa_element_tree  element_tree; 
-};
+PA_API s8 paHandleSlotMap(struct pa_slotmap *map, s16 idx,
+                struct pa_slot_handle *out);
 
 /*
- * Initialize the document and prepare everything.
+ * Get a pointer to the next entry in the slotmap. The entries are stored
+ * densely, so this works the same way as paIterateList(). For the first step
+ * pass NULL for ptr.
  *
- * @doc: Pointer to the document
+ * @map: Pointer to the slotmap
+ * @ptr: The current pointer
  *
- * Returns: 0 on success or -1 if an error occurred
+ * Returns: A pointer to the next entry or NULL if there are no more entries
  */
-PA_API s8 paInit(struct pa_document *doc);
-
+PA_API void *paIterateSlotMap(struct pa_slotmap *map, void *ptr);
 
 /*
- * Shut everything down, free all allocated memory and cleanup.
+ * -----------------------------------------------------------------------------
  *
- * @doc: Pointer to the document
+ *      HEAP
+ *
+ * The heap is a binary min-heap used as priority-queue. The entry which comes
+ * first according to the compare-function is always on top. The nodes are
+ * stored in a list in the usual array-layout, so the children of the node i
+ * are at 2i+1 and 2i+2.
+ *
+ * Every node looks like this:
+ *
+ *   <entry><padding><slot>
+ *
+ * The node-size is rounded up to keep the entries aligned. Handles work the
+ * same way as for the slotmap: Every pushed entry gets a slot, which contains
+ * the current position of its node, so the key of an entry can be changed
+ * after it has been pushed. Free slots are chained into a free-list. The
+ * generation of a slot is incremented every time the slot is used or freed,
+ * so handles of entries which have already been popped or removed are
+ * detected as stale, even if the slot has been reused since.
  */
-PA_API void paQuit(struct pa_document *doc);
-
-#endif /* _PATCHY_H */
-
-#ifdef PA_IMPLEMENTATION
-
-#ifndef _PATCHY_INTERNAL_H
-#define _PATCHY_INTERNAL_H
 
+struct pa_heap {
+        struct pa_list nodes;   /* The nodes in heap-order */
+        struct pa_list slots;   /* The slots referenced by handles */
 
+        pa_list_compare compare;
 
+        s16 entry_size; /* The size of an entry in bytes */
+        s16 free_head;  /* The first slot in the free-list or -1 */
+};
 
-/* 
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+/*
+ * Initialize the heap and preallocate the requested number of entries. The
+ * heap will scale to fit all new entries. After use call paDestroyHeap() to
+ * prevent memory leaks.
  *
- *              MEMORY
+ * @heap: Pointer to the heap
+ * @mem: Pointer to the memory-manager
+ * @size: The size of a single entry in bytes
+ * @alloc: The initial number of entries to preallocate
+ * @cmp: The compare-function used to order the entries
  *
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ * Returns: 0 on success or -1 if an error occurred
  */
+PA_API s8 paInitHeap(struct pa_heap *heap, struct pa_memory *mem, s16 size,
+                s16 alloc, pa_list_compare cmp);
 
 /*
- * Initialize the memory-manager and attach the default allocation functions to
- * it. The memory manager will therefore also be configured as dynamic.
+ * Create a static heap on top of the given buffer. The buffer is split up
+ * between the nodes and the slots. No more entries can be pushed once the heap
+ * is full.
+ * After use call paDestroyHeap() and then free the memory yourself.
  *
- * @mem: Pointer to the memory-manager
+ * @heap: Pointer to the heap
+ * @size: The size of a single entry in bytes
+ * @cmp: The compare-function used to order the entries
+ * @buf: The buffer to store the heap in
+ * @buf_sz: The size of the given buffer in bytes
  *
  * Returns: 0 on success or -1 if an error occurred
  */
-PA_LIB s8 pa_mem_init_default(struct pa_memory *mem);
+PA_API s8 paInitHeapFixed(struct pa_heap *heap, s16 size, pa_list_compare cmp,
+                void *buf, s32 buf_sz);
 
 /*
- * Allocate memory to fit the given number of bytes. If some memory has already
- * been allocated and is given through the pointer-parameter, the memory will
- * instead be reallocated. In case reallocation fails, the existing memory will
- * not be corrupted, but NULL will be returned.
- *
- * @mem: Poiner to the memory-manager
- * @[p]: Current memory pointer
- * @size: The requested number of bytes
+ * Destroy the heap and free the allocated memory.
  *
- * Returns: A pointer to the memory or NULL if an error occurred
+ * @heap: Pointer to the heap
  */
-PA_LIB void *pa_mem_alloc(struct pa_memory *mem, void *p, s32 size);
+PA_API void paDestroyHeap(struct pa_heap *heap);
 
 /*
- * Free the allocated memory if the mode is set to dynamic. In case of static
- * memory nothing will happen.
+ * Remove all entries from the heap. All handles will be invalid afterwards.
+ * This will not free memory.
  *
- * @mem: Pointer to the memory-manager
- * @p: Pointer to the memory-space to free
+ * @heap: Pointer to the heap
  */
-PA_LIB void pa_mem_free(struct pa_memory *mem, void *p);
+PA_API void paClearHeap(struct pa_heap *heap);
 
 /*
- * Set the all bytes in the given memory-space.
+ * Copy a new entry into the heap and write the handle for it to the given
+ * pointer.
  *
- * @p: Pointer to the memory-space
- * @v: The bytes
- * @size: The number of bytes to set
+ * @heap: Pointer to the heap
+ * @src: Pointer to the entry
+ * @[out]: A pointer to write the handle to
+ *
+ * Returns: 0 on success or -1 if an error occurred
  */
-PA_LIB void pa_mem_set(void *p, u8 v, s32 size);
+PA_API s8 paPushHeap(struct pa_heap *heap, void *src,
+                struct pa_slot_handle *out);
 
 /*
- * Zero all bytes in a given memory-space.
+ * Remove the top entry from the heap and write it to the given pointer. The
+ * handle of the entry is written as well, so it can be dropped by the caller.
+ * Using it afterwards will fail, as it is stale.
  *
- * @p: Pointer to the memory-space
- * @size: The number of bytes to zero out
+ * @heap: Pointer to the heap
+ * @[dst]: A pointer to write the entry to
+ * @[out]: A pointer to write the handle of the entry to
+ *
+ * Returns: 1 if an entry has been popped and 0 if the heap is empty
  */
-PA_LIB void pa_mem_zero(void *p, s32 size);
+PA_API s8 paPopHeap(struct pa_heap *heap, void *dst,
+                struct pa_slot_handle *out);
 
 /*
- * Copy over memory. If the source and destination overlap, this function can
- * overwrite the source while still reading from it, so watch out for this.
+ * Copy the top entry without removing it.
  *
- * @dst: Pointer to the destination
- * @src: Pointer to the source
- * @size: The number of bytes to copy
+ * @heap: Pointer to the heap
+ * @dst: A pointer to write the entry to
+ *
+ * Returns: 1 if an entry has been copied and 0 if the heap is empty
  */
-PA_LIB void pa_mem_copy(void *dst, void *src, s32 size);
+PA_API s8 paPeekHeap(struct pa_heap *heap, void *dst);
 
 /*
- * This will move memory while checking that the source will not be overwritten
- * while reading from it.
+ * Overwrite the entry referenced by the handle and move it to the right
+ * position. Use this to decrease (or increase) the key of an entry.
  *
- * @dst: Pointer to the destination
- * @src: Pointer to the source
- * @size: The number of bytes to move
+ * @heap: Pointer to the heap
+ * @hdl: The handle of the entry
+ * @src: Pointer to the new entry
+ *
+ * Returns: 0 on success or -1 if the handle is stale
  */
-PA_LIB void pa_mem_move(void *dst, void *src, s32 size);
+PA_API s8 paUpdateHeap(struct pa_heap *heap, struct pa_slot_handle hdl,
+                void *src);
 
 /*
- * Compare two memory-buffers byte-by-byte.
+ * Remove the entry referenced by the handle from the heap.
  *
- * @ptr1: Pointer for the first memory-buffer
- * @ptr2: Pointer to the second memory-buffer
+ * @heap: Pointer to the heap
+ * @hdl: The handle of the entry
+ * @[dst]: A pointer to write the entry to
  *
- * Returns: 1 if the buffers are equal and 0 if not
+ * Returns: 1 if the entry has been removed, 0 if the handle is stale
  */
-PA_LIB s8 pa_mem_compare(void *ptr1, void *ptr2, s32 size);
+PA_API s8 paRemoveHeap(struct pa_heap *heap, struct pa_slot_handle hdl,
+                void *dst);
 
-/* 
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+/*
+ * Push many entries at once and restore the heap-order afterwards in O(n)
+ * instead of sifting every single entry.
  *
- *              STRING-HELPER
+ * @heap: Pointer to the heap
+ * @src: Pointer to the entries
+ * @num: The number of entries
+ * @[out]: An array to write the handle of every pushed entry to
  *
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ * Returns: The number of entries pushed or -1 if an error occurred
  */
+PA_API s16 paBuildHeap(struct pa_heap *heap, void *src, s16 num,
+                struct pa_slot_handle *out);
 
 /*
- * Returns 1 for ASCII-space-character.
- * Otherwise returns 0.
+ * -----------------------------------------------------------------------------
+ *
+ *      BITSET
+ *
+ * The bitset stores one bit per index, packed into 32-bit words. It is meant
+ * for flags like dirty- or visibility-markers, which are needed for every
+ * element. Compared to a list of bytes, it only needs an eighth of the memory
+ * and scanning for set bits can skip 32 unset bits at once.
+ *
+ *   words: <bit 0..31><bit 32..63><bit 64..95>...
+ *
+ * In dynamic mode setting a bit beyond the current size will scale the bitset
+ * to fit the index. Reading bits beyond the size will always return 0.
  */
-PA_LIB s8 pa_isspace(char c);
+
+#define PA_BITSET_WORD          32
+
+struct pa_bitset {
+        struct pa_memory *memory;
+        enum pa_memory_mode mode;
+
+        u32 *words;     /* The buffer containing the bits */
+        s32 count;      /* The number of allocated words */
+};
 
 /*
- * Returns 1 for ASCII-characters A..Z, a..z.
- * Otherwise returns 0.
+ * Initialize the bitset and preallocate enough words for the given number of
+ * bits. All bits start unset. After use call paDestroyBitset() to prevent
+ * memory leaks.
+ *
+ * @set: Pointer to the bitset
+ * @mem: Pointer to the memory-manager
+ * @bits: The initial number of bits to preallocate
+ *
+ * Returns: 0 on success or -1 if an error occurred
  */
-PA_LIB s8 pa_isletter(char c);
+PA_API s8 paInitBitset(struct pa_bitset *set, struct pa_memory *mem, s32 bits);
 
 /*
- * Returns 1 for ASCII-characters 0..9.
- * Otherwise returns 0.
+ * Create a static bitset on top of the given buffer. The number of bits is
+ * calculated from the size of the buffer. After use call paDestroyBitset() and
+ * then free the memory yourself.
+ *
+ * @set: Pointer to the bitset
+ * @buf: The buffer to store the bits in
+ * @buf_sz: The size of the given buffer in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
  */
-PA_LIB s8 pa_isdigit(char c);
+PA_API s8 paInitBitsetFixed(struct pa_bitset *set, void *buf, s32 buf_sz);
 
 /*
- * Returns 1 for ASCII-characters 0..9, A..Z, a..z.
- * Otherwise returns 0.
+ * Destroy the bitset and free the allocated memory.
+ *
+ * @set: Pointer to the bitset
  */
-PA_LIB s8 pa_ishexcode(char c);
+PA_API void paDestroyBitset(struct pa_bitset *set);
 
 /*
- * A wrapper for the clib-strlen function.
+ * Unset all bits in the bitset. This will not free memory.
+ *
+ * @set: Pointer to the bitset
  */
-PA_LIB s32 pa_strlen(char *s);
+PA_API void paClearBitset(struct pa_bitset *set);
 
 /*
- * A wrapper for the clib-strcpy function.
+ * Set a single bit. If the bitset is configured as dynamic, it will scale to
+ * fit the index.
+ *
+ * @set: Pointer to the bitset
+ * @idx: The index of the bit
+ *
+ * Returns: 0 on success or -1 if the index is out of range
  */
-PA_LIB void pa_strcpy(char *dst, char *src);
+PA_API s8 paSetBit(struct pa_bitset *set, s32 idx);
 
 /*
- * A wrapper for the clib-strcmp function.
+ * Unset a single bit.
+ *
+ * @set: Pointer to the bitset
+ * @idx: The index of the bit
  */
-PA_LIB s16 pa_strcmp(char *str1, char *str2);
+PA_API void paClearBit(struct pa_bitset *set, s32 idx);
 
 /*
- * Trim the leading and trailing spaces from a string by moving the string
- * pointer to the first character and write a null-terminator after the last
- * character. This function will not move the characters to the beginning of the
- * string-buffer, so watch out to not lose the pointer for the original memory.
+ * Check if a single bit is set.
  *
- * @s: Pointer to the null-terminated string to trim
+ * @set: Pointer to the bitset
+ * @idx: The index of the bit
  *
- * Returns: The updated pointer to the string 
+ * Returns: 1 if the bit is set and 0 if not
  */
-PA_LIB char *pa_trim(char *str);
+PA_API s8 paTestBit(struct pa_bitset *set, s32 idx);
 
 /*
- * Remove all characters from the string, move all characters so they're
- * consecutive and update the null-terminator. All modifications will be applied
- * to the given string-buffer. To preserve the original state, duplicate the
- * buffer. The original pointer for the string-buffer will not be lost.
+ * Count the number of set bits.
  *
- * @str: Pointer to the null-terminated string to strip
+ * @set: Pointer to the bitset
  *
- * Returns: A pointer to the updated string
+ * Returns: The number of set bits
  */
-PA_LIB char *pa_strip(char *str);
+PA_API s32 paCountBitset(struct pa_bitset *set);
 
 /*
- * Convert the input string containing ASCII-encoded numbers into an usable
- * integer-value.
+ * Search for the next set bit, starting at the given index.
  *
- * @s: The null-terminated string containing the ASCII-encoded integer-value
+ * @set: Pointer to the bitset
+ * @start: The index to start searching from
  *
- * Returns: The resulting integer value
+ * Returns: The index of the next set bit or -1 if there are no more set bits
  */
-PA_LIB s64 pa_atoi(char *s);
+PA_API s32 paNextBit(struct pa_bitset *set, s32 start);
 
 /*
- * Convert the input string containing an ASCII-encoded floating-point value
- * into a usable float.
+ * Get the index of the next set bit. For the first step pass -1 for idx.
  *
- * @s: The null-terminated string containing the ASCII-encoded float-value
+ * Example on how to process all dirty elements:
+ * ...
+ * s32 idx = -1;
  *
- * Returns: The resulting float value
+ * while((idx = paIterateBitset(&dirty, idx)) >= 0) {
+ *         ...
+ * }
+ * ...
+ *
+ * @set: Pointer to the bitset
+ * @idx: The current index
+ *
+ * Returns: The index of the next set bit or -1 if there are no more set bits
  */
-PA_LIB f64 pa_atof(char *s);
+PA_API s32 paIterateBitset(struct pa_bitset *set, s32 idx);
 
-/* 
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
- *
- *              ELEMENT
+/*
+ * Only keep the bits, which are set in both bitsets.
  *
- * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ * @dst: Pointer to the bitset to write the result to
+ * @src: Pointer to the second bitset
  */
+PA_API void paAndBitset(struct pa_bitset *dst, struct pa_bitset *src);
 
 /*
- * Initialize the element-tree with the minimum of slots.
+ * Set all bits, which are set in the second bitset. If the destination is
+ * configured as dynamic, it will scale to fit all bits of the source.
  *
- * @tree: Pointer to the tree struct
+ * @dst: Pointer to the bitset to write the result to
+ * @src: Pointer to the second bitset
  *
- * Returns: 0 on success or -1 if an error occurred
+ * Returns: 0 on success or -1 if not all bits fit into the destination
  */
-PA_LIB s8 pa_etr_init(struct pa_element_tree *tree);
-
+PA_API s8 paOrBitset(struct pa_bitset *dst, struct pa_bitset *src);
 
 /*
- * Free the allocated memory and destroy the element-tree.
+ * Unset all bits, which are set in the second bitset.
  *
- * @tree: Pointer to the element-tree
+ * @dst: Pointer to the bitset to write the result to
+ * @src: Pointer to the second bitset
  */
-PA_LIB void pa_etr_destroy(struct pa_element_tree *tree);
-
+PA_API void paAndNotBitset(struct pa_bitset *dst, struct pa_bitset *src);
 
 /*
- * Reserve memory for a new element. Nothing will be initialized.
+ * -----------------------------------------------------------------------------
  *
- * @doc: Pointer to the document
+ *      BLOOM-FILTER
  *
- * Returns: Pointer to the memory space for the new element or NULL if an error
- *          occurred
+ * The dictionary and the table can use a bloom-filter to answer lookups for
+ * keys they don't contain without searching the buckets. The filter is split
+ * into blocks of PA_BLOOM_BLOCK words, which is the size of a cache-line. All
+ * bits of a key are set in the same block, so a lookup only touches a single
+ * cache-line.
+ *
+ * Removing a key can't clear its bits, as they might be shared with other
+ * keys. Instead the filter is rebuilt once too many keys have been removed or
+ * the dictionary or table has grown beyond the capacity of the filter.
  */
-PA_LIB struct pa_Element *pa_ele_new(struct pa_document *doc);
 
+#define PA_BLOOM_BLOCK  16
+
+struct pa_bloom {
+        u32 *bits;      /* The blocks of the filter or NULL if disabled */
+        s32 blocks;     /* The number of blocks */
+        s16 hashes;     /* The number of bits set for every key */
+        s32 capacity;   /* The number of keys the filter is sized for */
+        s32 stale;      /* The number of removed keys still in the filter */
+        f32 rate;       /* The target false-positive rate */
+};
 
 /*
- * Get a pointer to an element through the index.
+ * -----------------------------------------------------------------------------
  *
- * @doc: Pointer to the document
+ *      HASH-STATS
  *
- * Returns: Either a pointer to the element at the given index or NULL if an
- *          error occurred
+ * Statistics about the buckets of a dictionary or table, to see how well the
+ * keys are spread and how long lookups take. Everything except the hit- and
+ * miss-counters is computed from the current content when the statistics
+ * are requested, so collecting them doesn't slow down the lookups.
  */
-PA_LIB struct pa_Element *pa_ele_by_index(struct pa_document *doc, s16 idx);
 
+#define PA_STATS_CHAINS 8
 
-#endif /* _PATCHY_INTERNAL_H */
+struct pa_hash_stats {
+        s32 entries;    /* The number of entries */
+        s32 slots;      /* The number of allocated entry-slots */
+        s32 buckets;    /* The number of buckets */
+        f32 load;       /* The number of entries per bucket */
+
+        /*
+         * The number of buckets for every chain-length, so chains[0] are the
+         * empty buckets. The last element also counts all longer chains.
+         */
+        s32 chains[PA_STATS_CHAINS];
+        s32 longest;    /* The length of the longest chain */
 
+        f32 probe_hit;  /* Average entries compared to find a used key */
+        f32 probe_miss; /* Average entries compared for a missing key */
 
+        s32 collisions; /* Entries sharing their 16-bit hash with another */
 
+        u32 hits;       /* Lookups that found the key since the last reset */
+        u32 misses;     /* Lookups that didn't since the last reset */
 
-#include <stdio.h>
+        u32 filter_checks;  /* Lookups checked with the bloom-filter */
+        u32 filter_rejects; /* Lookups answered by the bloom-filter */
+};
 
 /*
  * -----------------------------------------------------------------------------
  *
- *      STRING
+ *      Dictionary
  *
- */
-
-/*
- * The number of trailing bytes for every byte in a UTF8-encoded sequence.
- * To get the total size of a sequence, get the trailing bytes and add one.
+ * When pushing a new key-value-pair into the dictionary, the key is hashed and
+ * the new entry consisting of the key and value memory is pushed with a next
+ * value into the dictionary-buffer. The entry will then be put into one of the
+ * buckets depending on the hash and attached to the last entry in the bucket by
+ * updating it's next value.
  *
- * Binary    Hex         Comments
- * 0xxxxxxx  0x00..0x7F  Only byte of a 1-byte character encoding
- * 10xxxxxx  0x80..0xBF  Continuation byte: one of 1-3 bytes following the first
- * 110xxxxx  0xC0..0xDF  First byte of a 2-byte character encoding
- * 1110xxxx  0xE0..0xEF  First byte of a 3-byte character encoding
- * 11110xxx  0xF0..0xF7  First byte of a 4-byte character encoding
+ * The dictionary-buffer looks like this:
+ *
+ *   ... <next><hash><key><value> <next><hash><key><value> ...
+ *
+ * The next-value is a short, the hash is an unsigned short, the key is the
+ * offset of the key in the key-buffer and the value-size is set during
+ * initialization. The keys can have any length and are stored one after
+ * another in a separate key-buffer:
+ *
+ *   ... <slot><size><key> <slot><size><key> ...
+ *
+ * Every record contains the slot of its entry and the size of the record, so
+ * once the key-buffer is full, the records of removed keys can be reclaimed by
+ * moving the remaining records to the front.
+ *
+ * To mark a entry-slot as not-used the next is set to -1. To identify the
+ * end of the bucket, the next is set to -(bucket_number + 2). All not-used
+ * slots are linked together in a free-list, with the hash-field of a slot
+ * containing the index of the next free slot, so finding an open slot doesn't
+ * require searching the buffer.
+ *
+ * To search for an entry in the dictionary, we again hash the key, determine
+ * the right bucket and then jump from entry to entry to find the right one like
+ * in a linked list.
+ *
+ * Once the number of entries exceeds PA_DICT_LOAD times the number of buckets,
+ * the number of buckets is doubled and all entries are redistributed, so the
+ * chains stay short. In dynamic mode the dictionary-buffer also scales when all
+ * slots are used. In fixed mode the buckets are stored behind the entries in
+ * the given buffer and their number is set once during initialization.
+ *
+ * In ordered mode new entries are always appended behind the last used slot,
+ * so the dictionary-buffer holds the entries in the order they have been added
+ * and the buckets just index into it. Removed entries leave a hole, which is
+ * only reclaimed once the end of the buffer is reached, by moving all used
+ * entries to the front. Iterating is then a linear scan over the buffer.
  */
-PA_INTERN const char str_trailing_bytes[256] = {
-        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-        1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-        2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2, 3,3,3,3,3,3,3,3,4,4,4,4,5,5,5,5
-};
-
-PA_INTERN const u32 str_offset_utf8[6] = {
-        0x00000000UL, 0x00003080UL, 0x000E2080UL,
-        0x03C82080UL, 0xFA082080UL, 0x82082080UL
-};
 
-PA_INTERN s16 str_sequence_size(char *s)
-{
-        return str_trailing_bytes[*(u8 *)s] + 1;
-}
+#define PA_DICT_NEXT_SIZE 2
+#define PA_DICT_HASH_SIZE 2
+#define PA_DICT_KEY_SIZE  4
+#define PA_DICT_HEAD_SIZE (PA_DICT_NEXT_SIZE+PA_DICT_HASH_SIZE+PA_DICT_KEY_SIZE)
+#define PA_DICT_KEY_HEAD  4
+#define PA_DICT_KEY_AVG   16
+#define PA_DICT_BUCKETS   8
+#define PA_DICT_BUCKETS_MAX 16384
+#define PA_DICT_LOAD      0.75
 
-PA_INTERN u32 str_next(char *s, s32 *off)
-{
-        u32 ch = 0;
-        s32 sz = 0;
+struct pa_dictionary {
+        struct pa_memory *memory;
+        enum pa_memory_mode mode;
 
-        do {
-                ch <<= 6;
-                ch += (u8)s[(*off)++];
-                sz++;
-        } while(s[*off] && !PA_ISUTF(s[*off]));
+        s32 value_size; /* The size of the value-part in bytes */
+        s32 entry_size; /* The size of the header and value */
 
-        ch -= str_offset_utf8[sz-1];
-        return ch;
-}
+        s16 number;   /* Number of active entries in the dictionary */
+        s16 alloc;    /* Number of slots of entries in the dictionary */  
+        u8 *buffer;   /* Memory-buffer to store the entries */
+        s16 free_head;/* Index of the first free slot or -1 */
 
-PA_INTERN s16 str_length(char *s)
-{
-        s16 count = 0;
-        s32 i = 0;
+        s8 ordered;   /* 1 if the entries are kept in insertion order */
+        s16 tail;     /* In ordered mode the index behind the last used slot */
 
-        if(s == NULL || pa_strlen(s) == 0)
-                return 0;
+        u8 *keys;       /* Memory-buffer to store the keys */
+        s32 keys_size;  /* The size of the key-buffer in bytes */
+        s32 keys_used;  /* Number of bytes written to the key-buffer */
+        s32 keys_dead;  /* Number of bytes of removed keys */
 
-        while(str_next(s, &i) != 0)
-                count++;
+        /* 
+         * All buckets containing the index for their first entry in the
+         * dictionary-buffer. The number of buckets is always a power of two.
+         */
+        s16 bucket_count;
+        s16 *buckets;
 
-        return count;
-}
+        struct pa_bloom filter; /* Optional filter for missing keys */
 
-/* charnum => byte offset */
-PA_INTERN s32 str_offset(char *s, s16 charnum)
-{
-        s16 offs = 0;
+        u32 hits;       /* Lookups that found the key */
+        u32 misses;     /* Lookups that didn't */
 
-        while(charnum > 0 && s[offs]) {
-                (void)(PA_ISUTF(s[++offs]) || PA_ISUTF(s[++offs]) ||
-                                PA_ISUTF(s[++offs]) || ++offs);
-                charnum--;
-        }
+        /* Kept outside the filter, so rebuilding it doesn't reset them */
+        u32 filter_checks;  /* Lookups checked with the filter */
+        u32 filter_rejects; /* Lookups answered by the filter */
+};
 
-        return offs;
-}
+struct pa_dictionary_entry {
+        char *key;      /* Valid until the dictionary is modified */
+        void *value;
+};
 
-/* byte offset => charnum */
-PA_INTERN s16 str_charnum(char *s, s32 offset)
-{
-        s16 charnum = 0;
-        s32 offs = 0;
+/*
+ * Initialize the dictionary, link to the memory-manager and preallocate the
+ * specified number of entries.
+ *
+ * @dct: Pointer to the dictionary
+ * @mem: Pointer to the memory-manager
+ * @size: The size of the value-part in bytes
+ * @alloc: The number of entries to preallocate
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitDictionary(struct pa_dictionary *dct, struct pa_memory *mem,
+                s32 size, s16 alloc);
 
-        while(offs < offset && s[offs]) {
-                (void)(PA_ISUTF(s[++offs]) || PA_ISUTF(s[++offs]) ||
-                                PA_ISUTF(s[++offs]) || ++offs);
-                charnum++;
-        }
+/*
+ * Initialize the dictionary using static memory, and prepare the
+ * dictionary-buffer. The buffer is shared by the entries, the buckets and the
+ * keys, with PA_DICT_KEY_AVG bytes reserved for every key.
+ *
+ * @dic: Pointer to the dictionary
+ * @buffer: The buffer to use to store the entries
+ * @buf_sz: The size of the buffer in bytes
+ * @value_sz: The size of the value-part in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitDictionaryFixed(struct pa_dictionary *dct, void *buffer,
+                s32 buf_sz, s32 value_sz);
 
-        return charnum;
-}
+/*
+ * Destroy the dictionary, reset all attributes and if configured as dynamic,
+ * free the allocated memory.
+ *
+ * @dct: Pointer to the dictionary
+ */
+PA_API void paDestroyDictionary(struct pa_dictionary *dct);
 
-PA_INTERN void str_inc(char *s, int *i)
-{
-        (void)(PA_ISUTF(s[++(*i)]) || PA_ISUTF(s[++(*i)]) ||
-                        PA_ISUTF(s[++(*i)]) || ++(*i));
-}
+/*
+ * Set a key-value-pair in the dictionary. If the key already exists then
+ * overwrite it. If it does not yet exist, create it. This function will copy
+ * over the memory into the buffer.
+ *
+ * @dct: Pointer to the dictionary
+ * @key: Pointer to the key
+ * @value: Pointer to the value
+ *
+ * Returns: Either 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSetDictionary(struct pa_dictionary *dct, char *key, void *value);
 
-PA_INTERN void str_dec(char *s, int *i)
-{
-        (void)(PA_ISUTF(s[--(*i)]) || PA_ISUTF(s[--(*i)]) || 
-                        PA_ISUTF(s[--(*i)]) || --(*i));
-}
+/*
+ * Retrieve an entry from the dictionary by searching for the key. To do so, the
+ * key will be hashed and the proper bucket determined. Then the function will
+ * go through all entries in the bucked until the requested entry is found.
+ *
+ * @dct: Pointer to the dictionary
+ * @key: Pointer to the key to look for
+ * @dst: A pointer to write the entry for the key to
+ *
+ * Returns: 1 if the entry has been found, 0 if not and -1 if an error occurred
+ */
+PA_API s8 paGetDictionary(struct pa_dictionary *dct, char *key, void *out);
 
-PA_INTERN void str_ensure_fit(struct pa_string *str, s32 size)
-{
-        s32 new_alloc;
-        void *p;
+/*
+ * Remove an entry from the dictionary and open up the slot. The memory in the
+ * entry will be lost!
+ *
+ * @dct: Pointer to the dictionary
+ * @key: The key of the entry
+ */
+PA_API void paRemoveDictionary(struct pa_dictionary *dct, char *key);
+
+/*
+ * Enable a bloom-filter in front of the buckets, so most lookups for keys not
+ * in the dictionary can be answered without searching a bucket. The filter is
+ * sized for the current number of slots and rebuilt when the dictionary grows.
+ * This is only possible in dynamic mode.
+ *
+ * @dct: Pointer to the dictionary
+ * @rate: The target false-positive rate, or 0 to disable the filter
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paEnableDictionaryFilter(struct pa_dictionary *dct, f32 rate);
+
+/*
+ * Collect statistics about the buckets and lookups of the dictionary.
+ *
+ * @dct: Pointer to the dictionary
+ * @stats: A pointer to write the statistics to
+ */
+PA_API void paGetDictionaryStats(struct pa_dictionary *dct,
+                struct pa_hash_stats *stats);
+
+/*
+ * Reset the hit- and miss-counters of the dictionary and its bloom-filter.
+ *
+ * @dct: Pointer to the dictionary
+ */
+PA_API void paResetDictionaryStats(struct pa_dictionary *dct);
+
+/*
+ * Switch the insertion-ordered mode on or off. When switching, all used
+ * entries are moved to the front of the dictionary-buffer, keeping their
+ * current order. Entries added from then on in ordered mode come after the
+ * existing ones.
+ *
+ * @dct: Pointer to the dictionary
+ * @ordered: 1 to keep the entries in insertion order and 0 to reuse free slots
+ */
+PA_API void paSetDictionaryOrdered(struct pa_dictionary *dct, s8 ordered);
+
+/*
+ * This function allows the iteration of every entry in every bucket. The basic
+ * principal is passing a pointer to the current entry and getting the
+ * entry-data and pointer for the next entry. Note that this function goes from
+ * bucket to bucket, so it will not return the entries in respect to when they
+ * have been added, unless the dictionary is in ordered mode. Then the entries
+ * are returned in the order they have been added.
+ *
+ * Here's an example of how to use the function:
+ * ...
+ * struct pa_dictionary dict;
+ * struct pa_dictionary_entry ent;
+ * void *ptr = NULL;
+ * ...
+ * while((ptr = paIterateDictionary(&dict, ptr, &ent))) {
+ *      ..Do something with the entry...
+ * }
+ * ...
+ *
+ * @dct: Pointer to the dictionary
+ * @ptr: The runing pointer used to iterate(pass NULL at the start)
+ * @ent: A pointer to write the entry data to
+ *
+ * Returns: The pointer for the current entry in the dictionary-buffer or NULL
+ *          if this is the last entry in the dictionary
+ */
+PA_API void *paIterateDictionary(struct pa_dictionary *dct, void *ptr, 
+                struct pa_dictionary_entry *ent);
+
+/*
+ * Iterate through all entries in a bucket.
+ *
+ * Here's an example of how to use the function to iterate through bucket 2:
+ * ...
+ * struct pa_dictionary dict;
+ * struct pa_dictionary_entry ent;
+ * void *ptr = NULL;
+ * ...
+ * while((ptr = paIterateDictionaryBucket(&dict, 2, ptr, &ent))) {
+ *      ..Do something with the entry...
+ * }
+ * ...
+ *
+ * @dct: Pointer to the dictionary
+ * @bucket: The bucket to iterate through
+ * @ptr: The running pointer used to iterate(pass NULL at start)
+ * @ent: A pointer to write the entry data to
+ *
+ * Returns: The pointer for the current entry in the dictionary-buffer or NULL
+ *          if this is the last entry in the bucket
+ */
+PA_API void *paIterateDictionaryBucket(struct pa_dictionary *dct, s16 bucket,
+                void *ptr, struct pa_dictionary_entry *ent);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      TABLE
+ *
+ * When pushing a new key-value-pair into the table, the key is hashed and
+ * the new entry consisting of the key and value memory is pushed with a next
+ * value into the table-buffer. The entry will then be put into one of the
+ * buckets depending on the hash and attached to the last entry in the bucket by
+ * updating it's next value.
+ *
+ * The table-buffer looks like this:
+ *
+ *   ... <next><hash><key><value> <next><hash><key><value> ...
+ *
+ * The next-value is a short, the hash is an unsigned short, the key and the 
+ * value-size is set during initialization.
+ *
+ * To mark a entry-slot as not-used the next is set to -1. To identify the
+ * end of the bucket, the next is set to -(bucket_number + 2). All not-used
+ * slots are linked together in a free-list, with the hash-field of a slot
+ * containing the index of the next free slot, so finding an open slot doesn't
+ * require searching the buffer.
+ *
+ * To search for an entry in the dictionary, we again hash the key, determine
+ * the right bucket and then jump from entry to entry to find the right one like
+ * in a linked list.
+ *
+ * Once the number of entries exceeds PA_TBL_LOAD times the number of buckets,
+ * the number of buckets is doubled and all entries are redistributed, so the
+ * chains stay short. In dynamic mode the table-buffer also scales when all
+ * slots are used. In fixed mode the buckets are stored behind the entries in
+ * the given buffer and their number is set once during initialization.
+ *
+ * As the entries and buckets only reference each other by index, a table can
+ * be saved to a file and mapped back into memory later without any fixups.
+ * The file contains a short header followed by the table-buffer and the
+ * buckets, laid out the same way as in fixed mode:
+ *
+ *   <head> <entries...> <buckets...>
+ */
+
+
+#define PA_TBL_NEXT_SIZE 2
+#define PA_TBL_HASH_SIZE 2
+#define PA_TBL_HEAD_SIZE (PA_TBL_NEXT_SIZE+PA_TBL_HASH_SIZE)
+#define PA_TBL_BUCKETS   8
+#define PA_TBL_BUCKETS_MAX 16384
+#define PA_TBL_LOAD      0.75
+#define PA_TBL_BATCH     16
+
+struct pa_table {
+        struct pa_memory *memory;
+        enum pa_memory_mode mode;
+
+        s32 key_size;   /* The size of the key in bytes */
+        s32 value_size; /* The size of the value-part in bytes */
+        s32 entry_size; /* The size of the header, key and value in bytes */
+
+        s16 number;   /* Number of active entries in the table */
+        s16 alloc;    /* Number of slots of entries in the table */  
+        u8 *buffer;   /* Memory-buffer to store the entries */
+        s16 free_head;/* Index of the first free slot or -1 */
+
+        /* 
+         * All buckets containing the index for their first entry in the
+         * table-buffer. The number of buckets is always a power of two.
+         */
+        s16 bucket_count;
+        s16 *buckets;
+
+        struct pa_bloom filter; /* Optional filter for missing keys */
+
+        u32 hits;       /* Lookups that found the key */
+        u32 misses;     /* Lookups that didn't */
+
+        /* Kept outside the filter, so rebuilding it doesn't reset them */
+        u32 filter_checks;  /* Lookups checked with the filter */
+        u32 filter_rejects; /* Lookups answered by the filter */
+};
+
+struct pa_table_entry {
+        void *key;
+        void *value;
+};
+
+/*
+ * Initialize the table, link to the memory-manager and preallocate the
+ * specified number of entries.
+ *
+ * @tbl: Pointer to the table
+ * @mem: Pointer to the memory-manager
+ * @key_sz: The size of the key in bytes
+ * @value_sz: The size of the value in bytes
+ * @alloc: The number of entries to preallocate
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitTable(struct pa_table *tbl, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s16 alloc);
+
+/*
+ * Initialize the table using static memory, and prepare the
+ * table-buffer.
+ *
+ * @dic: Pointer to the table
+ * @buffer: The buffer to use to store the entries
+ * @buf_sz: The size of the buffer in bytes
+ * @value_sz: The size of the value-part in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitTableFixed(struct pa_table *tbl, void *buffer,
+                s32 buf_sz, s32 key_sz, s32 value_sz);
+
+/*
+ * Destroy the table, reset all attributes and if configured as dynamic,
+ * free the allocated memory.
+ *
+ * @tbl: Pointer to the table
+ */
+PA_API void paDestroyTable(struct pa_table *tbl);
+
+/*
+ * Set a key-value-pair in the table. If the key already exists then
+ * overwrite it. If it does not yet exist, create it. This function will copy
+ * over the memory into the buffer. Tables mapped with paMapTable() are
+ * read-only and always fail.
+ *
+ * @tbl: Pointer to the table
+ * @key: Pointer to the key
+ * @value: Pointer to the value
+ *
+ * Returns: Either 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSetTable(struct pa_table *tbl, void *key, void *value);
+
+/*
+ * Hash a key the same way the table does internally. The hash only depends on
+ * the key and the key-size, so it can be passed to paGetTableHashed() and
+ * paSetTableHashed() for every table with the same key-size, to avoid hashing
+ * the same key over and over again.
+ *
+ * @tbl: Pointer to the table
+ * @key: Pointer to the key
+ *
+ * Returns: The hash of the key
+ */
+PA_API u16 paHashTableKey(struct pa_table *tbl, void *key);
+
+/*
+ * Same as paSetTable(), but using a hash returned by paHashTableKey().
+ *
+ * @tbl: Pointer to the table
+ * @key: Pointer to the key
+ * @hash: The hash of the key
+ * @value: Pointer to the value
+ *
+ * Returns: Either 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSetTableHashed(struct pa_table *tbl, void *key, u16 hash,
+                void *value);
+
+/*
+ * Replace the content of the table with the given key-value-pairs. Instead of
+ * adding the pairs one by one, the table is sized once, the entries are
+ * sorted by bucket with a counting-sort and written so that all entries of a
+ * bucket lie next to each other in the table-buffer. This makes building
+ * faster and later lookups more cache-friendly. If a key appears multiple
+ * times, the last value is kept. In fixed mode the pairs have to fit into the
+ * existing slots.
+ *
+ * @tbl: Pointer to the table
+ * @keys: An array containing the keys one after another
+ * @values: An array containing the values one after another
+ * @num: The number of key-value-pairs
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paBuildTable(struct pa_table *tbl, void *keys, void *values,
+                s16 num);
+
+/*
+ * Retrieve an entry from the table by searching for the key. To do so, the
+ * key will be hashed and the proper bucket determined. Then the function will
+ * go through all entries in the bucked until the requested entry is found.
+ *
+ * @tbl: Pointer to the table
+ * @key: Pointer to the buffer containing the key
+ * @dst: A pointer to write the entry for the key to
+ *
+ * Returns: 1 if the entry has been found, 0 if not and -1 if an error occurred
+ */
+PA_API s8 paGetTable(struct pa_table *tbl, void *key, void *out);
+
+/*
+ * Same as paGetTable(), but using a hash returned by paHashTableKey(). The
+ * hash is too short for the bloom-filter, so the filter is skipped.
+ *
+ * @tbl: Pointer to the table
+ * @key: Pointer to the buffer containing the key
+ * @hash: The hash of the key
+ * @out: A pointer to write the value for the key to
+ *
+ * Returns: 1 if the entry has been found, 0 if not and -1 if an error occurred
+ */
+PA_API s8 paGetTableHashed(struct pa_table *tbl, void *key, u16 hash,
+                void *out);
+
+/*
+ * Look up multiple keys at once. The keys are processed in groups of
+ * PA_TBL_BATCH: first all keys in the group are hashed and the needed buckets
+ * and entries are requested from memory, then the buckets are searched. This
+ * way the memory-latency of the lookups overlaps, instead of waiting for every
+ * lookup one after another.
+ *
+ * @tbl: Pointer to the table
+ * @keys: An array containing the keys one after another
+ * @num: The number of keys
+ * @out: An array to write the values to, one value-slot per key
+ * @[found]: An array to mark for every key, if it has been found
+ *
+ * Returns: The number of keys found
+ */
+PA_API s16 paGetTableBatch(struct pa_table *tbl, void *keys, s16 num,
+                void *out, s8 *found);
+
+/*
+ * Remove an entry from the table and open up the slot. The memory in the
+ * entry will be lost! Tables mapped with paMapTable() are read-only and are
+ * left untouched.
+ *
+ * @tbl: Pointer to the table
+ * @key: Pointer to a buffer containing the key
+ */
+PA_API void paRemoveTable(struct pa_table *tbl, void *key);
+
+/*
+ * Enable a bloom-filter in front of the buckets, so most calls of paGetTable()
+ * for keys not in the table can be answered without searching a bucket. The
+ * filter is sized for the current number of slots and rebuilt when the table
+ * grows. This is only possible in dynamic mode.
+ *
+ * @tbl: Pointer to the table
+ * @rate: The target false-positive rate, or 0 to disable the filter
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paEnableTableFilter(struct pa_table *tbl, f32 rate);
+
+/*
+ * Collect statistics about the buckets and lookups of the table.
+ *
+ * @tbl: Pointer to the table
+ * @stats: A pointer to write the statistics to
+ */
+PA_API void paGetTableStats(struct pa_table *tbl, struct pa_hash_stats *stats);
+
+/*
+ * Reset the hit- and miss-counters of the table and its bloom-filter.
+ *
+ * @tbl: Pointer to the table
+ */
+PA_API void paResetTableStats(struct pa_table *tbl);
+
+/*
+ * This function allows the iteration of every entry in every bucket. The basic
+ * principal is passing a pointer to the current entry and getting the
+ * entry-data and pointer for the next entry. Note that this function goes from
+ * bucket to bucket, so it will not return the entries in respect to when they
+ * have been added.
+ *
+ * Here's an example of how to use the function:
+ * ...
+ * struct pa_table tbl;
+ * struct pa_table_entry ent;
+ * void *ptr = NULL;
+ * ...
+ * while((ptr = paIterateTable(&tbl, ptr, &ent))) {
+ *      ..Do something with the entry...
+ * }
+ * ...
+ *
+ * @tbl: Pointer to the table
+ * @ptr: The runing pointer used to iterate(pass NULL at the start)
+ * @ent: A pointer to write the entry data to
+ *
+ * Returns: The pointer for the current entry in the table-buffer or NULL
+ *          if this is the last entry in the table
+ */
+PA_API void *paIterateTable(struct pa_table *tbl, void *ptr, 
+                struct pa_table_entry *ent);
+
+/*
+ * Iterate through all entries in a bucket.
+ *
+ * Here's an example of how to use the function to iterate through bucket 2:
+ * ...
+ * struct pa_table tbl;
+ * struct pa_table_entry ent;
+ * void *ptr = NULL;
+ * ...
+ * while((ptr = paIterateTableBucket(&tbl, 2, ptr, &ent))) {
+ *      ..Do something with the entry...
+ * }
+ * ...
+ *
+ * @tbl: Pointer to the table
+ * @bucket: The bucket to iterate through
+ * @ptr: The running pointer used to iterate(pass NULL at start)
+ * @ent: A pointer to write the entry data to
+ *
+ * Returns: The pointer for the current entry in the table-buffer or NULL
+ *          if this is the last entry in the bucket
+ */
+PA_API void *paIterateTableBucket(struct pa_table *tbl, s16 bucket,
+                void *ptr, struct pa_table_entry *ent);
+
+/*
+ * Write the table to a file, so it can be mapped back into memory using
+ * paMapTable(). The file is only valid on machines with the same byte-order
+ * and type-sizes.
+ *
+ * @tbl: Pointer to the table
+ * @path: The path of the file to write
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSaveTable(struct pa_table *tbl, char *path);
+
+/*
+ * Map a file written by paSaveTable() into memory and initialize the table to
+ * use it directly, without copying or rebuilding anything. The mapping is
+ * read-only, so the table can be searched and iterated, but setting or
+ * removing entries fails. Files with invalid sizes, indices pointing outside
+ * the table or broken bucket-chains are rejected. Call paDestroyTable() to unmap the file again.
+ *
+ * Mapping requires POSIX and is disabled by defining PA_NO_MMAP, in which case
+ * the function always fails.
+ *
+ * @tbl: Pointer to the table
+ * @path: The path of the file to map
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paMapTable(struct pa_table *tbl, char *path);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      FLAT-TABLE
+ *
+ * The flat-table works like the table, but instead of linking the entries of
+ * a bucket together, all entries are stored directly in an array of slots
+ * (open addressing). Next to the slots there is one control-byte per slot:
+ *
+ *   control: <ctrl><ctrl><ctrl>...               One byte per slot
+ *   slots:   <key><value> <key><value> ...       The key-value-pairs
+ *
+ * A control-byte is either PA_FLAT_EMPTY, PA_FLAT_DELETED or, for a used
+ * slot, the lower 7 bits of the hash of the key. The slots are grouped into
+ * groups of PA_FLAT_GROUP slots. To search for a key, the remaining bits of
+ * the hash select the first group to look at, and the control-bytes of the
+ * whole group are compared with the 7 bits at once. Only the slots with a
+ * matching control-byte have to be compared with the key. If the group
+ * contains an empty slot, the search ends, otherwise the next group in the
+ * probe-sequence is checked.
+ *
+ * When more than 7/8 of the slots are used, the table is rebuilt. In dynamic
+ * mode the number of slots is doubled, in fixed mode only the slots of
+ * removed entries are reclaimed.
+ */
+
+#define PA_FLAT_GROUP           16
+#define PA_FLAT_EMPTY           0x80
+#define PA_FLAT_DELETED         0xFE
+
+struct pa_flat_table {
+        struct pa_memory *memory;
+        enum pa_memory_mode mode;
+
+        s32 key_size;   /* The size of the key in bytes */
+        s32 value_size; /* The size of the value-part in bytes */
+        s32 entry_size; /* The size of the key and value in bytes */
+
+        s32 number;     /* Number of active entries in the table */
+        s32 alloc;      /* Number of slots, always a power of two */
+        s32 growth_left;/* Number of empty slots left before rebuilding */
+
+        u8 *buffer;     /* Memory-buffer containing control-bytes and slots */
+        u8 *control;    /* One control-byte per slot */
+        u8 *slots;      /* The key-value-pairs */
+};
+
+/*
+ * Initialize the flat-table, link to the memory-manager and preallocate
+ * enough slots for the specified number of entries.
+ *
+ * @tbl: Pointer to the flat-table
+ * @mem: Pointer to the memory-manager
+ * @key_sz: The size of the key in bytes
+ * @value_sz: The size of the value in bytes
+ * @alloc: The number of entries to preallocate
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitFlatTable(struct pa_flat_table *tbl, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s32 alloc);
+
+/*
+ * Initialize the flat-table using static memory. The number of slots is the
+ * largest power of two fitting into the buffer.
+ *
+ * @tbl: Pointer to the flat-table
+ * @buffer: The buffer to use to store the control-bytes and slots
+ * @buf_sz: The size of the buffer in bytes
+ * @key_sz: The size of the key in bytes
+ * @value_sz: The size of the value in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitFlatTableFixed(struct pa_flat_table *tbl, void *buffer,
+                s32 buf_sz, s32 key_sz, s32 value_sz);
+
+/*
+ * Destroy the flat-table, reset all attributes and if configured as dynamic,
+ * free the allocated memory.
+ *
+ * @tbl: Pointer to the flat-table
+ */
+PA_API void paDestroyFlatTable(struct pa_flat_table *tbl);
+
+/*
+ * Remove all entries from the flat-table. This will not free memory.
+ *
+ * @tbl: Pointer to the flat-table
+ */
+PA_API void paClearFlatTable(struct pa_flat_table *tbl);
+
+/*
+ * Set a key-value-pair in the flat-table. If the key already exists then
+ * overwrite it. If it does not yet exist, create it. This function will copy
+ * over the memory into the buffer.
+ *
+ * @tbl: Pointer to the flat-table
+ * @key: Pointer to the key
+ * @value: Pointer to the value
+ *
+ * Returns: Either 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSetFlatTable(struct pa_flat_table *tbl, void *key, void *value);
+
+/*
+ * Retrieve an entry from the flat-table by searching for the key.
+ *
+ * @tbl: Pointer to the flat-table
+ * @key: Pointer to the buffer containing the key
+ * @out: A pointer to write the value for the key to
+ *
+ * Returns: 1 if the entry has been found, 0 if not and -1 if an error occurred
+ */
+PA_API s8 paGetFlatTable(struct pa_flat_table *tbl, void *key, void *out);
+
+/*
+ * Remove an entry from the flat-table and open up the slot.
+ *
+ * @tbl: Pointer to the flat-table
+ * @key: Pointer to a buffer containing the key
+ */
+PA_API void paRemoveFlatTable(struct pa_flat_table *tbl, void *key);
+
+/*
+ * Iterate through all entries in the flat-table. The entries are returned in
+ * the order of the slots, which has nothing to do with when they have been
+ * added.
+ *
+ * Here's an example of how to use the function:
+ * ...
+ * struct pa_flat_table tbl;
+ * struct pa_table_entry ent;
+ * void *ptr = NULL;
+ * ...
+ * while((ptr = paIterateFlatTable(&tbl, ptr, &ent))) {
+ *      ..Do something with the entry...
+ * }
+ * ...
+ *
+ * @tbl: Pointer to the flat-table
+ * @ptr: The running pointer used to iterate(pass NULL at the start)
+ * @ent: A pointer to write the entry data to
+ *
+ * Returns: The pointer for the current slot or NULL if there are no more
+ *          entries in the flat-table
+ */
+PA_API void *paIterateFlatTable(struct pa_flat_table *tbl, void *ptr,
+                struct pa_table_entry *ent);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      SHARED-TABLE
+ *
+ * The shared-table is a table that can be read by multiple threads at the same
+ * time while another thread writes to it. It's meant for read-mostly data like
+ * resources and styles, which are looked up all the time but only change
+ * every once in a while.
+ *
+ * The entries are stored in snapshots, which are regular fixed tables and never
+ * change once published. A write copies the current snapshot, applies the
+ * change to the copy and then publishes it, so writes are serialized and cost
+ * a full copy of the table. Lookups don't take any locks and don't write to
+ * any memory shared with other readers. Every reader instead owns a slot in
+ * which it announces the version it's currently reading, so the writer knows
+ * when an old snapshot isn't used anymore and can be freed.
+ *
+ * Writers are only serialized if the framework is compiled with PA_PTHREADS
+ * defined. Otherwise only a single thread may write to the table. Readers on
+ * other threads rely on a full memory barrier between publishing a snapshot
+ * and checking the epochs, which is available with GCC, Clang and MSVC on x86.
+ * Compiling with PA_PTHREADS fails on compilers without such a barrier.
+ */
+
+struct pa_shared_table {
+        struct pa_memory *memory;
+
+        s32 key_size;   /* The size of the key in bytes */
+        s32 value_size; /* The size of the value-part in bytes */
+        s16 readers;    /* The number of reader slots */
+
+        void *state;    /* Internal state shared with the readers */
+};
+
+/*
+ * Initialize the shared-table with an empty snapshot and the given number of
+ * reader slots.
+ *
+ * @tbl: Pointer to the shared-table
+ * @mem: Pointer to the memory-manager
+ * @key_sz: The size of the key in bytes
+ * @value_sz: The size of the value in bytes
+ * @readers: The number of threads reading from the table at the same time
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitSharedTable(struct pa_shared_table *tbl, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s16 readers);
+
+/*
+ * Destroy the shared-table and free all snapshots. No thread may still be
+ * accessing the table.
+ *
+ * @tbl: Pointer to the shared-table
+ */
+PA_API void paDestroySharedTable(struct pa_shared_table *tbl);
+
+/*
+ * Set a key-value-pair in the table. If the key already exists then overwrite
+ * it. The change is visible to all lookups starting after this function
+ * returns.
+ *
+ * @tbl: Pointer to the shared-table
+ * @key: Pointer to the key
+ * @value: Pointer to the value
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSetSharedTable(struct pa_shared_table *tbl, void *key,
+                void *value);
+
+/*
+ * Set multiple key-value-pairs with a single copy of the table. Use this when
+ * loading many entries at once.
+ *
+ * @tbl: Pointer to the shared-table
+ * @keys: An array containing the keys one after another
+ * @values: An array containing the values one after another
+ * @num: The number of key-value-pairs
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSetSharedTableBatch(struct pa_shared_table *tbl, void *keys,
+                void *values, s16 num);
+
+/*
+ * Remove an entry from the table.
+ *
+ * @tbl: Pointer to the shared-table
+ * @key: Pointer to the key
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paRemoveSharedTable(struct pa_shared_table *tbl, void *key);
+
+/*
+ * Retrieve an entry from the table without taking any locks. Every thread
+ * reading at the same time has to use a different reader slot.
+ *
+ * @tbl: Pointer to the shared-table
+ * @reader: The index of the reader slot of the calling thread
+ * @key: Pointer to the key
+ * @out: A pointer to write the value for the key to
+ *
+ * Returns: 1 if the entry has been found and 0 if not
+ */
+PA_API s8 paGetSharedTable(struct pa_shared_table *tbl, s16 reader,
+                void *key, void *out);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      CACHE
+ *
+ * The cache is a table with a fixed budget of entries. Once the budget is used
+ * up, adding a new entry evicts an old one. The entry to evict is chosen with
+ * the CLOCK algorithm, which approximates least-recently-used: every entry has
+ * a reference-bit, which is set whenever the entry is used. A hand moves over
+ * the slots of the table, clearing the reference-bits it passes, and evicts
+ * the first entry whose bit is already clear. So lookups only set a bit and
+ * evicting an entry takes constant time on average.
+ *
+ * The reference-bit is stored behind the value of every entry in the table,
+ * followed by padding to keep the entries aligned:
+ *
+ *   ... <next><hash><key><value><ref><pad> ...
+ */
+
+/*
+ * Called for an entry right before it's evicted from the cache. The key and
+ * value are only valid during the call.
+ */
+typedef void (*pa_cache_func)(void *key, void *value, void *pass);
+
+struct pa_cache {
+        struct pa_table table;
+
+        s32 value_size;         /* The size of the value-part in bytes */
+        s16 budget;             /* The maximum number of entries */
+        s16 hand;               /* The slot to check next when evicting */
+
+        pa_cache_func evict;    /* Callback for evicted entries or NULL */
+        void *pass;             /* Passed onto the callback */
+
+        u32 hits;               /* Number of lookups that found the key */
+        u32 misses;             /* Number of lookups that didn't */
+        u32 evictions;          /* Number of evicted entries */
+};
+
+/*
+ * Initialize the cache and allocate memory for the given budget of entries.
+ *
+ * @cache: Pointer to the cache
+ * @mem: Pointer to the memory-manager
+ * @key_sz: The size of the key in bytes
+ * @value_sz: The size of the value in bytes
+ * @budget: The maximum number of entries in the cache
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitCache(struct pa_cache *cache, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s16 budget);
+
+/*
+ * Initialize the cache using static memory. The budget is the number of entries
+ * that fit into the buffer.
+ *
+ * @cache: Pointer to the cache
+ * @buffer: The buffer to use to store the entries
+ * @buf_sz: The size of the buffer in bytes
+ * @key_sz: The size of the key in bytes
+ * @value_sz: The size of the value in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitCacheFixed(struct pa_cache *cache, void *buffer,
+                s32 buf_sz, s32 key_sz, s32 value_sz);
+
+/*
+ * Destroy the cache and if configured as dynamic, free the allocated memory.
+ * The eviction-callback is not called for the remaining entries.
+ *
+ * @cache: Pointer to the cache
+ */
+PA_API void paDestroyCache(struct pa_cache *cache);
+
+/*
+ * Set the callback-function to call for every entry evicted from the cache.
+ *
+ * @cache: Pointer to the cache
+ * @fnc: The callback-function or NULL
+ * @pass: A pointer that will be passed onto every function-call
+ */
+PA_API void paSetCacheCallback(struct pa_cache *cache, pa_cache_func fnc,
+                void *pass);
+
+/*
+ * Set a key-value-pair in the cache. If the key already exists then overwrite
+ * it. Otherwise, if the budget is used up, evict an entry to make room.
+ *
+ * @cache: Pointer to the cache
+ * @key: Pointer to the key
+ * @value: Pointer to the value
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSetCache(struct pa_cache *cache, void *key, void *value);
+
+/*
+ * Look up a key in the cache and mark the entry as used. Updates the hit- and
+ * miss-counters.
+ *
+ * @cache: Pointer to the cache
+ * @key: Pointer to the key
+ * @out: A pointer to write the value for the key to
+ *
+ * Returns: 1 if the entry has been found and 0 if not
+ */
+PA_API s8 paGetCache(struct pa_cache *cache, void *key, void *out);
+
+/*
+ * Remove an entry from the cache without calling the eviction-callback.
+ *
+ * @cache: Pointer to the cache
+ * @key: Pointer to the key
+ */
+PA_API void paRemoveCache(struct pa_cache *cache, void *key);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      FLEX
+ *
+ * The flex-helper is used to parse mathematical expressions for size like for
+ * example "3px * 4 - 5em" and create flex-terms. A single parser is needed to
+ * parse and process any amount of terms as it's just used for providing the
+ * necessary resources for parsing and processing. A single flex-term is just a
+ * container for an instance of a size-expression.
+ *
+ * After parsing, the term is compiled by evaluating it with symbolic values.
+ * Every value is kept as a linear form a + b * relative + c * font, so
+ * constant subexpressions fold together, for example "10px + 5px" becomes
+ * "15px" and "2 * 3pct" becomes "0.06 * relative". If the whole term is such
+ * a linear form, the three coefficients are stored in the flex-term and the
+ * tokens are replaced by the shortest equivalent term. Terms multiplying or
+ * dividing by a reference, or dividing by zero, are kept as they are.
+ */
+
+#define PA_FLX_READ_BUFFER_SIZE        64
+
+/*
+ * ----  CODE-TABLE  ----
+ *
+ * OPERATOR
+ * 	
+ * 	0x01	(	
+ * 	0x02	)
+ * 	0x03	*
+ * 	0x04	+
+ * 	0x05	-
+ * 	0x06	/
+ *
+ * OPERAND
+ *
+ * 	0x11    const	     12	  Constant value
+ * 	0x12	PIXEL	    9px	  Pixel value, works like const
+ * 	0x13	PERCENT	  10pct	  Pct. used to scale with size value
+ * 	0x14	EM	    4em	  Faktor multp. with text size
+ *
+ * ----------------------
+ */
+struct pa_flex_token {
+        u8                      code;
+        f32                     value;
+};
+
+struct pa_flex_helper {
+        struct pa_list          tokens;
+        struct pa_list          swap;
+        struct pa_list          values;
+};
+
+struct pa_flex {
+        struct pa_flex_helper   *helper;
+        struct pa_list          tokens;
+
+        s8                      linear;   /* 1 if compiled to a linear form */
+        f32                     constant; /* The constant part */
+        f32                     relative; /* The factor for the relative size */
+        f32                     font;     /* The factor for the font-size */
+};
+
+struct pa_flex_reference {
+        s32 relative;      /* Width/Height of the reference */
+        s32 font;          /* Font-Size */
+};
+
+/*
+ * Initialize a flex-helper using the dynamic funcitionalities of the
+ * framework and preallocate the requeste number of tokens.
+ *
+ * @hlp: Pointer to the flex-helper
+ * @mem: Pointer to the memory-manager
+ * @token: The initial number of token to preallocate
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitFlexHelper(struct pa_flex_helper *hlp, struct pa_memory *mem,
+                s16 tokens);
+
+/*
+ * Initialize a flex-helper using a static buffer. The flex-helper will then
+ * calculate the maximum number of tokens that can be stored in the given
+ * buffer. Any attempt to push tokens into the flex-helper when it has already
+ * reached its limit will be ignored. Usually the token- and swap-buffers should
+ * be the same size!
+ *
+ * @hlp: Pointer to the flex-helper
+ * @tok_buf: Pointer to the buffer to use for storing tokens
+ * @tok_buf_sz: The size of the given buffer
+ * @swp_buf: The swap-buffer used when parsing the input-string
+ * @swp_buf_sz: The size of the swap-buffer in bytes
+ * @val_buf: The value-buffer used when processing a flex-term
+ * @val_buf_sz: The size of the value-buffer in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitFlexHelperFixed(struct pa_flex_helper *hlp, 
+                void *tok_buf, s32 tok_buf_sz, 
+                void *swp_buf, s32 swp_buf_sz, 
+                void *val_buf, s32 val_buf_sz);
+
+/*
+ * Destroy a flex-helper, reset all attributes and, if configured as dynamic,
+ * free. the allocated memory. Use this function after use, even if the
+ * flex-helper is configured as static.
+ *
+ * @hlp: Pointer to the flex-helper
+ */
+PA_API void paDestroyFlexHelper(struct pa_flex_helper *hlp);
+
+/*
+ * Clear all contents of a flex-helper and reset all internal lists. Everything
+ * in the flex-helper will be lost!
+ *
+ * @hlp: Pointer to the flex-helper
+ */
+PA_API void paClearFlexHelper(struct pa_flex_helper *hlp);
+
+/*
+ * Dynamically initialize an expression into the flex-term using the
+ * flex-helper. The requested number of token slots will be allocated during
+ * initialization and if necessary the flex-term will scale to fit new tokens
+ * beyond its original limits.
+ *
+ * @flx: Pointer to the flex-term
+ * @hlp: Pointer to the flex-helper using for parsing and processing
+ * @mem: Pointer to the memory-manager
+ * @tokens: The number of token-slots to preallocate during initialization
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitFlex(struct pa_flex *flx, struct pa_flex_helper *hlp,
+                struct pa_memory *mem, s16 tokens);
+
+/*
+ * Statically create a flex-term on top of the given memory buffer. The maximum
+ * number of tokens is calculated from the size of the given buffer. If the
+ * limit has been reached, all new incoming tokens will be ignored.
+ *
+ * @flx: Pointer to the flex-term
+ * @hlp: Pointer to the flex-helper using for parsing and processing
+ * @tok_buf: The token-buffer to store the tokens in
+ * @tok_buf_sz: The size of the token-buffer in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitFlexFixed(struct pa_flex *flx, struct pa_flex_helper *hlp,
+                void *tok_buf, s32 tok_buf_sz);
+
+/*
+ * Destroy a flex-term and if allocated dynamically free the allocated memory.
+ * Call this function even if the flex-term has been created with static memory,
+ * but don't forget to free the provided buffer yourself.
+ *
+ * @flx: Pointer to the flex-term
+ */
+PA_API void paDestroyFlex(struct pa_flex *flx);
+
+/*
+ * Clear the internal memory of the flex-term without freeing it. This will lose
+ * all data contained in the flex-term, so use with caution.
+ *
+ * @flx: Pointer to the flex-term
+ */
+PA_API void paClearFlex(struct pa_flex *flx);
+
+/*
+ * IMPORTANT: Using this function will overwrite everything already in the
+ * flex-term! Also check that both the parser and the term have both already
+ * been initialized!
+ *
+ *
+ * Parse an input-term by first tokenizing the input and then converting it to
+ * postfix-notation using Dijkstra's shunting yard algortihm. Afterwards the
+ * term is compiled and constant subexpressions are folded. Compiling needs
+ * room for three values per token in the value-buffer of the flex-helper,
+ * otherwise the term is left as it is.
+ * If the flex-handler is configured as static, the function will only write as
+ * many tokens to the flex-handler, as the limit allows. If the flex-handler is
+ * configured as dynamic, the token-list will be scaled according the the
+ * incoming number of tokens.
+ *
+ * @hlp: Pointer to the the flex-helper
+ * @str: A null-terminated string containing the size-expression
+ * @flx: Pointer to the flex-term to parse into
+ *
+ * Returns: The number of written tokens or -1 if an error occurred
+ */
+PA_API s16 paParseFlex(struct pa_flex *flx, char *str);
+
+/*
+ * Process the flex-term using the given set of references. If the term was
+ * compiled to a linear form, the result is calculated directly from the three
+ * coefficients without touching the tokens or the value-buffer. Otherwise the
+ * postfix-term is interpreted.
+ *
+ * @flx: Pointer to the flex
+ * @ref: Pointer to the set of references
+ *
+ * Returns: The resulting value of the expression
+ */
+PA_API s32 paProcessFlex(struct pa_flex *flx, struct pa_flex_reference *ref);
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              RESOURCES
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */ 
+
+/*
+ * Contains all resources for the patchy-instance like textures, fonts and
+ * icons.
+ */
+struct pa_context {
+        char placeholder;
+};
+
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              STYLE
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * A single style-attribute.
+ */
+struct pa_style_attribute { 
+        char placeholder; 
+};
+
+
+/*
+ * 
+ */
+struct pa_stylesheet {
+        char placeholder;
+};
+
+
+/*
+ * 
+ */
+struct pa_style {
+        char placeholder;
+};
+
+
+/*
+ * A class is a bundle of different style-attributes applies to all elements
+ * tagged with the class-name.
+ */
+struct pa_class_style {
+        char placeholder;
+};
+
+/*
+ * The typeclass is a bundle of different style-attributes applied to all
+ * elements with a given type.
+ */
+struct pa_type_style {
+        char placeholder;
+};
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              EVENT
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*  */
+struct pa_event {
+        char placeholder;
+};
+
+typedef s8 (*pa_event_callback)(struct pa_event evt, void *data);
+
+/*  */
+struct pa_event_handler {
+        char placeholder;
+};
+
+
+PA_API void paEventBegin(void);
+PA_API void paEventEnd(void);
+
+PA_API void paEventKey(void);
+PA_API void paEventMotion(void);
+PA_API void paEventButton(void);
+PA_API void paEventScroll(void);
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              ELEMENT
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+#define PA_ELEMENT_NAME_MAX     128
+
+/*
+ * 
+ */
+struct pa_element {
+        /*  */
+        char    name[PA_ELEMENT_NAME_MAX];
+
+        /*  */
+        s16     parent;
+
+        /*  */
+        s16     sibling_next;
+
+        /*  */
+        s16     children_number;
+        s16     children_start;
+
+        /*  */
+        s16     broadsearch_next;
+
+        /*  */
+        s16     pipe_next;
+};
+
+
+#define PA_ELEMENT_TREE_MIN     128
+
+/*
+ * 
+ */
+struct pa_element_tree {
+        /* A list containing all elements */
+        struct pa_list          elements;
+
+        /* The z-index pipeline to handle overlap */
+        s16                     pipe_start;
+};
+
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              BATCHING
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * A patch is a representation of the final rendering instructions and contains
+ * information about size, position and possible references to required
+ * resources from the context.
+ */
+struct pa_patch {
+        char placeholder;
+};
+
+/*
+ * A batch contains multiple patches using the same material, ie. the same
+ * transparency/opaquenes, same resources, same color, etc.
+ */
+struct pa_batch {
+        char placeholder;
+};
+
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              DOCUMENT
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * General wrapper for a patchy-instance containing all necessary modules and
+ * parts.
+ * Use one per window.
+ */
+struct pa_document {
+        /*
+         * Memory manager to handle alloc, realloc, free, etc.
+         * For now it relies on the default allocation functions, but in the
+         * future it will be adapted to work with static memory and custom
+         * allocation functions.
+         */
+        struct pa_memory        memory;
+
+        struct pa_element_tree  element_tree; 
+};
+
+/*
+ * Initialize the document and prepare everything.
+ *
+ * @doc: Pointer to the document
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInit(struct pa_document *doc);
+
+
+/*
+ * Shut everything down, free all allocated memory and cleanup.
+ *
+ * @doc: Pointer to the document
+ */
+PA_API void paQuit(struct pa_document *doc);
+
+#endif /* _PATCHY_H */
+
+#ifdef PA_IMPLEMENTATION
+
+#ifndef _PATCHY_INTERNAL_H
+#define _PATCHY_INTERNAL_H
+
+
+
+/*
+ * Use SSE2 if the target supports it, unless it has been disabled by defining
+ * PA_NO_SIMD.
+ */
+#if defined(__SSE2__) && !defined(PA_NO_SIMD)
+#define PA_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * Use mmap() to map files into memory if POSIX is available, unless it has been
+ * disabled by defining PA_NO_MMAP.
+ */
+#if defined(_POSIX_C_SOURCE) && !defined(PA_NO_MMAP)
+#define PA_MMAP
+#endif
+
+/* Hint the CPU to load the memory into the cache ahead of time */
+#if defined(__GNUC__)
+#define PA_PREFETCH(p)  __builtin_prefetch(p)
+#else
+#define PA_PREFETCH(p)
+#endif
+
+/*
+ * Full memory barrier, neither the compiler nor the CPU reorder across it.
+ * Threads sharing data without a lock depend on it, so refuse to build with
+ * threads if there is no barrier. Single-threaded code needs no ordering.
+ */
+#if defined(__GNUC__)
+#define PA_BARRIER()    __sync_synchronize()
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define PA_BARRIER()    _mm_mfence()
+#elif defined(PA_PTHREADS)
+#error "PA_PTHREADS requires a compiler providing a memory barrier"
+#else
+#define PA_BARRIER()
+#endif
+
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              MEMORY
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * Initialize the memory-manager and attach the default allocation functions to
+ * it. The memory manager will therefore also be configured as dynamic.
+ *
+ * @mem: Pointer to the memory-manager
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_LIB s8 pa_mem_init_default(struct pa_memory *mem);
+
+/*
+ * Allocate memory to fit the given number of bytes. If some memory has already
+ * been allocated and is given through the pointer-parameter, the memory will
+ * instead be reallocated. In case reallocation fails, the existing memory will
+ * not be corrupted, but NULL will be returned.
+ *
+ * @mem: Poiner to the memory-manager
+ * @[p]: Current memory pointer
+ * @size: The requested number of bytes
+ *
+ * Returns: A pointer to the memory or NULL if an error occurred
+ */
+PA_LIB void *pa_mem_alloc(struct pa_memory *mem, void *p, s32 size);
+
+/*
+ * Free the allocated memory if the mode is set to dynamic. In case of static
+ * memory nothing will happen.
+ *
+ * @mem: Pointer to the memory-manager
+ * @p: Pointer to the memory-space to free
+ */
+PA_LIB void pa_mem_free(struct pa_memory *mem, void *p);
+
+/*
+ * Set the all bytes in the given memory-space.
+ *
+ * @p: Pointer to the memory-space
+ * @v: The bytes
+ * @size: The number of bytes to set
+ */
+PA_LIB void pa_mem_set(void *p, u8 v, s32 size);
+
+/*
+ * Zero all bytes in a given memory-space.
+ *
+ * @p: Pointer to the memory-space
+ * @size: The number of bytes to zero out
+ */
+PA_LIB void pa_mem_zero(void *p, s32 size);
+
+/*
+ * Copy over memory. If the source and destination overlap, this function can
+ * overwrite the source while still reading from it, so watch out for this.
+ *
+ * @dst: Pointer to the destination
+ * @src: Pointer to the source
+ * @size: The number of bytes to copy
+ */
+PA_LIB void pa_mem_copy(void *dst, void *src, s32 size);
+
+/*
+ * This will move memory while checking that the source will not be overwritten
+ * while reading from it.
+ *
+ * @dst: Pointer to the destination
+ * @src: Pointer to the source
+ * @size: The number of bytes to move
+ */
+PA_LIB void pa_mem_move(void *dst, void *src, s32 size);
+
+/*
+ * Compare two memory-buffers byte-by-byte.
+ *
+ * @ptr1: Pointer for the first memory-buffer
+ * @ptr2: Pointer to the second memory-buffer
+ *
+ * Returns: 1 if the buffers are equal and 0 if not
+ */
+PA_LIB s8 pa_mem_compare(void *ptr1, void *ptr2, s32 size);
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              STRING-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * Returns 1 for ASCII-space-character.
+ * Otherwise returns 0.
+ */
+PA_LIB s8 pa_isspace(char c);
+
+/*
+ * Returns 1 for ASCII-characters A..Z, a..z.
+ * Otherwise returns 0.
+ */
+PA_LIB s8 pa_isletter(char c);
+
+/*
+ * Returns 1 for ASCII-characters 0..9.
+ * Otherwise returns 0.
+ */
+PA_LIB s8 pa_isdigit(char c);
+
+/*
+ * Returns 1 for ASCII-characters 0..9, A..Z, a..z.
+ * Otherwise returns 0.
+ */
+PA_LIB s8 pa_ishexcode(char c);
+
+/*
+ * A wrapper for the clib-strlen function.
+ */
+PA_LIB s32 pa_strlen(char *s);
+
+/*
+ * A wrapper for the clib-strcpy function.
+ */
+PA_LIB void pa_strcpy(char *dst, char *src);
+
+/*
+ * A wrapper for the clib-strcmp function.
+ */
+PA_LIB s16 pa_strcmp(char *str1, char *str2);
+
+/*
+ * Trim the leading and trailing spaces from a string by moving the string
+ * pointer to the first character and write a null-terminator after the last
+ * character. This function will not move the characters to the beginning of the
+ * string-buffer, so watch out to not lose the pointer for the original memory.
+ *
+ * @s: Pointer to the null-terminated string to trim
+ *
+ * Returns: The updated pointer to the string 
+ */
+PA_LIB char *pa_trim(char *str);
+
+/*
+ * Remove all characters from the string, move all characters so they're
+ * consecutive and update the null-terminator. All modifications will be applied
+ * to the given string-buffer. To preserve the original state, duplicate the
+ * buffer. The original pointer for the string-buffer will not be lost.
+ *
+ * @str: Pointer to the null-terminated string to strip
+ *
+ * Returns: A pointer to the updated string
+ */
+PA_LIB char *pa_strip(char *str);
+
+/*
+ * Convert the input string containing ASCII-encoded numbers into an usable
+ * integer-value.
+ *
+ * @s: The null-terminated string containing the ASCII-encoded integer-value
+ *
+ * Returns: The resulting integer value
+ */
+PA_LIB s64 pa_atoi(char *s);
+
+/*
+ * Convert the input string containing an ASCII-encoded floating-point value
+ * into a usable float.
+ *
+ * @s: The null-terminated string containing the ASCII-encoded float-value
+ *
+ * Returns: The resulting float value
+ */
+PA_LIB f64 pa_atof(char *s);
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              BIT-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * Count the trailing zero-bits in a word. Uses the hardware bit-scan if the
+ * compiler supports it.
+ *
+ * @x: The word, must not be 0
+ *
+ * Returns: The index of the lowest set bit
+ */
+PA_LIB s8 pa_bit_ctz(u32 x);
+
+/*
+ * Count the set bits in a word. Uses the hardware popcount if the compiler
+ * supports it.
+ *
+ * @x: The word
+ *
+ * Returns: The number of set bits
+ */
+PA_LIB s8 pa_bit_popcount(u32 x);
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              HASH-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * Hash a block of memory using xxHash32. The input is processed in stripes
+ * of four 32-bit words, so long keys need only a few multiplications per
+ * 16 bytes, while short keys skip straight to the final mixing.
+ *
+ * @key: Pointer to the memory to hash
+ * @size: The number of bytes to hash
+ *
+ * Returns: The 32-bit hash
+ */
+PA_LIB u32 pa_hash(void *key, s32 size);
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              BLOOM-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * Allocate a bloom-filter sized for the given number of keys, so the
+ * false-positive rate stays close to the requested one.
+ *
+ * @flt: Pointer to the bloom-filter
+ * @mem: Pointer to the memory-manager
+ * @capacity: The number of keys the filter should hold
+ * @rate: The target false-positive rate between 0 and 1
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_LIB s8 pa_bloom_init(struct pa_bloom *flt, struct pa_memory *mem,
+                s32 capacity, f32 rate);
+
+/*
+ * Free the memory of the bloom-filter and disable it.
+ *
+ * @flt: Pointer to the bloom-filter
+ * @mem: Pointer to the memory-manager
+ */
+PA_LIB void pa_bloom_destroy(struct pa_bloom *flt, struct pa_memory *mem);
+
+/*
+ * Add a key to the bloom-filter.
+ *
+ * @flt: Pointer to the bloom-filter
+ * @hash: The 32-bit hash of the key
+ */
+PA_LIB void pa_bloom_add(struct pa_bloom *flt, u32 hash);
+
+/*
+ * Check if a key might be in the bloom-filter.
+ *
+ * @flt: Pointer to the bloom-filter
+ * @hash: The 32-bit hash of the key
+ *
+ * Returns: 0 if the key is definitely not in the filter and 1 if it might be
+ */
+PA_LIB s8 pa_bloom_test(struct pa_bloom *flt, u32 hash);
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              KEYWORD-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * A minimal perfect hash table for a fixed set of keywords. The tables are
+ * generated by build.py from patchy_keyword.txt into patchy_keyword.c, so
+ * every keyword maps to its own slot and a lookup needs one hash and one
+ * compare.
+ */
+struct pa_keyword_set {
+        s16 number;             /* The number of keywords */
+        s16 buckets;            /* The number of displacements */
+        const u16 *disp;        /* The displacement for every bucket */
+        const char *const *keys;/* The keyword in every slot */
+        const s32 *values;      /* The value for every slot */
+};
+
+PA_LIB const struct pa_keyword_set pa_kwd_unit;
+PA_LIB const struct pa_keyword_set pa_kwd_tag;
+
+/*
+ * Look up a keyword in a keyword-set.
+ *
+ * @set: Pointer to the keyword-set
+ * @s: The keyword, doesn't have to be null-terminated
+ * @len: The length of the keyword in bytes
+ *
+ * Returns: The value for the keyword or -1 if it's not in the set
+ */
+PA_LIB s32 pa_kwd_find(const struct pa_keyword_set *set, char *s, s32 len);
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              ELEMENT
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * Initialize the element-tree with the minimum of slots.
+ *
+ * @tree: Pointer to the tree struct
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_LIB s8 pa_etr_init(struct pa_element_tree *tree);
+
+
+/*
+ * Free the allocated memory and destroy the element-tree.
+ *
+ * @tree: Pointer to the element-tree
+ */
+PA_LIB void pa_etr_destroy(struct pa_element_tree *tree);
+
+
+/*
+ * Get the tag-type for the name of a tag.
+ *
+ * @name: The null-terminated name of the tag
+ *
+ * Returns: The tag-type or PA_UNDEF if the name is unknown
+ */
+PA_LIB enum pa_tag_type pa_tag_by_name(char *name);
+
+
+/*
+ * Reserve memory for a new element. Nothing will be initialized.
+ *
+ * @doc: Pointer to the document
+ *
+ * Returns: Pointer to the memory space for the new element or NULL if an error
+ *          occurred
+ */
+PA_LIB struct pa_Element *pa_ele_new(struct pa_document *doc);
+
+
+/*
+ * Get a pointer to an element through the index.
+ *
+ * @doc: Pointer to the document
+ *
+ * Returns: Either a pointer to the element at the given index or NULL if an
+ *          error occurred
+ */
+PA_LIB struct pa_Element *pa_ele_by_index(struct pa_document *doc, s16 idx);
+
+
+#endif /* _PATCHY_INTERNAL_H */
+
+/*
+ * Generated by build.py from patchy_keyword.txt, do not edit!
+ */
+
+
+
+
+static const u16 kwd_unit_disp[] = {
+        2,
+        0
+};
+
+static const char *const kwd_unit_keys[] = {
+        "pct",
+        "em",
+        "px"
+};
+
+static const s32 kwd_unit_values[] = {
+        0x13,
+        0x14,
+        0x12
+};
+
+const struct pa_keyword_set pa_kwd_unit = {
+        3, 2,
+        kwd_unit_disp,
+        kwd_unit_keys,
+        kwd_unit_values
+};
+
+static const u16 kwd_tag_disp[] = {
+        0,
+        0,
+        8
+};
+
+static const char *const kwd_tag_keys[] = {
+        "text",
+        "custom",
+        "body",
+        "input",
+        "block",
+        "image"
+};
+
+static const s32 kwd_tag_values[] = {
+        PA_TEXT,
+        PA_CUSTOM,
+        PA_BODY,
+        PA_INPUT,
+        PA_BLOCK,
+        PA_IMAGE
+};
+
+const struct pa_keyword_set pa_kwd_tag = {
+        6, 3,
+        kwd_tag_disp,
+        kwd_tag_keys,
+        kwd_tag_values
+};
+
+
+
+
+
+#include <stdio.h>
+
+#ifdef PA_PTHREADS
+#include <pthread.h>
+#endif
+
+#ifdef PA_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      STRING
+ *
+ */
+
+/*
+ * The number of trailing bytes for every byte in a UTF8-encoded sequence.
+ * To get the total size of a sequence, get the trailing bytes and add one.
+ *
+ * Binary    Hex         Comments
+ * 0xxxxxxx  0x00..0x7F  Only byte of a 1-byte character encoding
+ * 10xxxxxx  0x80..0xBF  Continuation byte: one of 1-3 bytes following the first
+ * 110xxxxx  0xC0..0xDF  First byte of a 2-byte character encoding
+ * 1110xxxx  0xE0..0xEF  First byte of a 3-byte character encoding
+ * 11110xxx  0xF0..0xF7  First byte of a 4-byte character encoding
+ */
+PA_INTERN const char str_trailing_bytes[256] = {
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+        2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2, 3,3,3,3,3,3,3,3,4,4,4,4,5,5,5,5
+};
+
+PA_INTERN const u32 str_offset_utf8[6] = {
+        0x00000000UL, 0x00003080UL, 0x000E2080UL,
+        0x03C82080UL, 0xFA082080UL, 0x82082080UL
+};
+
+PA_INTERN s16 str_sequence_size(char *s)
+{
+        return str_trailing_bytes[*(u8 *)s] + 1;
+}
+
+PA_INTERN u32 str_next(char *s, s32 *off)
+{
+        u32 ch = 0;
+        s32 sz = 0;
+
+        do {
+                ch <<= 6;
+                ch += (u8)s[(*off)++];
+                sz++;
+        } while(s[*off] && !PA_ISUTF(s[*off]));
+
+        ch -= str_offset_utf8[sz-1];
+        return ch;
+}
+
+PA_INTERN s16 str_length(char *s)
+{
+        s16 count = 0;
+        s32 i = 0;
+
+        if(s == NULL || pa_strlen(s) == 0)
+                return 0;
+
+        while(str_next(s, &i) != 0)
+                count++;
+
+        return count;
+}
+
+/* charnum => byte offset */
+PA_INTERN s32 str_offset(char *s, s16 charnum)
+{
+        s16 offs = 0;
+
+        while(charnum > 0 && s[offs]) {
+                (void)(PA_ISUTF(s[++offs]) || PA_ISUTF(s[++offs]) ||
+                                PA_ISUTF(s[++offs]) || ++offs);
+                charnum--;
+        }
+
+        return offs;
+}
+
+/* byte offset => charnum */
+PA_INTERN s16 str_charnum(char *s, s32 offset)
+{
+        s16 charnum = 0;
+        s32 offs = 0;
+
+        while(offs < offset && s[offs]) {
+                (void)(PA_ISUTF(s[++offs]) || PA_ISUTF(s[++offs]) ||
+                                PA_ISUTF(s[++offs]) || ++offs);
+                charnum++;
+        }
+
+        return charnum;
+}
+
+PA_INTERN void str_inc(char *s, int *i)
+{
+        (void)(PA_ISUTF(s[++(*i)]) || PA_ISUTF(s[++(*i)]) ||
+                        PA_ISUTF(s[++(*i)]) || ++(*i));
+}
+
+PA_INTERN void str_dec(char *s, int *i)
+{
+        (void)(PA_ISUTF(s[--(*i)]) || PA_ISUTF(s[--(*i)]) || 
+                        PA_ISUTF(s[--(*i)]) || --(*i));
+}
+
+PA_INTERN void str_ensure_fit(struct pa_string *str, s32 size)
+{
+        s32 new_alloc;
+        void *p;
+
+        if(size < 1)
+                return;
+
+        if(str->size + size + 1 > str->alloc && str->mode == PA_DYNAMIC) {
+                new_alloc = (str->size + size) * 1.5;
+                if(!(p = pa_mem_alloc(str->memory, str->buffer, new_alloc))) {
+                        return;
+                }
+                str->buffer = p;
+                str->alloc = new_alloc;
+        }
+}
+
+
+
+PA_API s8 paInitString(struct pa_string *str, struct pa_memory *mem)
+{
+        str->memory = mem;
+        str->mode = PA_DYNAMIC;
+
+        str->length = 0;
+        str->size = 0;
+        str->alloc = PA_STRING_INITIAL_SIZE;
+
+        if(!(str->buffer = pa_mem_alloc(str->memory, NULL, str->alloc))) {
+                return -1;
+        }
+        *str->buffer = 0;
+
+        return 0;
+}
+
+PA_API s8 paInitStringFixed(struct pa_string *str, void *buf, s32 alloc)
+{
+        str->memory = NULL;
+        str->mode = PA_FIXED;
+
+        str->buffer = buf;
+        *str->buffer = 0;
+
+        str->length = 0;
+        str->size = 0;
+        str->alloc = alloc;
+        return 0;
+}
+
+PA_API void paDestroyString(struct pa_string *str)
+{
+        if(str->mode == PA_DYNAMIC) {
+                pa_mem_free(str->memory, str->buffer);
+        }
+
+        str->buffer = NULL;
+        str->length = 0;
+        str->size = 0;
+        str->alloc = 0;
+}
+
+PA_API s16 paWriteString(struct pa_string *str, char *src, s16 off, s16 num)
+{
+        s32 free_size;
+        s32 read_sz;
+        s32 write_off;
+        s32 write_sz;
+        s32 run;
+        s16 count;
+
+        s16 overlap;
+        s32 overlap_sz;
+
+        s32 trail_sz;
+
+        /* First we figure out how many bytes should be read from the source */
+        if(num == PA_ALL) {
+                read_sz = pa_strlen(src);
+                num = str_charnum(src, read_sz);
+        }
+        else {
+                read_sz = str_offset(src, num);
+        }
+
+        /* Second, we figure out what the offset should be */
+        off = off == PA_END ? str->length : off;
+        write_off = paGetStringOffset(str, off);
+
+        /* Validate input parameters */
+        if(read_sz < 1) return 0;
+        if(off < 0 || off > str->length) return 0;
+
+        /* Next we figure out the overlap */
+        overlap = PA_OVERLAP(0, str->length, off, num);
+        overlap_sz = str_offset(str->buffer + write_off, overlap);  
+
+        /* Scale the string-buffer to fit the new characters */
+        str_ensure_fit(str, read_sz - overlap_sz);
+
+        /* 
+         * Determine how much free memory is left (subtract 1 for the
+         * null-terminator).
+         */
+        free_size = str->alloc - str->size - 1 + overlap_sz;
+
+
+        /* Now we have to figure out how many characters can actually we written
+         * to the string buffer.
+         */
+        run = 0;
+        count = 0;
+        write_sz = 0;
+        while(str_next(src, &run) && run <= free_size && run <= read_sz) {
+                write_sz = run;
+                count++;
+        }
+        num = count;
+
+        /* 
+         * Before we can actually copy to the string buffer, we have to move the
+         * trailing characters.
+         */
+        trail_sz = str->size - (write_off + overlap_sz);
+        if(trail_sz > 0) {
+                pa_mem_move(str->buffer + write_off + write_sz, 
+                                str->buffer + (str->size - trail_sz),
+                                trail_sz);
+        }
+
+        /* Copy from source to the string buffer */
+        pa_mem_copy(str->buffer + write_off, src, write_sz);
+
+        /* Update string byte-size and set null-terminator */
+        str->size += write_sz - overlap_sz;
+        str->length += num - overlap;
+        str->buffer[str->size] = 0;
+
+        /* Return number of written bytes */
+        return num;
+}
+
+PA_API s16 paInsertString(struct pa_string *str, char *src, s16 off, s16 num)
+{
+        s32 free_size;
+        s16 read_num;
+        s32 read_sz;
+        s32 write_off;
+        s32 write_sz;
+        s32 run;
+        s32 move_off;
+        s32 move_sz;
+        s16 count;
+
+        /* First we figure out how many bytes should be read from the source */
+        if(num == PA_ALL) {
+                read_sz = pa_strlen(src);
+                read_num = str_charnum(src, read_sz);
+        }
+        else {
+                read_sz = str_offset(src, num);
+                read_num = num;
+        }
+
+        /* Second, we figure out what the offset should be */
+        off = off == PA_END ? str->length : off;
+        write_off = str_offset(str->buffer, off);
+
+        /* If the string is dynamic, scale the buffer to fit new characters */
+        str_ensure_fit(str, read_sz);
+
+        /* 
+         * Then we determine how much free memory is actually left in the
+         * string(also subtract 1 for the null-terminator).
+         */
+        free_size = str->alloc - str->size - 1;
+
+        /* Now we have to figure out how many characters can actually we written
+         * to the string buffer.
+         */
+        run = 0;
+        count = 0;
+        while(str_next(src, &run) && run <= free_size && run <= read_sz) {
+                write_sz = run;
+                count++;
+        }
+        read_num = count;
+
+        /* 
+         * Determine the size of the trailing block which has to be moved and
+         * move it.
+         */
+        move_sz = str->size - write_off;
+        if(move_sz > 0) {
+                move_off = write_off + write_sz;
+                pa_mem_move(str->buffer + move_off, str->buffer + write_off,
+                                move_sz);
+        }
+
+        /* Copy from source to the string buffer */
+        pa_mem_copy(str->buffer + write_off, src, write_sz);
+
+        /* Update string byte-size and set null-terminator */
+        str->size += write_sz;
+        str->length += read_num;
+        str->buffer[str->size] = 0;
+
+        /* Return number of written bytes */
+        return num;
+}
+
+PA_API s16 paCopyString(struct pa_string *str, char *dst, s16 off,
+                s16 num, s32 lim)
+{
+        s32 trail;
+        s32 copy_sz;
+        s32 copy_off;
+        s16 count;
+
+        if(off >= str->length) return 0;
+
+        /* Resolve input parameters */
+        trail = str->length - off;
+        num = num == PA_ALL ? trail : num;
+        num = num > trail ? trail : num;
+
+        /* Calculate the size and offset for the characters in the string */
+        copy_off = str_offset(str->buffer, off);
+        copy_sz = str_offset(str->buffer + copy_off, num);
+
+        /* Reduce character count to keep in the limit */
+        count = 0;
+        while(copy_sz > lim) {
+                str_dec(str->buffer, &copy_sz);
+                count++;
+        }
+        num -= count;
+
+        /* Copy over the characters and set null-terminator in output-buffer */
+        pa_mem_copy(dst, str->buffer + copy_off, copy_sz);
+        dst[copy_sz] = 0;
+
+        /* Return the number of copied characters */
+        return num;
+}
+
+PA_API s16 paReadString(struct pa_string *str, char *dst, s16 off,
+                s16 num, s32 lim)
+{
+        s16 trail;
+        s32 read_off;
+        s32 read_sz;
+        s32 move_off;
+        s32 move_sz;
+        s16 count;
+
+        if(off >= str->length) return 0;
+
+        /* Resolve input parameters */
+        trail = str->length - off;
+        num = num == PA_ALL ? trail : num;
+        num = num > trail ? trail : num;
+
+        /* Calculate the size and offset for the characters in the string */
+        read_off = str_offset(str->buffer, off);
+        read_sz = str_offset(str->buffer + read_off, num);
+
+        /* Reduce character count to keep in the limit */
+        count = 0;
+        while(read_sz > lim) {
+                str_dec(str->buffer, &read_sz);
+                count++;
+        }
+        num -= count;
+
+        /* Copy over the characters and set null-terminator in output-buffer */
+        pa_mem_copy(dst, str->buffer + read_off, read_sz);
+        dst[read_sz] = 0;
+
+        /* Calculate the size and new offset for the trailing block */
+        move_sz = str->size - read_off;
+        move_off = read_off + read_sz;
+
+        /* Move the trailing block forward to fill the gap */
+        pa_mem_move(str->buffer + read_off, str->buffer + move_off,
+                        move_sz);
+
+        /* Update string byte-size and set null-terminator */
+        str->size -= read_sz;
+        str->length -= num;
+        str->buffer[str->size] = 0;
+
+        /* Return the number of read bytes */
+        return num;
+}
+
+PA_API s16 paGetStringCharacter(struct pa_string *str, s32 off)
+{
+        s16 charnum = 0;
+        s16 offs = 0;
+        char *s = str->buffer;
+
+        while(offs < off && s[offs]) {
+                (void)(PA_ISUTF(s[++offs]) || PA_ISUTF(s[++offs]) ||
+                                PA_ISUTF(s[++offs]) || ++offs);
+                charnum++;
+        }
+
+        return charnum;
+}
+
+PA_API s32 paGetStringOffset(struct pa_string *str, s16 cnum)
+{
+        s32 offs = 0;
+        char *s = str->buffer;
+
+        while(cnum > 0 && s[offs]) {
+                (void)(PA_ISUTF(s[++offs]) || PA_ISUTF(s[++offs]) ||
+                                PA_ISUTF(s[++offs]) || ++offs);
+                cnum--;
+        }
+
+        return offs;
+}
+
+PA_API u32 paNextStringChar(struct pa_string *str, s32 *off)
+{
+        return str_next(str->buffer, off);
+}
+
+PA_API char *paIterateString(struct pa_string *str, char *chr)
+{
+        if(chr == NULL)
+                return str->buffer;
+
+        if(*chr == 0)
+                return NULL;
+
+        return chr + str_sequence_size(chr);
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      LIST
+ *
+ */
+
+PA_INTERN void lst_ensure_fit(struct pa_list *lst, s32 num)
+{
+        s32 new_num = lst->count + num;
+        s32 new_alloc;
+        s32 new_size;
+        void *p;
+
+        if(lst->mode != PA_DYNAMIC)
+                return;
+
+        if(new_num < lst->alloc)
+                return;
+
+        new_alloc = new_num * 1.5; 
+        new_size = new_alloc * lst->entry_size;
+
+        if(lst->limit > 0) {
+                new_size = PA_MIN(new_size, lst->limit);
+
+                if(new_size == lst->alloc_size)
+                        return;
+        }
+
+
+        if(!(p = pa_mem_alloc(lst->memory, lst->data, new_size)))
+                return;
+
+        lst->data = p;
+        lst->alloc = new_alloc;
+        lst->alloc_size = new_size;
+}
+
+PA_LIB s8 paInitList(struct pa_list *lst, struct pa_memory *mem, 
+                s32 size, s16 alloc, s32 lim)
+{
+        lst->memory = mem;
+        lst->mode = PA_DYNAMIC;
+        lst->entry_size = size;
+        lst->count = 0;
+        lst->alloc = alloc;
+        lst->alloc_size = lst->alloc * lst->entry_size;
+        lst->limit = lim;
+
+        if(!(lst->data = pa_mem_alloc(lst->memory, NULL, lst->alloc_size))) {
+                return -1;
+        }
+
+        paClearList(lst);
+        return 0;
+}
+
+PA_LIB s8 paInitListFixed(struct pa_list *lst, s16 size, void *buf, s32 buf_sz)
+{
+        lst->memory = NULL;
+        lst->mode = PA_FIXED;
+        lst->entry_size = size;
+        lst->count = 0;
+        lst->alloc = buf_sz / size; /* Calculate the number of usable slots */
+        lst->alloc_size = buf_sz;
+        lst->data = buf;
+        lst->limit = PA_NOLIM;
+
+        paClearList(lst);
+        return 0;
+}
+
+PA_LIB void paDestroyList(struct pa_list *lst)
+{
+        if(lst->mode == PA_DYNAMIC) {
+                pa_mem_free(lst->memory, lst->data);
+        }
+}
+
+PA_LIB void paClearList(struct pa_list *lst)
+{
+        pa_mem_set(lst->data, 0, lst->alloc * lst->entry_size);
+
+        lst->count = 0;
+}
+
+PA_LIB s16 paPushList(struct pa_list *lst, void *src, s16 num)
+{
+        s16 open_slots;
+        s16 entry_number;
+        s32 offset;
+        s32 size;
+
+        /* If configured as dynamic, scale to fit new entries */
+        lst_ensure_fit(lst, num);
+
+        /* Figure out how many entries can be written to the list */
+        open_slots = lst->alloc - lst->count;
+        entry_number = num > open_slots ? open_slots : num;
+
+        /* Copy entries to list */
+        offset = lst->count * lst->entry_size;
+        size = entry_number * lst->entry_size;
+        pa_mem_copy(lst->data + offset, src, size);
+
+        /* Update number of entries in list and return number of written */
+        lst->count += entry_number;
+        return entry_number;
+}
+
+PA_LIB s16 paPopList(struct pa_list *lst, void *dst, s16 num)
+{
+        s16 entry_number;
+        s32 size;
+        s32 offset;
+
+        /* Figure out how many entries can be returned */
+        entry_number = num > lst->count ? lst->count : num;
+
+        /* Copy entries from list */
+        size = entry_number * lst->entry_size;
+        offset = (lst->count * lst->entry_size) - size;
+        pa_mem_copy(dst, lst->data + offset, size);
+
+        /* Update the number of entries in the list and return */
+        lst->count -= entry_number;
+        return entry_number;
+}
+
+PA_LIB s16 paUnshiftList(struct pa_list *lst, void *src, s16 num)
+{
+        s16 open_slots;
+        s16 entry_number;
+        s32 size;
+        s32 move_sz;
+
+        /* If configured as dynamic, scale to fit new entries */
+        lst_ensure_fit(lst, num);
+
+        /* Figure out how many entries can be written to the list */
+        open_slots = lst->alloc - lst->count;
+        entry_number = num > open_slots ? open_slots : num;
+        size = entry_number * lst->entry_size;
+
+        /* Move all entries back to make space at the beginning */
+        move_sz = lst->count * lst->entry_size;
+        pa_mem_move(lst->data + size, lst->data, move_sz);
+
+        /* Now copy over the data from the source */
+        pa_mem_copy(lst->data, src, size);
+
+        /* Update the number of entries in the list and return */
+        lst->count += entry_number;
+        return entry_number;
+}
+
+PA_LIB s16 paShiftList(struct pa_list *lst, void *dst, s16 num)
+{
+        s16 entry_number;
+        s16 entry_left;
+        s32 size;
+        s32 offset;
+
+        /* Figure out how many entries can be returned */
+        entry_number = num > lst->count ? lst->count : num;
+
+        /* Copy entries from list */
+        size = entry_number * lst->entry_size;
+        pa_mem_copy(dst, lst->data, size);
+
+        /* Move the rest of the entries forward to close the gap */
+        entry_left = lst->count - entry_number;
+        if(entry_left > 0) {
+                offset = size;
+                size = entry_left * lst->entry_size;
+                pa_mem_move(lst->data, lst->data + offset, size);
+        }
+
+        /* Update the number of entries in the list and return */
+        lst->count -= entry_number;
+        return entry_number;
+}
+
+PA_LIB s16 paInsertList(struct pa_list *lst, void *src, s16 start, s16 num)
+{
+        s16 open_slots;
+        s16 entry_number;
+        s32 offset;
+        s32 size;
+        s32 move_off;
+        s32 move_sz;
+
+        if(start == PA_END) {
+                start = lst->count;
+        }
+
+        /* If configured as dynamic, scale to fit new entries */
+        lst_ensure_fit(lst, num);
+
+        /* Figure out how many entries can be inserted into the list */
+        open_slots = lst->alloc - lst->count;
+        entry_number = num > open_slots ? open_slots : num;
+        size = entry_number * lst->entry_size;
+        offset = start * lst->entry_size;
+
+        /* Move entries back to make space */
+        move_sz = (lst->count - start) * lst->entry_size;
+        move_off = offset + size;
+        pa_mem_move(lst->data + move_off, lst->data + offset, move_sz);
+
+        /* Copy over the entries from the source */
+        pa_mem_copy(lst->data + offset, src, size);
+
+        /* Update the number of entries in the list and return */
+        lst->count += entry_number;
+        return entry_number;
+}
+
+PA_LIB s16 paPeekList(struct pa_list *lst, void *dst, s16 start, s16 num)
+{
+        s16 entry_number;
+        s16 entry_left;
+        s32 offset;
+        s32 size;
+
+        /* Figure out how many entries can actually be returned */
+        entry_left = lst->count - start;
+        entry_number = num > entry_left ? entry_left : num;
+
+        /* Copy over the entries */
+        offset = start * lst->entry_size;
+        size = entry_number * lst->entry_size;
+        pa_mem_copy(dst, lst->data + offset, size);
+
+        /* Return the number of returned entries */
+        return entry_number;
+}
+
+PA_LIB s16 paGetList(struct pa_list *lst, void *dst, s16 start, s16 num)
+{
+        s16 entry_left;
+        s16 entry_number;
+        s32 offset;
+        s32 size;
+        s32 move_off;
+        s32 move_sz;
+
+        /* Figure out how many entries can actually be returned */
+        entry_left = lst->count - start;
+        entry_number = num > entry_left ? entry_left : num;
+
+        /* Copy over the entries */
+        offset = start * lst->entry_size;
+        size = entry_number * lst->entry_size;
+        pa_mem_copy(dst, lst->data + offset, size);
+
+        /* Move back the entries to fill the gap */
+        move_off = offset + size;
+        move_sz = (lst->count - (start + entry_number)) * lst->entry_size;
+        pa_mem_move(lst->data + offset, lst->data + move_off, move_sz);
+
+        /* Update the number of entries in the list and return */
+        lst->count -= entry_number;
+        return entry_number;
+}
+
+PA_API s16 paCopyList(struct pa_list *dst, struct pa_list *src,
+                s16 dst_off, s16 src_off, s16 num)
+{
+        s16 read_num;
+        s16 write_num;
+        s32 read_off;
+        s32 write_free;
+        s32 write_off;
+        s32 size;
+        s16 overlap;
+
+        /* Validate input parameters */
+        if(src_off < 0 || src_off >= src->count) return -1;
+        if(dst_off < -1 || dst_off > dst->count) return -1;
+        if(src->entry_size != dst->entry_size) return -1;
+
+        /* Resolve parameters */
+        dst_off = dst_off == PA_END ? dst->count : dst_off;
+        num = num == PA_ALL ? (src->count - src_off) : num;
+
+        /* Figure out the potential overlap in the destination-list */
+        overlap = PA_OVERLAP(0, dst->count, dst_off, num);
+
+        /* Scale to fit new entries */
+        lst_ensure_fit(dst, num - overlap);
+
+        /* Calculate how many entries can be actually be copied */
+        read_num = src->count - src_off;
+        write_free = (dst->alloc - dst->count) + overlap;
+        num = PA_MIN(num, PA_MIN(read_num, write_free));
+
+        /* Copy over the entries to the source */
+        size = src->entry_size * num;
+        read_off = src_off * src->entry_size;
+        write_off = dst_off * src->entry_size;
+        pa_mem_copy(dst->data + write_off, src->data + read_off, size);
+
+        /* Update the number of entries in the destionation-list and return */
+        dst->count += num - overlap;
+        return num;
+}
+
+PA_API void *paIterateList(struct pa_list *lst, void *ptr)
+{
+        /* First step, set pointer to beginning of data buffer */
+        if(ptr == NULL) {
+                return lst->data;
+        }
+
+        /* Increment the pointer */
+        ptr = (void *)((u8 *)ptr + lst->entry_size);
+
+        /* Check if the pointer has reached the end of the line */
+        if((u8 *)ptr >= lst->data + (lst->count * lst->entry_size)) {
+                return NULL;
+        }
+
+        return ptr;
+}
+
+PA_API void paApplyList(struct pa_list *lst, pa_list_func fnc, void *pass)
+{
+        s32 i;
+        struct pa_handle hdl;
+
+
+        for(i = 0; i < lst->count; i++) {
+                hdl.pointer = lst->data + (i * lst->entry_size);
+                hdl.index = i;
+                if(fnc(&hdl, pass)) return;
+        }
+}
+
+PA_API void paApplyListBack(struct pa_list *lst, pa_list_func fnc, void *pass)
+{
+        s32 i;
+        struct pa_handle hdl;
+
+
+        for(i = lst->count - 1; i >= 0; i--) {
+                hdl.pointer = lst->data + (i * lst->entry_size);
+                hdl.index = i;
+                if(fnc(&hdl, pass)) return;
+        }
+}
+
+/*
+ * Get a pointer to the entry at the given index.
+ */
+PA_INTERN u8 *lst_at(struct pa_list *lst, s32 idx)
+{
+        return lst->data + idx * lst->entry_size;
+}
+
+/*
+ * Swap two entries byte by byte, so no temporary entry is needed.
+ */
+PA_INTERN void lst_swap(struct pa_list *lst, s32 a, s32 b)
+{
+        u8 *pa = lst_at(lst, a);
+        u8 *pb = lst_at(lst, b);
+        u8 tmp;
+        s32 i;
+
+        if(a == b)
+                return;
+
+        for(i = 0; i < lst->entry_size; i++) {
+                tmp = pa[i];
+                pa[i] = pb[i];
+                pb[i] = tmp;
+        }
+}
+
+PA_INTERN void lst_insertion_sort(struct pa_list *lst, s32 lo, s32 hi,
+                pa_list_compare cmp)
+{
+        s32 i;
+        s32 j;
+
+        for(i = lo + 1; i <= hi; i++) {
+                for(j = i; j > lo; j--) {
+                        if(cmp(lst_at(lst, j - 1), lst_at(lst, j)) <= 0)
+                                break;
+
+                        lst_swap(lst, j - 1, j);
+                }
+        }
+}
+
+PA_INTERN void lst_sift_down(struct pa_list *lst, s32 lo, s32 root, s32 num,
+                pa_list_compare cmp)
+{
+        s32 child;
+
+        while((child = 2 * root + 1) < num) {
+                if(child + 1 < num && cmp(lst_at(lst, lo + child),
+                                        lst_at(lst, lo + child + 1)) < 0)
+                        child++;
+
+                if(cmp(lst_at(lst, lo + root), lst_at(lst, lo + child)) >= 0)
+                        return;
+
+                lst_swap(lst, lo + root, lo + child);
+                root = child;
+        }
+}
+
+PA_INTERN void lst_heap_sort(struct pa_list *lst, s32 lo, s32 hi,
+                pa_list_compare cmp)
+{
+        s32 num = hi - lo + 1;
+        s32 i;
+
+        for(i = num / 2 - 1; i >= 0; i--)
+                lst_sift_down(lst, lo, i, num, cmp);
+
+        for(i = num - 1; i > 0; i--) {
+                lst_swap(lst, lo, lo + i);
+                lst_sift_down(lst, lo, 0, i, cmp);
+        }
+}
+
+/*
+ * Move the median of the first, middle and last entry to the front, so it can
+ * be used as pivot.
+ */
+PA_INTERN void lst_median_to_front(struct pa_list *lst, s32 lo, s32 hi,
+                pa_list_compare cmp)
+{
+        s32 mid = lo + (hi - lo) / 2;
+
+        if(cmp(lst_at(lst, mid), lst_at(lst, lo)) < 0)
+                lst_swap(lst, mid, lo);
+        if(cmp(lst_at(lst, hi), lst_at(lst, lo)) < 0)
+                lst_swap(lst, hi, lo);
+        if(cmp(lst_at(lst, hi), lst_at(lst, mid)) < 0)
+                lst_swap(lst, hi, mid);
+
+        /* Now lo <= mid <= hi, so use mid as pivot */
+        lst_swap(lst, lo, mid);
+}
+
+PA_INTERN void lst_intro_sort(struct pa_list *lst, s32 lo, s32 hi, s32 depth,
+                pa_list_compare cmp)
+{
+        s32 i;
+        s32 j;
+
+        while(hi - lo > 16) {
+                if(depth-- == 0) {
+                        lst_heap_sort(lst, lo, hi, cmp);
+                        return;
+                }
+
+                /*
+                 * Partition around the pivot at lo. Both sides stop on equal
+                 * entries, so lists with many equal entries are split evenly.
+                 */
+                lst_median_to_front(lst, lo, hi, cmp);
+                i = lo;
+                j = hi + 1;
+                while(1) {
+                        while(cmp(lst_at(lst, ++i), lst_at(lst, lo)) < 0)
+                                if(i == hi) break;
+                        while(cmp(lst_at(lst, lo), lst_at(lst, --j)) < 0)
+                                if(j == lo) break;
+                        if(i >= j) break;
+                        lst_swap(lst, i, j);
+                }
+                lst_swap(lst, lo, j);
+
+                /* Recurse into the smaller part, loop on the bigger one */
+                if(j - lo < hi - j) {
+                        lst_intro_sort(lst, lo, j - 1, depth, cmp);
+                        lo = j + 1;
+                }
+                else {
+                        lst_intro_sort(lst, j + 1, hi, depth, cmp);
+                        hi = j - 1;
+                }
+        }
+
+        lst_insertion_sort(lst, lo, hi, cmp);
+}
+
+/*
+ * Read the digit of the key in the given entry. Digit 0 is the least
+ * significant byte. For signed keys the sign-bit is flipped, so negative keys
+ * come first.
+ */
+PA_INTERN u32 lst_key_digit(u8 *ptr, s16 size, s16 digit, s8 sign)
+{
+        u64 key;
+        u32 byte;
+
+        switch(size) {
+                case 1: key = *(u8 *)ptr; break;
+                case 2: key = *(u16 *)ptr; break;
+                case 4: key = *(u32 *)ptr; break;
+                default: key = *(u64 *)ptr; break;
+        }
+
+        byte = (key >> (digit * 8)) & 0xFF;
+        if(sign && digit == size - 1)
+                byte ^= 0x80;
+
+        return byte;
+}
+
+PA_INTERN void lst_radix_insertion(struct pa_list *lst, s32 lo, s32 hi,
+                s16 off, s16 size, s8 sign)
+{
+        s32 i;
+        s32 j;
+        s16 d;
+        u32 da;
+        u32 db;
+
+        for(i = lo + 1; i <= hi; i++) {
+                for(j = i; j > lo; j--) {
+                        /* Compare the keys digit by digit */
+                        for(d = size - 1; d >= 0; d--) {
+                                da = lst_key_digit(lst_at(lst, j - 1) + off,
+                                                size, d, sign);
+                                db = lst_key_digit(lst_at(lst, j) + off,
+                                                size, d, sign);
+                                if(da != db) break;
+                        }
+                        if(d < 0 || da < db) break;
+                        lst_swap(lst, j - 1, j);
+                }
+        }
+}
+
+/*
+ * Sort the range [lo, hi) by the given digit in-place and then recurse into
+ * every bucket with the next lower digit (American flag sort).
+ */
+PA_INTERN void lst_radix_sort(struct pa_list *lst, s32 lo, s32 hi, s16 off,
+                s16 size, s16 digit, s8 sign)
+{
+        s32 count[256];
+        s32 head[256];
+        s32 tail[256];
+        s32 i;
+        u32 b;
+        u32 d;
+
+        if(hi - lo <= 32) {
+                lst_radix_insertion(lst, lo, hi - 1, off, size, sign);
+                return;
+        }
+
+        /* Count the entries for every bucket */
+        for(b = 0; b < 256; b++)
+                count[b] = 0;
+
+        for(i = lo; i < hi; i++)
+                count[lst_key_digit(lst_at(lst, i) + off, size, digit, sign)]++;
+
+        head[0] = lo;
+        for(b = 0; b < 256; b++) {
+                if(b > 0) head[b] = tail[b - 1];
+                tail[b] = head[b] + count[b];
+        }
+
+        /* Move every entry into its bucket by swapping */
+        for(b = 0; b < 256; b++) {
+                while(head[b] < tail[b]) {
+                        d = lst_key_digit(lst_at(lst, head[b]) + off, size,
+                                        digit, sign);
+                        if(d == b) {
+                                head[b]++;
+                        }
+                        else {
+                                lst_swap(lst, head[b], head[d]);
+                                head[d]++;
+                        }
+                }
+        }
+
+        if(digit == 0)
+                return;
+
+        /* Sort every bucket by the next digit */
+        for(b = 0; b < 256; b++) {
+                if(count[b] > 1) {
+                        lst_radix_sort(lst, tail[b] - count[b], tail[b], off,
+                                        size, digit - 1, sign);
+                }
+        }
+}
+
+PA_API void paSortList(struct pa_list *lst, pa_list_compare cmp)
+{
+        s32 depth = 0;
+        s32 n;
+
+        if(lst->count < 2)
+                return;
+
+        /* Fall back to heapsort after 2*log2(n) levels */
+        for(n = lst->count; n > 1; n >>= 1)
+                depth += 2;
+
+        lst_intro_sort(lst, 0, lst->count - 1, depth, cmp);
+}
+
+PA_API s8 paSortListKey(struct pa_list *lst, s16 off, s16 size, s8 sign)
+{
+        /* Validate input parameters */
+        if(size != 1 && size != 2 && size != 4 && size != 8)
+                return -1;
+        /* u64 is only 4 bytes wide on LLP64 and 32-bit targets */
+        if(size > (s16)sizeof(u64))
+                return -1;
+        if(off < 0 || off + size > lst->entry_size)
+                return -1;
+
+        if(lst->count < 2)
+                return 0;
+
+        lst_radix_sort(lst, 0, lst->count, off, size, size - 1, sign);
+        return 0;
+}
+
+PA_API s16 paLowerBoundList(struct pa_list *lst, void *key,
+                pa_list_compare cmp)
+{
+        s32 lo = 0;
+        s32 hi = lst->count;
+        s32 mid;
+
+        while(lo < hi) {
+                mid = lo + (hi - lo) / 2;
+                if(cmp(lst_at(lst, mid), key) < 0)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        return lo;
+}
+
+PA_API s16 paUpperBoundList(struct pa_list *lst, void *key,
+                pa_list_compare cmp)
+{
+        s32 lo = 0;
+        s32 hi = lst->count;
+        s32 mid;
+
+        while(lo < hi) {
+                mid = lo + (hi - lo) / 2;
+                if(cmp(lst_at(lst, mid), key) <= 0)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        return lo;
+}
+
+PA_API s16 paInsertListSorted(struct pa_list *lst, void *src,
+                pa_list_compare cmp)
+{
+        s16 idx = paUpperBoundList(lst, src, cmp);
+
+        if(paInsertList(lst, src, idx, 1) < 1)
+                return -1;
+
+        return idx;
+}
+
+PA_API s16 paMergeList(struct pa_list *dst, struct pa_list *a,
+                struct pa_list *b, pa_list_compare cmp)
+{
+        s32 i = 0;
+        s32 j = 0;
+        s16 written = 0;
+        u8 *ptr;
+
+        /* Validate input parameters */
+        if(dst == a || dst == b) return -1;
+        if(a->entry_size != dst->entry_size) return -1;
+        if(b->entry_size != dst->entry_size) return -1;
+
+        lst_ensure_fit(dst, a->count + b->count);
+
+        while(i < a->count || j < b->count) {
+                /* Take from a on ties, so the merge is stable */
+                if(j >= b->count || (i < a->count &&
+                                        cmp(lst_at(a, i), lst_at(b, j)) <= 0)) {
+                        ptr = lst_at(a, i++);
+                }
+                else {
+                        ptr = lst_at(b, j++);
+                }
+
+                if(paPushList(dst, ptr, 1) < 1)
+                        break;
+
+                written++;
+        }
+
+        return written;
+}
+
+/*
+ * Compare two entries, using a single comparison for the common sizes.
+ */
+PA_INTERN s8 lst_equal(u8 *a, u8 *b, s16 size)
+{
+        switch(size) {
+                case 1: return *a == *b;
+                case 2: return *(u16 *)a == *(u16 *)b;
+                case 4: return *(u32 *)a == *(u32 *)b;
+                case 8: return ((u32 *)a)[0] == ((u32 *)b)[0] &&
+                                ((u32 *)a)[1] == ((u32 *)b)[1];
+        }
+
+        return pa_mem_compare(a, b, size);
+}
+
+PA_INTERN s8 lst_simd_size(s16 size)
+{
+        return size == 1 || size == 2 || size == 4 || size == 8;
+}
+
+#ifdef PA_SSE2
+
+/*
+ * Repeat the key to fill a whole register.
+ */
+PA_INTERN __m128i lst_broadcast(void *key, s16 size)
+{
+        u8 pattern[16];
+        s16 i;
+
+        for(i = 0; i < 16; i += size)
+                pa_mem_copy(pattern + i, key, size);
+
+        return _mm_loadu_si128((__m128i *)pattern);
+}
+
+/*
+ * Compare 16 bytes of entries with the key. Every byte of a matching entry
+ * will have its bit set in the returned mask.
+ */
+PA_INTERN u32 lst_match_mask(u8 *ptr, __m128i key, s16 size)
+{
+        __m128i v = _mm_loadu_si128((__m128i *)ptr);
+        __m128i eq;
+
+        switch(size) {
+                case 1: eq = _mm_cmpeq_epi8(v, key); break;
+                case 2: eq = _mm_cmpeq_epi16(v, key); break;
+                case 4: eq = _mm_cmpeq_epi32(v, key); break;
+                default:
+                        /* No 64-bit compare in SSE2, so combine both halves */
+                        eq = _mm_cmpeq_epi32(v, key);
+                        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq,
+                                                _MM_SHUFFLE(2, 3, 0, 1)));
+                        break;
+        }
+
+        return _mm_movemask_epi8(eq);
+}
+
+#endif /* PA_SSE2 */
+
+/*
+ * Find the first entry equal to the key, starting at the given index.
+ */
+PA_INTERN s32 lst_find_from(struct pa_list *lst, void *key, s32 start)
+{
+        s16 size = lst->entry_size;
+        s32 i = start;
+#ifdef PA_SSE2
+        __m128i k;
+        s32 per_block;
+        u32 mask;
+
+        if(lst_simd_size(size)) {
+                k = lst_broadcast(key, size);
+                per_block = 16 / size;
+
+                for(; i + per_block <= lst->count; i += per_block) {
+                        mask = lst_match_mask(lst_at(lst, i), k, size);
+                        if(mask)
+                                return i + pa_bit_ctz(mask) / size;
+                }
+        }
+#endif
+
+        for(; i < lst->count; i++) {
+                if(lst_equal(lst_at(lst, i), key, size))
+                        return i;
+        }
+
+        return -1;
+}
+
+PA_API s16 paFindList(struct pa_list *lst, void *key, s16 start)
+{
+        if(start < 0)
+                return -1;
+
+        return lst_find_from(lst, key, start);
+}
+
+PA_API s16 paFindListAll(struct pa_list *lst, void *key, struct pa_list *out)
+{
+        s16 number = 0;
+        s16 idx = -1;
+
+        if(out->entry_size != sizeof(s16))
+                return -1;
+
+        while((idx = lst_find_from(lst, key, idx + 1)) >= 0) {
+                if(paPushList(out, &idx, 1) < 1)
+                        break;
+
+                number++;
+        }
+
+        return number;
+}
+
+PA_API s16 paCountList(struct pa_list *lst, void *key)
+{
+        s16 size = lst->entry_size;
+        s32 number = 0;
+        s32 i = 0;
+#ifdef PA_SSE2
+        __m128i k;
+        s32 per_block;
+
+        if(lst_simd_size(size)) {
+                k = lst_broadcast(key, size);
+                per_block = 16 / size;
+
+                for(; i + per_block <= lst->count; i += per_block) {
+                        number += pa_bit_popcount(lst_match_mask(lst_at(lst, i),
+                                                k, size)) / size;
+                }
+        }
+#endif
+
+        for(; i < lst->count; i++) {
+                if(lst_equal(lst_at(lst, i), key, size))
+                        number++;
+        }
+
+        return number;
+}
+
+PA_API s16 paFillList(struct pa_list *lst, void *src, s16 start, s16 num)
+{
+        s32 size = lst->entry_size;
+        s32 done;
+        s32 step;
+        u8 *ptr;
+
+        /* Validate input parameters */
+        if(start < 0 || start > lst->count)
+                return -1;
+
+        num = num == PA_ALL ? lst->count - start : num;
+
+        /* If configured as dynamic, scale to fit the range */
+        if(start + num > lst->count)
+                lst_ensure_fit(lst, start + num - lst->count);
+
+        num = PA_MIN(num, lst->alloc - start);
+        if(num < 1)
+                return 0;
+
+        ptr = lst_at(lst, start);
+        if(size == 1) {
+                pa_mem_set(ptr, *(u8 *)src, num);
+        }
+        else {
+                /* Write one entry, then keep doubling the written block */
+                pa_mem_copy(ptr, src, size);
+                done = 1;
+                while(done < num) {
+                        step = PA_MIN(done, num - done);
+                        pa_mem_copy(ptr + done * size, ptr, step * size);
+                        done += step;
+                }
+        }
+
+        if(start + num > lst->count)
+                lst->count = start + num;
+
+        return num;
+}
+
+PA_INTERN void lst_minmax_u8(u8 *data, s32 num, u8 *lo, u8 *hi)
+{
+        s32 i = 0;
+#ifdef PA_SSE2
+        __m128i vlo;
+        __m128i vhi;
+        __m128i v;
+        u8 buf[2][16];
+        s32 j;
+#endif
+
+        *lo = *hi = data[0];
+
+#ifdef PA_SSE2
+        if(num >= 16) {
+                vlo = vhi = _mm_loadu_si128((__m128i *)data);
+                for(i = 16; i + 16 <= num; i += 16) {
+                        v = _mm_loadu_si128((__m128i *)(data + i));
+                        vlo = _mm_min_epu8(vlo, v);
+                        vhi = _mm_max_epu8(vhi, v);
+                }
+
+                _mm_storeu_si128((__m128i *)buf[0], vlo);
+                _mm_storeu_si128((__m128i *)buf[1], vhi);
+                for(j = 0; j < 16; j++) {
+                        if(buf[0][j] < *lo) *lo = buf[0][j];
+                        if(buf[1][j] > *hi) *hi = buf[1][j];
+                }
+        }
+#endif
+
+        for(; i < num; i++) {
+                if(data[i] < *lo) *lo = data[i];
+                if(data[i] > *hi) *hi = data[i];
+        }
+}
+
+PA_INTERN void lst_minmax_s16(s16 *data, s32 num, s16 *lo, s16 *hi)
+{
+        s32 i = 0;
+#ifdef PA_SSE2
+        __m128i vlo;
+        __m128i vhi;
+        __m128i v;
+        s16 buf[2][8];
+        s32 j;
+#endif
+
+        *lo = *hi = data[0];
+
+#ifdef PA_SSE2
+        if(num >= 8) {
+                vlo = vhi = _mm_loadu_si128((__m128i *)data);
+                for(i = 8; i + 8 <= num; i += 8) {
+                        v = _mm_loadu_si128((__m128i *)(data + i));
+                        vlo = _mm_min_epi16(vlo, v);
+                        vhi = _mm_max_epi16(vhi, v);
+                }
+
+                _mm_storeu_si128((__m128i *)buf[0], vlo);
+                _mm_storeu_si128((__m128i *)buf[1], vhi);
+                for(j = 0; j < 8; j++) {
+                        if(buf[0][j] < *lo) *lo = buf[0][j];
+                        if(buf[1][j] > *hi) *hi = buf[1][j];
+                }
+        }
+#endif
+
+        for(; i < num; i++) {
+                if(data[i] < *lo) *lo = data[i];
+                if(data[i] > *hi) *hi = data[i];
+        }
+}
+
+PA_INTERN void lst_minmax_f32(f32 *data, s32 num, f32 *lo, f32 *hi)
+{
+        s32 i = 0;
+#ifdef PA_SSE2
+        __m128 vlo;
+        __m128 vhi;
+        __m128 v;
+        f32 buf[2][4];
+        s32 j;
+#endif
+
+        *lo = *hi = data[0];
+
+#ifdef PA_SSE2
+        if(num >= 4) {
+                vlo = vhi = _mm_loadu_ps(data);
+                for(i = 4; i + 4 <= num; i += 4) {
+                        v = _mm_loadu_ps(data + i);
+                        vlo = _mm_min_ps(vlo, v);
+                        vhi = _mm_max_ps(vhi, v);
+                }
+
+                _mm_storeu_ps(buf[0], vlo);
+                _mm_storeu_ps(buf[1], vhi);
+                for(j = 0; j < 4; j++) {
+                        if(buf[0][j] < *lo) *lo = buf[0][j];
+                        if(buf[1][j] > *hi) *hi = buf[1][j];
+                }
+        }
+#endif
+
+        for(; i < num; i++) {
+                if(data[i] < *lo) *lo = data[i];
+                if(data[i] > *hi) *hi = data[i];
+        }
+}
+
+PA_INTERN void lst_minmax_f64(f64 *data, s32 num, f64 *lo, f64 *hi)
+{
+        s32 i = 0;
+#ifdef PA_SSE2
+        __m128d vlo;
+        __m128d vhi;
+        __m128d v;
+        f64 buf[2][2];
+        s32 j;
+#endif
+
+        *lo = *hi = data[0];
+
+#ifdef PA_SSE2
+        if(num >= 2) {
+                vlo = vhi = _mm_loadu_pd(data);
+                for(i = 2; i + 2 <= num; i += 2) {
+                        v = _mm_loadu_pd(data + i);
+                        vlo = _mm_min_pd(vlo, v);
+                        vhi = _mm_max_pd(vhi, v);
+                }
+
+                _mm_storeu_pd(buf[0], vlo);
+                _mm_storeu_pd(buf[1], vhi);
+                for(j = 0; j < 2; j++) {
+                        if(buf[0][j] < *lo) *lo = buf[0][j];
+                        if(buf[1][j] > *hi) *hi = buf[1][j];
+                }
+        }
+#endif
+
+        for(; i < num; i++) {
+                if(data[i] < *lo) *lo = data[i];
+                if(data[i] > *hi) *hi = data[i];
+        }
+}
+
+/*
+ * Scalar min-max for the types without a SIMD-path.
+ */
+#define LST_MINMAX(type, data, num, lo, hi)                             \
+        do {                                                            \
+                type *d_ = (type *)(data);                              \
+                s32 i_;                                                 \
+                *(type *)(lo) = *(type *)(hi) = d_[0];                  \
+                for(i_ = 1; i_ < (num); i_++) {                         \
+                        if(d_[i_] < *(type *)(lo)) *(type *)(lo) = d_[i_]; \
+                        if(d_[i_] > *(type *)(hi)) *(type *)(hi) = d_[i_]; \
+                }                                                       \
+        } while(0)
+
+PA_API s8 paMinMaxList(struct pa_list *lst, enum pa_number_type type,
+                void *min, void *max)
+{
+        /* Use unions to keep the results aligned */
+        union { u8 bytes[8]; f64 f; s64 s; u64 u; } lo;
+        union { u8 bytes[8]; f64 f; s64 s; u64 u; } hi;
+        s16 size = lst->entry_size;
+        u8 *data = lst->data;
+        s32 num = lst->count;
+
+        if(num < 1)
+                return -1;
+
+        if(type == PA_FLOAT) {
+                if(size == 4)
+                        lst_minmax_f32((f32 *)data, num, (f32 *)lo.bytes,
+                                        (f32 *)hi.bytes);
+                else if(size == 8)
+                        lst_minmax_f64((f64 *)data, num, &lo.f, &hi.f);
+                else
+                        return -1;
+        }
+        else if(type == PA_SIGNED) {
+                switch(size) {
+                        case 1: LST_MINMAX(s8, data, num, lo.bytes, hi.bytes);
+                                break;
+                        case 2: lst_minmax_s16((s16 *)data, num,
+                                                (s16 *)lo.bytes,
+                                                (s16 *)hi.bytes);
+                                break;
+                        case 4: LST_MINMAX(s32, data, num, lo.bytes, hi.bytes);
+                                break;
+                        case 8: if(sizeof(s64) != 8) return -1;
+                                LST_MINMAX(s64, data, num, lo.bytes, hi.bytes);
+                                break;
+                        default: return -1;
+                }
+        }
+        else {
+                switch(size) {
+                        case 1: lst_minmax_u8(data, num, lo.bytes, hi.bytes);
+                                break;
+                        case 2: LST_MINMAX(u16, data, num, lo.bytes, hi.bytes);
+                                break;
+                        case 4: LST_MINMAX(u32, data, num, lo.bytes, hi.bytes);
+                                break;
+                        case 8: if(sizeof(u64) != 8) return -1;
+                                LST_MINMAX(u64, data, num, lo.bytes, hi.bytes);
+                                break;
+                        default: return -1;
+                }
+        }
+
+        if(min) pa_mem_copy(min, lo.bytes, size);
+        if(max) pa_mem_copy(max, hi.bytes, size);
+        return 0;
+}
+
+#undef LST_MINMAX
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      SMALL-LIST
+ *
+ */
+
+/*
+ * Move the entries from the inline buffer to the heap, if the new entries
+ * don't fit into the inline buffer anymore. Once spilled, the wrapped list is
+ * dynamic and scales by itself.
+ */
+PA_INTERN void sml_spill(struct pa_small_list *lst, s32 num)
+{
+        struct pa_list *l = &lst->list;
+        s32 new_alloc;
+        s32 new_size;
+        void *p;
+
+        if(l->mode != PA_FIXED || !lst->spill)
+                return;
+
+        if(l->count + num <= l->alloc)
+                return;
+
+        new_alloc = PA_MAX(l->count + num, l->alloc) * 2;
+        new_size = new_alloc * l->entry_size;
+
+        if(!(p = pa_mem_alloc(lst->spill, NULL, new_size)))
+                return;
+
+        pa_mem_copy(p, l->data, l->count * l->entry_size);
+
+        l->memory = lst->spill;
+        l->mode = PA_DYNAMIC;
+        l->data = p;
+        l->alloc = new_alloc;
+        l->alloc_size = new_size;
+        l->limit = PA_NOLIM;
+}
+
+PA_API s8 paInitSmallList(struct pa_small_list *lst, struct pa_memory *mem,
+                s16 size)
+{
+        lst->spill = mem;
+
+        return paInitListFixed(&lst->list, size, lst->inline_buffer.bytes,
+                        PA_SMALL_LIST_SIZE);
+}
+
+PA_API void paDestroySmallList(struct pa_small_list *lst)
+{
+        paDestroyList(&lst->list);
+
+        lst->list.mode = PA_MEM_UDEF;
+        lst->list.count = 0;
+}
+
+PA_API void paClearSmallList(struct pa_small_list *lst)
+{
+        lst->list.count = 0;
+}
+
+PA_API s16 paPushSmallList(struct pa_small_list *lst, void *src, s16 num)
+{
+        sml_spill(lst, num);
+        return paPushList(&lst->list, src, num);
+}
+
+PA_API s16 paPopSmallList(struct pa_small_list *lst, void *dst, s16 num)
+{
+        return paPopList(&lst->list, dst, num);
+}
+
+PA_API s16 paInsertSmallList(struct pa_small_list *lst, void *src, s16 start,
+                s16 num)
+{
+        sml_spill(lst, num);
+        return paInsertList(&lst->list, src, start, num);
+}
+
+PA_API void *paIterateSmallList(struct pa_small_list *lst, void *ptr)
+{
+        if(lst->list.count < 1)
+                return NULL;
+
+        return paIterateList(&lst->list, ptr);
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      COLUMN-LIST
+ *
+ */
+
+PA_INTERN s32 col_align(s32 size)
+{
+        return (size + PA_COLUMN_ALIGN - 1) & ~(PA_COLUMN_ALIGN - 1);
+}
+
+/*
+ * Calculate the number of bytes needed to store the given number of rows,
+ * including the padding to align the buffer and the columns.
+ */
+PA_INTERN s32 col_buffer_size(struct pa_column_list *lst, s32 rows)
+{
+        s32 size = PA_COLUMN_ALIGN;
+        s16 i;
+
+        for(i = 0; i < lst->columns; i++)
+                size += col_align(rows * lst->sizes[i]);
+
+        return size;
+}
+
+/*
+ * Set the column-pointers for the given buffer and number of rows.
+ */
+PA_INTERN void col_layout(struct pa_column_list *lst, u8 *buf, s32 rows,
+                u8 **data)
+{
+        u8 *ptr = buf;
+        s16 i;
+
+        /* Align the first column */
+        ptr += (PA_COLUMN_ALIGN - ((unsigned long)ptr % PA_COLUMN_ALIGN)) %
+                PA_COLUMN_ALIGN;
+
+        for(i = 0; i < lst->columns; i++) {
+                data[i] = ptr;
+                ptr += col_align(rows * lst->sizes[i]);
+        }
+}
+
+/*
+ * Scale the column-list to fit the given number of new rows. As all columns
+ * share one buffer, the columns have to be copied one by one into the new
+ * buffer.
+ */
+PA_INTERN void col_ensure_fit(struct pa_column_list *lst, s32 num)
+{
+        s32 new_num = lst->count + num;
+        s32 new_alloc;
+        s32 new_size;
+        u8 *data[PA_COLUMNS_MAX];
+        u8 *p;
+        s16 i;
+
+        if(lst->mode != PA_DYNAMIC)
+                return;
+
+        if(new_num <= lst->alloc)
+                return;
+
+        new_alloc = new_num * 1.5;
+        new_size = col_buffer_size(lst, new_alloc);
+
+        if(!(p = pa_mem_alloc(lst->memory, NULL, new_size)))
+                return;
+
+        col_layout(lst, p, new_alloc, data);
+        for(i = 0; i < lst->columns; i++) {
+                pa_mem_copy(data[i], lst->data[i], lst->count * lst->sizes[i]);
+                lst->data[i] = data[i];
+        }
+
+        pa_mem_free(lst->memory, lst->buffer);
+
+        lst->buffer = p;
+        lst->buffer_size = new_size;
+        lst->alloc = new_alloc;
+}
+
+/*
+ * Copy the fields of a row to the packed row and the other way around.
+ */
+PA_INTERN void col_pack(struct pa_column_list *lst, s16 idx, u8 *dst)
+{
+        s16 i;
+
+        for(i = 0; i < lst->columns; i++) {
+                pa_mem_copy(dst, lst->data[i] + idx * lst->sizes[i],
+                                lst->sizes[i]);
+                dst += lst->sizes[i];
+        }
+}
+
+PA_INTERN void col_unpack(struct pa_column_list *lst, s16 idx, u8 *src)
+{
+        s16 i;
+
+        for(i = 0; i < lst->columns; i++) {
+                pa_mem_copy(lst->data[i] + idx * lst->sizes[i], src,
+                                lst->sizes[i]);
+                src += lst->sizes[i];
+        }
+}
+
+PA_INTERN s8 col_set_columns(struct pa_column_list *lst, s16 *sizes,
+                s16 columns)
+{
+        s16 i;
+
+        if(columns < 1 || columns > PA_COLUMNS_MAX)
+                return -1;
+
+        lst->columns = columns;
+        lst->row_size = 0;
+        for(i = 0; i < columns; i++) {
+                if(sizes[i] < 1)
+                        return -1;
+
+                lst->sizes[i] = sizes[i];
+                lst->row_size += sizes[i];
+        }
+
+        return 0;
+}
+
+PA_API s8 paInitColumnList(struct pa_column_list *lst, struct pa_memory *mem,
+                s16 *sizes, s16 columns, s16 alloc)
+{
+        if(col_set_columns(lst, sizes, columns) < 0)
+                return -1;
+
+        lst->memory = mem;
+        lst->mode = PA_DYNAMIC;
+        lst->count = 0;
+        lst->alloc = alloc;
+        lst->buffer_size = col_buffer_size(lst, alloc);
+
+        if(!(lst->buffer = pa_mem_alloc(lst->memory, NULL, lst->buffer_size)))
+                return -1;
+
+        col_layout(lst, lst->buffer, lst->alloc, lst->data);
+        return 0;
+}
+
+PA_API s8 paInitColumnListFixed(struct pa_column_list *lst, s16 *sizes,
+                s16 columns, void *buf, s32 buf_sz)
+{
+        s32 rows;
+
+        if(col_set_columns(lst, sizes, columns) < 0)
+                return -1;
+
+        lst->memory = NULL;
+        lst->mode = PA_FIXED;
+        lst->buffer = buf;
+        lst->buffer_size = buf_sz;
+        lst->count = 0;
+
+        /*
+         * Every column might need some padding, so start with an estimate
+         * and reduce the number of rows until everything fits.
+         */
+        rows = buf_sz / lst->row_size;
+        while(rows > 0 && col_buffer_size(lst, rows) > buf_sz)
+                rows--;
+
+        lst->alloc = rows;
+        col_layout(lst, lst->buffer, lst->alloc, lst->data);
+        return 0;
+}
+
+PA_API void paDestroyColumnList(struct pa_column_list *lst)
+{
+        if(lst->mode == PA_DYNAMIC) {
+                pa_mem_free(lst->memory, lst->buffer);
+        }
+
+        lst->mode = PA_MEM_UDEF;
+        lst->buffer = NULL;
+        lst->count = 0;
+        lst->alloc = 0;
+}
+
+PA_API void paClearColumnList(struct pa_column_list *lst)
+{
+        lst->count = 0;
+}
+
+PA_API s8 paPushColumnList(struct pa_column_list *lst, void *src)
+{
+        /* If configured as dynamic, scale to fit the new row */
+        col_ensure_fit(lst, 1);
+
+        if(lst->count >= lst->alloc)
+                return 0;
+
+        col_unpack(lst, lst->count, src);
+        lst->count++;
+        return 1;
+}
+
+PA_API s8 paPopColumnList(struct pa_column_list *lst, void *dst)
+{
+        if(lst->count < 1)
+                return 0;
+
+        lst->count--;
+        if(dst) col_pack(lst, lst->count, dst);
+        return 1;
+}
+
+PA_API s8 paRemoveColumnList(struct pa_column_list *lst, s16 idx, void *dst)
+{
+        s16 last = lst->count - 1;
+        s16 i;
+
+        if(idx < 0 || idx >= lst->count)
+                return 0;
+
+        if(dst) col_pack(lst, idx, dst);
+
+        /* Move the last row into the gap */
+        if(idx != last) {
+                for(i = 0; i < lst->columns; i++) {
+                        pa_mem_copy(lst->data[i] + idx * lst->sizes[i],
+                                        lst->data[i] + last * lst->sizes[i],
+                                        lst->sizes[i]);
+                }
+        }
+
+        lst->count--;
+        return 1;
+}
+
+PA_API s8 paPeekColumnList(struct pa_column_list *lst, void *dst, s16 idx)
+{
+        if(idx < 0 || idx >= lst->count)
+                return 0;
+
+        col_pack(lst, idx, dst);
+        return 1;
+}
+
+PA_API s8 paWriteColumnList(struct pa_column_list *lst, void *src, s16 idx)
+{
+        if(idx < 0 || idx >= lst->count)
+                return 0;
+
+        col_unpack(lst, idx, src);
+        return 1;
+}
+
+PA_API void *paGetColumn(struct pa_column_list *lst, s16 col)
+{
+        if(col < 0 || col >= lst->columns)
+                return NULL;
+
+        return lst->data[col];
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      WORKER-POOL
+ *
+ */
+
+#ifdef PA_PTHREADS
+
+/*
+ * The range of entries left for a single thread.
+ */
+struct wkp_range {
+        pthread_mutex_t lock;
+        s32             begin;
+        s32             end;
+};
+
+struct wkp_state {
+        pthread_mutex_t lock;
+        pthread_cond_t  wake;   /* Signaled when a new job is started */
+        pthread_cond_t  done;   /* Signaled when the last thread is done */
+
+        pthread_t       *threads;
+        struct wkp_range *ranges; /* One range per thread plus the caller */
+        s16             number;
+        s32             grain;
+
+        u32             job;    /* Incremented for every new job */
+        s16             active; /* Number of threads still working */
+        s8              quit;
+        volatile s8     stop;   /* Set if a callback returned 1 */
+
+        struct pa_list  *list;
+        pa_list_func    func;
+        void            *pass;
+};
+
+struct wkp_arg {
+        struct wkp_state *state;
+        s16             index;
+};
+
+/*
+ * Take the next piece from the given range.
+ *
+ * Returns: 1 if a piece has been taken and 0 if the range is empty
+ */
+PA_INTERN s8 wkp_take(struct wkp_state *st, s16 idx, s32 *begin, s32 *end)
+{
+        struct wkp_range *rng = &st->ranges[idx];
+        s8 ret = 0;
+
+        pthread_mutex_lock(&rng->lock);
+        if(rng->begin < rng->end) {
+                *begin = rng->begin;
+                *end = PA_MIN(rng->begin + st->grain, rng->end);
+                rng->begin = *end;
+                ret = 1;
+        }
+        pthread_mutex_unlock(&rng->lock);
+
+        return ret;
+}
+
+/*
+ * Steal the back half of the biggest range left and make it the range of the
+ * thread with the given index.
+ *
+ * Returns: 1 if something has been stolen and 0 if all work is done
+ */
+PA_INTERN s8 wkp_steal(struct wkp_state *st, s16 idx)
+{
+        struct wkp_range *rng;
+        s32 left;
+        s32 max_left;
+        s32 mid;
+        s32 end;
+        s16 victim;
+        s16 i;
+
+        while(!st->stop) {
+                /* Look for the biggest range without locking */
+                victim = -1;
+                max_left = 0;
+                for(i = 0; i <= st->number; i++) {
+                        left = st->ranges[i].end - st->ranges[i].begin;
+                        if(i != idx && left > max_left) {
+                                max_left = left;
+                                victim = i;
+                        }
+                }
+
+                if(victim < 0)
+                        return 0;
+
+                /* The range might have changed, so check again */
+                rng = &st->ranges[victim];
+                pthread_mutex_lock(&rng->lock);
+                left = rng->end - rng->begin;
+                if(left < 1) {
+                        pthread_mutex_unlock(&rng->lock);
+                        continue;
+                }
+                mid = rng->begin + left / 2;
+                end = rng->end;
+                rng->end = mid;
+                pthread_mutex_unlock(&rng->lock);
+
+                rng = &st->ranges[idx];
+                pthread_mutex_lock(&rng->lock);
+                rng->begin = mid;
+                rng->end = end;
+                pthread_mutex_unlock(&rng->lock);
+                return 1;
+        }
+
+        return 0;
+}
+
+/*
+ * Process pieces until there is nothing left to take or steal.
+ */
+PA_INTERN void wkp_work(struct wkp_state *st, s16 idx)
+{
+        struct pa_handle hdl;
+        struct pa_list *lst = st->list;
+        s32 begin;
+        s32 end;
+        s32 i;
+
+        do {
+                while(!st->stop && wkp_take(st, idx, &begin, &end)) {
+                        for(i = begin; i < end; i++) {
+                                hdl.pointer = lst->data + (i * lst->entry_size);
+                                hdl.index = i;
+                                if(st->func(&hdl, st->pass)) {
+                                        st->stop = 1;
+                                        break;
+                                }
+                        }
+                }
+        } while(wkp_steal(st, idx));
+}
+
+PA_INTERN void *wkp_thread(void *p)
+{
+        struct wkp_arg *arg = p;
+        struct wkp_state *st = arg->state;
+        u32 job = 0;
+
+        while(1) {
+                /* Wait for a new job or the signal to quit */
+                pthread_mutex_lock(&st->lock);
+                while(!st->quit && st->job == job)
+                        pthread_cond_wait(&st->wake, &st->lock);
+
+                if(st->quit) {
+                        pthread_mutex_unlock(&st->lock);
+                        break;
+                }
+                job = st->job;
+                pthread_mutex_unlock(&st->lock);
+
+                wkp_work(st, arg->index);
+
+                pthread_mutex_lock(&st->lock);
+                if(--st->active == 0)
+                        pthread_cond_signal(&st->done);
+                pthread_mutex_unlock(&st->lock);
+        }
+
+        return NULL;
+}
+
+PA_INTERN void wkp_stop(struct wkp_state *st, s16 started)
+{
+        s16 i;
+
+        pthread_mutex_lock(&st->lock);
+        st->quit = 1;
+        pthread_cond_broadcast(&st->wake);
+        pthread_mutex_unlock(&st->lock);
+
+        for(i = 0; i < started; i++)
+                pthread_join(st->threads[i], NULL);
+
+        for(i = 0; i <= st->number; i++)
+                pthread_mutex_destroy(&st->ranges[i].lock);
+
+        pthread_cond_destroy(&st->done);
+        pthread_cond_destroy(&st->wake);
+        pthread_mutex_destroy(&st->lock);
+}
+
+PA_API s8 paInitWorkerPool(struct pa_worker_pool *pool, struct pa_memory *mem,
+                s16 threads)
+{
+        struct wkp_state *st;
+        struct wkp_arg *args;
+        s32 size;
+        s16 i;
+
+        pool->memory = mem;
+        pool->number = threads < 0 ? 0 : threads;
+        pool->grain = PA_WORKER_GRAIN;
+
+        /* Allocate the state, the thread-handles, the ranges and arguments */
+        size = sizeof(struct wkp_state) +
+                pool->number * sizeof(pthread_t) +
+                (pool->number + 1) * sizeof(struct wkp_range) +
+                pool->number * sizeof(struct wkp_arg);
+
+        if(!(st = pa_mem_alloc(mem, NULL, size)))
+                return -1;
+
+        st->threads = (pthread_t *)(st + 1);
+        st->ranges = (struct wkp_range *)(st->threads + pool->number);
+        args = (struct wkp_arg *)(st->ranges + pool->number + 1);
+
+        st->number = pool->number;
+        st->grain = pool->grain;
+        st->job = 0;
+        st->active = 0;
+        st->quit = 0;
+        st->stop = 0;
+
+        pthread_mutex_init(&st->lock, NULL);
+        pthread_cond_init(&st->wake, NULL);
+        pthread_cond_init(&st->done, NULL);
+
+        for(i = 0; i <= st->number; i++) {
+                pthread_mutex_init(&st->ranges[i].lock, NULL);
+                st->ranges[i].begin = 0;
+                st->ranges[i].end = 0;
+        }
+
+        for(i = 0; i < st->number; i++) {
+                args[i].state = st;
+                args[i].index = i;
+                if(pthread_create(&st->threads[i], NULL, &wkp_thread,
+                                        &args[i]) != 0) {
+                        wkp_stop(st, i);
+                        pa_mem_free(mem, st);
+                        return -1;
+                }
+        }
+
+        pool->state = st;
+        return 0;
+}
+
+PA_API void paDestroyWorkerPool(struct pa_worker_pool *pool)
+{
+        struct wkp_state *st = pool->state;
+
+        if(!st)
+                return;
+
+        wkp_stop(st, st->number);
+        pa_mem_free(pool->memory, st);
+
+        pool->state = NULL;
+        pool->number = 0;
+}
+
+PA_API void paApplyListParallel(struct pa_list *lst,
+                struct pa_worker_pool *pool, pa_list_func fnc, void *pass)
+{
+        struct wkp_state *st = pool->state;
+        s32 per_thread;
+        s16 i;
+
+        /* Not worth waking up the threads */
+        if(!st || st->number < 1 || lst->count <= pool->grain) {
+                paApplyList(lst, fnc, pass);
+                return;
+        }
+
+        /* Split the list evenly, the caller takes the last range */
+        st->grain = PA_MAX(pool->grain, 1);
+        per_thread = lst->count / (st->number + 1);
+        for(i = 0; i <= st->number; i++) {
+                st->ranges[i].begin = i * per_thread;
+                st->ranges[i].end = (i == st->number) ?
+                        lst->count : (i + 1) * per_thread;
+        }
+
+        st->list = lst;
+        st->func = fnc;
+        st->pass = pass;
+        st->stop = 0;
+
+        /* Wake up all threads */
+        pthread_mutex_lock(&st->lock);
+        st->active = st->number;
+        st->job++;
+        pthread_cond_broadcast(&st->wake);
+        pthread_mutex_unlock(&st->lock);
+
+        wkp_work(st, st->number);
+
+        /* Wait for all threads to finish */
+        pthread_mutex_lock(&st->lock);
+        while(st->active > 0)
+                pthread_cond_wait(&st->done, &st->lock);
+        pthread_mutex_unlock(&st->lock);
+}
+
+#else /* PA_PTHREADS */
+
+PA_API s8 paInitWorkerPool(struct pa_worker_pool *pool, struct pa_memory *mem,
+                s16 threads)
+{
+        PA_IGNORE(threads);
+
+        pool->memory = mem;
+        pool->number = 0;
+        pool->grain = PA_WORKER_GRAIN;
+        pool->state = NULL;
+        return 0;
+}
+
+PA_API void paDestroyWorkerPool(struct pa_worker_pool *pool)
+{
+        pool->state = NULL;
+        pool->number = 0;
+}
+
+PA_API void paApplyListParallel(struct pa_list *lst,
+                struct pa_worker_pool *pool, pa_list_func fnc, void *pass)
+{
+        PA_IGNORE(pool);
+
+        paApplyList(lst, fnc, pass);
+}
+
+#endif /* PA_PTHREADS */
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      CHUNK-LIST
+ *
+ */
+
+PA_INTERN u8 *chl_chunk(struct pa_chunk_list *lst, s16 chunk)
+{
+        return *(u8 **)(lst->chunks.data + chunk * sizeof(u8 *));
+}
+
+PA_INTERN u8 *chl_entry(struct pa_chunk_list *lst, s16 idx)
+{
+        s16 chunk = idx / lst->chunk_entries;
+        s16 slot = idx % lst->chunk_entries;
+
+        return chl_chunk(lst, chunk) + slot * lst->entry_size;
+}
+
+/*
+ * Append a new chunk to the list. This only works if the list is dynamic.
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_INTERN s8 chl_add_chunk(struct pa_chunk_list *lst)
+{
+        u8 *chunk;
+        s32 size = lst->chunk_entries * lst->entry_size;
+
+        if(lst->mode != PA_DYNAMIC)
+                return -1;
+
+        if(!(chunk = pa_mem_alloc(lst->memory, NULL, size)))
+                return -1;
+
+        if(paPushList(&lst->chunks, &chunk, 1) < 1) {
+                pa_mem_free(lst->memory, chunk);
+                return -1;
+        }
+
+        return 0;
+}
+
+PA_API s8 paInitChunkList(struct pa_chunk_list *lst, struct pa_memory *mem,
+                s16 size, s16 chunk, s16 alloc)
+{
+        s16 num;
+
+        if(size < 1 || chunk < 1)
+                return -1;
+
+        lst->memory = mem;
+        lst->mode = PA_DYNAMIC;
+        lst->entry_size = size;
+        lst->chunk_entries = chunk;
+        lst->count = 0;
+
+        num = (alloc + chunk - 1) / chunk;
+        if(paInitList(&lst->chunks, mem, sizeof(u8 *), PA_MAX(num, 4),
+                                PA_NOLIM) < 0)
+                return -1;
+
+        while(num-- > 0) {
+                if(chl_add_chunk(lst) < 0) {
+                        paDestroyChunkList(lst);
+                        return -1;
+                }
+        }
+
+        return 0;
+}
+
+PA_API s8 paInitChunkListFixed(struct pa_chunk_list *lst, s16 size, s16 chunk,
+                void *buf, s32 buf_sz)
+{
+        u8 *ptr = buf;
+        u8 *chunk_ptr;
+        s32 chunk_sz;
+        s32 table_sz;
+        s32 num;
+        s16 i;
+
+        if(size < 1 || chunk < 1 || buf_sz < 8)
+                return -1;
+
+        lst->memory = NULL;
+        lst->mode = PA_FIXED;
+        lst->entry_size = size;
+        lst->chunk_entries = chunk;
+        lst->count = 0;
+
+        /*
+         * The chunk-pointers are stored at the beginning of the buffer,
+         * followed by the chunks aligned to 8 bytes.
+         */
+        chunk_sz = chunk * size;
+        num = (buf_sz - 8) / (chunk_sz + (s32)sizeof(u8 *));
+        if(num < 1)
+                return -1;
+
+        if(num > 0x7FFF)
+                num = 0x7FFF;
+
+        table_sz = (num * sizeof(u8 *) + 7) & ~7;
+        paInitListFixed(&lst->chunks, sizeof(u8 *), ptr, table_sz);
+
+        for(i = 0; i < num; i++) {
+                chunk_ptr = ptr + table_sz + i * chunk_sz;
+                paPushList(&lst->chunks, &chunk_ptr, 1);
+        }
+
+        return 0;
+}
+
+PA_API void paDestroyChunkList(struct pa_chunk_list *lst)
+{
+        s16 i;
+
+        if(lst->mode == PA_DYNAMIC) {
+                for(i = 0; i < lst->chunks.count; i++)
+                        pa_mem_free(lst->memory, chl_chunk(lst, i));
+        }
+
+        paDestroyList(&lst->chunks);
+
+        lst->mode = PA_MEM_UDEF;
+        lst->count = 0;
+}
+
+PA_API void paClearChunkList(struct pa_chunk_list *lst)
+{
+        lst->count = 0;
+}
+
+PA_API s16 paPushChunkList(struct pa_chunk_list *lst, void *src, s16 num)
+{
+        s16 written = 0;
+        s16 slot;
+        s16 entry_number;
+        u8 *ptr = src;
+
+        while(written < num) {
+                /* Append a new chunk if all chunks are full */
+                if(lst->count >= lst->chunks.count * lst->chunk_entries) {
+                        if(chl_add_chunk(lst) < 0)
+                                break;
+                }
+
+                /* Fill up the current chunk as much as possible */
+                slot = lst->count % lst->chunk_entries;
+                entry_number = PA_MIN(num - written, lst->chunk_entries - slot);
+                pa_mem_copy(chl_entry(lst, lst->count), ptr,
+                                entry_number * lst->entry_size);
+
+                ptr += entry_number * lst->entry_size;
+                written += entry_number;
+                lst->count += entry_number;
+        }
+
+        return written;
+}
+
+PA_API s16 paPopChunkList(struct pa_chunk_list *lst, void *dst, s16 num)
+{
+        s16 entry_number;
+        s16 start;
+        s16 idx;
+        s16 copy_num;
+        u8 *ptr = dst;
+
+        /* Figure out how many entries can be returned */
+        entry_number = num > lst->count ? lst->count : num;
+        start = lst->count - entry_number;
+
+        /* Copy the entries chunk by chunk, keeping their order */
+        idx = start;
+        while(idx < lst->count) {
+                copy_num = lst->chunk_entries - (idx % lst->chunk_entries);
+                copy_num = PA_MIN(copy_num, lst->count - idx);
+                pa_mem_copy(ptr, chl_entry(lst, idx),
+                                copy_num * lst->entry_size);
+
+                ptr += copy_num * lst->entry_size;
+                idx += copy_num;
+        }
+
+        lst->count = start;
+        return entry_number;
+}
+
+PA_API void *paIndexChunkList(struct pa_chunk_list *lst, s16 idx)
+{
+        if(idx < 0 || idx >= lst->count)
+                return NULL;
+
+        return chl_entry(lst, idx);
+}
+
+PA_API void *paSpanChunkList(struct pa_chunk_list *lst, s16 chunk, s16 *num)
+{
+        s16 start = chunk * lst->chunk_entries;
+
+        if(chunk < 0 || start >= lst->count) {
+                *num = 0;
+                return NULL;
+        }
+
+        *num = PA_MIN(lst->chunk_entries, lst->count - start);
+        return chl_chunk(lst, chunk);
+}
+
+PA_API void *paIterateChunkList(struct pa_chunk_list *lst,
+                struct pa_handle *hdl)
+{
+        /* First step, start with the first entry */
+        if(hdl->pointer == NULL) {
+                hdl->index = 0;
+        }
+        else {
+                hdl->index++;
+        }
+
+        if(hdl->index >= lst->count) {
+                hdl->pointer = NULL;
+                return NULL;
+        }
+
+        /* Only jump to the next chunk if the current one is done */
+        if(hdl->index % lst->chunk_entries == 0) {
+                hdl->pointer = chl_chunk(lst, hdl->index / lst->chunk_entries);
+        }
+        else {
+                hdl->pointer = (u8 *)hdl->pointer + lst->entry_size;
+        }
+
+        return hdl->pointer;
+}
+
+PA_API void paApplyChunkList(struct pa_chunk_list *lst, pa_list_func fnc,
+                void *pass)
+{
+        struct pa_handle hdl;
+
+        hdl.pointer = NULL;
+        while(paIterateChunkList(lst, &hdl)) {
+                if(fnc(&hdl, pass)) return;
+        }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      SLOTMAP
+ *
+ */
+
+PA_INTERN struct pa_slot *smp_slot(struct pa_slotmap *map, s16 idx)
+{
+        return (struct pa_slot *)(map->slots.data + idx * PA_SLOT_SIZE);
+}
+
+PA_INTERN s16 *smp_owner(struct pa_slotmap *map, s16 idx)
+{
+        return (s16 *)(map->owner.data + idx * sizeof(s16));
+}
+
+/*
+ * Check if the handle still references a used slot.
+ */
+PA_INTERN struct pa_slot *smp_resolve(struct pa_slotmap *map,
+                struct pa_slot_handle hdl)
+{
+        struct pa_slot *slot;
+
+        if(hdl.index < 0 || hdl.index >= map->slots.count)
+                return NULL;
+
+        /* Used slots always have an odd generation */
+        slot = smp_slot(map, hdl.index);
+        if(slot->generation != hdl.generation || slot->generation % 2 == 0)
+                return NULL;
+
+        return slot;
+}
+
+PA_API s8 paInitSlotMap(struct pa_slotmap *map, struct pa_memory *mem,
+                s16 size, s16 alloc)
+{
+        if(paInitList(&map->data, mem, size, alloc, PA_NOLIM) < 0)
+                return -1;
+
+        if(paInitList(&map->slots, mem, PA_SLOT_SIZE, alloc, PA_NOLIM) < 0)
+                goto err_destroy_data;
+
+        if(paInitList(&map->owner, mem, sizeof(s16), alloc, PA_NOLIM) < 0)
+                goto err_destroy_slots;
+
+        map->free_head = -1;
+        return 0;
+
+err_destroy_slots:
+        paDestroyList(&map->slots);
+
+err_destroy_data:
+        paDestroyList(&map->data);
+
+        return -1;
+}
+
+PA_API s8 paInitSlotMapFixed(struct pa_slotmap *map, s16 size, void *buf,
+                s32 buf_sz)
+{
+        u8 *ptr = buf;
+        s32 num;
+        s32 slots_sz;
+        s32 owner_sz;
+        s32 head_sz;
+
+        /*
+         * The slots and owner-indices come first, followed by the entries,
+         * which are aligned to 8 bytes.
+         */
+        if(buf_sz < 8)
+                return -1;
+
+        num = (buf_sz - 8) / (size + PA_SLOT_SIZE + (s32)sizeof(s16));
+        if(num < 1)
+                return -1;
+
+        if(num > 0x7FFF)
+                num = 0x7FFF;
+
+        slots_sz = num * PA_SLOT_SIZE;
+        owner_sz = num * sizeof(s16);
+        head_sz = (slots_sz + owner_sz + 7) & ~7;
+
+        paInitListFixed(&map->slots, PA_SLOT_SIZE, ptr, slots_sz);
+        paInitListFixed(&map->owner, sizeof(s16), ptr + slots_sz, owner_sz);
+        paInitListFixed(&map->data, size, ptr + head_sz, num * size);
+
+        map->free_head = -1;
+        return 0;
+}
+
+PA_API void paDestroySlotMap(struct pa_slotmap *map)
+{
+        paDestroyList(&map->data);
+        paDestroyList(&map->slots);
+        paDestroyList(&map->owner);
+
+        map->free_head = -1;
+}
+
+PA_API void paClearSlotMap(struct pa_slotmap *map)
+{
+        struct pa_slot *slot;
+        s16 i;
+
+        /*
+         * Keep the slots, so the generations are preserved, but free all of
+         * them so old handles become invalid.
+         */
+        map->free_head = -1;
+        for(i = map->slots.count - 1; i >= 0; i--) {
+                slot = smp_slot(map, i);
+                if(slot->generation % 2 == 1)
+                        slot->generation++;
+
+                slot->index = map->free_head;
+                map->free_head = i;
+        }
+
+        map->data.count = 0;
+        map->owner.count = 0;
+}
+
+PA_API s8 paInsertSlotMap(struct pa_slotmap *map, void *src,
+                struct pa_slot_handle *out)
+{
+        struct pa_slot new_slot;
+        struct pa_slot *slot;
+        s16 slot_idx;
+        s16 data_idx = map->data.count;
+
+        /* Write the entry to the end of the dense list */
+        if(paPushList(&map->data, src, 1) < 1)
+                return -1;
+
+        /* Reuse a free slot if there is one, otherwise create a new one */
+        if(map->free_head >= 0) {
+                slot_idx = map->free_head;
+                slot = smp_slot(map, slot_idx);
+                map->free_head = slot->index;
+        }
+        else {
+                new_slot.index = -1;
+                new_slot.generation = 0;
+
+                slot_idx = map->slots.count;
+                if(paPushList(&map->slots, &new_slot, 1) < 1)
+                        goto err_pop_data;
+
+                slot = smp_slot(map, slot_idx);
+        }
+
+        if(paPushList(&map->owner, &slot_idx, 1) < 1)
+                goto err_free_slot;
+
+        slot->index = data_idx;
+        slot->generation++;
+
+        if(out) {
+                out->index = slot_idx;
+                out->generation = slot->generation;
+        }
+
+        return 0;
+
+err_free_slot:
+        slot->index = map->free_head;
+        map->free_head = slot_idx;
+
+err_pop_data:
+        map->data.count--;
+        return -1;
+}
+
+PA_API s8 paRemoveSlotMap(struct pa_slotmap *map, struct pa_slot_handle hdl,
+                void *dst)
+{
+        struct pa_slot *slot;
+        s16 data_idx;
+        s16 last_idx;
+        s16 last_slot;
+        s32 size = map->data.entry_size;
+
+        if(!(slot = smp_resolve(map, hdl)))
+                return 0;
+
+        data_idx = slot->index;
+        last_idx = map->data.count - 1;
+
+        if(dst) {
+                pa_mem_copy(dst, map->data.data + data_idx * size, size);
+        }
+
+        /* Move the last entry into the gap and update its slot */
+        if(data_idx != last_idx) {
+                pa_mem_copy(map->data.data + data_idx * size,
+                                map->data.data + last_idx * size, size);
+
+                last_slot = *smp_owner(map, last_idx);
+                *smp_owner(map, data_idx) = last_slot;
+                smp_slot(map, last_slot)->index = data_idx;
+        }
+
+        map->data.count--;
+        map->owner.count--;
+
+        /* Invalidate all handles and push the slot onto the free-list */
+        slot->generation++;
+        slot->index = map->free_head;
+        map->free_head = hdl.index;
+
+        return 1;
+}
+
+PA_API void *paLookupSlotMap(struct pa_slotmap *map, struct pa_slot_handle hdl)
+{
+        struct pa_slot *slot;
+
+        if(!(slot = smp_resolve(map, hdl)))
+                return NULL;
+
+        return map->data.data + slot->index * map->data.entry_size;
+}
+
+PA_API s8 paHandleSlotMap(struct pa_slotmap *map, s16 idx,
+                struct pa_slot_handle *out)
+{
+        s16 slot_idx;
+
+        if(idx < 0 || idx >= map->data.count)
+                return -1;
+
+        slot_idx = *smp_owner(map, idx);
+        out->index = slot_idx;
+        out->generation = smp_slot(map, slot_idx)->generation;
+        return 0;
+}
+
+PA_API void *paIterateSlotMap(struct pa_slotmap *map, void *ptr)
+{
+        if(map->data.count < 1)
+                return NULL;
+
+        return paIterateList(&map->data, ptr);
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      HEAP
+ *
+ */
+
+/*
+ * Calculate the size of a node, so the entries stay aligned.
+ */
+PA_INTERN s16 hep_node_size(s16 size)
+{
+        s16 align = size >= 8 ? 8 : (size >= 4 ? 4 : 2);
+
+        return (size + sizeof(s16) + align - 1) / align * align;
+}
+
+PA_INTERN s16 *hep_handle(struct pa_heap *heap, s32 pos)
+{
+        s32 off = heap->nodes.entry_size - sizeof(s16);
+
+        return (s16 *)(lst_at(&heap->nodes, pos) + off);
+}
+
+PA_INTERN struct pa_slot *hep_slot(struct pa_heap *heap, s16 idx)
+{
+        return (struct pa_slot *)lst_at(&heap->slots, idx);
+}
+
+PA_INTERN s32 hep_compare(struct pa_heap *heap, s32 a, s32 b)
+{
+        return heap->compare(lst_at(&heap->nodes, a), lst_at(&heap->nodes, b));
+}
+
+/*
+ * Swap two nodes and update the positions in their slots.
+ */
+PA_INTERN void hep_swap(struct pa_heap *heap, s32 a, s32 b)
+{
+        lst_swap(&heap->nodes, a, b);
+
+        hep_slot(heap, *hep_handle(heap, a))->index = a;
+        hep_slot(heap, *hep_handle(heap, b))->index = b;
+}
+
+PA_INTERN s32 hep_sift_up(struct pa_heap *heap, s32 pos)
+{
+        s32 parent;
+
+        while(pos > 0) {
+                parent = (pos - 1) / 2;
+                if(hep_compare(heap, pos, parent) >= 0)
+                        break;
+
+                hep_swap(heap, pos, parent);
+                pos = parent;
+        }
+
+        return pos;
+}
+
+PA_INTERN s32 hep_sift_down(struct pa_heap *heap, s32 pos)
+{
+        s32 num = heap->nodes.count;
+        s32 child;
+
+        while((child = 2 * pos + 1) < num) {
+                if(child + 1 < num && hep_compare(heap, child + 1, child) < 0)
+                        child++;
+
+                if(hep_compare(heap, child, pos) >= 0)
+                        break;
+
+                hep_swap(heap, pos, child);
+                pos = child;
+        }
+
+        return pos;
+}
+
+/*
+ * Check if the handle still references a used slot.
+ */
+PA_INTERN struct pa_slot *hep_resolve(struct pa_heap *heap,
+                struct pa_slot_handle hdl)
+{
+        struct pa_slot *slot;
+
+        if(hdl.index < 0 || hdl.index >= heap->slots.count)
+                return NULL;
+
+        /* Used slots always have an odd generation */
+        slot = hep_slot(heap, hdl.index);
+        if(slot->generation != hdl.generation || slot->generation % 2 == 0)
+                return NULL;
+
+        return slot;
+}
+
+/*
+ * Attach a slot to the node at the given position, either from the free-list
+ * or by appending a new one, and write the handle for it.
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_INTERN s8 hep_take_slot(struct pa_heap *heap, s32 pos,
+                struct pa_slot_handle *out)
+{
+        struct pa_slot new_slot;
+        struct pa_slot *slot;
+        s16 idx;
+
+        if(heap->free_head >= 0) {
+                idx = heap->free_head;
+                slot = hep_slot(heap, idx);
+                heap->free_head = slot->index;
+        }
+        else {
+                new_slot.index = -1;
+                new_slot.generation = 0;
+
+                idx = heap->slots.count;
+                if(paPushList(&heap->slots, &new_slot, 1) < 1)
+                        return -1;
+
+                slot = hep_slot(heap, idx);
+        }
+
+        slot->index = pos;
+        slot->generation++;
+        *hep_handle(heap, pos) = idx;
+
+        if(out) {
+                out->index = idx;
+                out->generation = slot->generation;
+        }
+
+        return 0;
+}
+
+/*
+ * Remove the node at the given position by moving the last node into the gap.
+ * The slot of the node is freed, so all handles to it become stale.
+ */
+PA_INTERN void hep_remove_at(struct pa_heap *heap, s32 pos, void *dst,
+                struct pa_slot_handle *out)
+{
+        struct pa_slot *slot;
+        s32 last = heap->nodes.count - 1;
+        s16 idx = *hep_handle(heap, pos);
+
+        if(dst) {
+                pa_mem_copy(dst, lst_at(&heap->nodes, pos), heap->entry_size);
+        }
+
+        slot = hep_slot(heap, idx);
+        if(out) {
+                out->index = idx;
+                out->generation = slot->generation;
+        }
+
+        /* Invalidate all handles and push the slot onto the free-list */
+        slot->generation++;
+        slot->index = heap->free_head;
+        heap->free_head = idx;
+
+        if(pos != last) {
+                pa_mem_copy(lst_at(&heap->nodes, pos),
+                                lst_at(&heap->nodes, last),
+                                heap->nodes.entry_size);
+                hep_slot(heap, *hep_handle(heap, pos))->index = pos;
+        }
+
+        heap->nodes.count--;
+
+        if(pos != last) {
+                if(hep_sift_up(heap, pos) == pos)
+                        hep_sift_down(heap, pos);
+        }
+}
+
+PA_API s8 paInitHeap(struct pa_heap *heap, struct pa_memory *mem, s16 size,
+                s16 alloc, pa_list_compare cmp)
+{
+        s16 node_sz = hep_node_size(size);
+
+        if(paInitList(&heap->nodes, mem, node_sz, alloc, PA_NOLIM) < 0)
+                return -1;
+
+        if(paInitList(&heap->slots, mem, PA_SLOT_SIZE, alloc, PA_NOLIM) < 0) {
+                paDestroyList(&heap->nodes);
+                return -1;
+        }
+
+        heap->compare = cmp;
+        heap->entry_size = size;
+        heap->free_head = -1;
+        return 0;
+}
+
+PA_API s8 paInitHeapFixed(struct pa_heap *heap, s16 size, pa_list_compare cmp,
+                void *buf, s32 buf_sz)
+{
+        u8 *ptr = buf;
+        s16 node_sz = hep_node_size(size);
+        s32 num;
+
+        /* The nodes come first, followed by the slots */
+        num = buf_sz / (node_sz + PA_SLOT_SIZE);
+        if(num < 1)
+                return -1;
+
+        if(num > 0x7FFF)
+                num = 0x7FFF;
+
+        paInitListFixed(&heap->nodes, node_sz, ptr, num * node_sz);
+        paInitListFixed(&heap->slots, PA_SLOT_SIZE, ptr + num * node_sz,
+                        num * PA_SLOT_SIZE);
+
+        heap->compare = cmp;
+        heap->entry_size = size;
+        heap->free_head = -1;
+        return 0;
+}
+
+PA_API void paDestroyHeap(struct pa_heap *heap)
+{
+        paDestroyList(&heap->nodes);
+        paDestroyList(&heap->slots);
+
+        heap->free_head = -1;
+}
+
+PA_API void paClearHeap(struct pa_heap *heap)
+{
+        struct pa_slot *slot;
+        s16 i;
+
+        /*
+         * Keep the slots, so the generations are preserved, but free all of
+         * them so old handles become invalid.
+         */
+        heap->free_head = -1;
+        for(i = heap->slots.count - 1; i >= 0; i--) {
+                slot = hep_slot(heap, i);
+                if(slot->generation % 2 == 1)
+                        slot->generation++;
+
+                slot->index = heap->free_head;
+                heap->free_head = i;
+        }
+
+        heap->nodes.count = 0;
+}
+
+PA_API s8 paPushHeap(struct pa_heap *heap, void *src,
+                struct pa_slot_handle *out)
+{
+        s32 pos = heap->nodes.count;
+
+        /* Make room for the node before attaching a slot to it */
+        lst_ensure_fit(&heap->nodes, 1);
+        if(pos >= heap->nodes.alloc)
+                return -1;
+
+        if(hep_take_slot(heap, pos, out) < 0)
+                return -1;
+
+        /* Append the node to the end, then move it up */
+        pa_mem_copy(lst_at(&heap->nodes, pos), src, heap->entry_size);
+        heap->nodes.count++;
+
+        hep_sift_up(heap, pos);
+        return 0;
+}
+
+PA_API s8 paPopHeap(struct pa_heap *heap, void *dst,
+                struct pa_slot_handle *out)
+{
+        if(heap->nodes.count < 1)
+                return 0;
+
+        hep_remove_at(heap, 0, dst, out);
+        return 1;
+}
+
+PA_API s8 paPeekHeap(struct pa_heap *heap, void *dst)
+{
+        if(heap->nodes.count < 1)
+                return 0;
+
+        pa_mem_copy(dst, heap->nodes.data, heap->entry_size);
+        return 1;
+}
+
+PA_API s8 paUpdateHeap(struct pa_heap *heap, struct pa_slot_handle hdl,
+                void *src)
+{
+        struct pa_slot *slot;
+        s16 pos;
+
+        if(!(slot = hep_resolve(heap, hdl)))
+                return -1;
+
+        pos = slot->index;
+        pa_mem_copy(lst_at(&heap->nodes, pos), src, heap->entry_size);
+
+        if(hep_sift_up(heap, pos) == pos)
+                hep_sift_down(heap, pos);
+
+        return 0;
+}
+
+PA_API s8 paRemoveHeap(struct pa_heap *heap, struct pa_slot_handle hdl,
+                void *dst)
+{
+        struct pa_slot *slot;
+
+        if(!(slot = hep_resolve(heap, hdl)))
+                return 0;
+
+        hep_remove_at(heap, slot->index, dst, NULL);
+        return 1;
+}
+
+PA_API s16 paBuildHeap(struct pa_heap *heap, void *src, s16 num,
+                struct pa_slot_handle *out)
+{
+        u8 *ptr = src;
+        s16 written = 0;
+        s32 pos;
+        s32 i;
+
+        lst_ensure_fit(&heap->nodes, num);
+
+        /* Append all nodes without ordering them */
+        while(written < num && heap->nodes.count < heap->nodes.alloc) {
+                pos = heap->nodes.count;
+                if(hep_take_slot(heap, pos, out ? out + written : NULL) < 0)
+                        break;
+
+                pa_mem_copy(lst_at(&heap->nodes, pos), ptr, heap->entry_size);
+                heap->nodes.count++;
+
+                ptr += heap->entry_size;
+                written++;
+        }
+
+        /* Restore the heap-order bottom-up */
+        for(i = heap->nodes.count / 2 - 1; i >= 0; i--)
+                hep_sift_down(heap, i);
+
+        return written;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      BITSET
+ *
+ */
+
+#define BST_WORD(idx)           ((idx) / PA_BITSET_WORD)
+#define BST_MASK(idx)           ((u32)1 << ((idx) % PA_BITSET_WORD))
+
+/*
+ * Scale the bitset to fit the given number of words. The new words are
+ * unset.
+ */
+PA_INTERN s8 bst_ensure_fit(struct pa_bitset *set, s32 num)
+{
+        s32 new_count;
+        u32 *p;
+
+        if(num <= set->count)
+                return 0;
+
+        if(set->mode != PA_DYNAMIC)
+                return -1;
+
+        new_count = num * 1.5;
+        if(!(p = pa_mem_alloc(set->memory, set->words,
+                                        new_count * sizeof(u32))))
+                return -1;
+
+        pa_mem_zero(p + set->count, (new_count - set->count) * sizeof(u32));
+
+        set->words = p;
+        set->count = new_count;
+        return 0;
+}
+
+PA_API s8 paInitBitset(struct pa_bitset *set, struct pa_memory *mem, s32 bits)
+{
+        s32 count = (bits + PA_BITSET_WORD - 1) / PA_BITSET_WORD;
+
+        if(count < 1)
+                count = 1;
+
+        set->memory = mem;
+        set->mode = PA_DYNAMIC;
+        set->count = count;
+
+        if(!(set->words = pa_mem_alloc(mem, NULL, count * sizeof(u32))))
+                return -1;
+
+        pa_mem_zero(set->words, count * sizeof(u32));
+        return 0;
+}
+
+PA_API s8 paInitBitsetFixed(struct pa_bitset *set, void *buf, s32 buf_sz)
+{
+        u8 *ptr = buf;
+        s32 pad;
+
+        /* Align the words to 4 bytes */
+        pad = (sizeof(u32) - ((unsigned long)ptr % sizeof(u32))) %
+                sizeof(u32);
+        if(buf_sz - pad < (s32)sizeof(u32))
+                return -1;
+
+        set->memory = NULL;
+        set->mode = PA_FIXED;
+        set->words = (u32 *)(ptr + pad);
+        set->count = (buf_sz - pad) / sizeof(u32);
+
+        pa_mem_zero(set->words, set->count * sizeof(u32));
+        return 0;
+}
+
+PA_API void paDestroyBitset(struct pa_bitset *set)
+{
+        if(set->mode == PA_DYNAMIC) {
+                pa_mem_free(set->memory, set->words);
+        }
+
+        set->mode = PA_MEM_UDEF;
+        set->words = NULL;
+        set->count = 0;
+}
+
+PA_API void paClearBitset(struct pa_bitset *set)
+{
+        pa_mem_zero(set->words, set->count * sizeof(u32));
+}
+
+PA_API s8 paSetBit(struct pa_bitset *set, s32 idx)
+{
+        if(idx < 0)
+                return -1;
+
+        if(bst_ensure_fit(set, BST_WORD(idx) + 1) < 0)
+                return -1;
+
+        set->words[BST_WORD(idx)] |= BST_MASK(idx);
+        return 0;
+}
+
+PA_API void paClearBit(struct pa_bitset *set, s32 idx)
+{
+        if(idx < 0 || BST_WORD(idx) >= set->count)
+                return;
+
+        set->words[BST_WORD(idx)] &= ~BST_MASK(idx);
+}
+
+PA_API s8 paTestBit(struct pa_bitset *set, s32 idx)
+{
+        if(idx < 0 || BST_WORD(idx) >= set->count)
+                return 0;
+
+        return (set->words[BST_WORD(idx)] & BST_MASK(idx)) != 0;
+}
+
+PA_API s32 paCountBitset(struct pa_bitset *set)
+{
+        s32 num = 0;
+        s32 i;
+
+        for(i = 0; i < set->count; i++)
+                num += pa_bit_popcount(set->words[i]);
+
+        return num;
+}
+
+PA_API s32 paNextBit(struct pa_bitset *set, s32 start)
+{
+        s32 i;
+        u32 word;
+
+        if(start < 0)
+                start = 0;
+
+        if((i = BST_WORD(start)) >= set->count)
+                return -1;
+
+        /* Mask out the bits before the start in the first word */
+        word = set->words[i] & ~(BST_MASK(start) - 1);
+
+        while(!word) {
+                if(++i >= set->count)
+                        return -1;
+
+                word = set->words[i];
+        }
+
+        return i * PA_BITSET_WORD + pa_bit_ctz(word);
+}
+
+PA_API s32 paIterateBitset(struct pa_bitset *set, s32 idx)
+{
+        return paNextBit(set, idx + 1);
+}
+
+PA_API void paAndBitset(struct pa_bitset *dst, struct pa_bitset *src)
+{
+        s32 num = dst->count < src->count ? dst->count : src->count;
+        s32 i;
+
+        for(i = 0; i < num; i++)
+                dst->words[i] &= src->words[i];
+
+        /* Bits beyond the source are unset in the source */
+        if(dst->count > num) {
+                pa_mem_zero(dst->words + num,
+                                (dst->count - num) * sizeof(u32));
+        }
+}
+
+PA_API s8 paOrBitset(struct pa_bitset *dst, struct pa_bitset *src)
+{
+        s32 num = src->count;
+        s8 r = 0;
+        s32 i;
+
+        /* Only scale if the additional words actually contain set bits */
+        while(num > dst->count && !src->words[num - 1])
+                num--;
+
+        if(bst_ensure_fit(dst, num) < 0) {
+                num = dst->count;
+                r = -1;
+        }
+
+        for(i = 0; i < num; i++)
+                dst->words[i] |= src->words[i];
+
+        return r;
+}
+
+PA_API void paAndNotBitset(struct pa_bitset *dst, struct pa_bitset *src)
+{
+        s32 num = dst->count < src->count ? dst->count : src->count;
+        s32 i;
+
+        for(i = 0; i < num; i++)
+                dst->words[i] &= ~src->words[i];
+}
+
+#undef BST_WORD
+#undef BST_MASK
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      HASH-STATS
+ *
+ */
+
+/*
+ * Walk all buckets and collect the chain-lengths, probe-lengths and
+ * collisions. The dictionary and the table both start their entries with the
+ * next-index and the 16-bit hash, so this works for both. Entries with the
+ * same hash always end up in the same bucket, so only the chains have to be
+ * searched for collisions.
+ */
+PA_INTERN void hst_collect(struct pa_hash_stats *stats, u8 *buffer,
+                s32 entry_size, s16 *buckets, s16 bucket_count)
+{
+        s32 probes = 0;
+        s32 len;
+        s16 idx;
+        s16 other;
+        u16 hash;
+        s16 i;
+
+        pa_mem_zero(stats, sizeof(struct pa_hash_stats));
+        stats->buckets = bucket_count;
+
+        for(i = 0; i < bucket_count; i++) {
+                len = 0;
+                for(idx = buckets[i]; idx >= 0;
+                                idx = *(s16 *)(buffer + idx * entry_size)) {
+                        len++;
+                        probes += len;
+
+                        /* Look for another entry with the same hash */
+                        hash = *(u16 *)(buffer + idx * entry_size +
+                                        sizeof(s16));
+                        for(other = buckets[i]; other >= 0; other =
+                                        *(s16 *)(buffer + other * entry_size)) {
+                                if(other != idx && hash == *(u16 *)(buffer +
+                                                other * entry_size +
+                                                sizeof(s16))) {
+                                        stats->collisions++;
+                                        break;
+                                }
+                        }
+                }
+
+                stats->entries += len;
+                stats->chains[PA_MIN(len, PA_STATS_CHAINS - 1)]++;
+                if(len > stats->longest)
+                        stats->longest = len;
+        }
+
+        if(bucket_count > 0) {
+                stats->load = (f32)stats->entries / bucket_count;
+                stats->probe_miss = stats->load;
+        }
+
+        if(stats->entries > 0)
+                stats->probe_hit = (f32)probes / stats->entries;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      DICTIONARY
+ *
+ */
+
+/*
+ * Hash the key. The lower 16 bits are stored with the entry to skip most
+ * key-comparisons, all 32 bits are used by the bloom-filter.
+ */
+PA_INTERN u32 dct_hash(char *key)
+{
+        return pa_hash(key, pa_strlen(key));
+}
+
+/*
+ * Mark the entry-slots in the given range as not-used and push them onto the
+ * free-list. Free slots don't need a hash, so the hash-field is used to store
+ * the index of the next free slot.
+ */
+PA_INTERN void dct_reset_slots(struct pa_dictionary *dct, s16 from, s16 to)
+{
+        u8 *ptr;
+        s16 i;
+
+        for(i = to - 1; i >= from; i--) {
+                ptr = dct->buffer + i * dct->entry_size;
+                *(s16 *)ptr = -1;
+                *(s16 *)(ptr + PA_DICT_NEXT_SIZE) = dct->free_head;
+                dct->free_head = i;
+        }
+}
+
+/*
+ * Pop the next open slot from the free-list. In ordered mode the free-list is
+ * not used and the slot behind the last used one is taken instead.
+ */
+PA_INTERN s16 dct_find_open(struct pa_dictionary *dct)
+{
+        s16 slot;
+
+        if(dct->ordered) {
+                if(dct->tail >= dct->alloc)
+                        return -1;
+
+                return dct->tail++;
+        }
+
+        if((slot = dct->free_head) < 0)
+                return -1;
+
+        dct->free_head = *(s16 *)(dct->buffer + slot * dct->entry_size +
+                        PA_DICT_NEXT_SIZE);
+        return slot;
+}
+
+/*
+ * Get a pointer to the key of an entry in the key-buffer.
+ */
+PA_INTERN char *dct_key(struct pa_dictionary *dct, u8 *ptr)
+{
+        s32 off = *(s32 *)(ptr + PA_DICT_NEXT_SIZE + PA_DICT_HASH_SIZE);
+
+        return (char *)(dct->keys + off + PA_DICT_KEY_HEAD);
+}
+
+/*
+ * Move the keys of all used entries to the front of the key-buffer and update
+ * the offsets in the entries. The records are visited in the order they are
+ * stored, so they only ever move towards the front and this can be done in
+ * place.
+ */
+PA_INTERN void dct_compact_keys(struct pa_dictionary *dct)
+{
+        s32 read = 0;
+        s32 write = 0;
+        s16 slot;
+        s16 size;
+        u8 *ptr;
+
+        while(read < dct->keys_used) {
+                slot = *(s16 *)(dct->keys + read);
+                size = *(s16 *)(dct->keys + read + sizeof(s16));
+
+                if(slot >= 0) {
+                        pa_mem_move(dct->keys + write, dct->keys + read, size);
+
+                        ptr = dct->buffer + slot * dct->entry_size;
+                        ptr += PA_DICT_NEXT_SIZE + PA_DICT_HASH_SIZE;
+                        *(s32 *)ptr = write;
+
+                        write += size;
+                }
+
+                read += size;
+        }
+
+        dct->keys_used = write;
+        dct->keys_dead = 0;
+}
+
+/*
+ * Append the key to the key-buffer and return the offset of the record. The
+ * records of removed keys are reclaimed once the key-buffer is full. In
+ * dynamic mode this only happens if at least half of the buffer is unused,
+ * otherwise the key-buffer is scaled instead.
+ */
+PA_INTERN s32 dct_store_key(struct pa_dictionary *dct, char *key, s16 slot)
+{
+        s32 len = pa_strlen(key) + 1;
+        s32 size = (PA_DICT_KEY_HEAD + len + 1) & ~1;
+        s32 new_size;
+        s32 off;
+        u8 *p;
+
+        if(size > 0x7FFF)
+                return -1;
+
+        if(dct->keys_used + size > dct->keys_size && dct->keys_dead > 0) {
+                if(dct->mode != PA_DYNAMIC ||
+                                dct->keys_dead >= dct->keys_used / 2)
+                        dct_compact_keys(dct);
+        }
+
+        if(dct->keys_used + size > dct->keys_size) {
+                if(dct->mode != PA_DYNAMIC)
+                        return -1;
+
+                new_size = (dct->keys_used + size) * 1.5;
+                if(!(p = pa_mem_alloc(dct->memory, dct->keys, new_size)))
+                        return -1;
+
+                dct->keys = p;
+                dct->keys_size = new_size;
+        }
+
+        /* Write the record: <slot><size><key> */
+        off = dct->keys_used;
+        *(s16 *)(dct->keys + off) = slot;
+        *(s16 *)(dct->keys + off + sizeof(s16)) = size;
+        pa_mem_copy(dct->keys + off + PA_DICT_KEY_HEAD, key, len);
+
+        dct->keys_used += size;
+        return off;
+}
+
+/*
+ * Get the number of buckets needed to keep the load factor for the given
+ * number of entries below PA_DICT_LOAD.
+ */
+PA_INTERN s16 dct_bucket_num(s32 num)
+{
+        s32 buckets = PA_DICT_BUCKETS;
+
+        while(buckets < PA_DICT_BUCKETS_MAX && num > buckets * PA_DICT_LOAD)
+                buckets *= 2;
+
+        return buckets;
+}
+
+/*
+ * Get the number of bytes needed to store the given number of entries
+ * followed by the buckets and the key-buffer in a single buffer.
+ */
+PA_INTERN s32 dct_fixed_size(struct pa_dictionary *dct, s32 num)
+{
+        s32 size = (num * dct->entry_size + 1) & ~1;
+
+        size += dct_bucket_num(num) * sizeof(s16);
+        return size + num * PA_DICT_KEY_AVG;
+}
+
+/*
+ * Reset the buckets and attach all used entries to the bucket for their hash
+ * again. Going backwards and attaching every entry at the front of the bucket
+ * keeps the entries in each bucket in slot-order.
+ */
+PA_INTERN void dct_rehash(struct pa_dictionary *dct)
+{
+        s16 mask = dct->bucket_count - 1;
+        s16 bucket;
+        u8 *ptr;
+        s16 i;
+
+        for(i = 0; i < dct->bucket_count; i++)
+                dct->buckets[i] = -1;
+
+        for(i = dct->alloc - 1; i >= 0; i--) {
+                ptr = dct->buffer + i * dct->entry_size;
+                if(*(s16 *)ptr == -1)
+                        continue;
+
+                bucket = *(u16 *)(ptr + PA_DICT_NEXT_SIZE) & mask;
+                if(dct->buckets[bucket] < 0)
+                        *(s16 *)ptr = -(bucket + 2);
+                else
+                        *(s16 *)ptr = dct->buckets[bucket];
+
+                dct->buckets[bucket] = i;
+        }
+}
+
+/*
+ * Move all used entries to the front of the dictionary-buffer, keeping their
+ * order, and rebuild the free-list and the buckets. The records in the
+ * key-buffer are updated to point to the new slots.
+ */
+PA_INTERN void dct_compact_slots(struct pa_dictionary *dct)
+{
+        s16 write = 0;
+        u8 *src;
+        u8 *dst;
+        u8 *rec;
+        s16 i;
+
+        for(i = 0; i < dct->alloc; i++) {
+                src = dct->buffer + i * dct->entry_size;
+                if(*(s16 *)src == -1)
+                        continue;
+
+                if(i != write) {
+                        dst = dct->buffer + write * dct->entry_size;
+                        pa_mem_copy(dst, src, dct->entry_size);
+
+                        rec = (u8 *)dct_key(dct, dst) - PA_DICT_KEY_HEAD;
+                        *(s16 *)rec = write;
+                }
+
+                write++;
+        }
+
+        dct->tail = write;
+        dct->free_head = -1;
+        dct_reset_slots(dct, write, dct->alloc);
+        dct_rehash(dct);
+}
+
+/*
+ * Create the bloom-filter anew with the given false-positive rate, sized for
+ * the current number of slots, and add all keys.
+ */
+PA_INTERN s8 dct_build_filter(struct pa_dictionary *dct, f32 rate)
+{
+        u8 *ptr;
+        s16 i;
+
+        pa_bloom_destroy(&dct->filter, dct->memory);
+        if(pa_bloom_init(&dct->filter, dct->memory, dct->alloc, rate) < 0)
+                return -1;
+
+        for(i = 0; i < dct->alloc; i++) {
+                ptr = dct->buffer + i * dct->entry_size;
+                if(*(s16 *)ptr != -1)
+                        pa_bloom_add(&dct->filter, dct_hash(dct_key(dct, ptr)));
+        }
+
+        return 0;
+}
+
+/*
+ * If configured as dynamic, scale the dictionary-buffer to fit one more entry
+ * and double the number of buckets if the load factor would be exceeded.
+ *
+ * In ordered mode, the holes left by removed entries are reclaimed once the
+ * last slot has been used. In dynamic mode this only happens if at least a
+ * third of the slots are holes, otherwise the dictionary-buffer is scaled.
+ */
+PA_INTERN s8 dct_ensure_fit(struct pa_dictionary *dct)
+{
+        s32 new_alloc;
+        s16 new_count;
+        s16 *buckets;
+        u8 *p;
+
+        if(dct->ordered && dct->tail >= dct->alloc &&
+                        dct->number < dct->alloc) {
+                if(dct->mode != PA_DYNAMIC ||
+                                dct->alloc - dct->number >= dct->alloc / 3)
+                        dct_compact_slots(dct);
+        }
+
+        if(dct->mode != PA_DYNAMIC)
+                return 0;
+
+        if((dct->ordered ? dct->tail : dct->number) >= dct->alloc) {
+                new_alloc = dct->alloc * 1.5 + 1;
+                if(new_alloc > 0x7FFF)
+                        new_alloc = 0x7FFF;
+
+                if(new_alloc <= dct->alloc)
+                        return -1;
+
+                if(!(p = pa_mem_alloc(dct->memory, dct->buffer,
+                                                new_alloc * dct->entry_size)))
+                        return -1;
+
+                dct->buffer = p;
+                dct_reset_slots(dct, dct->alloc, new_alloc);
+                dct->alloc = new_alloc;
+
+                /* The filter would fill up, so size it for the new slots */
+                if(dct->filter.bits &&
+                                dct_build_filter(dct, dct->filter.rate) < 0)
+                        return -1;
+        }
+
+        if((new_count = dct_bucket_num(dct->number + 1)) > dct->bucket_count) {
+                if(!(buckets = pa_mem_alloc(dct->memory, dct->buckets,
+                                                new_count * sizeof(s16))))
+                        return -1;
+
+                dct->buckets = buckets;
+                dct->bucket_count = new_count;
+                dct_rehash(dct);
+        }
+
+        return 0;
+}
+PA_INTERN u8 *dct_next_bucket(struct pa_dictionary *dct, s16 bucket, u8 *ptr)
+{
+        s16 next_idx = -1;
+
+        if(bucket < 0 || bucket >= dct->bucket_count)
+                return NULL;
+
+        if(dct->buckets[bucket] < 0)
+                return NULL;
+
+        /*
+         * On the first call ptr will be NULL, so we have to find the first
+         * entry in the dictionary.
+         */
+        if(!ptr) {
+                return dct->buffer + (dct->buckets[bucket] * dct->entry_size);
+        }
+
+        /*
+         * Otherwise we have to get a pointer to the next entry.
+         */
+        if((next_idx = *(s16 *)ptr) < 0) {
+                return NULL;
+        }
+
+        /* Return a pointer to the entry */
+        return dct->buffer + (next_idx * dct->entry_size);
+
+
+}
+
+PA_INTERN u8 *dct_next(struct pa_dictionary *dct, u8 *ptr)
+{
+        s16 idx = -1;
+        s16 next_idx = -1;
+        s16 bucket_num;
+
+        /*
+         * On the first call ptr will be NULL, so we have to find the first
+         * entry in the dictionary.
+         */
+        if(!ptr) {
+                bucket_num = 0;
+                while(bucket_num < dct->bucket_count) {
+                        if(dct->buckets[bucket_num] >= 0) {
+                                idx = dct->buckets[bucket_num];
+                                ptr = dct->buffer + (idx * dct->entry_size);
+                                break;
+                        }
+                        bucket_num++;
+                }
+
+                return ptr;
+        }
+
+        /*
+         * Otherwise we have to get a pointer to the next entry.
+         */
+        next_idx = *(s16 *)ptr;
+        if(next_idx <= -2) {
+                bucket_num = (-1 * next_idx) - 2 + 1;
+                while(bucket_num < dct->bucket_count) {
+                        if(dct->buckets[bucket_num] >= 0) {
+                                next_idx = dct->buckets[bucket_num];
+                                break;
+                        }
+                        bucket_num++;
+                }
+
+                /* No more entries left in the dictionary */
+                if(next_idx <= -2)
+                        return NULL;
+        }
+
+        /* Return a pointer to the entry */
+        return dct->buffer + (next_idx * dct->entry_size);
+}
+
+PA_INTERN u8 *dct_find_key(struct pa_dictionary *dct, char *key, u32 hash,
+                u8 **prev, s16 *bucket_out)
+{
+        s16 bucket = hash & (dct->bucket_count - 1);
+        u8 *ptr = NULL;
+
+        if(dct->buckets[bucket] < 0)
+                return NULL;
+
+        if(bucket_out) *bucket_out = bucket;
+
+        if(prev) *prev = NULL;
+        while((ptr = dct_next_bucket(dct, bucket, ptr))) {
+                /* Compare the hashes */
+                if((hash & 0xFFFF) == *(u16 *)(ptr + PA_DICT_NEXT_SIZE)) {
+                        if(pa_strcmp(key, dct_key(dct, ptr)) == 0) {
+                                return ptr;
+                        }
+                }
+                if(prev) *prev = ptr;
+        }
+
+        return NULL;
+}
+
+PA_API s8 paInitDictionary(struct pa_dictionary *dct, struct pa_memory *mem,
+                s32 size, s16 alloc)
+{
+        s32 alloc_sz;
+        s16 i;
+
+        dct->memory = mem;
+        dct->mode = PA_DYNAMIC;
+
+        dct->value_size = size;
+        dct->entry_size = (PA_DICT_HEAD_SIZE + size + 3) & ~3;
+        dct->number = 0;
+        dct->alloc = alloc;
+        dct->ordered = 0;
+        dct->tail = 0;
+        dct->bucket_count = dct_bucket_num(alloc);
+        dct->keys_size = (alloc > 0 ? alloc : 1) * PA_DICT_KEY_AVG;
+        dct->keys_used = 0;
+        dct->keys_dead = 0;
+
+        alloc_sz = dct->entry_size * dct->alloc;
+        if(!(dct->buffer = pa_mem_alloc(dct->memory, NULL, alloc_sz))) {
+                return -1;
+        }
+
+        alloc_sz = dct->bucket_count * sizeof(s16);
+        if(!(dct->buckets = pa_mem_alloc(dct->memory, NULL, alloc_sz))) {
+                goto err_free_buffer;
+        }
+
+        if(!(dct->keys = pa_mem_alloc(dct->memory, NULL, dct->keys_size))) {
+                goto err_free_buckets;
+        }
+
+        /* Reset all memory slots in the buffer */
+        dct->free_head = -1;
+        dct_reset_slots(dct, 0, dct->alloc);
+        pa_mem_zero(&dct->filter, sizeof(struct pa_bloom));
+        dct->hits = 0;
+        dct->misses = 0;
+        dct->filter_checks = 0;
+        dct->filter_rejects = 0;
+
+        /* Reset all buckets */
+        for(i = 0; i < dct->bucket_count; i++) {
+                dct->buckets[i] = -1;
+        }
+
+        return 0;
+
+err_free_buckets:
+        pa_mem_free(dct->memory, dct->buckets);
+
+err_free_buffer:
+        pa_mem_free(dct->memory, dct->buffer);
+        return -1;
+}
+
+PA_API s8 paInitDictionaryFixed(struct pa_dictionary *dct, void *buffer,
+                s32 buf_sz, s32 value_sz)
+{
+        s32 num;
+        s16 i;
+
+        dct->memory = NULL;
+        dct->mode = PA_FIXED;
+
+        dct->value_size = value_sz;
+        dct->entry_size = (PA_DICT_HEAD_SIZE + value_sz + 3) & ~3;
+        dct->number = 0;
+        dct->ordered = 0;
+        dct->tail = 0;
+        dct->buffer = buffer;
+
+        /*
+         * The entries come first, followed by the buckets and the key-buffer,
+         * which gets all the remaining memory. Start with as many entries as
+         * fit into the buffer and reduce the number until the buckets and
+         * PA_DICT_KEY_AVG bytes per key fit as well.
+         */
+        num = buf_sz / dct->entry_size;
+        if(num > 0x7FFF)
+                num = 0x7FFF;
+
+        while(num > 0 && dct_fixed_size(dct, num) > buf_sz)
+                num--;
+
+        if(num < 1)
+                return -1;
+
+        dct->alloc = num;
+        dct->bucket_count = dct_bucket_num(num);
+        dct->buckets = (s16 *)(dct->buffer +
+                        ((num * dct->entry_size + 1) & ~1));
+
+        dct->keys = (u8 *)(dct->buckets + dct->bucket_count);
+        dct->keys_size = (buf_sz - (dct->keys - dct->buffer)) & ~1;
+        dct->keys_used = 0;
+        dct->keys_dead = 0;
+
+        /* Reset all entry-slots in the buffer */
+        dct->free_head = -1;
+        dct_reset_slots(dct, 0, dct->alloc);
+        pa_mem_zero(&dct->filter, sizeof(struct pa_bloom));
+        dct->hits = 0;
+        dct->misses = 0;
+        dct->filter_checks = 0;
+        dct->filter_rejects = 0;
+
+        /* Reset all buckets */
+        for(i = 0; i < dct->bucket_count; i++) {
+                dct->buckets[i] = -1;
+        }
+
+        return 0;
+}
+
+PA_API void paDestroyDictionary(struct pa_dictionary *dct)
+{
+        if(dct->mode == PA_DYNAMIC) {
+                pa_mem_free(dct->memory, dct->buffer);
+                pa_mem_free(dct->memory, dct->buckets);
+                pa_mem_free(dct->memory, dct->keys);
+                pa_bloom_destroy(&dct->filter, dct->memory);
+        }
+
+        dct->memory = 0;
+        dct->mode = PA_MEM_UDEF;
+
+        dct->value_size = 0;
+        dct->entry_size = 0;
+        dct->number = 0;
+        dct->alloc = 0;
+        dct->buffer = 0;
+        dct->ordered = 0;
+        dct->tail = 0;
+        dct->bucket_count = 0;
+        dct->buckets = 0;
+        dct->keys = 0;
+        dct->keys_size = 0;
+        dct->keys_used = 0;
+        dct->keys_dead = 0;
+}
+
+PA_API s8 paSetDictionary(struct pa_dictionary *dct, char *key, void *value)
+{
+        s16 slot;
+        u32 hash;
+        s16 bucket;
+        u8 *ptr;
+        s32 tmp;
+        s32 key_off;
+        s16 next_idx;
+
+        /*
+         * If there is already an entry with the keyword in the dictionary, we
+         * can just overwrite it's value and return.
+         */
+        hash = dct_hash(key);
+        if((ptr = dct_find_key(dct, key, hash, NULL, NULL))) {
+                /* Copy over the content */
+                pa_mem_copy(ptr + PA_DICT_HEAD_SIZE, value, dct->value_size);
+                return 0;
+
+        }
+
+        /* If configured as dynamic, scale to fit the new entry */
+        if(dct_ensure_fit(dct) < 0)
+                return -1;
+
+        /* Get an open slot in the dictionary-buffer */
+        if((slot = dct_find_open(dct)) < 0)
+                return -1;
+
+        /* Write the key to the key-buffer, or give the slot back */
+        if((key_off = dct_store_key(dct, key, slot)) < 0) {
+                if(dct->ordered)
+                        dct->tail--;
+                else
+                        dct_reset_slots(dct, slot, slot + 1);
+                return -1;
+        }
+
+        /* Determine the bucket */
+        bucket = hash & (dct->bucket_count - 1);
+
+        /* 
+         * Write the copy over the data to the dictionary-buffer.
+         */
+
+        /* Set the next index */
+        ptr = dct->buffer + (slot * dct->entry_size);
+        *(s16 *)ptr = -(bucket + 2);
+        ptr += PA_DICT_NEXT_SIZE;
+
+        /* Copy the hash */
+        *(u16 *)ptr = hash & 0xFFFF;
+        ptr += PA_DICT_HASH_SIZE;
+
+        /* Set the offset of the key */
+        *(s32 *)ptr = key_off;
+        ptr += PA_DICT_KEY_SIZE;
+
+        /* Copy over the content */
+        pa_mem_copy(ptr, value, dct->value_size);
+
+        /*
+         * Attach the entry to the bucket.
+         */
+        if(dct->buckets[bucket] < 0) {
+                dct->buckets[bucket] = slot;
+        }
+        else {
+                tmp = dct->buckets[bucket] * dct->entry_size;
+                ptr = dct->buffer + tmp;
+                while((next_idx = *(s16 *)ptr) >= 0) {
+                        ptr = dct->buffer + next_idx * dct->entry_size;
+                }
+                *(s16 *)ptr = slot;
+        }
+
+        if(dct->filter.bits)
+                pa_bloom_add(&dct->filter, hash);
+
+        dct->number++;
+        return 0;
+}
+
+PA_API s8 paGetDictionary(struct pa_dictionary *dct, char *key, void *out)
+{
+        u32 hash = dct_hash(key);
+        u8 *ptr;
+
+        if(dct->filter.bits) {
+                dct->filter_checks++;
+                if(!pa_bloom_test(&dct->filter, hash)) {
+                        dct->filter_rejects++;
+                        dct->misses++;
+                        return 0;
+                }
+        }
+
+        if(!(ptr = dct_find_key(dct, key, hash, NULL, NULL))) {
+                dct->misses++;
+                return 0;
+        }
+
+        pa_mem_copy(out, ptr + PA_DICT_HEAD_SIZE, dct->value_size);
+        dct->hits++;
+        return 1;
+}
+
+PA_API void paRemoveDictionary(struct pa_dictionary *dct, char *key)
+{
+        s16 bucket;
+        u8 *ptr;
+        u8 *prev;
+        u8 *rec;
+        s16 next_idx;
+
+        if((ptr = dct_find_key(dct, key, dct_hash(key), &prev, &bucket))) {
+                next_idx = *(s16 *)ptr;
+
+                if(!prev && next_idx < 0) {
+                        dct->buckets[bucket] = -1;
+                }
+                else if(!prev && next_idx >= 0) {
+                        dct->buckets[bucket] = next_idx;
+                }
+                else if(prev) {
+                        *(s16 *)prev = *(s16 *)ptr;
+                }
+
+                /* Mark the record in the key-buffer as unused */
+                rec = (u8 *)dct_key(dct, ptr) - PA_DICT_KEY_HEAD;
+                *(s16 *)rec = -1;
+                dct->keys_dead += *(s16 *)(rec + sizeof(s16));
+
+                /* Push the slot onto the free-list */
+                *(s16 *)ptr = -1;
+                *(s16 *)(ptr + PA_DICT_NEXT_SIZE) = dct->free_head;
+                dct->free_head = (ptr - dct->buffer) / dct->entry_size;
+                dct->number--;
+
+                /*
+                 * The bits of the key stay in the filter, so rebuild it once
+                 * too many are left. If that fails, just go without it.
+                 */
+                if(dct->filter.bits && ++dct->filter.stale >
+                                dct->filter.capacity / 2) {
+                        if(dct_build_filter(dct, dct->filter.rate) < 0)
+                                pa_bloom_destroy(&dct->filter, dct->memory);
+                }
+        }
+}
+
+PA_API s8 paEnableDictionaryFilter(struct pa_dictionary *dct, f32 rate)
+{
+        if(dct->mode != PA_DYNAMIC)
+                return -1;
+
+        if(rate <= 0) {
+                pa_bloom_destroy(&dct->filter, dct->memory);
+                return 0;
+        }
+
+        return dct_build_filter(dct, rate);
+}
+
+PA_API void paGetDictionaryStats(struct pa_dictionary *dct,
+                struct pa_hash_stats *stats)
+{
+        hst_collect(stats, dct->buffer, dct->entry_size, dct->buckets,
+                        dct->bucket_count);
+
+        stats->slots = dct->alloc;
+        stats->hits = dct->hits;
+        stats->misses = dct->misses;
+        stats->filter_checks = dct->filter_checks;
+        stats->filter_rejects = dct->filter_rejects;
+}
+
+PA_API void paResetDictionaryStats(struct pa_dictionary *dct)
+{
+        dct->hits = 0;
+        dct->misses = 0;
+        dct->filter_checks = 0;
+        dct->filter_rejects = 0;
+}
+
+PA_API void paSetDictionaryOrdered(struct pa_dictionary *dct, s8 ordered)
+{
+        /* Either way the free-list and the tail have to be rebuilt */
+        dct_compact_slots(dct);
+        dct->ordered = ordered ? 1 : 0;
+}
+
+PA_API void *paIterateDictionary(struct pa_dictionary *dct, void *ptr, 
+                struct pa_dictionary_entry *ent)
+{
+        s16 idx = 0;
+
+        /* Check if the dictionary is empty */
+        if(dct->number < 1)
+                return NULL;
+
+        if(dct->ordered) {
+                /* Scan the buffer and skip the holes of removed entries */
+                if(ptr)
+                        idx = ((u8 *)ptr - dct->buffer) / dct->entry_size + 1;
+
+                for(; idx < dct->tail; idx++) {
+                        ptr = dct->buffer + idx * dct->entry_size;
+                        if(*(s16 *)ptr != -1)
+                                break;
+                }
+
+                if(idx >= dct->tail)
+                        return NULL;
+        }
+        /* Go to the next entry in the dictionary */
+        else if(!(ptr = dct_next(dct, ptr))) {
+                return NULL;
+        }
+
+        /* Return the entry-data for the current entry */
+        if(ent) {
+                ent->key = dct_key(dct, ptr);
+                ent->value = (u8 *)ptr + PA_DICT_HEAD_SIZE;
+        }
+
+        return ptr;
+}
+
+PA_API void *paIterateDictionaryBucket(struct pa_dictionary *dct, s16 bucket,
+                void *ptr, struct pa_dictionary_entry *ent)
+{
+        /* Check if the dictionary is empty */
+        if(dct->number < 1)
+                return NULL;
 
-        if(size < 1)
-                return;
+        if(!(ptr = dct_next_bucket(dct, bucket, ptr)))
+                return NULL;
 
-        if(str->size + size + 1 > str->alloc && str->mode == PA_DYNAMIC) {
-                new_alloc = (str->size + size) * 1.5;
-                if(!(p = pa_mem_alloc(str->memory, str->buffer, new_alloc))) {
-                        return;
-                }
-                str->buffer = p;
-                str->alloc = new_alloc;
+        /* Return the data for the current entry */
+        if(ent) {
+                ent->key = dct_key(dct, ptr);
+                ent->value = (u8 *)ptr + PA_DICT_HEAD_SIZE;
         }
+
+        return ptr;
 }
 
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      TABLE
+ *
+ */
 
+/*
+ * Hash the whole key and fold the result into 16 bits, which are stored with
+ * the entry to skip most key-comparisons.
+ */
+PA_INTERN u16 tbl_hash(u8 *key, s32 key_sz)
+{
+        return pa_hash(key, key_sz) & 0xFFFF;
+}
 
-PA_API s8 paInitString(struct pa_string *str, struct pa_memory *mem)
+/*
+ * Mark the entry-slots in the given range as not-used and push them onto the
+ * free-list. Free slots don't need a hash, so the hash-field is used to store
+ * the index of the next free slot.
+ */
+PA_INTERN void tbl_reset_slots(struct pa_table *tbl, s16 from, s16 to)
 {
-        str->memory = mem;
-        str->mode = PA_DYNAMIC;
+        u8 *ptr;
+        s16 i;
 
-        str->length = 0;
-        str->size = 0;
-        str->alloc = PA_STRING_INITIAL_SIZE;
+        for(i = to - 1; i >= from; i--) {
+                ptr = tbl->buffer + i * tbl->entry_size;
+                *(s16 *)ptr = -1;
+                *(s16 *)(ptr + PA_TBL_NEXT_SIZE) = tbl->free_head;
+                tbl->free_head = i;
+        }
+}
 
-        if(!(str->buffer = pa_mem_alloc(str->memory, NULL, str->alloc))) {
+/*
+ * Pop the next open slot from the free-list.
+ */
+PA_INTERN s16 tbl_find_open(struct pa_table *tbl)
+{
+        s16 slot;
+
+        if((slot = tbl->free_head) < 0)
+                return -1;
+
+        tbl->free_head = *(s16 *)(tbl->buffer + slot * tbl->entry_size +
+                        PA_TBL_NEXT_SIZE);
+        return slot;
+}
+/*
+ * Get the number of buckets needed to keep the load factor for the given
+ * number of entries below PA_TBL_LOAD.
+ */
+PA_INTERN s16 tbl_bucket_num(s32 num)
+{
+        s32 buckets = PA_TBL_BUCKETS;
+
+        while(buckets < PA_TBL_BUCKETS_MAX && num > buckets * PA_TBL_LOAD)
+                buckets *= 2;
+
+        return buckets;
+}
+
+/*
+ * Get the number of bytes needed to store the given number of entries
+ * followed by the buckets in a single buffer.
+ */
+PA_INTERN s32 tbl_fixed_size(struct pa_table *tbl, s32 num)
+{
+        s32 size = (num * tbl->entry_size + 1) & ~1;
+
+        return size + tbl_bucket_num(num) * sizeof(s16);
+}
+
+/*
+ * Reset the buckets and attach all used entries to the bucket for their hash
+ * again. Going backwards and attaching every entry at the front of the bucket
+ * keeps the entries in each bucket in slot-order.
+ */
+PA_INTERN void tbl_rehash(struct pa_table *tbl)
+{
+        s16 mask = tbl->bucket_count - 1;
+        s16 bucket;
+        u8 *ptr;
+        s16 i;
+
+        for(i = 0; i < tbl->bucket_count; i++)
+                tbl->buckets[i] = -1;
+
+        for(i = tbl->alloc - 1; i >= 0; i--) {
+                ptr = tbl->buffer + i * tbl->entry_size;
+                if(*(s16 *)ptr == -1)
+                        continue;
+
+                bucket = *(u16 *)(ptr + PA_TBL_NEXT_SIZE) & mask;
+                if(tbl->buckets[bucket] < 0)
+                        *(s16 *)ptr = -(bucket + 2);
+                else
+                        *(s16 *)ptr = tbl->buckets[bucket];
+
+                tbl->buckets[bucket] = i;
+        }
+}
+
+/*
+ * Create the bloom-filter anew with the given false-positive rate, sized for
+ * the current number of slots, and add all keys.
+ */
+PA_INTERN s8 tbl_build_filter(struct pa_table *tbl, f32 rate)
+{
+        u8 *ptr;
+        s16 i;
+
+        pa_bloom_destroy(&tbl->filter, tbl->memory);
+        if(pa_bloom_init(&tbl->filter, tbl->memory, tbl->alloc, rate) < 0)
                 return -1;
+
+        for(i = 0; i < tbl->alloc; i++) {
+                ptr = tbl->buffer + i * tbl->entry_size;
+                if(*(s16 *)ptr == -1)
+                        continue;
+
+                ptr += PA_TBL_HEAD_SIZE;
+                pa_bloom_add(&tbl->filter, pa_hash(ptr, tbl->key_size));
         }
-        *str->buffer = 0;
 
         return 0;
 }
 
-PA_API s8 paInitStringFixed(struct pa_string *str, void *buf, s32 alloc)
+/*
+ * If configured as dynamic, scale the table-buffer to fit one more entry
+ * and double the number of buckets if the load factor would be exceeded.
+ */
+PA_INTERN s8 tbl_ensure_fit(struct pa_table *tbl)
 {
-        str->memory = NULL;
-        str->mode = PA_FIXED;
+        s32 new_alloc;
+        s16 new_count;
+        s16 *buckets;
+        u8 *p;
 
-        str->buffer = buf;
-        *str->buffer = 0;
+        if(tbl->mode != PA_DYNAMIC)
+                return 0;
+
+        if(tbl->number >= tbl->alloc) {
+                new_alloc = tbl->alloc * 1.5 + 1;
+                if(new_alloc > 0x7FFF)
+                        new_alloc = 0x7FFF;
+
+                if(new_alloc <= tbl->alloc)
+                        return -1;
+
+                if(!(p = pa_mem_alloc(tbl->memory, tbl->buffer,
+                                                new_alloc * tbl->entry_size)))
+                        return -1;
+
+                tbl->buffer = p;
+                tbl_reset_slots(tbl, tbl->alloc, new_alloc);
+                tbl->alloc = new_alloc;
+
+                /* The filter would fill up, so size it for the new slots */
+                if(tbl->filter.bits &&
+                                tbl_build_filter(tbl, tbl->filter.rate) < 0)
+                        return -1;
+        }
+
+        if((new_count = tbl_bucket_num(tbl->number + 1)) > tbl->bucket_count) {
+                if(!(buckets = pa_mem_alloc(tbl->memory, tbl->buckets,
+                                                new_count * sizeof(s16))))
+                        return -1;
+
+                tbl->buckets = buckets;
+                tbl->bucket_count = new_count;
+                tbl_rehash(tbl);
+        }
 
-        str->length = 0;
-        str->size = 0;
-        str->alloc = alloc;
         return 0;
 }
 
-PA_API void paDestroyString(struct pa_string *str)
+PA_INTERN u8 *tbl_next_bucket(struct pa_table *tbl, s16 bucket, u8 *ptr)
 {
-        if(str->mode == PA_DYNAMIC) {
-                pa_mem_free(str->memory, str->buffer);
+        s16 next_idx = -1;
+
+        if(bucket < 0 || bucket >= tbl->bucket_count)
+                return NULL;
+
+        if(tbl->buckets[bucket] < 0)
+                return NULL;
+
+        /*
+         * On the first call ptr will be NULL, so we have to find the first
+         * entry in the table.
+         */
+        if(!ptr) {
+                return tbl->buffer + (tbl->buckets[bucket] * tbl->entry_size);
         }
 
-        str->buffer = NULL;
-        str->length = 0;
-        str->size = 0;
-        str->alloc = 0;
+        /*
+         * Otherwise we have to get a pointer to the next entry.
+         */
+        if((next_idx = *(s16 *)ptr) < 0) {
+                return NULL;
+        }
+
+        /* Return a pointer to the entry */
+        return tbl->buffer + (next_idx * tbl->entry_size);
 }
 
-PA_API s16 paWriteString(struct pa_string *str, char *src, s16 off, s16 num)
+PA_INTERN u8 *tbl_next(struct pa_table *tbl, u8 *ptr)
 {
-        s32 free_size;
-        s32 read_sz;
-        s32 write_off;
-        s32 write_sz;
-        s32 run;
-        s16 count;
+        s16 idx = -1;
+        s16 next_idx = -1;
+        s16 bucket_num;
 
-        s16 overlap;
-        s32 overlap_sz;
+        /*
+         * On the first call ptr will be NULL, so we have to find the first
+         * entry in the table.
+         */
+        if(!ptr) {
+                bucket_num = 0;
+                while(bucket_num < tbl->bucket_count) {
+                        if(tbl->buckets[bucket_num] >= 0) {
+                                idx = tbl->buckets[bucket_num];
+                                ptr = tbl->buffer + (idx * tbl->entry_size);
+                                break;
+                        }
+                        bucket_num++;
+                }
 
-        s32 trail_sz;
+                return ptr;
+        }
 
-        /* First we figure out how many bytes should be read from the source */
-        if(num == PA_ALL) {
-                read_sz = pa_strlen(src);
-                num = str_charnum(src, read_sz);
+        /*
+         * Otherwise we have to get a pointer to the next entry.
+         */
+        next_idx = *(s16 *)ptr;
+        if(next_idx <= -2) {
+                bucket_num = (-1 * next_idx) - 2 + 1;
+                while(bucket_num < tbl->bucket_count) {
+                        if(tbl->buckets[bucket_num] >= 0) {
+                                next_idx = tbl->buckets[bucket_num];
+                                break;
+                        }
+                        bucket_num++;
+                }
+
+                /* No more entries left in the table */
+                if(next_idx <= -2)
+                        return NULL;
         }
-        else {
-                read_sz = str_offset(src, num);
+
+        /* Return a pointer to the entry */
+        return tbl->buffer + (next_idx * tbl->entry_size);
+}
+
+PA_INTERN u8 *tbl_find_key(struct pa_table *tbl, u8 *key, u16 hash,
+                u8 **prev, s16 *bucket_out)
+{
+        s16 bucket = hash & (tbl->bucket_count - 1);
+        u8 *ptr = NULL;
+        s16 off = PA_TBL_NEXT_SIZE + PA_TBL_HASH_SIZE;
+
+        if(tbl->buckets[bucket] < 0)
+                return NULL;
+
+        if(bucket_out) *bucket_out = bucket;
+
+        if(prev) *prev = NULL;
+        while((ptr = tbl_next_bucket(tbl, bucket, ptr))) {
+                /* Compare the hashes */
+                if(hash == *(u16 *)(ptr + PA_TBL_NEXT_SIZE)) {
+                        if(pa_mem_compare(key, ptr + off, tbl->key_size)) {
+                                return ptr;
+                        }
+                }
+                if(prev) *prev = ptr;
         }
 
-        /* Second, we figure out what the offset should be */
-        off = off == PA_END ? str->length : off;
-        write_off = paGetStringOffset(str, off);
+        return NULL;
+}
 
-        /* Validate input parameters */
-        if(read_sz < 1) return 0;
-        if(off < 0 || off > str->length) return 0;
+/*
+ * Get the entry for the key, or create a new one if the key isn't in the table
+ * yet. The value of a new entry is left for the caller to write.
+ *
+ * Returns: A pointer to the entry or NULL if an error occurred
+ */
+PA_INTERN u8 *tbl_insert(struct pa_table *tbl, void *key, u16 hash)
+{
+        s16 slot;
+        s16 bucket;
+        u8 *ptr;
+        u8 *ent;
+        s32 tmp;
+        s16 next_idx;
 
-        /* Next we figure out the overlap */
-        overlap = PA_OVERLAP(0, str->length, off, num);
-        overlap_sz = str_offset(str->buffer + write_off, overlap);  
+        /* A mapped table is read-only */
+        if(tbl->mode == PA_MAPPED)
+                return NULL;
 
-        /* Scale the string-buffer to fit the new characters */
-        str_ensure_fit(str, read_sz - overlap_sz);
+        /* If there is already an entry with the key, just return it */
+        if((ptr = tbl_find_key(tbl, key, hash, NULL, NULL)))
+                return ptr;
+
+        /* If configured as dynamic, scale to fit the new entry */
+        if(tbl_ensure_fit(tbl) < 0)
+                return NULL;
+
+        /* Get an open slot in the table-buffer */
+        if((slot = tbl_find_open(tbl)) < 0)
+                return NULL;
+
+        /* Determine the bucket */
+        bucket = hash & (tbl->bucket_count - 1);
 
         /* 
-         * Determine how much free memory is left (subtract 1 for the
-         * null-terminator).
+         * Write the copy over the data to the table-buffer.
          */
-        free_size = str->alloc - str->size - 1 + overlap_sz;
 
+        /* Set the next index */
+        ent = ptr = tbl->buffer + (slot * tbl->entry_size);
+        *(s16 *)ptr = -(bucket + 2);
+        ptr += PA_TBL_NEXT_SIZE;
+
+        /* Copy the hash */
+        *(u16 *)ptr = hash;
+        ptr += PA_TBL_HASH_SIZE;
+
+        /* Copy over the keyword */
+        pa_mem_copy(ptr, key, tbl->key_size);
 
-        /* Now we have to figure out how many characters can actually we written
-         * to the string buffer.
+        /*
+         * Attach the entry to the bucket.
          */
-        run = 0;
-        count = 0;
-        write_sz = 0;
-        while(str_next(src, &run) && run <= free_size && run <= read_sz) {
-                write_sz = run;
-                count++;
+        if(tbl->buckets[bucket] < 0) {
+                tbl->buckets[bucket] = slot;
         }
-        num = count;
-
-        /* 
-         * Before we can actually copy to the string buffer, we have to move the
-         * trailing characters.
-         */
-        trail_sz = str->size - (write_off + overlap_sz);
-        if(trail_sz > 0) {
-                pa_mem_move(str->buffer + write_off + write_sz, 
-                                str->buffer + (str->size - trail_sz),
-                                trail_sz);
+        else {
+                tmp = tbl->buckets[bucket] * tbl->entry_size;
+                ptr = tbl->buffer + tmp;
+                while((next_idx = *(s16 *)ptr) >= 0) {
+                        ptr = tbl->buffer + next_idx * tbl->entry_size;
+                }
+                *(s16 *)ptr = slot;
         }
 
-        /* Copy from source to the string buffer */
-        pa_mem_copy(str->buffer + write_off, src, write_sz);
-
-        /* Update string byte-size and set null-terminator */
-        str->size += write_sz - overlap_sz;
-        str->length += num - overlap;
-        str->buffer[str->size] = 0;
+        if(tbl->filter.bits)
+                pa_bloom_add(&tbl->filter, pa_hash(key, tbl->key_size));
 
-        /* Return number of written bytes */
-        return num;
+        tbl->number++;
+        return ent;
 }
 
-PA_API s16 paInsertString(struct pa_string *str, char *src, s16 off, s16 num)
+/*
+ * Link the entries of a bucket written next to each other by paBuildTable().
+ * Duplicate keys are dropped, keeping the value of the last one, and their
+ * slots are pushed onto the free-list.
+ *
+ * Returns: The number of entries in the bucket
+ */
+PA_INTERN s16 tbl_link_bucket(struct pa_table *tbl, s16 bucket, s16 from,
+                s16 to)
 {
-        s32 free_size;
-        s16 read_num;
-        s32 read_sz;
-        s32 write_off;
-        s32 write_sz;
-        s32 run;
-        s32 move_off;
-        s32 move_sz;
-        s16 count;
+        s16 val_off = PA_TBL_HEAD_SIZE + tbl->key_size;
+        s16 last = -1;
+        s16 number = 0;
+        u8 *a;
+        u8 *b;
+        s16 i;
+        s16 j;
 
-        /* First we figure out how many bytes should be read from the source */
-        if(num == PA_ALL) {
-                read_sz = pa_strlen(src);
-                read_num = str_charnum(src, read_sz);
-        }
-        else {
-                read_sz = str_offset(src, num);
-                read_num = num;
-        }
+        for(i = from; i < to; i++) {
+                a = tbl->buffer + i * tbl->entry_size;
+                if(*(s16 *)a == -1)
+                        continue;
 
-        /* Second, we figure out what the offset should be */
-        off = off == PA_END ? str->length : off;
-        write_off = str_offset(str->buffer, off);
+                for(j = i + 1; j < to; j++) {
+                        b = tbl->buffer + j * tbl->entry_size;
+                        if(*(s16 *)b == -1 || *(u16 *)(a + PA_TBL_NEXT_SIZE) !=
+                                        *(u16 *)(b + PA_TBL_NEXT_SIZE))
+                                continue;
 
-        /* If the string is dynamic, scale the buffer to fit new characters */
-        str_ensure_fit(str, read_sz);
+                        if(pa_mem_compare(a + PA_TBL_HEAD_SIZE,
+                                                b + PA_TBL_HEAD_SIZE,
+                                                tbl->key_size)) {
+                                pa_mem_copy(a + val_off, b + val_off,
+                                                tbl->value_size);
+                                *(s16 *)b = -1;
+                        }
+                }
+        }
 
-        /* 
-         * Then we determine how much free memory is actually left in the
-         * string(also subtract 1 for the null-terminator).
-         */
-        free_size = str->alloc - str->size - 1;
+        /* Going backwards, so every entry links to the one behind it */
+        for(i = to - 1; i >= from; i--) {
+                a = tbl->buffer + i * tbl->entry_size;
+                if(*(s16 *)a == -1) {
+                        tbl_reset_slots(tbl, i, i + 1);
+                        continue;
+                }
 
-        /* Now we have to figure out how many characters can actually we written
-         * to the string buffer.
-         */
-        run = 0;
-        count = 0;
-        while(str_next(src, &run) && run <= free_size && run <= read_sz) {
-                write_sz = run;
-                count++;
+                *(s16 *)a = last < 0 ? -(bucket + 2) : last;
+                last = i;
+                number++;
         }
-        read_num = count;
 
-        /* 
-         * Determine the size of the trailing block which has to be moved and
-         * move it.
-         */
-        move_sz = str->size - write_off;
-        if(move_sz > 0) {
-                move_off = write_off + write_sz;
-                pa_mem_move(str->buffer + move_off, str->buffer + write_off,
-                                move_sz);
-        }
+        tbl->buckets[bucket] = last;
+        return number;
+}
 
-        /* Copy from source to the string buffer */
-        pa_mem_copy(str->buffer + write_off, src, write_sz);
+/*
+ * The header at the start of a file written by paSaveTable().
+ */
+#define TBL_FILE_MAGIC  0x4C425450      /* "PTBL" */
+
+struct tbl_file_head {
+        u32 magic;
+        s32 key_size;
+        s32 value_size;
+        s32 entry_size;
+        s16 number;
+        s16 alloc;
+        s16 free_head;
+        s16 bucket_count;
+};
 
-        /* Update string byte-size and set null-terminator */
-        str->size += write_sz;
-        str->length += read_num;
-        str->buffer[str->size] = 0;
+/*
+ * Get the number of bytes of the table-buffer and buckets in a file, which are
+ * laid out like in a fixed table.
+ */
+PA_INTERN s32 tbl_file_size(struct pa_table *tbl)
+{
+        s32 size = (tbl->alloc * tbl->entry_size + 1) & ~1;
 
-        /* Return number of written bytes */
-        return num;
+        return size + tbl->bucket_count * sizeof(s16);
 }
 
-PA_API s16 paCopyString(struct pa_string *str, char *dst, s16 off,
-                s16 num, s32 lim)
+/*
+ * Unmap the file of a mapped table.
+ */
+PA_INTERN void tbl_unmap(struct pa_table *tbl)
 {
-        s32 trail;
-        s32 copy_sz;
-        s32 copy_off;
-        s16 count;
+#ifdef PA_MMAP
+        u8 *map = tbl->buffer - sizeof(struct tbl_file_head);
 
-        if(off >= str->length) return 0;
+        munmap(map, sizeof(struct tbl_file_head) + tbl_file_size(tbl));
+#else
+        PA_IGNORE(tbl);
+#endif
+}
 
-        /* Resolve input parameters */
-        trail = str->length - off;
-        num = num == PA_ALL ? trail : num;
-        num = num > trail ? trail : num;
+PA_API s8 paInitTable(struct pa_table *tbl, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s16 alloc)
+{
+        s32 alloc_sz;
+        s16 i;
 
-        /* Calculate the size and offset for the characters in the string */
-        copy_off = str_offset(str->buffer, off);
-        copy_sz = str_offset(str->buffer + copy_off, num);
+        tbl->memory = mem;
+        tbl->mode = PA_DYNAMIC;
 
-        /* Reduce character count to keep in the limit */
-        count = 0;
-        while(copy_sz > lim) {
-                str_dec(str->buffer, &copy_sz);
-                count++;
+        tbl->key_size = key_sz;
+        tbl->value_size = value_sz;
+        tbl->entry_size = PA_TBL_HEAD_SIZE + key_sz + value_sz;
+        tbl->number = 0;
+        tbl->alloc = alloc;
+        tbl->bucket_count = tbl_bucket_num(alloc);
+
+        alloc_sz = tbl->entry_size * tbl->alloc;
+        if(!(tbl->buffer = pa_mem_alloc(tbl->memory, NULL, alloc_sz))) {
+                return -1;
         }
-        num -= count;
 
-        /* Copy over the characters and set null-terminator in output-buffer */
-        pa_mem_copy(dst, str->buffer + copy_off, copy_sz);
-        dst[copy_sz] = 0;
+        alloc_sz = tbl->bucket_count * sizeof(s16);
+        if(!(tbl->buckets = pa_mem_alloc(tbl->memory, NULL, alloc_sz))) {
+                goto err_free_buffer;
+        }
 
-        /* Return the number of copied characters */
-        return num;
+        /* Reset all memory slots in the buffer */
+        tbl->free_head = -1;
+        tbl_reset_slots(tbl, 0, tbl->alloc);
+        pa_mem_zero(&tbl->filter, sizeof(struct pa_bloom));
+        tbl->hits = 0;
+        tbl->misses = 0;
+        tbl->filter_checks = 0;
+        tbl->filter_rejects = 0;
+
+        /* Reset all buckets */
+        for(i = 0; i < tbl->bucket_count; i++) {
+                tbl->buckets[i] = -1;
+        }
+
+        return 0;
+
+err_free_buffer:
+        pa_mem_free(tbl->memory, tbl->buffer);
+        return -1;
 }
 
-PA_API s16 paReadString(struct pa_string *str, char *dst, s16 off,
-                s16 num, s32 lim)
+PA_API s8 paInitTableFixed(struct pa_table *tbl, void *buffer,
+                s32 buf_sz, s32 key_sz, s32 value_sz)
 {
-        s16 trail;
-        s32 read_off;
-        s32 read_sz;
-        s32 move_off;
-        s32 move_sz;
-        s16 count;
+        s32 num;
+        s16 i;
 
-        if(off >= str->length) return 0;
+        tbl->memory = NULL;
+        tbl->mode = PA_FIXED;
 
-        /* Resolve input parameters */
-        trail = str->length - off;
-        num = num == PA_ALL ? trail : num;
-        num = num > trail ? trail : num;
+        tbl->key_size = key_sz;
+        tbl->value_size = value_sz;
+        tbl->entry_size = PA_TBL_HEAD_SIZE + key_sz + value_sz;
+        tbl->number = 0;
+        tbl->buffer = buffer;
 
-        /* Calculate the size and offset for the characters in the string */
-        read_off = str_offset(str->buffer, off);
-        read_sz = str_offset(str->buffer + read_off, num);
+        /*
+         * The entries come first, followed by the buckets. Start with as many
+         * entries as fit into the buffer and reduce the number until the
+         * buckets fit as well.
+         */
+        num = buf_sz / tbl->entry_size;
+        if(num > 0x7FFF)
+                num = 0x7FFF;
 
-        /* Reduce character count to keep in the limit */
-        count = 0;
-        while(read_sz > lim) {
-                str_dec(str->buffer, &read_sz);
-                count++;
-        }
-        num -= count;
+        while(num > 0 && tbl_fixed_size(tbl, num) > buf_sz)
+                num--;
 
-        /* Copy over the characters and set null-terminator in output-buffer */
-        pa_mem_copy(dst, str->buffer + read_off, read_sz);
-        dst[read_sz] = 0;
+        if(num < 1)
+                return -1;
 
-        /* Calculate the size and new offset for the trailing block */
-        move_sz = str->size - read_off;
-        move_off = read_off + read_sz;
+        tbl->alloc = num;
+        tbl->bucket_count = tbl_bucket_num(num);
+        tbl->buckets = (s16 *)(tbl->buffer +
+                        ((num * tbl->entry_size + 1) & ~1));
 
-        /* Move the trailing block forward to fill the gap */
-        pa_mem_move(str->buffer + read_off, str->buffer + move_off,
-                        move_sz);
+        /* Reset all entry-slots in the buffer */
+        tbl->free_head = -1;
+        tbl_reset_slots(tbl, 0, tbl->alloc);
+        pa_mem_zero(&tbl->filter, sizeof(struct pa_bloom));
+        tbl->hits = 0;
+        tbl->misses = 0;
+        tbl->filter_checks = 0;
+        tbl->filter_rejects = 0;
 
-        /* Update string byte-size and set null-terminator */
-        str->size -= read_sz;
-        str->length -= num;
-        str->buffer[str->size] = 0;
+        /* Reset all buckets */
+        for(i = 0; i < tbl->bucket_count; i++) {
+                tbl->buckets[i] = -1;
+        }
 
-        /* Return the number of read bytes */
-        return num;
+        return 0;
 }
 
-PA_API s16 paGetStringCharacter(struct pa_string *str, s32 off)
+PA_API void paDestroyTable(struct pa_table *tbl)
 {
-        s16 charnum = 0;
-        s16 offs = 0;
-        char *s = str->buffer;
-
-        while(offs < off && s[offs]) {
-                (void)(PA_ISUTF(s[++offs]) || PA_ISUTF(s[++offs]) ||
-                                PA_ISUTF(s[++offs]) || ++offs);
-                charnum++;
+        if(tbl->mode == PA_DYNAMIC) {
+                pa_mem_free(tbl->memory, tbl->buffer);
+                pa_mem_free(tbl->memory, tbl->buckets);
+                pa_bloom_destroy(&tbl->filter, tbl->memory);
+        }
+        else if(tbl->mode == PA_MAPPED) {
+                tbl_unmap(tbl);
         }
 
-        return charnum;
+        tbl->memory = 0;
+        tbl->mode = PA_MEM_UDEF;
+
+        tbl->value_size = 0;
+        tbl->entry_size = 0;
+        tbl->number = 0;
+        tbl->alloc = 0;
+        tbl->buffer = 0;
+        tbl->bucket_count = 0;
+        tbl->buckets = 0;
 }
 
-PA_API s32 paGetStringOffset(struct pa_string *str, s16 cnum)
+PA_API u16 paHashTableKey(struct pa_table *tbl, void *key)
 {
-        s32 offs = 0;
-        char *s = str->buffer;
-
-        while(cnum > 0 && s[offs]) {
-                (void)(PA_ISUTF(s[++offs]) || PA_ISUTF(s[++offs]) ||
-                                PA_ISUTF(s[++offs]) || ++offs);
-                cnum--;
-        }
-
-        return offs;
+        return tbl_hash(key, tbl->key_size);
 }
 
-PA_API u32 paNextStringChar(struct pa_string *str, s32 *off)
+PA_API s8 paSetTable(struct pa_table *tbl, void *key, void *value)
 {
-        return str_next(str->buffer, off);
+        return paSetTableHashed(tbl, key, tbl_hash(key, tbl->key_size), value);
 }
 
-PA_API char *paIterateString(struct pa_string *str, char *chr)
+PA_API s8 paSetTableHashed(struct pa_table *tbl, void *key, u16 hash,
+                void *value)
 {
-        if(chr == NULL)
-                return str->buffer;
+        u8 *ptr;
 
-        if(*chr == 0)
-                return NULL;
+        if(tbl->mode == PA_MAPPED)
+                return -1;
 
-        return chr + str_sequence_size(chr);
-}
+        if(!(ptr = tbl_insert(tbl, key, hash)))
+                return -1;
 
-/*
- * -----------------------------------------------------------------------------
- *
- *      LIST
- *
- */
+        /* Copy over the content */
+        pa_mem_copy(ptr + PA_TBL_HEAD_SIZE + tbl->key_size, value,
+                        tbl->value_size);
+        return 0;
+}
 
-PA_INTERN void lst_ensure_fit(struct pa_list *lst, s32 num)
+PA_API s8 paBuildTable(struct pa_table *tbl, void *keys, void *values,
+                s16 num)
 {
-        s32 new_num = lst->count + num;
-        s32 new_alloc;
-        s32 new_size;
-        void *p;
+        u8 *key_ptr = keys;
+        u8 *val_ptr = values;
+        s16 count;
+        s16 start;
+        s16 end;
+        s16 mask;
+        s16 bucket;
+        s16 *buckets;
+        u16 hash;
+        u8 *ptr;
+        s16 i;
 
-        if(lst->mode != PA_DYNAMIC)
-                return;
+        if(num < 0 || tbl->mode == PA_MAPPED)
+                return -1;
 
-        if(new_num < lst->alloc)
-                return;
+        /* Size the table once for all entries */
+        if(tbl->mode == PA_DYNAMIC) {
+                if(num > tbl->alloc) {
+                        if(!(ptr = pa_mem_alloc(tbl->memory, tbl->buffer,
+                                                        num * tbl->entry_size)))
+                                return -1;
 
-        new_alloc = new_num * 1.5; 
-        new_size = new_alloc * lst->entry_size;
+                        tbl->buffer = ptr;
+                        tbl->alloc = num;
+                }
 
-        if(lst->limit > 0) {
-                new_size = PA_MIN(new_size, lst->limit);
+                if((count = tbl_bucket_num(num)) > tbl->bucket_count) {
+                        if(!(buckets = pa_mem_alloc(tbl->memory, tbl->buckets,
+                                                        count * sizeof(s16))))
+                                return -1;
 
-                if(new_size == lst->alloc_size)
-                        return;
+                        tbl->buckets = buckets;
+                        tbl->bucket_count = count;
+                }
+        }
+        else if(num > tbl->alloc) {
+                return -1;
         }
 
+        mask = tbl->bucket_count - 1;
 
-        if(!(p = pa_mem_alloc(lst->memory, lst->data, new_size)))
-                return;
+        /* Count the entries for every bucket */
+        for(i = 0; i < tbl->bucket_count; i++)
+                tbl->buckets[i] = 0;
 
-        lst->data = p;
-        lst->alloc = new_alloc;
-        lst->alloc_size = new_size;
-}
+        for(i = 0; i < num; i++)
+                tbl->buckets[tbl_hash(key_ptr + i * tbl->key_size,
+                                tbl->key_size) & mask]++;
 
-PA_LIB s8 paInitList(struct pa_list *lst, struct pa_memory *mem, 
-                s32 size, s16 alloc, s32 lim)
-{
-        lst->memory = mem;
-        lst->mode = PA_DYNAMIC;
-        lst->entry_size = size;
-        lst->count = 0;
-        lst->alloc = alloc;
-        lst->alloc_size = lst->alloc * lst->entry_size;
-        lst->limit = lim;
+        /* Turn the counts into the first slot of every bucket */
+        for(i = 0, start = 0; i < tbl->bucket_count; i++) {
+                count = tbl->buckets[i];
+                tbl->buckets[i] = start;
+                start += count;
+        }
 
-        if(!(lst->data = pa_mem_alloc(lst->memory, NULL, lst->alloc_size))) {
-                return -1;
+        /*
+         * Write the entries in the order they are given, using the buckets as
+         * cursors. Afterwards every bucket points behind its last entry, which
+         * is the first entry of the next bucket.
+         */
+        for(i = 0; i < num; i++) {
+                hash = tbl_hash(key_ptr, tbl->key_size);
+                bucket = hash & mask;
+
+                ptr = tbl->buffer + tbl->buckets[bucket]++ * tbl->entry_size;
+                *(s16 *)ptr = 0;
+                *(u16 *)(ptr + PA_TBL_NEXT_SIZE) = hash;
+                pa_mem_copy(ptr + PA_TBL_HEAD_SIZE, key_ptr, tbl->key_size);
+                pa_mem_copy(ptr + PA_TBL_HEAD_SIZE + tbl->key_size, val_ptr,
+                                tbl->value_size);
+
+                key_ptr += tbl->key_size;
+                val_ptr += tbl->value_size;
         }
 
-        paClearList(lst);
-        return 0;
-}
+        /* Link the entries and mark the remaining slots as free */
+        tbl->free_head = -1;
+        tbl_reset_slots(tbl, num, tbl->alloc);
 
-PA_LIB s8 paInitListFixed(struct pa_list *lst, s16 size, void *buf, s32 buf_sz)
-{
-        lst->memory = NULL;
-        lst->mode = PA_FIXED;
-        lst->entry_size = size;
-        lst->count = 0;
-        lst->alloc = buf_sz / size; /* Calculate the number of usable slots */
-        lst->alloc_size = buf_sz;
-        lst->data = buf;
-        lst->limit = PA_NOLIM;
+        tbl->number = 0;
+        for(i = 0, start = 0; i < tbl->bucket_count; i++) {
+                end = tbl->buckets[i];
+                tbl->number += tbl_link_bucket(tbl, i, start, end);
+                start = end;
+        }
+
+        if(tbl->filter.bits && tbl_build_filter(tbl, tbl->filter.rate) < 0)
+                pa_bloom_destroy(&tbl->filter, tbl->memory);
 
-        paClearList(lst);
         return 0;
 }
 
-PA_LIB void paDestroyList(struct pa_list *lst)
+PA_API s8 paGetTable(struct pa_table *tbl, void *key, void *out)
 {
-        if(lst->mode == PA_DYNAMIC) {
-                pa_mem_free(lst->memory, lst->data);
+        u32 hash;
+
+        if(!tbl->filter.bits)
+                return paGetTableHashed(tbl, key, tbl_hash(key, tbl->key_size),
+                                out);
+
+        hash = pa_hash(key, tbl->key_size);
+        tbl->filter_checks++;
+        if(!pa_bloom_test(&tbl->filter, hash)) {
+                tbl->filter_rejects++;
+                tbl->misses++;
+                return 0;
         }
+
+        return paGetTableHashed(tbl, key, hash & 0xFFFF, out);
 }
 
-PA_LIB void paClearList(struct pa_list *lst)
+PA_API s8 paGetTableHashed(struct pa_table *tbl, void *key, u16 hash,
+                void *out)
 {
-        pa_mem_set(lst->data, 0, lst->alloc * lst->entry_size);
+        u8 *ptr;
+        s16 off = PA_TBL_HEAD_SIZE + tbl->key_size;
 
-        lst->count = 0;
+        if(!(ptr = tbl_find_key(tbl, key, hash, NULL, NULL))) {
+                tbl->misses++;
+                return 0;
+        }
+
+        pa_mem_copy(out, ptr + off, tbl->value_size);
+        tbl->hits++;
+        return 1;
 }
 
-PA_LIB s16 paPushList(struct pa_list *lst, void *src, s16 num)
+PA_API s16 paGetTableBatch(struct pa_table *tbl, void *keys, s16 num,
+                void *out, s8 *found)
 {
-        s16 open_slots;
-        s16 entry_number;
-        s32 offset;
-        s32 size;
-
-        /* If configured as dynamic, scale to fit new entries */
-        lst_ensure_fit(lst, num);
+        u16 hashes[PA_TBL_BATCH];
+        s16 heads[PA_TBL_BATCH];
+        u8 *key_ptr = keys;
+        u8 *out_ptr = out;
+        s16 off = PA_TBL_HEAD_SIZE + tbl->key_size;
+        s16 mask = tbl->bucket_count - 1;
+        s16 number = 0;
+        s16 batch;
+        s16 i;
+        s16 j;
+        u8 *ptr;
 
-        /* Figure out how many entries can be written to the list */
-        open_slots = lst->alloc - lst->count;
-        entry_number = num > open_slots ? open_slots : num;
+        for(i = 0; i < num; i += batch) {
+                batch = num - i < PA_TBL_BATCH ? num - i : PA_TBL_BATCH;
 
-        /* Copy entries to list */
-        offset = lst->count * lst->entry_size;
-        size = entry_number * lst->entry_size;
-        pa_mem_copy(lst->data + offset, src, size);
+                /* Hash all keys and request the bucket-heads */
+                for(j = 0; j < batch; j++) {
+                        hashes[j] = tbl_hash(key_ptr + j * tbl->key_size,
+                                        tbl->key_size);
+                        PA_PREFETCH(&tbl->buckets[hashes[j] & mask]);
+                }
 
-        /* Update number of entries in list and return number of written */
-        lst->count += entry_number;
-        return entry_number;
-}
+                /* Request the first entry of every bucket */
+                for(j = 0; j < batch; j++) {
+                        heads[j] = tbl->buckets[hashes[j] & mask];
+                        if(heads[j] >= 0)
+                                PA_PREFETCH(tbl->buffer +
+                                                heads[j] * tbl->entry_size);
+                }
 
-PA_LIB s16 paPopList(struct pa_list *lst, void *dst, s16 num)
-{
-        s16 entry_number;
-        s32 size;
-        s32 offset;
+                /* Now walk the buckets, which should be in the cache */
+                for(j = 0; j < batch; j++) {
+                        ptr = NULL;
+                        if(heads[j] >= 0)
+                                ptr = tbl_find_key(tbl, key_ptr, hashes[j],
+                                                NULL, NULL);
+
+                        if(ptr) {
+                                pa_mem_copy(out_ptr, ptr + off,
+                                                tbl->value_size);
+                                number++;
+                        }
 
-        /* Figure out how many entries can be returned */
-        entry_number = num > lst->count ? lst->count : num;
+                        if(found)
+                                found[i + j] = ptr != NULL;
 
-        /* Copy entries from list */
-        size = entry_number * lst->entry_size;
-        offset = (lst->count * lst->entry_size) - size;
-        pa_mem_copy(dst, lst->data + offset, size);
+                        key_ptr += tbl->key_size;
+                        out_ptr += tbl->value_size;
+                }
+        }
 
-        /* Update the number of entries in the list and return */
-        lst->count -= entry_number;
-        return entry_number;
+        tbl->hits += number;
+        tbl->misses += num - number;
+        return number;
 }
 
-PA_LIB s16 paUnshiftList(struct pa_list *lst, void *src, s16 num)
+PA_API void paRemoveTable(struct pa_table *tbl, void *key)
 {
-        s16 open_slots;
-        s16 entry_number;
-        s32 size;
-        s32 move_sz;
+        s16 bucket;
+        u8 *ptr;
+        u8 *prev;
+        s16 next_idx;
 
-        /* If configured as dynamic, scale to fit new entries */
-        lst_ensure_fit(lst, num);
+        /* A mapped table is read-only */
+        if(tbl->mode == PA_MAPPED)
+                return;
 
-        /* Figure out how many entries can be written to the list */
-        open_slots = lst->alloc - lst->count;
-        entry_number = num > open_slots ? open_slots : num;
-        size = entry_number * lst->entry_size;
+        if((ptr = tbl_find_key(tbl, key, tbl_hash(key, tbl->key_size), &prev,
+                                        &bucket))) {
+                next_idx = *(s16 *)ptr;
 
-        /* Move all entries back to make space at the beginning */
-        move_sz = lst->count * lst->entry_size;
-        pa_mem_move(lst->data + size, lst->data, move_sz);
+                if(!prev && next_idx < 0) {
+                        tbl->buckets[bucket] = -1;
+                }
+                else if(!prev && next_idx >= 0) {
+                        tbl->buckets[bucket] = next_idx;
+                }
+                else if(prev) {
+                        *(s16 *)prev = *(s16 *)ptr;
+                }
 
-        /* Now copy over the data from the source */
-        pa_mem_copy(lst->data, src, size);
+                /* Push the slot onto the free-list */
+                *(s16 *)ptr = -1;
+                *(s16 *)(ptr + PA_TBL_NEXT_SIZE) = tbl->free_head;
+                tbl->free_head = (ptr - tbl->buffer) / tbl->entry_size;
+                tbl->number--;
 
-        /* Update the number of entries in the list and return */
-        lst->count += entry_number;
-        return entry_number;
+                /*
+                 * The bits of the key stay in the filter, so rebuild it once
+                 * too many are left. If that fails, just go without it.
+                 */
+                if(tbl->filter.bits && ++tbl->filter.stale >
+                                tbl->filter.capacity / 2) {
+                        if(tbl_build_filter(tbl, tbl->filter.rate) < 0)
+                                pa_bloom_destroy(&tbl->filter, tbl->memory);
+                }
+        }
 }
 
-PA_LIB s16 paShiftList(struct pa_list *lst, void *dst, s16 num)
+PA_API void paGetTableStats(struct pa_table *tbl, struct pa_hash_stats *stats)
 {
-        s16 entry_number;
-        s16 entry_left;
-        s32 size;
-        s32 offset;
-
-        /* Figure out how many entries can be returned */
-        entry_number = num > lst->count ? lst->count : num;
-
-        /* Copy entries from list */
-        size = entry_number * lst->entry_size;
-        pa_mem_copy(dst, lst->data, size);
-
-        /* Move the rest of the entries forward to close the gap */
-        entry_left = lst->count - entry_number;
-        if(entry_left > 0) {
-                offset = size;
-                size = entry_left * lst->entry_size;
-                pa_mem_move(lst->data, lst->data + offset, size);
-        }
+        hst_collect(stats, tbl->buffer, tbl->entry_size, tbl->buckets,
+                        tbl->bucket_count);
+
+        stats->slots = tbl->alloc;
+        stats->hits = tbl->hits;
+        stats->misses = tbl->misses;
+        stats->filter_checks = tbl->filter_checks;
+        stats->filter_rejects = tbl->filter_rejects;
+}
 
-        /* Update the number of entries in the list and return */
-        lst->count -= entry_number;
-        return entry_number;
+PA_API void paResetTableStats(struct pa_table *tbl)
+{
+        tbl->hits = 0;
+        tbl->misses = 0;
+        tbl->filter_checks = 0;
+        tbl->filter_rejects = 0;
 }
 
-PA_LIB s16 paInsertList(struct pa_list *lst, void *src, s16 start, s16 num)
+PA_API s8 paEnableTableFilter(struct pa_table *tbl, f32 rate)
 {
-        s16 open_slots;
-        s16 entry_number;
-        s32 offset;
-        s32 size;
-        s32 move_off;
-        s32 move_sz;
+        if(tbl->mode != PA_DYNAMIC)
+                return -1;
 
-        if(start == PA_END) {
-                start = lst->count;
+        if(rate <= 0) {
+                pa_bloom_destroy(&tbl->filter, tbl->memory);
+                return 0;
         }
 
-        /* If configured as dynamic, scale to fit new entries */
-        lst_ensure_fit(lst, num);
-
-        /* Figure out how many entries can be inserted into the list */
-        open_slots = lst->alloc - lst->count;
-        entry_number = num > open_slots ? open_slots : num;
-        size = entry_number * lst->entry_size;
-        offset = start * lst->entry_size;
-
-        /* Move entries back to make space */
-        move_sz = (lst->count - start) * lst->entry_size;
-        move_off = (lst->count * lst->entry_size) - move_sz;
-        pa_mem_move(lst->data + move_off, lst->data + offset, move_sz);
-
-        /* Copy over the entries from the source */
-        pa_mem_copy(lst->data + offset, src, size);
-
-        /* Update the number of entries in the list and return */
-        lst->count += entry_number;
-        return entry_number;
+        return tbl_build_filter(tbl, rate);
 }
 
-PA_LIB s16 paPeekList(struct pa_list *lst, void *dst, s16 start, s16 num)
+PA_API void *paIterateTable(struct pa_table *tbl, void *ptr, 
+                struct pa_table_entry *ent)
 {
-        s16 entry_number;
-        s16 entry_left;
-        s32 offset;
-        s32 size;
+        char *tmp;
+
+        /* Check if the table is empty */
+        if(tbl->number < 1)
+                return NULL;
+
+        /* Go to the next entry in the table */
+        if(!(ptr = tbl_next(tbl, ptr)))
+                return NULL;
 
-        /* Figure out how many entries can actually be returned */
-        entry_left = lst->count - start;
-        entry_number = num > entry_left ? entry_left : num;
+        /* Return the entry-data for the current entry */
+        if(ent) {
+                /* Copy over the key */
+                tmp = (char *)ptr + PA_TBL_NEXT_SIZE + PA_TBL_HASH_SIZE;
 
-        /* Copy over the entries */
-        offset = start * lst->entry_size;
-        size = entry_number * lst->entry_size;
-        pa_mem_copy(dst, lst->data + offset, size);
+                /* Set the pointer for the data */
+                ent->key = tmp;
+                ent->value = tmp + tbl->key_size;
+        }
 
-        /* Return the number of returned entries */
-        return entry_number;
+        return ptr;
 }
 
-PA_LIB s16 paGetList(struct pa_list *lst, void *dst, s16 start, s16 num)
+PA_API void *paIterateTableBucket(struct pa_table *tbl, s16 bucket,
+                void *ptr, struct pa_table_entry *ent)
 {
-        s16 entry_left;
-        s16 entry_number;
-        s32 offset;
-        s32 size;
-        s32 move_off;
-        s32 move_sz;
+        char *tmp;
 
-        /* Figure out how many entries can actually be returned */
-        entry_left = lst->count - start;
-        entry_number = num > entry_left ? entry_left : num;
+        /* Check if the table is empty */
+        if(tbl->number < 1)
+                return NULL;
 
-        /* Copy over the entries */
-        offset = start * lst->entry_size;
-        size = entry_number * lst->entry_size;
-        pa_mem_copy(dst, lst->data + offset, size);
+        if(!(ptr = tbl_next_bucket(tbl, bucket, ptr)))
+                return NULL;
 
-        /* Move back the entries to fill the gap */
-        move_off = offset + size;
-        move_sz = (lst->count - (start + entry_number)) * lst->entry_size;
-        pa_mem_move(lst->data + offset, lst->data + move_off, move_sz);
+        /* Return the data for the current entry */
+        if(ent) {
+                /* Copy over the key */
+                tmp = (char *)ptr + PA_TBL_NEXT_SIZE + PA_TBL_HASH_SIZE;
 
-        /* Update the number of entries in the list and return */
-        lst->count -= entry_number;
-        return entry_number;
+                /* Set the pointer for the data */
+                ent->key = tmp;
+                ent->value = tmp + tbl->key_size;
+        }
+
+        return ptr;
 }
 
-PA_API s16 paCopyList(struct pa_list *dst, struct pa_list *src,
-                s16 dst_off, s16 src_off, s16 num)
+PA_API s8 paSaveTable(struct pa_table *tbl, char *path)
 {
-        s16 read_num;
-        s16 write_num;
-        s32 read_off;
-        s32 write_free;
-        s32 write_off;
-        s32 size;
-        s16 overlap;
+        struct tbl_file_head head;
+        s32 size = tbl->alloc * tbl->entry_size;
+        FILE *fp;
+        u8 pad = 0;
+
+        head.magic = TBL_FILE_MAGIC;
+        head.key_size = tbl->key_size;
+        head.value_size = tbl->value_size;
+        head.entry_size = tbl->entry_size;
+        head.number = tbl->number;
+        head.alloc = tbl->alloc;
+        head.free_head = tbl->free_head;
+        head.bucket_count = tbl->bucket_count;
+
+        if(!(fp = fopen(path, "wb")))
+                return -1;
 
-        /* Validate input parameters */
-        if(src_off < 0 || src_off >= src->count) return -1;
-        if(dst_off < -1 || dst_off > dst->count) return -1;
-        if(src->entry_size != dst->entry_size) return -1;
+        if(fwrite(&head, sizeof(head), 1, fp) != 1)
+                goto err_close;
 
-        /* Resolve parameters */
-        dst_off = dst_off == PA_END ? dst->count : dst_off;
-        num = num == PA_ALL ? (src->count - src_off) : num;
+        if(size > 0 && fwrite(tbl->buffer, size, 1, fp) != 1)
+                goto err_close;
 
-        /* Figure out the potential overlap in the destination-list */
-        overlap = PA_OVERLAP(0, dst->count, dst_off, num);
+        /* Keep the buckets aligned */
+        if((size % 2) && fwrite(&pad, 1, 1, fp) != 1)
+                goto err_close;
 
-        /* Scale to fit new entries */
-        lst_ensure_fit(dst, num - overlap);
+        if(fwrite(tbl->buckets, sizeof(s16), tbl->bucket_count, fp) !=
+                        (size_t)tbl->bucket_count)
+                goto err_close;
 
-        /* Calculate how many entries can be actually be copied */
-        read_num = src->count - src_off;
-        write_free = (dst->alloc - dst->count) + overlap;
-        num = PA_MIN(num, PA_MIN(read_num, write_free));
+        if(fclose(fp) != 0)
+                return -1;
 
-        /* Copy over the entries to the source */
-        size = src->entry_size * num;
-        read_off = src_off * src->entry_size;
-        write_off = dst_off * src->entry_size;
-        pa_mem_copy(dst->data + write_off, src->data + read_off, size);
+        return 0;
 
-        /* Update the number of entries in the destionation-list and return */
-        dst->count += num - overlap;
-        return num;
+err_close:
+        fclose(fp);
+        return -1;
 }
 
-PA_API void *paIterateList(struct pa_list *lst, void *ptr)
+/*
+ * Check that every index stored in a mapped table stays inside of it, so a
+ * damaged file can't send lookups or iterations outside the mapping. Entries
+ * in use link to the next entry or end with -(bucket + 2), open slots are
+ * marked with -1 and link to the next open slot.
+ *
+ * Afterwards every bucket-chain is walked, to make sure it ends with its own
+ * bucket and doesn't loop. Together all chains have to reach exactly the
+ * number of entries in the table.
+ *
+ * Returns: 0 if all indices are valid or -1 if not
+ */
+PA_INTERN s8 tbl_check_links(struct pa_table *tbl)
 {
-        /* First step, set pointer to beginning of data buffer */
-        if(ptr == NULL) {
-                return lst->data;
+        s16 next_idx;
+        s32 reached = 0;
+        u8 *ptr;
+        s16 i;
+
+        if(tbl->number < 0 || tbl->number > tbl->alloc)
+                return -1;
+
+        if(tbl->free_head < -1 || tbl->free_head >= tbl->alloc)
+                return -1;
+
+        for(i = 0; i < tbl->bucket_count; i++) {
+                if(tbl->buckets[i] < -1 || tbl->buckets[i] >= tbl->alloc)
+                        return -1;
         }
 
-        /* Increment the pointer */
-        ptr = (void *)((u8 *)ptr + lst->entry_size);
+        for(i = 0; i < tbl->alloc; i++) {
+                ptr = tbl->buffer + i * tbl->entry_size;
+                next_idx = *(s16 *)ptr;
 
-        /* Check if the pointer has reached the end of the line */
-        if((u8 *)ptr >= lst->data + (lst->count * lst->entry_size)) {
-                return NULL;
+                if(next_idx == -1)
+                        next_idx = *(s16 *)(ptr + PA_TBL_NEXT_SIZE);
+                else if(next_idx < 0 && -(next_idx + 2) < tbl->bucket_count)
+                        continue;
+
+                if(next_idx < -1 || next_idx >= tbl->alloc)
+                        return -1;
         }
 
-        return ptr;
-}
+        for(i = 0; i < tbl->bucket_count; i++) {
+                next_idx = tbl->buckets[i];
 
-PA_API void paApplyList(struct pa_list *lst, pa_list_func fnc, void *pass)
-{
-        s32 i;
-        struct pa_handle hdl;
+                while(next_idx >= 0) {
+                        /* More entries than stored means the chain loops */
+                        if(++reached > tbl->number)
+                                return -1;
 
+                        ptr = tbl->buffer + next_idx * tbl->entry_size;
+                        next_idx = *(s16 *)ptr;
+                }
 
-        for(i = 0; i < lst->count; i++) {
-                hdl.pointer = lst->data + (i * lst->entry_size);
-                hdl.index = i;
-                if(fnc(&hdl, pass)) return;
+                /* A chain has to end with its own bucket, not an open slot */
+                if(tbl->buckets[i] >= 0 && next_idx != -(i + 2))
+                        return -1;
         }
+
+        return reached == tbl->number ? 0 : -1;
 }
 
-PA_API void paApplyListBack(struct pa_list *lst, pa_list_func fnc, void *pass)
+PA_API s8 paMapTable(struct pa_table *tbl, char *path)
 {
-        s32 i;
-        struct pa_handle hdl;
-
+#ifdef PA_MMAP
+        struct tbl_file_head *head;
+        struct stat st;
+        s32 entry_size;
+        u8 *map;
+        int fd;
+
+        if((fd = open(path, O_RDONLY)) < 0)
+                return -1;
 
-        for(i = lst->count - 1; i >= 0; i--) {
-                hdl.pointer = lst->data + (i * lst->entry_size);
-                hdl.index = i;
-                if(fnc(&hdl, pass)) return;
+        if(fstat(fd, &st) < 0 ||
+                        st.st_size < (off_t)sizeof(struct tbl_file_head)) {
+                close(fd);
+                return -1;
         }
+
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if(map == MAP_FAILED)
+                return -1;
+
+        /* Make sure the file is intact before using it */
+        head = (struct tbl_file_head *)map;
+        if(head->key_size < 1 || head->value_size < 0 ||
+                        head->key_size > st.st_size ||
+                        head->value_size > st.st_size)
+                goto err_unmap;
+
+        entry_size = PA_TBL_HEAD_SIZE + head->key_size + head->value_size;
+        if(head->magic != TBL_FILE_MAGIC || head->entry_size != entry_size ||
+                        head->alloc < 1 || head->bucket_count < 1 ||
+                        (head->bucket_count & (head->bucket_count - 1)))
+                goto err_unmap;
+
+        /* Keep alloc * entry_size from overflowing */
+        if((off_t)head->alloc * entry_size > st.st_size)
+                goto err_unmap;
+
+        tbl->memory = NULL;
+        tbl->mode = PA_MAPPED;
+
+        tbl->key_size = head->key_size;
+        tbl->value_size = head->value_size;
+        tbl->entry_size = head->entry_size;
+        tbl->number = head->number;
+        tbl->alloc = head->alloc;
+        tbl->free_head = head->free_head;
+        tbl->bucket_count = head->bucket_count;
+        pa_mem_zero(&tbl->filter, sizeof(struct pa_bloom));
+        tbl->hits = 0;
+        tbl->misses = 0;
+        tbl->filter_checks = 0;
+        tbl->filter_rejects = 0;
+
+        if(st.st_size != (off_t)(sizeof(*head) + tbl_file_size(tbl)))
+                goto err_unmap;
+
+        tbl->buffer = map + sizeof(*head);
+        tbl->buckets = (s16 *)(tbl->buffer +
+                        ((tbl->alloc * tbl->entry_size + 1) & ~1));
+
+        if(tbl_check_links(tbl) < 0)
+                goto err_unmap;
+
+        return 0;
+
+err_unmap:
+        munmap(map, st.st_size);
+        tbl->mode = PA_MEM_UDEF;
+        return -1;
+#else
+        PA_IGNORE(tbl);
+        PA_IGNORE(path);
+        return -1;
+#endif
 }
 
 /*
  * -----------------------------------------------------------------------------
  *
- *      DICTIONARY
+ *      FLAT-TABLE
  *
  */
 
-/* Source: https://stackoverflow.com/a/21001712 */
-PA_INTERN u16 dct_hash(char *key)
+PA_INTERN u8 *ftb_slot(struct pa_flat_table *tbl, s32 idx)
 {
-        u32 byte;
-        u32 crc;
-        u32 mask;
-        s32 i = 0;
-        s32 j;
+        return tbl->slots + idx * tbl->entry_size;
+}
 
-        crc = 0xFFFFFFFF;
-        while(key[i] != 0) {
-                byte = key[i];
-                crc = crc ^ byte;
-                for (j = 7; j >= 0; j--) {
-                        mask = -(crc & 1);
-                        crc = (crc >> 1) ^ (0xEDB88320 & mask);
-                }
-                i++;
-        }
-        return (~crc) % 0xFFFF;
+/*
+ * Get the number of slots that can be used before the table has to be
+ * rebuilt.
+ */
+PA_INTERN s32 ftb_max_load(s32 alloc)
+{
+        return alloc - alloc / 8;
 }
 
-PA_INTERN s16 dct_find_open(struct pa_dictionary *dct)
+/*
+ * Get the number of bytes needed for the given number of slots, including
+ * the padding to align the control-bytes. As the number of slots is a
+ * multiple of PA_FLAT_GROUP, this also aligns the slots.
+ */
+PA_INTERN s32 ftb_buffer_size(struct pa_flat_table *tbl, s32 alloc)
 {
-        s16 i;
+        return PA_FLAT_GROUP + alloc + alloc * tbl->entry_size;
+}
 
-        for(i = 0; i < dct->alloc; i++) {
-                if(*(s16 *)(dct->buffer + i * dct->entry_size) == -1)
-                        return i;
-        }
+/*
+ * Set the pointers for the given buffer and number of slots and mark all
+ * slots as empty.
+ */
+PA_INTERN void ftb_layout(struct pa_flat_table *tbl, u8 *buf, s32 alloc)
+{
+        buf += (PA_FLAT_GROUP - ((unsigned long)buf % PA_FLAT_GROUP)) %
+                PA_FLAT_GROUP;
 
-        return -1;
+        tbl->control = buf;
+        tbl->slots = buf + alloc;
+        tbl->alloc = alloc;
+        tbl->number = 0;
+        tbl->growth_left = ftb_max_load(alloc);
+
+        pa_mem_set(tbl->control, PA_FLAT_EMPTY, alloc);
 }
 
-PA_INTERN u8 *dct_next_bucket(struct pa_dictionary *dct, s16 bucket, u8 *ptr)
+/*
+ * Get a bitmask with a bit set for every slot in the group, which has the
+ * given control-byte.
+ */
+PA_INTERN u32 ftb_match(u8 *ctrl, u8 value)
 {
-        s16 next_idx = -1;
-
-        if(dct->buckets[bucket] < 0)
-                return NULL;
+#ifdef PA_SSE2
+        __m128i v = _mm_load_si128((__m128i *)ctrl);
 
-        /*
-         * On the first call ptr will be NULL, so we have to find the first
-         * entry in the dictionary.
-         */
-        if(!ptr) {
-                return dct->buffer + (dct->buckets[bucket] * dct->entry_size);
-        }
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(value)));
+#else
+        u32 mask = 0;
+        s8 i;
 
-        /*
-         * Otherwise we have to get a pointer to the next entry.
-         */
-        if((next_idx = *(s16 *)ptr) < 0) {
-                return NULL;
+        for(i = 0; i < PA_FLAT_GROUP; i++) {
+                if(ctrl[i] == value)
+                        mask |= 1 << i;
         }
 
-        /* Return a pointer to the entry */
-        return dct->buffer + (next_idx * dct->entry_size);
+        return mask;
+#endif
+}
 
+/*
+ * Get a bitmask with a bit set for every empty or deleted slot in the group.
+ * Both have the highest bit set, while used slots never do.
+ */
+PA_INTERN u32 ftb_match_free(u8 *ctrl)
+{
+#ifdef PA_SSE2
+        return _mm_movemask_epi8(_mm_load_si128((__m128i *)ctrl));
+#else
+        u32 mask = 0;
+        s8 i;
+
+        for(i = 0; i < PA_FLAT_GROUP; i++) {
+                if(ctrl[i] & 0x80)
+                        mask |= 1 << i;
+        }
 
+        return mask;
+#endif
 }
 
-PA_INTERN u8 *dct_next(struct pa_dictionary *dct, u8 *ptr)
+/*
+ * Search for the slot containing the key. The groups are visited in a
+ * triangular sequence, which reaches every group once as the number of groups
+ * is a power of two.
+ */
+PA_INTERN s32 ftb_find(struct pa_flat_table *tbl, u8 *key, u32 hash)
 {
-        s16 idx = -1;
-        s16 next_idx = -1;
-        s16 bucket_num;
+        s32 groups = tbl->alloc / PA_FLAT_GROUP;
+        s32 group = (hash >> 7) & (groups - 1);
+        u8 *ctrl;
+        u32 mask;
+        s32 idx;
+        s32 i;
 
-        /*
-         * On the first call ptr will be NULL, so we have to find the first
-         * entry in the dictionary.
-         */
-        if(!ptr) {
-                bucket_num = 0;
-                while(bucket_num < PA_DICT_BUCKETS) {
-                        if(dct->buckets[bucket_num] >= 0) {
-                                idx = dct->buckets[bucket_num];
-                                ptr = dct->buffer + (idx * dct->entry_size);
-                                break;
-                        }
-                        bucket_num++;
+        for(i = 1; i <= groups; i++) {
+                ctrl = tbl->control + group * PA_FLAT_GROUP;
+
+                mask = ftb_match(ctrl, hash & 0x7F);
+                while(mask) {
+                        idx = group * PA_FLAT_GROUP + pa_bit_ctz(mask);
+                        if(pa_mem_compare(key, ftb_slot(tbl, idx),
+                                                tbl->key_size))
+                                return idx;
+
+                        mask &= mask - 1;
                 }
 
-                return ptr;
+                /* An empty slot ends the probe-sequence */
+                if(ftb_match(ctrl, PA_FLAT_EMPTY))
+                        return -1;
+
+                group = (group + i) & (groups - 1);
         }
 
-        /*
-         * Otherwise we have to get a pointer to the next entry.
-         */
-        next_idx = *(s16 *)ptr;
-        if(next_idx <= -2) {
-                bucket_num = (-1 * next_idx) - 2 + 1;
-                while(bucket_num < PA_DICT_BUCKETS) {
-                        if(dct->buckets[bucket_num] >= 0) {
-                                next_idx = dct->buckets[bucket_num];
-                                break;
-                        }
-                        bucket_num++;
-                }
+        return -1;
+}
 
-                /* No more entries left in the dictionary */
-                if(next_idx <= -2)
-                        return NULL;
+/*
+ * Get the first empty or deleted slot in the probe-sequence for the hash.
+ */
+PA_INTERN s32 ftb_find_free(struct pa_flat_table *tbl, u32 hash)
+{
+        s32 groups = tbl->alloc / PA_FLAT_GROUP;
+        s32 group = (hash >> 7) & (groups - 1);
+        u32 mask;
+        s32 i;
+
+        for(i = 1; i <= groups; i++) {
+                if((mask = ftb_match_free(tbl->control +
+                                                group * PA_FLAT_GROUP)))
+                        return group * PA_FLAT_GROUP + pa_bit_ctz(mask);
+
+                group = (group + i) & (groups - 1);
         }
 
-        /* Return a pointer to the entry */
-        return dct->buffer + (next_idx * dct->entry_size);
+        return -1;
 }
 
-PA_INTERN u8 *dct_find_key(struct pa_dictionary *dct, char *key, u8 **prev,
-                s16 *bucket_out)
+PA_INTERN void ftb_swap(struct pa_flat_table *tbl, s32 a, s32 b)
 {
-        u16 hash = dct_hash(key);
-        s16 bucket = hash % PA_DICT_BUCKETS;
-        u8 *ptr = NULL;
-        s16 off = PA_DICT_NEXT_SIZE + PA_DICT_HASH_SIZE;
-
-        if(dct->buckets[bucket] < 0)
-                return NULL;
-
-        if(bucket_out) *bucket_out = bucket;
+        u8 *pa = ftb_slot(tbl, a);
+        u8 *pb = ftb_slot(tbl, b);
+        u8 tmp;
+        s32 i;
 
-        if(prev) *prev = NULL;
-        while((ptr = dct_next_bucket(dct, bucket, ptr))) {
-                /* Compare the hashes */
-                if(hash == *(u16 *)(ptr + PA_DICT_NEXT_SIZE)) {
-                        if(pa_strcmp(key, (char *)(ptr + off)) == 0) {
-                                return ptr;
-                        }
-                }
-                if(prev) *prev = ptr;
+        for(i = 0; i < tbl->entry_size; i++) {
+                tmp = pa[i];
+                pa[i] = pb[i];
+                pb[i] = tmp;
         }
-
-        return NULL;
 }
 
-PA_API s8 paInitDictionary(struct pa_dictionary *dct, struct pa_memory *mem,
-                s32 size, s16 alloc)
+/*
+ * Reclaim the slots of removed entries without allocating new memory. First
+ * all used slots are marked as deleted and all deleted slots as empty. Then
+ * every slot marked as deleted is moved to the first free slot in its
+ * probe-sequence. If that slot still has to be moved itself, both slots are
+ * swapped and the current slot is processed again.
+ */
+PA_INTERN void ftb_rehash_in_place(struct pa_flat_table *tbl)
 {
-        s32 alloc_sz;
-        s16 i;
+        u8 *ctrl = tbl->control;
+        s32 target;
+        u32 hash;
+        s32 i;
 
-        dct->memory = mem;
-        dct->mode = PA_DYNAMIC;
+        for(i = 0; i < tbl->alloc; i++)
+                ctrl[i] = (ctrl[i] & 0x80) ? PA_FLAT_EMPTY : PA_FLAT_DELETED;
 
-        dct->value_size = size;
-        dct->entry_size = PA_DICT_HEAD_SIZE + size;
-        dct->number = 0;
-        dct->alloc = alloc;
+        for(i = 0; i < tbl->alloc; i++) {
+                if(ctrl[i] != PA_FLAT_DELETED)
+                        continue;
 
-        alloc_sz = dct->entry_size * dct->alloc;
-        if(!(dct->buffer = pa_mem_alloc(dct->memory, NULL, alloc_sz))) {
-                return -1;
-        }
+                hash = pa_hash(ftb_slot(tbl, i), tbl->key_size);
+                target = ftb_find_free(tbl, hash);
 
-        /* Reset all memory slots in the buffer */
-        for(i = 0; i < dct->alloc; i++) {
-                *(s16 *)(dct->buffer + i * dct->entry_size) = -1;
-        }
+                /* The slot is already in the right group */
+                if(target / PA_FLAT_GROUP == i / PA_FLAT_GROUP) {
+                        ctrl[i] = hash & 0x7F;
+                        continue;
+                }
 
-        /* Reset all buckets */
-        for(i = 0; i < PA_DICT_BUCKETS; i++) {
-                dct->buckets[i] = -1;
+                if(ctrl[target] == PA_FLAT_EMPTY) {
+                        pa_mem_copy(ftb_slot(tbl, target), ftb_slot(tbl, i),
+                                        tbl->entry_size);
+                        ctrl[target] = hash & 0x7F;
+                        ctrl[i] = PA_FLAT_EMPTY;
+                }
+                else {
+                        ftb_swap(tbl, i, target);
+                        ctrl[target] = hash & 0x7F;
+                        i--;
+                }
         }
 
-        return 0;
+        tbl->growth_left = ftb_max_load(tbl->alloc) - tbl->number;
 }
 
-PA_API s8 paInitDictionaryFixed(struct pa_dictionary *dct, void *buffer,
-                s32 buf_sz, s32 value_sz)
+/*
+ * Move all entries into a new buffer with the given number of slots.
+ */
+PA_INTERN s8 ftb_resize(struct pa_flat_table *tbl, s32 alloc)
 {
-        s16 i;
+        u8 *old_buffer = tbl->buffer;
+        u8 *old_control = tbl->control;
+        u8 *old_slots = tbl->slots;
+        s32 old_alloc = tbl->alloc;
+        s32 number = tbl->number;
+        u8 *src;
+        u32 hash;
+        s32 idx;
+        s32 i;
+        u8 *p;
 
-        dct->memory = NULL;
-        dct->mode = PA_FIXED;
+        if(!(p = pa_mem_alloc(tbl->memory, NULL, ftb_buffer_size(tbl, alloc))))
+                return -1;
 
-        dct->value_size = value_sz;
-        dct->entry_size = PA_DICT_HEAD_SIZE + value_sz;
-        dct->number = 0;
-        dct->buffer = buffer;
+        tbl->buffer = p;
+        ftb_layout(tbl, p, alloc);
 
-        dct->alloc = buf_sz / dct->entry_size;
+        for(i = 0; i < old_alloc; i++) {
+                if(old_control[i] & 0x80)
+                        continue;
 
-        /* Reset all entry-slots in the buffer */
-        for(i = 0; i < dct->alloc; i++) {
-                *(s16 *)(dct->buffer + i * dct->entry_size) = -1;
-        }
+                src = old_slots + i * tbl->entry_size;
+                hash = pa_hash(src, tbl->key_size);
+                idx = ftb_find_free(tbl, hash);
 
-        /* Reset all buckets */
-        for(i = 0; i < PA_DICT_BUCKETS; i++) {
-                dct->buckets[i] = -1;
+                tbl->control[idx] = hash & 0x7F;
+                pa_mem_copy(ftb_slot(tbl, idx), src, tbl->entry_size);
         }
 
+        tbl->number = number;
+        tbl->growth_left -= number;
+
+        pa_mem_free(tbl->memory, old_buffer);
         return 0;
 }
 
-PA_API void paDestroyDictionary(struct pa_dictionary *dct)
+/*
+ * Make room for a new entry once all usable slots are taken. If most of the
+ * taken slots belong to removed entries, reclaim them. Otherwise double the
+ * number of slots, which is only possible if configured as dynamic.
+ */
+PA_INTERN s8 ftb_rebuild(struct pa_flat_table *tbl)
 {
-        if(dct->mode == PA_DYNAMIC) {
-                pa_mem_free(dct->memory, dct->buffer);
-        }
+        s32 max = ftb_max_load(tbl->alloc);
 
-        dct->memory = 0;
-        dct->mode = PA_MEM_UDEF;
+        if(tbl->mode == PA_DYNAMIC && tbl->number > max / 2)
+                return ftb_resize(tbl, tbl->alloc * 2);
 
-        dct->value_size = 0;
-        dct->entry_size = 0;
-        dct->number = 0;
-        dct->alloc = 0;
-        dct->buffer = 0;
+        if(tbl->number >= max)
+                return -1;
+
+        ftb_rehash_in_place(tbl);
+        return 0;
 }
 
-PA_API s8 paSetDictionary(struct pa_dictionary *dct, char *key, void *value)
+PA_API s8 paInitFlatTable(struct pa_flat_table *tbl, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s32 alloc)
 {
-        s16 slot;
-        u16 hash;
-        s16 bucket;
-        u8 *ptr;
-        s32 tmp;
-        s16 next_idx;
-
+        s32 slots = PA_FLAT_GROUP;
 
-        /* Validate the input parameters */
-        if(pa_strlen(key) > 32)
+        if(key_sz < 1 || value_sz < 0)
                 return -1;
 
-        /*
-         * If there is already an entry with the keyword in the dictionary, we
-         * can just overwrite it's value and return.
-         */
-        if((ptr = dct_find_key(dct, key, NULL, NULL))) {
-                /* Copy over the content */
-                pa_mem_copy(ptr + PA_DICT_HEAD_SIZE, value, dct->value_size);
-                return 0;
+        tbl->memory = mem;
+        tbl->mode = PA_DYNAMIC;
 
-        }
+        tbl->key_size = key_sz;
+        tbl->value_size = value_sz;
+        tbl->entry_size = key_sz + value_sz;
 
-        /* Get an open slot in the dictionary-buffer */
-        if((slot = dct_find_open(dct)) < 0)
+        while(ftb_max_load(slots) < alloc)
+                slots *= 2;
+
+        if(!(tbl->buffer = pa_mem_alloc(mem, NULL,
+                                        ftb_buffer_size(tbl, slots))))
                 return -1;
 
-        /* Hash the key and determine the bucket  */
-        hash = dct_hash(key); 
-        bucket = hash % PA_DICT_BUCKETS;
+        ftb_layout(tbl, tbl->buffer, slots);
+        return 0;
+}
 
-        /* 
-         * Write the copy over the data to the dictionary-buffer.
-         */
+PA_API s8 paInitFlatTableFixed(struct pa_flat_table *tbl, void *buffer,
+                s32 buf_sz, s32 key_sz, s32 value_sz)
+{
+        s32 slots = PA_FLAT_GROUP;
 
-        /* Set the next index */
-        ptr = dct->buffer + (slot * dct->entry_size);
-        *(s16 *)ptr = -(bucket + 2);
-        ptr += PA_DICT_NEXT_SIZE;
+        if(key_sz < 1 || value_sz < 0)
+                return -1;
 
-        /* Copy the hash */
-        *(u16 *)ptr = hash;
-        ptr += PA_DICT_HASH_SIZE;
+        tbl->memory = NULL;
+        tbl->mode = PA_FIXED;
 
-        /* Copy over the keyword */
-        pa_strcpy((char *)ptr, key);
-        ptr += PA_DICT_KEY_SIZE;
+        tbl->key_size = key_sz;
+        tbl->value_size = value_sz;
+        tbl->entry_size = key_sz + value_sz;
 
-        /* Copy over the content */
-        pa_mem_copy(ptr, value, dct->value_size);
+        if(ftb_buffer_size(tbl, slots) > buf_sz)
+                return -1;
 
-        /*
-         * Attach the entry to the bucket.
-         */
-        if(dct->buckets[bucket] < 0) {
-                dct->buckets[bucket] = slot;
-        }
-        else {
-                tmp = dct->buckets[bucket] * dct->entry_size;
-                ptr = dct->buffer + tmp;
-                while((next_idx = *(s16 *)ptr) >= 0) {
-                        ptr = dct->buffer + next_idx * dct->entry_size;
-                }
-                *(s16 *)ptr = slot;
-        }
+        while(ftb_buffer_size(tbl, slots * 2) <= buf_sz)
+                slots *= 2;
 
-        dct->number++;
+        tbl->buffer = buffer;
+        ftb_layout(tbl, tbl->buffer, slots);
         return 0;
 }
 
-PA_API s8 paGetDictionary(struct pa_dictionary *dct, char *key, void *out)
+PA_API void paDestroyFlatTable(struct pa_flat_table *tbl)
 {
-        u8 *ptr;
+        if(tbl->mode == PA_DYNAMIC) {
+                pa_mem_free(tbl->memory, tbl->buffer);
+        }
 
-        if(!(ptr = dct_find_key(dct, key, NULL, NULL)))
-                return 0;
+        tbl->memory = NULL;
+        tbl->mode = PA_MEM_UDEF;
 
-        pa_mem_copy(out, ptr + PA_DICT_HEAD_SIZE, dct->entry_size);
-        return 1;
+        tbl->number = 0;
+        tbl->alloc = 0;
+        tbl->growth_left = 0;
+        tbl->buffer = NULL;
+        tbl->control = NULL;
+        tbl->slots = NULL;
 }
 
-PA_API void paRemoveDictionary(struct pa_dictionary *dct, char *key)
+PA_API void paClearFlatTable(struct pa_flat_table *tbl)
 {
-        s16 bucket;
+        pa_mem_set(tbl->control, PA_FLAT_EMPTY, tbl->alloc);
+
+        tbl->number = 0;
+        tbl->growth_left = ftb_max_load(tbl->alloc);
+}
+
+PA_API s8 paSetFlatTable(struct pa_flat_table *tbl, void *key, void *value)
+{
+        u32 hash = pa_hash(key, tbl->key_size);
+        s32 idx;
         u8 *ptr;
-        u8 *prev;
-        s16 next_idx;
 
-        if((ptr = dct_find_key(dct, key, &prev, &bucket))) {
-                next_idx = *(s16 *)ptr;
+        /*
+         * If there is already an entry with the key in the table, we can just
+         * overwrite it's value and return.
+         */
+        if((idx = ftb_find(tbl, key, hash)) >= 0) {
+                ptr = ftb_slot(tbl, idx) + tbl->key_size;
+                pa_mem_copy(ptr, value, tbl->value_size);
+                return 0;
+        }
 
-                if(!prev && next_idx < 0) {
-                        dct->buckets[bucket] = -1;
-                }
-                else if(!prev && next_idx >= 0) {
-                        dct->buckets[bucket] = next_idx;
-                }
-                else if(prev) {
-                        *(s16 *)prev = *(s16 *)ptr;
-                }
+        /* Reusing the slot of a removed entry is always possible */
+        idx = ftb_find_free(tbl, hash);
+        if(tbl->growth_left < 1 && tbl->control[idx] != PA_FLAT_DELETED) {
+                if(ftb_rebuild(tbl) < 0)
+                        return -1;
 
-                *(s16 *)ptr = -1;
-                dct->number--;
+                idx = ftb_find_free(tbl, hash);
         }
+
+        if(tbl->control[idx] == PA_FLAT_EMPTY)
+                tbl->growth_left--;
+
+        tbl->control[idx] = hash & 0x7F;
+        tbl->number++;
+
+        /* Copy over the key and value */
+        ptr = ftb_slot(tbl, idx);
+        pa_mem_copy(ptr, key, tbl->key_size);
+        pa_mem_copy(ptr + tbl->key_size, value, tbl->value_size);
+        return 0;
 }
 
-PA_API void *paIterateDictionary(struct pa_dictionary *dct, void *ptr, 
-                struct pa_dictionary_entry *ent)
+PA_API s8 paGetFlatTable(struct pa_flat_table *tbl, void *key, void *out)
 {
-        char *tmp;
+        s32 idx;
 
-        /* Check if the dictionary is empty */
-        if(dct->number < 1)
-                return NULL;
+        if((idx = ftb_find(tbl, key, pa_hash(key, tbl->key_size))) < 0)
+                return 0;
 
-        /* Go to the next entry in the dictionary */
-        if(!(ptr = dct_next(dct, ptr)))
-                return NULL;
+        pa_mem_copy(out, ftb_slot(tbl, idx) + tbl->key_size, tbl->value_size);
+        return 1;
+}
 
-        /* Return the entry-data for the current entry */
-        if(ent) {
-                /* Copy over the key */
-                tmp = (char *)ptr + PA_DICT_NEXT_SIZE + PA_DICT_HASH_SIZE;
-                pa_strcpy(ent->key, tmp);
+PA_API void paRemoveFlatTable(struct pa_flat_table *tbl, void *key)
+{
+        s32 group;
+        s32 idx;
 
-                /* Set the pointer for the data */
-                ent->value = tmp + PA_DICT_KEY_SIZE;
+        if((idx = ftb_find(tbl, key, pa_hash(key, tbl->key_size))) < 0)
+                return;
+
+        /*
+         * If the group still has an empty slot, no probe-sequence continues
+         * past this group, so the slot can be marked as empty again. Otherwise
+         * it has to be marked as deleted to keep later entries reachable.
+         */
+        group = idx - idx % PA_FLAT_GROUP;
+        if(ftb_match(tbl->control + group, PA_FLAT_EMPTY)) {
+                tbl->control[idx] = PA_FLAT_EMPTY;
+                tbl->growth_left++;
+        }
+        else {
+                tbl->control[idx] = PA_FLAT_DELETED;
         }
 
-        return ptr;
+        tbl->number--;
 }
 
-PA_API void *paIterateDictionaryBucket(struct pa_dictionary *dct, s16 bucket,
-                void *ptr, struct pa_dictionary_entry *ent)
+PA_API void *paIterateFlatTable(struct pa_flat_table *tbl, void *ptr,
+                struct pa_table_entry *ent)
 {
-        char *tmp;
+        s32 idx = 0;
+        s32 group;
+        u32 mask;
 
-        /* Check if the dictionary is empty */
-        if(dct->number < 1)
+        /* Check if the table is empty */
+        if(tbl->number < 1)
                 return NULL;
 
-        if(!(ptr = dct_next_bucket(dct, bucket, ptr)))
-                return NULL;
+        if(ptr)
+                idx = ((u8 *)ptr - tbl->slots) / tbl->entry_size + 1;
 
-        /* Return the data for the current entry */
-        if(ent) {
-                /* Copy over the key */
-                tmp = (char *)ptr + PA_DICT_NEXT_SIZE + PA_DICT_HASH_SIZE;
-                pa_strcpy(ent->key, tmp);
+        /* Skip whole groups of free slots at once */
+        while(idx < tbl->alloc) {
+                group = idx - idx % PA_FLAT_GROUP;
+                mask = ~ftb_match_free(tbl->control + group) & 0xFFFF;
+                mask >>= idx - group;
 
-                /* Set the pointer for the data */
-                ent->value = tmp + PA_DICT_KEY_SIZE;
+                if(mask) {
+                        idx += pa_bit_ctz(mask);
+                        ptr = ftb_slot(tbl, idx);
+
+                        if(ent) {
+                                ent->key = ptr;
+                                ent->value = (u8 *)ptr + tbl->key_size;
+                        }
+
+                        return ptr;
+                }
+
+                idx = group + PA_FLAT_GROUP;
         }
 
-        return ptr;
+        return NULL;
 }
 
 /*
  * -----------------------------------------------------------------------------
  *
- *      TABLE
+ *      SHARED-TABLE
  *
  */
 
-/* Source: https://stackoverflow.com/a/21001712 */
-PA_INTERN u16 tbl_hash(u8 *key, s32 key_sz)
-{
-        u32 byte;
-        u32 crc;
-        u32 mask;
-        s32 i = 0;
-        s32 j;
+/* Size of a cache-line, so reader slots don't share one */
+#define SHR_LINE        64
 
-        crc = 0xFFFFFFFF;
-        while(i < key_sz && key[i] != 0) {
-                byte = key[i];
-                crc = crc ^ byte;
-                for (j = 7; j >= 0; j--) {
-                        mask = -(crc & 1);
-                        crc = (crc >> 1) ^ (0xEDB88320 & mask);
-                }
-                i++;
-        }
-        return (~crc) % 0xFFFF;
+/*
+ * A published version of the table. The fixed table-buffer follows directly
+ * behind the struct in the same allocation.
+ */
+struct shr_snapshot {
+        struct pa_table table;
+        u32 version;                    /* The version it was published as */
+        struct shr_snapshot *next;      /* The next retired snapshot */
+};
+
+/*
+ * The epoch of a reader and the current snapshot and version are shared
+ * without a lock. The volatile only keeps the compiler from caching them in
+ * registers, the ordering between publishing a snapshot and checking the
+ * epochs of the readers comes from PA_BARRIER().
+ */
+struct shr_reader {
+        volatile u32 epoch;     /* The version being read or 0 if idle */
+        u8 pad[SHR_LINE - sizeof(u32)];
+};
+
+struct shr_state {
+#ifdef PA_PTHREADS
+        pthread_mutex_t lock;
+#endif
+
+        struct shr_snapshot *volatile current;
+        volatile u32 version;
+
+        /* Replaced snapshots which might still be read */
+        struct shr_snapshot *retired;
+
+        struct shr_reader *readers;
+};
+
+PA_INTERN void shr_lock(struct shr_state *st)
+{
+#ifdef PA_PTHREADS
+        pthread_mutex_lock(&st->lock);
+#else
+        PA_IGNORE(st);
+#endif
 }
 
-PA_INTERN s16 tbl_find_open(struct pa_table *tbl)
+PA_INTERN void shr_unlock(struct shr_state *st)
 {
-        s16 i;
-
-        for(i = 0; i < tbl->alloc; i++) {
-                if(*(s16 *)(tbl->buffer + i * tbl->entry_size) == -1)
-                        return i;
-        }
-
-        return -1;
+#ifdef PA_PTHREADS
+        pthread_mutex_unlock(&st->lock);
+#else
+        PA_IGNORE(st);
+#endif
 }
 
-PA_INTERN u8 *tbl_next_bucket(struct pa_table *tbl, s16 bucket, u8 *ptr)
+/*
+ * Create a new snapshot with room for the given number of entries and copy
+ * over all entries of the old snapshot, if one is given.
+ *
+ * Returns: The new snapshot or NULL if an error occurred
+ */
+PA_INTERN struct shr_snapshot *shr_copy(struct pa_shared_table *tbl,
+                struct shr_snapshot *old, s32 num)
 {
-        s16 next_idx = -1;
+        struct shr_snapshot *snap;
+        struct pa_table_entry ent;
+        struct pa_table tmp;
+        void *ptr = NULL;
+        s32 buf_sz;
+        u16 hash;
 
-        if(tbl->buckets[bucket] < 0)
+        if(num > 0x7FFF)
                 return NULL;
 
-        /*
-         * On the first call ptr will be NULL, so we have to find the first
-         * entry in the table.
-         */
-        if(!ptr) {
-                return tbl->buffer + (tbl->buckets[bucket] * tbl->entry_size);
-        }
+        tmp.entry_size = PA_TBL_HEAD_SIZE + tbl->key_size + tbl->value_size;
+        buf_sz = tbl_fixed_size(&tmp, PA_MAX(num, 1));
 
-        /*
-         * Otherwise we have to get a pointer to the next entry.
-         */
-        if((next_idx = *(s16 *)ptr) < 0) {
+        if(!(snap = pa_mem_alloc(tbl->memory, NULL, sizeof(*snap) + buf_sz)))
                 return NULL;
+
+        if(paInitTableFixed(&snap->table, snap + 1, buf_sz, tbl->key_size,
+                                tbl->value_size) < 0)
+                goto err_free_snap;
+
+        snap->version = 0;
+        snap->next = NULL;
+
+        if(!old)
+                return snap;
+
+        /* The hashes are stored in the entries, so don't hash them again */
+        while((ptr = paIterateTable(&old->table, ptr, &ent))) {
+                hash = *(u16 *)((u8 *)ptr + PA_TBL_NEXT_SIZE);
+                if(paSetTableHashed(&snap->table, ent.key, hash,
+                                        ent.value) < 0)
+                        goto err_free_snap;
         }
 
-        /* Return a pointer to the entry */
-        return tbl->buffer + (next_idx * tbl->entry_size);
+        return snap;
+
+err_free_snap:
+        pa_mem_free(tbl->memory, snap);
+        return NULL;
 }
 
-PA_INTERN u8 *tbl_next(struct pa_table *tbl, u8 *ptr)
+/*
+ * Free all retired snapshots no reader can see anymore. A reader announcing
+ * version v only ever reads snapshots published as v or later.
+ */
+PA_INTERN void shr_reclaim(struct pa_shared_table *tbl)
 {
-        s16 idx = -1;
-        s16 next_idx = -1;
-        s16 bucket_num;
-
-        /*
-         * On the first call ptr will be NULL, so we have to find the first
-         * entry in the table.
-         */
-        if(!ptr) {
-                bucket_num = 0;
-                while(bucket_num < PA_TBL_BUCKETS) {
-                        if(tbl->buckets[bucket_num] >= 0) {
-                                idx = tbl->buckets[bucket_num];
-                                ptr = tbl->buffer + (idx * tbl->entry_size);
-                                break;
-                        }
-                        bucket_num++;
-                }
+        struct shr_state *st = tbl->state;
+        struct shr_snapshot **link = &st->retired;
+        struct shr_snapshot *snap;
+        u32 oldest = st->version + 1;
+        u32 epoch;
+        s16 i;
 
-                return ptr;
+        for(i = 0; i < tbl->readers; i++) {
+                epoch = st->readers[i].epoch;
+                if(epoch != 0 && epoch < oldest)
+                        oldest = epoch;
         }
 
-        /*
-         * Otherwise we have to get a pointer to the next entry.
-         */
-        next_idx = *(s16 *)ptr;
-        if(next_idx <= -2) {
-                bucket_num = (-1 * next_idx) - 2 + 1;
-                while(bucket_num < PA_TBL_BUCKETS) {
-                        if(tbl->buckets[bucket_num] >= 0) {
-                                next_idx = tbl->buckets[bucket_num];
-                                break;
-                        }
-                        bucket_num++;
+        while((snap = *link)) {
+                if(snap->version < oldest) {
+                        *link = snap->next;
+                        pa_mem_free(tbl->memory, snap);
+                }
+                else {
+                        link = &snap->next;
                 }
-
-                /* No more entries left in the table */
-                if(next_idx <= -2)
-                        return NULL;
         }
-
-        /* Return a pointer to the entry */
-        return tbl->buffer + (next_idx * tbl->entry_size);
 }
 
-PA_INTERN u8 *tbl_find_key(struct pa_table *tbl, u8 *key, u8 **prev,
-                s16 *bucket_out)
+/*
+ * Replace the current snapshot with the given one and retire the old one. Must
+ * be called with the writer-lock held.
+ */
+PA_INTERN void shr_publish(struct pa_shared_table *tbl,
+                struct shr_snapshot *snap)
 {
-        u16 hash = tbl_hash(key, tbl->key_size);
-        s16 bucket = hash % PA_TBL_BUCKETS;
-        u8 *ptr = NULL;
-        s16 off = PA_TBL_NEXT_SIZE + PA_TBL_HASH_SIZE;
+        struct shr_state *st = tbl->state;
+        struct shr_snapshot *old = st->current;
 
-        if(tbl->buckets[bucket] < 0)
-                return NULL;
+        snap->version = st->version + 1;
 
-        if(bucket_out) *bucket_out = bucket;
+        /* The snapshot has to be complete before anyone can see it */
+        PA_BARRIER();
+        st->current = snap;
+        PA_BARRIER();
+        st->version = snap->version;
 
-        if(prev) *prev = NULL;
-        while((ptr = tbl_next_bucket(tbl, bucket, ptr))) {
-                /* Compare the hashes */
-                if(hash == *(u16 *)(ptr + PA_TBL_NEXT_SIZE)) {
-                        if(pa_mem_compare(key, ptr + off, tbl->key_size)) {
-                                return ptr;
-                        }
-                }
-                if(prev) *prev = ptr;
-        }
+        /* Make the new version visible before checking the readers */
+        PA_BARRIER();
 
-        return NULL;
+        old->next = st->retired;
+        st->retired = old;
+
+        shr_reclaim(tbl);
 }
 
-PA_API s8 paInitTable(struct pa_table *tbl, struct pa_memory *mem,
-                s32 key_sz, s32 value_sz, s16 alloc)
+PA_API s8 paInitSharedTable(struct pa_shared_table *tbl, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s16 readers)
 {
-        s32 alloc_sz;
+        struct shr_state *st;
+        s32 size;
+        u8 *ptr;
         s16 i;
 
-        tbl->memory = mem;
-        tbl->mode = PA_DYNAMIC;
+        if(readers < 1)
+                return -1;
 
+        tbl->memory = mem;
         tbl->key_size = key_sz;
         tbl->value_size = value_sz;
-        tbl->entry_size = PA_TBL_HEAD_SIZE + key_sz + value_sz;
-        tbl->number = 0;
-        tbl->alloc = alloc;
+        tbl->readers = readers;
 
-        alloc_sz = tbl->entry_size * tbl->alloc;
-        if(!(tbl->buffer = pa_mem_alloc(tbl->memory, NULL, alloc_sz))) {
+        /* Allocate the state and the reader slots aligned to a cache-line */
+        size = sizeof(struct shr_state) + (readers + 1) * SHR_LINE;
+        if(!(st = pa_mem_alloc(mem, NULL, size)))
                 return -1;
-        }
 
-        /* Reset all memory slots in the buffer */
-        for(i = 0; i < tbl->alloc; i++) {
-                *(s16 *)(tbl->buffer + i * tbl->entry_size) = -1;
-        }
+        ptr = (u8 *)(st + 1);
+        ptr += (SHR_LINE - ((unsigned long)ptr % SHR_LINE)) % SHR_LINE;
+        st->readers = (struct shr_reader *)ptr;
 
-        /* Reset all buckets */
-        for(i = 0; i < PA_TBL_BUCKETS; i++) {
-                tbl->buckets[i] = -1;
-        }
+        for(i = 0; i < readers; i++)
+                st->readers[i].epoch = 0;
+
+        st->retired = NULL;
+        st->version = 1;
+
+        tbl->state = st;
+        if(!(st->current = shr_copy(tbl, NULL, 0)))
+                goto err_free_state;
+
+        st->current->version = st->version;
+
+#ifdef PA_PTHREADS
+        pthread_mutex_init(&st->lock, NULL);
+#endif
 
         return 0;
+
+err_free_state:
+        pa_mem_free(mem, st);
+        tbl->state = NULL;
+        return -1;
 }
 
-PA_API s8 paInitTableFixed(struct pa_table *tbl, void *buffer,
-                s32 buf_sz, s32 key_sz, s32 value_sz)
+PA_API void paDestroySharedTable(struct pa_shared_table *tbl)
 {
-        s16 i;
+        struct shr_state *st = tbl->state;
+        struct shr_snapshot *snap;
 
-        tbl->memory = NULL;
-        tbl->mode = PA_FIXED;
+        if(!st)
+                return;
 
-        tbl->key_size = key_sz;
-        tbl->value_size = value_sz;
-        tbl->entry_size = PA_TBL_HEAD_SIZE + value_sz;
-        tbl->number = 0;
-        tbl->buffer = buffer;
+        while((snap = st->retired)) {
+                st->retired = snap->next;
+                pa_mem_free(tbl->memory, snap);
+        }
 
-        tbl->alloc = buf_sz / tbl->entry_size;
+        pa_mem_free(tbl->memory, st->current);
 
-        /* Reset all entry-slots in the buffer */
-        for(i = 0; i < tbl->alloc; i++) {
-                *(s16 *)(tbl->buffer + i * tbl->entry_size) = -1;
-        }
+#ifdef PA_PTHREADS
+        pthread_mutex_destroy(&st->lock);
+#endif
 
-        /* Reset all buckets */
-        for(i = 0; i < PA_TBL_BUCKETS; i++) {
-                tbl->buckets[i] = -1;
-        }
+        pa_mem_free(tbl->memory, st);
 
-        return 0;
+        tbl->state = NULL;
+        tbl->readers = 0;
 }
 
-PA_API void paDestroyTable(struct pa_table *tbl)
+PA_API s8 paSetSharedTable(struct pa_shared_table *tbl, void *key,
+                void *value)
 {
-        if(tbl->mode == PA_DYNAMIC) {
-                pa_mem_free(tbl->memory, tbl->buffer);
-        }
-
-        tbl->memory = 0;
-        tbl->mode = PA_MEM_UDEF;
-
-        tbl->value_size = 0;
-        tbl->entry_size = 0;
-        tbl->number = 0;
-        tbl->alloc = 0;
-        tbl->buffer = 0;
+        return paSetSharedTableBatch(tbl, key, value, 1);
 }
 
-PA_API s8 paSetTable(struct pa_table *tbl, void *key, void *value)
+PA_API s8 paSetSharedTableBatch(struct pa_shared_table *tbl, void *keys,
+                void *values, s16 num)
 {
-        s16 slot;
-        u16 hash;
-        s16 bucket;
-        u8 *ptr;
-        s32 tmp;
-        s16 next_idx;
+        struct shr_state *st = tbl->state;
+        struct shr_snapshot *snap;
+        u8 *key_ptr = keys;
+        u8 *val_ptr = values;
+        s16 i;
 
-        s16 key_off = PA_TBL_HEAD_SIZE;
-        s16 val_off = key_off + tbl->key_size;
-                
-        /*
-         * If there is already an entry with the keyword in the table, we
-         * can just overwrite it's value and return.
-         */
-        if((ptr = tbl_find_key(tbl, key, NULL, NULL))) {
-                /* Copy over the content */
-                pa_mem_copy(ptr + val_off, value, tbl->value_size);
-                return 0;
+        shr_lock(st);
 
-        }
+        snap = shr_copy(tbl, st->current, st->current->table.number + num);
+        if(!snap)
+                goto err_unlock;
 
-        /* Get an open slot in the table-buffer */
-        if((slot = tbl_find_open(tbl)) < 0)
-                return -1;
+        for(i = 0; i < num; i++) {
+                if(paSetTable(&snap->table, key_ptr, val_ptr) < 0)
+                        goto err_free_snap;
 
-        /* Hash the key and determine the bucket  */
-        hash = tbl_hash(key, tbl->key_size); 
-        bucket = hash % PA_TBL_BUCKETS;
+                key_ptr += tbl->key_size;
+                val_ptr += tbl->value_size;
+        }
 
-        /* 
-         * Write the copy over the data to the table-buffer.
-         */
+        shr_publish(tbl, snap);
+        shr_unlock(st);
+        return 0;
 
-        /* Set the next index */
-        ptr = tbl->buffer + (slot * tbl->entry_size);
-        *(s16 *)ptr = -(bucket + 2);
-        ptr += PA_TBL_NEXT_SIZE;
+err_free_snap:
+        pa_mem_free(tbl->memory, snap);
 
-        /* Copy the hash */
-        *(u16 *)ptr = hash;
-        ptr += PA_TBL_HASH_SIZE;
+err_unlock:
+        shr_unlock(st);
+        return -1;
+}
 
-        /* Copy over the keyword */
-        pa_mem_copy(ptr, key, tbl->key_size);
-        ptr += tbl->key_size;
+PA_API s8 paRemoveSharedTable(struct pa_shared_table *tbl, void *key)
+{
+        struct shr_state *st = tbl->state;
+        struct shr_snapshot *snap;
+        u16 hash = tbl_hash(key, tbl->key_size);
 
-        /* Copy over the content */
-        pa_mem_copy(ptr, value, tbl->value_size);
+        shr_lock(st);
 
-        /*
-         * Attach the entry to the bucket.
-         */
-        if(tbl->buckets[bucket] < 0) {
-                tbl->buckets[bucket] = slot;
+        /* Nothing to do if the key isn't in the table */
+        if(!tbl_find_key(&st->current->table, key, hash, NULL, NULL)) {
+                shr_unlock(st);
+                return 0;
         }
-        else {
-                tmp = tbl->buckets[bucket] * tbl->entry_size;
-                ptr = tbl->buffer + tmp;
-                while((next_idx = *(s16 *)ptr) >= 0) {
-                        ptr = tbl->buffer + next_idx * tbl->entry_size;
-                }
-                *(s16 *)ptr = slot;
+
+        if(!(snap = shr_copy(tbl, st->current, st->current->table.number))) {
+                shr_unlock(st);
+                return -1;
         }
 
-        tbl->number++;
+        paRemoveTable(&snap->table, key);
+
+        shr_publish(tbl, snap);
+        shr_unlock(st);
         return 0;
 }
 
-PA_API s8 paGetTable(struct pa_table *tbl, void *key, void *out)
+PA_API s8 paGetSharedTable(struct pa_shared_table *tbl, s16 reader,
+                void *key, void *out)
 {
+        struct shr_state *st = tbl->state;
+        struct shr_reader *rdr = &st->readers[reader];
+        struct shr_snapshot *snap;
+        u16 hash = tbl_hash(key, tbl->key_size);
+        u32 version;
         u8 *ptr;
-        s16 off = PA_TBL_HEAD_SIZE + tbl->key_size;
+        s8 ret;
 
-        if(!(ptr = tbl_find_key(tbl, key, NULL, NULL)))
-                return 0;
+        /*
+         * Announce the version before reading the snapshot. If the writer
+         * published a new version in the meantime, it might have missed the
+         * announcement, so try again.
+         */
+        do {
+                version = st->version;
+                rdr->epoch = version;
+                PA_BARRIER();
+        } while(st->version != version);
+
+        /* Search directly, so the readers don't share the hit-counters */
+        snap = st->current;
+        ptr = tbl_find_key(&snap->table, key, hash, NULL, NULL);
+        if((ret = ptr != NULL))
+                pa_mem_copy(out, ptr + PA_TBL_HEAD_SIZE + tbl->key_size,
+                                tbl->value_size);
+
+        /* Done reading, the snapshot may be freed from now on */
+        PA_BARRIER();
+        rdr->epoch = 0;
+
+        return ret;
+}
 
-        pa_mem_copy(out, ptr + off, tbl->entry_size);
-        return 1;
+#undef SHR_LINE
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      CACHE
+ *
+ */
+
+/*
+ * Get a pointer to the reference-bit of an entry in the table-buffer.
+ */
+PA_INTERN u8 *cch_ref(struct pa_cache *cache, u8 *ptr)
+{
+        return ptr + PA_TBL_HEAD_SIZE + cache->table.key_size +
+                cache->value_size;
 }
 
-PA_API void paRemoveTable(struct pa_table *tbl, void *key)
+/*
+ * Move the hand over the slots until an entry with a clear reference-bit is
+ * found, clearing the bits of all entries passed, and evict that entry.
+ */
+PA_INTERN void cch_evict(struct pa_cache *cache)
 {
-        s16 bucket;
+        struct pa_table *tbl = &cache->table;
         u8 *ptr;
-        u8 *prev;
-        s16 next_idx;
+        u8 *ref;
 
-        if((ptr = tbl_find_key(tbl, key, &prev, &bucket))) {
-                next_idx = *(s16 *)ptr;
+        while(1) {
+                ptr = tbl->buffer + cache->hand * tbl->entry_size;
+                if(++cache->hand >= tbl->alloc)
+                        cache->hand = 0;
 
-                if(!prev && next_idx < 0) {
-                        tbl->buckets[bucket] = -1;
-                }
-                else if(!prev && next_idx >= 0) {
-                        tbl->buckets[bucket] = next_idx;
-                }
-                else if(prev) {
-                        *(s16 *)prev = *(s16 *)ptr;
+                /* Skip the unused slots */
+                if(*(s16 *)ptr == -1)
+                        continue;
+
+                ref = cch_ref(cache, ptr);
+                if(*ref) {
+                        *ref = 0;
+                        continue;
                 }
 
-                *(s16 *)ptr = -1;
-                tbl->number--;
+                ptr += PA_TBL_HEAD_SIZE;
+                if(cache->evict)
+                        cache->evict(ptr, ptr + tbl->key_size, cache->pass);
+
+                paRemoveTable(tbl, ptr);
+                cache->evictions++;
+                return;
         }
 }
 
-PA_API void *paIterateTable(struct pa_table *tbl, void *ptr, 
-                struct pa_table_entry *ent)
+/*
+ * Get the size of the value-part in the table, with the reference-bit behind
+ * the value and padding to keep the entries aligned to four bytes.
+ */
+PA_INTERN s32 cch_value_size(s32 key_sz, s32 value_sz)
+{
+        return ((key_sz + value_sz + 1 + 3) & ~3) - key_sz;
+}
+
+PA_INTERN void cch_reset(struct pa_cache *cache, s32 value_sz)
+{
+        cache->value_size = value_sz;
+        cache->budget = cache->table.alloc;
+        cache->hand = 0;
+        cache->evict = NULL;
+        cache->pass = NULL;
+        cache->hits = 0;
+        cache->misses = 0;
+        cache->evictions = 0;
+}
+
+PA_API s8 paInitCache(struct pa_cache *cache, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s16 budget)
 {
-        char *tmp;
+        if(budget < 1)
+                return -1;
 
-        /* Check if the table is empty */
-        if(tbl->number < 1)
-                return NULL;
+        if(paInitTable(&cache->table, mem, key_sz,
+                                cch_value_size(key_sz, value_sz), budget) < 0)
+                return -1;
 
-        /* Go to the next entry in the table */
-        if(!(ptr = tbl_next(tbl, ptr)))
-                return NULL;
+        cch_reset(cache, value_sz);
+        return 0;
+}
 
-        /* Return the entry-data for the current entry */
-        if(ent) {
-                /* Copy over the key */
-                tmp = (char *)ptr + PA_TBL_NEXT_SIZE + PA_TBL_HASH_SIZE;
+PA_API s8 paInitCacheFixed(struct pa_cache *cache, void *buffer,
+                s32 buf_sz, s32 key_sz, s32 value_sz)
+{
+        if(paInitTableFixed(&cache->table, buffer, buf_sz, key_sz,
+                                cch_value_size(key_sz, value_sz)) < 0)
+                return -1;
 
-                /* Set the pointer for the data */
-                ent->key = tmp;
-                ent->value = tmp + tbl->key_size;
-        }
+        cch_reset(cache, value_sz);
+        return 0;
+}
 
-        return ptr;
+PA_API void paDestroyCache(struct pa_cache *cache)
+{
+        paDestroyTable(&cache->table);
+        cch_reset(cache, 0);
 }
 
-PA_API void *paIterateTableBucket(struct pa_table *tbl, s16 bucket,
-                void *ptr, struct pa_table_entry *ent)
+PA_API void paSetCacheCallback(struct pa_cache *cache, pa_cache_func fnc,
+                void *pass)
 {
-        char *tmp;
+        cache->evict = fnc;
+        cache->pass = pass;
+}
 
-        /* Check if the table is empty */
-        if(tbl->number < 1)
-                return NULL;
+PA_API s8 paSetCache(struct pa_cache *cache, void *key, void *value)
+{
+        struct pa_table *tbl = &cache->table;
+        u16 hash = tbl_hash(key, tbl->key_size);
+        u8 *ptr;
 
-        if(!(ptr = tbl_next_bucket(tbl, bucket, ptr)))
-                return NULL;
+        /* Make room if the key isn't cached yet and the budget is used up */
+        if(tbl->number >= cache->budget &&
+                        !tbl_find_key(tbl, key, hash, NULL, NULL))
+                cch_evict(cache);
 
-        /* Return the data for the current entry */
-        if(ent) {
-                /* Copy over the key */
-                tmp = (char *)ptr + PA_TBL_NEXT_SIZE + PA_TBL_HASH_SIZE;
+        if(!(ptr = tbl_insert(tbl, key, hash)))
+                return -1;
 
-                /* Set the pointer for the data */
-                ent->key = tmp;
-                ent->value = tmp + tbl->key_size;
+        pa_mem_copy(ptr + PA_TBL_HEAD_SIZE + tbl->key_size, value,
+                        cache->value_size);
+        *cch_ref(cache, ptr) = 1;
+        return 0;
+}
+
+PA_API s8 paGetCache(struct pa_cache *cache, void *key, void *out)
+{
+        struct pa_table *tbl = &cache->table;
+        u8 *ptr;
+
+        if(!(ptr = tbl_find_key(tbl, key, tbl_hash(key, tbl->key_size), NULL,
+                                        NULL))) {
+                cache->misses++;
+                return 0;
         }
 
-        return ptr;
+        pa_mem_copy(out, ptr + PA_TBL_HEAD_SIZE + tbl->key_size,
+                        cache->value_size);
+        *cch_ref(cache, ptr) = 1;
+        cache->hits++;
+        return 1;
+}
+
+PA_API void paRemoveCache(struct pa_cache *cache, void *key)
+{
+        paRemoveTable(&cache->table, key);
 }
 
 /*
@@ -3183,22 +10011,26 @@ PA_INTERN s8 flx_parse_token(u8 opt, char *s, struct pa_flex_token *tok)
                 buf[tail] = 0;
 
                 if(tail != 0) {
-                        if(pa_strcmp(buf, "px") == 0) {
-                                /* A pixel-value has to be an integer */
-                                tok->value = (s32)tok->value;
-                                tok->code = 0x12;
-                        }
-                        else if(pa_strcmp(buf, "pct") == 0) {
-                                tok->value /= 100.0;
+                        switch(pa_kwd_find(&pa_kwd_unit, buf, tail)) {
+                                case 0x12:
+                                        /* A pixel-value has to be an integer */
+                                        tok->value = (s32)tok->value;
+                                        tok->code = 0x12;
+                                        break;
 
-                                tok->code = 0x13;
-                        }
-                        else if(pa_strcmp(buf, "em") == 0) {
-                                tok->code = 0x14;
-                        }
-                        else {
-                                /* Unit invalid */
-                                return -1;
+                                case 0x13:
+                                        tok->value /= 100.0;
+
+                                        tok->code = 0x13;
+                                        break;
+
+                                case 0x14:
+                                        tok->code = 0x14;
+                                        break;
+
+                                default:
+                                        /* Unit invalid */
+                                        return -1;
                         }
                 }
 
@@ -3427,6 +10259,149 @@ err_return:
         return -1;
 }
 
+/*
+ * Combine two linear forms a + b * relative + c * font with an operator. The
+ * result is only a linear form again if at most one side contains references
+ * when multiplying, and if the divisor is a constant other than zero.
+ *
+ * @code: The operator-code
+ * @lft: The left operand
+ * @rgt: The right operand
+ * @out: A pointer to write the resulting linear form to
+ *
+ * Returns: 0 on success or -1 if the result is not a linear form
+ */
+PA_INTERN s8 flx_fold(u8 code, f32 *lft, f32 *rgt, f32 *out)
+{
+        s8 lft_const = lft[1] == 0 && lft[2] == 0;
+        s8 rgt_const = rgt[1] == 0 && rgt[2] == 0;
+        s8 i;
+
+        for(i = 0; i < 3; i++) {
+                switch(code) {
+                        case 0x03:
+                                if(rgt_const)
+                                        out[i] = lft[i] * rgt[0];
+                                else if(lft_const)
+                                        out[i] = lft[0] * rgt[i];
+                                else
+                                        return -1;
+                                break;
+
+                        case 0x04: out[i] = lft[i] + rgt[i]; break;
+                        case 0x05: out[i] = lft[i] - rgt[i]; break;
+
+                        case 0x06:
+                                if(!rgt_const || rgt[0] == 0)
+                                        return -1;
+                                out[i] = lft[i] / rgt[0];
+                                break;
+
+                        default: return -1;
+                }
+        }
+
+        return 0;
+}
+
+/*
+ * Replace the tokens of the flex-term with the shortest term for its linear
+ * form. This never needs more tokens than the original term, as every part of
+ * the linear form has to come from at least one operand.
+ */
+PA_INTERN void flx_emit(struct pa_flex *flx)
+{
+        struct pa_flex_token tok;
+        f32 parts[3];
+        u8 codes[3] = {0x11, 0x13, 0x14};
+        s8 num = 0;
+        s8 i;
+
+        parts[0] = flx->constant;
+        parts[1] = flx->relative;
+        parts[2] = flx->font;
+
+        paClearList(&flx->tokens);
+
+        for(i = 0; i < 3; i++) {
+                /* An empty form is still written as the constant zero */
+                if(parts[i] == 0 && (i > 0 || parts[1] != 0 || parts[2] != 0))
+                        continue;
+
+                tok.code = codes[i];
+                tok.value = parts[i];
+                paPushList(&flx->tokens, &tok, 1);
+
+                if(num++ > 0) {
+                        tok.code = 0x04;
+                        tok.value = 0;
+                        paPushList(&flx->tokens, &tok, 1);
+                }
+        }
+}
+
+/*
+ * Evaluate the postfix-term with every value kept as the linear form
+ * a + b * relative + c * font. If the whole term folds into a single linear
+ * form, store it and replace the tokens.
+ */
+PA_INTERN void flx_compile(struct pa_flex *flx)
+{
+        struct pa_list *values = &flx->helper->values;
+        struct pa_flex_token tok;
+        f32 lft[3];
+        f32 rgt[3];
+        f32 form[3];
+        s16 depth = 0;
+        u16 i = 0;
+
+        flx->linear = 0;
+        paClearList(values);
+
+        while(paPeekList(&flx->tokens, &tok, i++, 1)) {
+                /* Operands become a linear form with a single part */
+                if(tok.code > 0x06) {
+                        form[0] = form[1] = form[2] = 0;
+                        switch(tok.code) {
+                                case 0x13: form[1] = tok.value; break;
+                                case 0x14: form[2] = tok.value; break;
+                                default:   form[0] = tok.value; break;
+                        }
+                }
+                /* Operators combine the two topmost forms */
+                else {
+                        if(depth < 2)
+                                goto out_clear;
+
+                        paPopList(values, rgt, 3);
+                        paPopList(values, lft, 3);
+                        depth -= 2;
+
+                        if(flx_fold(tok.code, lft, rgt, form) < 0)
+                                goto out_clear;
+                }
+
+                if(paPushList(values, form, 3) != 3)
+                        goto out_clear;
+
+                depth++;
+        }
+
+        if(depth != 1)
+                goto out_clear;
+
+        paPopList(values, form, 3);
+        flx->constant = form[0];
+        flx->relative = form[1];
+        flx->font = form[2];
+        flx->linear = 1;
+
+        flx_emit(flx);
+
+out_clear:
+        paClearList(values);
+}
+
 PA_API s8 paInitFlexHelper(struct pa_flex_helper *hlp, struct pa_memory *mem,
                 s16 tokens)
 {
@@ -3503,6 +10478,7 @@ PA_API s8 paInitFlex(struct pa_flex *flx, struct pa_flex_helper *hlp,
 {
         s32 toksize = sizeof(struct pa_flex_token);
         flx->helper = hlp;
+        flx->linear = 0;
         return paInitList(&flx->tokens, mem, toksize, tokens, PA_NOLIM);
 }
 
@@ -3511,6 +10487,7 @@ PA_API s8 paInitFlexFixed(struct pa_flex *flx, struct pa_flex_helper *hlp,
 {
         s32 toksize = sizeof(struct pa_flex_token);
         flx->helper = hlp;
+        flx->linear = 0;
         return paInitListFixed(&flx->tokens, toksize, tok_buf, tok_buf_sz);
 }
 
@@ -3522,6 +10499,7 @@ PA_API void paDestroyFlex(struct pa_flex *flx)
 PA_API void paClearFlex(struct pa_flex *flx)
 {
         paClearList(&flx->tokens);
+        flx->linear = 0;
 }
 
 PA_API s16 paParseFlex(struct pa_flex *flx, char *str)
@@ -3529,7 +10507,8 @@ PA_API s16 paParseFlex(struct pa_flex *flx, char *str)
         /* Firs we tokenize the input and write the tokens to the parser */
         flx_tokenize(flx->helper, str);
 
-        flx_shunting_yard(flx->helper, flx);
+        if(flx_shunting_yard(flx->helper, flx) == 0)
+                flx_compile(flx);
 
         return 0;
 }
@@ -3542,6 +10521,12 @@ PA_API s32 paProcessFlex(struct pa_flex *flx, struct pa_flex_reference *ref)
         f32 opd[2];
         u16 i = 0;
 
+        if(flx->linear) {
+                value = flx->constant + flx->relative * ref->relative +
+                        flx->font * ref->font;
+                return (s32)value;
+        }
+
         values = &flx->helper->values;
 
         while(paPeekList(&flx->tokens, &tok, i++, 1)) {
@@ -3636,6 +10621,17 @@ PA_LIB void pa_element_tree_destroy(struct pa_element_tree *tree)
 }
 
 
+PA_LIB enum pa_tag_type pa_tag_by_name(char *name)
+{
+        s32 type;
+
+        if((type = pa_kwd_find(&pa_kwd_tag, name, pa_strlen(name))) < 0)
+                return PA_UNDEF;
+
+        return (enum pa_tag_type)type;
+}
+
+
 
 
 
@@ -3809,6 +10805,269 @@ PA_LIB f64 pa_atof(char *s)
         return a;
 }
 
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              BIT-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+PA_LIB s8 pa_bit_ctz(u32 x)
+{
+#if defined(__GNUC__)
+        return __builtin_ctz(x);
+#else
+        s8 n = 0;
+
+        while(!(x & 1)) {
+                x >>= 1;
+                n++;
+        }
+
+        return n;
+#endif
+}
+
+PA_LIB s8 pa_bit_popcount(u32 x)
+{
+#if defined(__GNUC__)
+        return __builtin_popcount(x);
+#else
+        x = x - ((x >> 1) & 0x55555555);
+        x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+        x = (x + (x >> 4)) & 0x0F0F0F0F;
+        return (x * 0x01010101) >> 24;
+#endif
+}
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              HASH-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+#define HSH_PRIME1      0x9E3779B1
+#define HSH_PRIME2      0x85EBCA77
+#define HSH_PRIME3      0xC2B2AE3D
+#define HSH_PRIME4      0x27D4EB2F
+#define HSH_PRIME5      0x165667B1
+
+#define HSH_ROTL(x, r)  (((x) << (r)) | ((x) >> (32 - (r))))
+
+/*
+ * Read a little-endian word. Compilers turn this into a single load on
+ * little-endian machines, without requiring the pointer to be aligned.
+ */
+PA_INTERN u32 hsh_read(u8 *p)
+{
+        return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) |
+                ((u32)p[3] << 24);
+}
+
+PA_INTERN u32 hsh_round(u32 acc, u32 input)
+{
+        acc += input * HSH_PRIME2;
+        acc = HSH_ROTL(acc, 13);
+        return acc * HSH_PRIME1;
+}
+
+PA_LIB u32 pa_hash(void *key, s32 size)
+{
+        u8 *p = key;
+        u8 *end = p + size;
+        u32 v1, v2, v3, v4;
+        u32 h;
+
+        if(size >= 16) {
+                v1 = HSH_PRIME1 + HSH_PRIME2;
+                v2 = HSH_PRIME2;
+                v3 = 0;
+                v4 = 0 - HSH_PRIME1;
+
+                while(p + 16 <= end) {
+                        v1 = hsh_round(v1, hsh_read(p));
+                        v2 = hsh_round(v2, hsh_read(p + 4));
+                        v3 = hsh_round(v3, hsh_read(p + 8));
+                        v4 = hsh_round(v4, hsh_read(p + 12));
+                        p += 16;
+                }
+
+                h = HSH_ROTL(v1, 1) + HSH_ROTL(v2, 7) + HSH_ROTL(v3, 12) +
+                        HSH_ROTL(v4, 18);
+        }
+        else {
+                h = HSH_PRIME5;
+        }
+
+        h += (u32)size;
+
+        while(p + 4 <= end) {
+                h += hsh_read(p) * HSH_PRIME3;
+                h = HSH_ROTL(h, 17) * HSH_PRIME4;
+                p += 4;
+        }
+
+        while(p < end) {
+                h += (u32)(*p) * HSH_PRIME5;
+                h = HSH_ROTL(h, 11) * HSH_PRIME1;
+                p++;
+        }
+
+        /* Mix the bits, so every input bit affects every output bit */
+        h ^= h >> 15;
+        h *= HSH_PRIME2;
+        h ^= h >> 13;
+        h *= HSH_PRIME3;
+        h ^= h >> 16;
+        return h;
+}
+
+#undef HSH_PRIME1
+#undef HSH_PRIME2
+#undef HSH_PRIME3
+#undef HSH_PRIME4
+#undef HSH_PRIME5
+#undef HSH_ROTL
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              BLOOM-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+#define BLM_BITS        (PA_BLOOM_BLOCK * 32)
+
+/*
+ * Get the block for a hash. The upper half of the hash is scaled to the
+ * number of blocks, which avoids a division.
+ */
+PA_INTERN u32 *blm_block(struct pa_bloom *flt, u32 hash)
+{
+        return flt->bits + ((hash >> 16) * (u32)flt->blocks >> 16) *
+                PA_BLOOM_BLOCK;
+}
+
+/*
+ * Get the next bit inside a block. The hash is remixed for every bit, so the
+ * bits of a key don't depend on each other.
+ */
+PA_INTERN u32 blm_next(u32 *h)
+{
+        *h ^= *h >> 15;
+        *h *= 0x2C1B3C6D;
+        return *h >> 23;
+}
+
+PA_LIB s8 pa_bloom_init(struct pa_bloom *flt, struct pa_memory *mem,
+                s32 capacity, f32 rate)
+{
+        s32 blocks;
+        s16 hashes = 0;
+        f32 r = rate;
+
+        if(rate <= 0 || rate >= 1)
+                return -1;
+
+        /*
+         * The optimal number of bits per key is log2(1/rate) and the filter
+         * needs about 1.44 bits per key and bit. Use a bit more, as keys are
+         * not spread perfectly evenly over the blocks.
+         */
+        while(r < 1 && hashes < 16) {
+                r *= 2;
+                hashes++;
+        }
+
+        blocks = (PA_MAX(capacity, 1) * hashes * 3 / 2 + BLM_BITS - 1) /
+                BLM_BITS;
+        blocks = PA_MIN(blocks, 0x10000);
+
+        if(!(flt->bits = pa_mem_alloc(mem, NULL, blocks * BLM_BITS / 8)))
+                return -1;
+
+        pa_mem_zero(flt->bits, blocks * BLM_BITS / 8);
+
+        flt->blocks = blocks;
+        flt->hashes = hashes;
+        flt->capacity = capacity;
+        flt->stale = 0;
+        flt->rate = rate;
+        return 0;
+}
+
+PA_LIB void pa_bloom_destroy(struct pa_bloom *flt, struct pa_memory *mem)
+{
+        if(flt->bits)
+                pa_mem_free(mem, flt->bits);
+
+        pa_mem_zero(flt, sizeof(struct pa_bloom));
+}
+
+PA_LIB void pa_bloom_add(struct pa_bloom *flt, u32 hash)
+{
+        u32 *block = blm_block(flt, hash);
+        u32 bit;
+        s16 i;
+
+        for(i = 0; i < flt->hashes; i++) {
+                bit = blm_next(&hash);
+                block[bit / 32] |= 1U << (bit % 32);
+        }
+}
+
+PA_LIB s8 pa_bloom_test(struct pa_bloom *flt, u32 hash)
+{
+        u32 *block = blm_block(flt, hash);
+        u32 bit;
+        s16 i;
+
+        for(i = 0; i < flt->hashes; i++) {
+                bit = blm_next(&hash);
+                if(!(block[bit / 32] & (1U << (bit % 32))))
+                        return 0;
+        }
+
+        return 1;
+}
+
+#undef BLM_BITS
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              KEYWORD-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+PA_LIB s32 pa_kwd_find(const struct pa_keyword_set *set, char *s, s32 len)
+{
+        u32 hash = pa_hash(s, len);
+        const char *key;
+        s32 i;
+
+        /* Apply the displacement of the bucket, same as in build.py */
+        hash = (hash ^ set->disp[hash % set->buckets]) * 0x85EBCA6B;
+        hash ^= hash >> 13;
+
+        /* Only this slot can contain the keyword */
+        key = set->keys[hash % set->number];
+        for(i = 0; i < len; i++) {
+                if(key[i] != s[i])
+                        return -1;
+        }
+
+        if(key[len] != 0)
+                return -1;
+
+        return set->values[hash % set->number];
+}
+
 
 
 
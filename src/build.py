@@ -4,10 +4,14 @@ import sys
 
 def print_help():
     print(
-"""usage: python single_header_packer.py --macro <macro> [--intro <files>] --pub <files> --priv <files> [--outro <files>]
+"""usage: python single_header_packer.py --macro <macro> [--intro <files>] --pub <files> --priv <files> [--outro <files>] [--keywords <spec>:<out>]
 
        where <files> can be a comma-separated list of files. e.g. --priv *.c,inc/*.h
 
+       With --keywords the key-sets in <spec> are turned into minimal perfect
+       hash tables, which are written to the C-file <out>. The option has to
+       come before the file-list containing <out>.
+
        The resulting code is packed as follows:
 
            /*
@@ -69,6 +73,142 @@ def omit_includes(str, files):
             str = str.replace("#include <" + fname + ">", "");
     return str
 
+# Keyword tables
+# ==============
+#
+# Every key-set in the spec-file is turned into a minimal perfect hash table
+# using hash-and-displace: The keys are hashed with the same xxHash32 as
+# pa_hash() and distributed into buckets. Then, starting with the largest
+# bucket, a displacement is searched for every bucket, which moves all keys of
+# the bucket into free slots. The lookup in pa_kwd_find() then only needs one
+# hash, one displacement and one compare.
+
+MASK32 = 0xFFFFFFFF
+
+def rotl32(x, r):
+    return ((x << r) | (x >> (32 - r))) & MASK32
+
+def xxh32(data):
+    p1, p2, p3, p4, p5 = (0x9E3779B1, 0x85EBCA77, 0xC2B2AE3D,
+                          0x27D4EB2F, 0x165667B1)
+    size = len(data)
+    i = 0
+
+    def word(i):
+        return int.from_bytes(data[i:i + 4], "little")
+
+    def round32(acc, inp):
+        return rotl32((acc + inp * p2) & MASK32, 13) * p1 & MASK32
+
+    if size >= 16:
+        v = [(p1 + p2) & MASK32, p2, 0, (0 - p1) & MASK32]
+        while i + 16 <= size:
+            v = [round32(v[j], word(i + j * 4)) for j in range(4)]
+            i += 16
+        h = (rotl32(v[0], 1) + rotl32(v[1], 7) + rotl32(v[2], 12) +
+             rotl32(v[3], 18)) & MASK32
+    else:
+        h = p5
+
+    h = (h + size) & MASK32
+    while i + 4 <= size:
+        h = rotl32((h + word(i) * p3) & MASK32, 17) * p4 & MASK32
+        i += 4
+    while i < size:
+        h = rotl32((h + data[i] * p5) & MASK32, 11) * p1 & MASK32
+        i += 1
+
+    h ^= h >> 15
+    h = h * p2 & MASK32
+    h ^= h >> 13
+    h = h * p3 & MASK32
+    h ^= h >> 16
+    return h
+
+def kwd_mix(h, d):
+    h = (h ^ d) * 0x85EBCA6B & MASK32
+    return h ^ (h >> 13)
+
+def kwd_build(keys):
+    num = len(keys)
+    bucket_num = max(1, (num + 1) // 2)
+    hashes = [xxh32(k.encode()) for k in keys]
+    buckets = [[] for _ in range(bucket_num)]
+    for i, h in enumerate(hashes):
+        buckets[h % bucket_num].append(i)
+
+    disp = [0] * bucket_num
+    slots = [None] * num
+    for b in sorted(range(bucket_num), key=lambda b: -len(buckets[b])):
+        if not buckets[b]:
+            continue
+
+        d = 0
+        while True:
+            pos = [kwd_mix(hashes[i], d) % num for i in buckets[b]]
+            if (len(set(pos)) == len(pos) and
+                    all(slots[p] is None for p in pos)):
+                break
+            d += 1
+            if d > 0xFFFF:
+                print("No perfect hash found for " + str(keys))
+                exit()
+
+        disp[b] = d
+        for i, p in zip(buckets[b], pos):
+            slots[p] = i
+
+    return disp, slots
+
+def kwd_parse(path):
+    sets = []
+    for line in open(path, 'r'):
+        line = line.split("#")[0].strip()
+        if line == "":
+            continue
+        if line.startswith("["):
+            sets.append((line.strip("[]"), []))
+        else:
+            key, value = line.split(None, 1)
+            sets[-1][1].append((key, value.strip()))
+    return sets
+
+def kwd_array(out, decl, items):
+    out.write(decl + " = {\n")
+    for i, item in enumerate(items):
+        sep = "," if i < len(items) - 1 else ""
+        out.write("        " + item + sep + "\n")
+    out.write("};\n\n")
+
+def kwd_generate(spec, path):
+    out = open(path, 'w')
+    out.write("/*\n")
+    out.write(" * Generated by build.py from " + os.path.basename(spec) +
+              ", do not edit!\n")
+    out.write(" */\n\n")
+    out.write("#include \"patchy.h\"\n")
+    out.write("#include \"patchy_internal.h\"\n\n")
+
+    for name, entries in kwd_parse(spec):
+        keys = [k for k, v in entries]
+        disp, slots = kwd_build(keys)
+
+        kwd_array(out, "static const u16 kwd_" + name + "_disp[]",
+                  [str(d) for d in disp])
+        kwd_array(out, "static const char *const kwd_" + name + "_keys[]",
+                  ["\"" + keys[i] + "\"" for i in slots])
+        kwd_array(out, "static const s32 kwd_" + name + "_values[]",
+                  [entries[i][1] for i in slots])
+
+        out.write("const struct pa_keyword_set pa_kwd_" + name + " = {\n")
+        out.write("        " + str(len(keys)) + ", " + str(len(disp)) + ",\n")
+        out.write("        kwd_" + name + "_disp,\n")
+        out.write("        kwd_" + name + "_keys,\n")
+        out.write("        kwd_" + name + "_values\n")
+        out.write("};\n\n")
+
+    out.close()
+
 # Main start
 # ==========
 
@@ -104,6 +244,11 @@ while cur_arg < len(sys.argv):
     elif sys.argv[cur_arg] == "--outro":
         cur_arg += 1
         outro_files = parse_files(sys.argv[cur_arg])
+    elif sys.argv[cur_arg] == "--keywords":
+        # Generate right away, so <out> can be used in the following lists
+        cur_arg += 1
+        spec, path = sys.argv[cur_arg].split(":")
+        kwd_generate(spec, path)
     else:
         print("Unknown argument " + sys.argv[cur_arg])
 
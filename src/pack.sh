@@ -8,4 +8,4 @@ else
     PYTHON=python
 fi
 
-$PYTHON build.py --macro PA --pub patchy.h --priv patchy_internal.h,patchy_component.c,patchy_document.c,patchy_element.c,patchy_helper.c,patchy_memory.c,patchy_string.c
+$PYTHON build.py --macro PA --pub patchy.h --keywords patchy_keyword.txt:patchy_keyword.c --priv patchy_internal.h,patchy_keyword.c,patchy_component.c,patchy_document.c,patchy_element.c,patchy_helper.c,patchy_memory.c,patchy_string.c
@@ -64,7 +64,8 @@ typedef double                  f64;
 enum pa_memory_mode {
         PA_MEM_UDEF     = -1,
         PA_DYNAMIC      =  0,
-        PA_FIXED        =  1
+        PA_FIXED        =  1,
+        PA_MAPPED       =  2
 };
 
 enum pa_tag_type {
@@ -77,6 +78,12 @@ enum pa_tag_type {
         PA_CUSTOM       = 6
 };
 
+enum pa_number_type {
+        PA_UNSIGNED     = 0,
+        PA_SIGNED       = 1,
+        PA_FLOAT        = 2
+};
+
 /* 
  * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
  *
@@ -532,290 +539,1651 @@ PA_API void paApplyList(struct pa_list *lst, pa_list_func fnc, void *pass);
 PA_API void paApplyListBack(struct pa_list *lst, pa_list_func fnc, void *pass);
 
 /*
- * -----------------------------------------------------------------------------
- *
- *      Dictionary
+ * The compare-function used to order entries. It should return a negative
+ * number if a comes before b, a positive number if a comes after b and 0 if
+ * they're equal.
+ */
+typedef s32 (*pa_list_compare)(void *a, void *b);
+
+/*
+ * Sort all entries in the list using introsort. The entries are ordered using
+ * quicksort, which falls back to heapsort if the recursion gets too deep and
+ * uses insertion sort for small ranges. The sorting is not stable.
  *
- * When pushing a new key-value-pair into the dictionary, the key is hashed and
- * the new entry consisting of the key and value memory is pushed with a next
- * value into the dictionary-buffer. The entry will then be put into one of the
- * buckets depending on the hash and attached to the last entry in the bucket by
- * updating it's next value.
+ * @lst: Pointer to the list
+ * @cmp: The compare-function
+ */
+PA_API void paSortList(struct pa_list *lst, pa_list_compare cmp);
+
+/*
+ * Sort all entries in the list by an integer-key stored in every entry using
+ * an in-place radix sort. The key is read from the given offset in the entry,
+ * and has to be 1, 2, 4 or 8 bytes wide. No compare-function is needed, so
+ * this is a lot faster than paSortList() for integer-keys.
  *
- * The dictionary-buffer looks like this:
+ * Example on how to sort elements by the parent-index:
+ * ...
+ * paSortListKey(&lst, offsetof(struct pa_element, parent), 2, 1);
+ * ...
  *
- *   ... <next><hash><key><value> <next><hash><key><value> ...
+ * @lst: Pointer to the list
+ * @off: The offset of the key in the entry in bytes
+ * @size: The size of the key in bytes
+ * @sign: 1 if the key is a signed integer and 0 if not
  *
- * The next-value is a short, the hash is an unsigned short, the key is defined
- * via PA_DICT_KEY_SIZE and the value-size is set during initialization.
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSortListKey(struct pa_list *lst, s16 off, s16 size, s8 sign);
+
+/*
+ * Find the first entry in the sorted list, which does not come before the key.
  *
- * To mark a entry-slot as not-used the next is set to -1. To identify the
- * end of the bucket, the next is set to -(bucket_number + 2).
+ * @lst: Pointer to the sorted list
+ * @key: Pointer to an entry to compare against
+ * @cmp: The compare-function
  *
- * To search for an entry in the dictionary, we again hash the key, determine
- * the right bucket and then jump from entry to entry to find the right one like
- * in a linked list.
+ * Returns: The index of the entry or the number of entries if all entries
+ *          come before the key
  */
+PA_API s16 paLowerBoundList(struct pa_list *lst, void *key,
+                pa_list_compare cmp);
 
-#define PA_DICT_NEXT_SIZE 2
-#define PA_DICT_HASH_SIZE 2
-#define PA_DICT_KEY_SIZE  32
-#define PA_DICT_HEAD_SIZE (PA_DICT_NEXT_SIZE+PA_DICT_HASH_SIZE+PA_DICT_KEY_SIZE)
-#define PA_DICT_BUCKETS   8
-
-struct pa_dictionary {
-        struct pa_memory *memory;
-        enum pa_memory_mode mode;
+/*
+ * Find the first entry in the sorted list, which comes after the key.
+ *
+ * @lst: Pointer to the sorted list
+ * @key: Pointer to an entry to compare against
+ * @cmp: The compare-function
+ *
+ * Returns: The index of the entry or the number of entries if no entry comes
+ *          after the key
+ */
+PA_API s16 paUpperBoundList(struct pa_list *lst, void *key,
+                pa_list_compare cmp);
 
-        s32 value_size; /* The size of the value-part in bytes */
-        s32 entry_size; /* The size of the header and value */
+/*
+ * Insert an entry into the sorted list, so the list stays sorted. The entry
+ * will be inserted after all equal entries.
+ *
+ * @lst: Pointer to the sorted list
+ * @src: Pointer to the entry to insert
+ * @cmp: The compare-function
+ *
+ * Returns: The index of the new entry or -1 if an error occurred
+ */
+PA_API s16 paInsertListSorted(struct pa_list *lst, void *src,
+                pa_list_compare cmp);
 
-        s16 number;   /* Number of active entries in the dictionary */
-        s16 alloc;    /* Number of slots of entries in the dictionary */  
-        u8 *buffer;   /* Memory-buffer to store the entries */
+/*
+ * Merge two sorted lists and append the result to the destination-list. All
+ * three lists need to have the same entry-size and the destination-list has to
+ * be a different list than the sources. If the destination-list is configured
+ * as static, only as many entries are written as fit into the list.
+ *
+ * @dst: Pointer to the destination-list
+ * @a: Pointer to the first sorted list
+ * @b: Pointer to the second sorted list
+ * @cmp: The compare-function
+ *
+ * Returns: The number of entries written or -1 if an error occurred
+ */
+PA_API s16 paMergeList(struct pa_list *dst, struct pa_list *a,
+                struct pa_list *b, pa_list_compare cmp);
 
-        /* 
-         * All buckets containing the index for their first entry in the
-         * dictionary-buffer.
-         */
-        s16 buckets[PA_DICT_BUCKETS];
-};
+/*
+ * Find the first entry equal to the key, starting from the given index. For
+ * entries with a size of 1, 2, 4 or 8 bytes, SIMD-instructions are used if
+ * available. All other entries are compared byte by byte.
+ *
+ * @lst: Pointer to the list
+ * @key: Pointer to an entry to look for
+ * @start: The index to start searching from
+ *
+ * Returns: The index of the first matching entry or -1 if there is none
+ */
+PA_API s16 paFindList(struct pa_list *lst, void *key, s16 start);
 
-struct pa_dictionary_entry {
-        char key[PA_DICT_KEY_SIZE];
-        void *value;
-};
+/*
+ * Find all entries equal to the key and push their indices as shorts to the
+ * output-list.
+ *
+ * @lst: Pointer to the list
+ * @key: Pointer to an entry to look for
+ * @out: Pointer to a list with an entry-size of 2 bytes
+ *
+ * Returns: The number of matching entries or -1 if an error occurred
+ */
+PA_API s16 paFindListAll(struct pa_list *lst, void *key, struct pa_list *out);
 
 /*
- * Initialize the dictionary, link to the memory-manager and preallocate the
- * specified number of entries.
+ * Count all entries in the list equal to the key.
  *
- * @dct: Pointer to the dictionary
- * @mem: Pointer to the memory-manager
- * @size: The size of the value-part in bytes
- * @alloc: The number of entries to preallocate
+ * @lst: Pointer to the list
+ * @key: Pointer to an entry to look for
  *
- * Returns: 0 on success or -1 if an error occurred
+ * Returns: The number of matching entries
  */
-PA_API s8 paInitDictionary(struct pa_dictionary *dct, struct pa_memory *mem,
-                s32 size, s16 alloc);
+PA_API s16 paCountList(struct pa_list *lst, void *key);
 
 /*
- * Initialize the dictionary using static memory, and prepare the
- * dictionary-buffer.
+ * Set a range of entries to the given value. If the range reaches past the end
+ * of the list, the list will grow to fit the range, if configured as dynamic.
  *
- * @dic: Pointer to the dictionary
- * @buffer: The buffer to use to store the entries
- * @buf_sz: The size of the buffer in bytes
- * @value_sz: The size of the value-part in bytes
+ * @lst: Pointer to the list
+ * @src: Pointer to the value to write to every entry
+ * @start: The index of the first entry
+ * @num: The number of entries to set, use PA_ALL to fill all entries from
+ *       start to the end of the list
  *
- * Returns: 0 on success or -1 if an error occurred
+ * Returns: The number of entries set or -1 if an error occurred
  */
-PA_API s8 paInitDictionaryFixed(struct pa_dictionary *dct, void *buffer,
-                s32 buf_sz, s32 value_sz);
+PA_API s16 paFillList(struct pa_list *lst, void *src, s16 start, s16 num);
 
 /*
- * Destroy the dictionary, reset all attributes and if configured as dynamic,
- * free the allocated memory.
+ * Find the smallest and the biggest entry in a list of numbers. Integers can
+ * be 1, 2, 4 or 8 bytes wide, floats 4 or 8 bytes.
  *
- * @dct: Pointer to the dictionary
+ * @lst: Pointer to the list
+ * @type: The type of the numbers in the list
+ * @[min]: A pointer to write the smallest entry to
+ * @[max]: A pointer to write the biggest entry to
+ *
+ * Returns: 0 on success or -1 if the list is empty or the entry-size is not
+ *          supported
  */
-PA_API void paDestroyDictionary(struct pa_dictionary *dct);
+PA_API s8 paMinMaxList(struct pa_list *lst, enum pa_number_type type,
+                void *min, void *max);
 
 /*
- * Set a key-value-pair in the dictionary. If the key already exists then
- * overwrite it. If it does not yet exist, create it. This function will copy
- * over the memory into the buffer.
+ * -----------------------------------------------------------------------------
  *
- * @dct: Pointer to the dictionary
- * @key: Pointer to the key
- * @value: Pointer to the value
+ *      SMALL-LIST
  *
- * Returns: Either 0 on success or -1 if an error occurred
+ * The small-list is a list with an inline buffer of PA_SMALL_LIST_SIZE bytes
+ * embedded into the struct. As long as the entries fit into the inline buffer,
+ * no memory will be allocated. Only once the inline buffer overflows, the
+ * entries are moved to memory allocated from the memory-manager and the list
+ * behaves like a normal dynamic list.
+ *
+ * The wrapped list can be passed to all list-functions which don't add entries,
+ * like paIterateList(), paPeekList() or paSortList(). Use the small-list
+ * functions to add entries, so the list can spill to the heap.
+ *
+ * As the list points into its own struct, a small-list must not be copied or
+ * moved after initialization!
  */
-PA_API s8 paSetDictionary(struct pa_dictionary *dct, char *key, void *value);
+
+#ifndef PA_SMALL_LIST_SIZE
+#define PA_SMALL_LIST_SIZE      64
+#endif
+
+struct pa_small_list {
+        struct pa_list list;            /* The wrapped list */
+        struct pa_memory *spill;        /* Memory-manager used on overflow */
+
+        /* The inline buffer, aligned by the union */
+        union {
+                u8      bytes[PA_SMALL_LIST_SIZE];
+                f64     align_f64;
+                void    *align_ptr;
+                s64     align_s64;
+        } inline_buffer;
+};
 
 /*
- * Retrieve an entry from the dictionary by searching for the key. To do so, the
- * key will be hashed and the proper bucket determined. Then the function will
- * go through all entries in the bucked until the requested entry is found.
+ * Initialize the small-list on top of the inline buffer. No memory will be
+ * allocated. If no memory-manager is given, the list will never spill and just
+ * stop accepting entries once the inline buffer is full.
  *
- * @dct: Pointer to the dictionary
- * @key: Pointer to the key to look for
- * @dst: A pointer to write the entry for the key to
+ * @lst: Pointer to the small-list
+ * @[mem]: Pointer to the memory-manager used once the inline buffer overflows
+ * @size: The size of a single entry in bytes
  *
- * Returns: 1 if the entry has been found, 0 if not and -1 if an error occurred
+ * Returns: 0 on success or -1 if an error occurred
  */
-PA_API s8 paGetDictionary(struct pa_dictionary *dct, char *key, void *out);
+PA_API s8 paInitSmallList(struct pa_small_list *lst, struct pa_memory *mem,
+                s16 size);
 
 /*
- * Remove an entry from the dictionary and open up the slot. The memory in the
- * entry will be lost!
+ * Destroy the small-list and free the memory, if the list has spilled.
  *
- * @dct: Pointer to the dictionary
- * @key: The key of the entry
+ * @lst: Pointer to the small-list
  */
-PA_API void paRemoveDictionary(struct pa_dictionary *dct, char *key);
+PA_API void paDestroySmallList(struct pa_small_list *lst);
 
 /*
- * This function allows the iteration of every entry in every bucket. The basic
- * principal is passing a pointer to the current entry and getting the
- * entry-data and pointer for the next entry. Note that this function goes from
- * bucket to bucket, so it will not return the entries in respect to when they
- * have been added.
+ * Remove all entries from the small-list. If the list has spilled, the
+ * allocated memory will be kept.
  *
- * Here's an example of how to use the function:
- * ...
- * struct pa_dictionary dict;
- * struct pa_dictionary_entry ent;
- * void *ptr = NULL;
- * ...
- * while((ptr = paIterateDictionary(&dict, ptr, &ent))) {
- *      ..Do something with the entry...
- * }
- * ...
+ * @lst: Pointer to the small-list
+ */
+PA_API void paClearSmallList(struct pa_small_list *lst);
+
+/*
+ * Append entries to the end of the small-list. Works like paPushList(), but
+ * the list will spill to the heap if the inline buffer is full.
  *
- * @dct: Pointer to the dictionary
- * @ptr: The runing pointer used to iterate(pass NULL at the start)
- * @ent: A pointer to write the entry data to
+ * @lst: Pointer to the small-list
+ * @src: Pointer to the data to write to the list
+ * @num: The number of entries to push to the list
  *
- * Returns: The pointer for the current entry in the dictionary-buffer or NULL
- *          if this is the last entry in the dictionary
+ * Returns: The number of entries written to the list or -1 if an error occurred
  */
-PA_API void *paIterateDictionary(struct pa_dictionary *dct, void *ptr, 
-                struct pa_dictionary_entry *ent);
+PA_API s16 paPushSmallList(struct pa_small_list *lst, void *src, s16 num);
 
 /*
- * Iterate through all entries in a bucket.
+ * Pop entries from the end of the small-list. Works like paPopList().
  *
- * Here's an example of how to use the function to iterate through bucket 2:
- * ...
- * struct pa_dictionary dict;
- * struct pa_dictionary_entry ent;
- * void *ptr = NULL;
- * ...
- * while((ptr = paIterateDictionaryBucket(&dict, 2, ptr, &ent))) {
- *      ..Do something with the entry...
- * }
- * ...
+ * @lst: Pointer to the small-list
+ * @dst: A pointer to write the entries to
+ * @num: The number of entries to pop from the list
  *
- * @dct: Pointer to the dictionary
- * @bucket: The bucket to iterate through
- * @ptr: The running pointer used to iterate(pass NULL at start)
- * @ent: A pointer to write the entry data to
+ * Returns: The number of entries popped from the list or -1 if an error
+ *          occurred
+ */
+PA_API s16 paPopSmallList(struct pa_small_list *lst, void *dst, s16 num);
+
+/*
+ * Insert entries into the small-list at a certain position. Works like
+ * paInsertList(), but the list will spill to the heap if the inline buffer is
+ * full.
  *
- * Returns: The pointer for the current entry in the dictionary-buffer or NULL
- *          if this is the last entry in the bucket
+ * @lst: Pointer to the small-list
+ * @src: Pointer to copy the entries from
+ * @start: The starting index to insert the entries to
+ * @num: The number of entries to insert
+ *
+ * Returns: The number of entries written to the list or -1 if an error occurred
  */
-PA_API void *paIterateDictionaryBucket(struct pa_dictionary *dct, s16 bucket,
-                void *ptr, struct pa_dictionary_entry *ent);
+PA_API s16 paInsertSmallList(struct pa_small_list *lst, void *src, s16 start,
+                s16 num);
 
 /*
- * -----------------------------------------------------------------------------
+ * Get a pointer to the next entry in the small-list. Works like
+ * paIterateList().
  *
- *      TABLE
+ * @lst: Pointer to the small-list
+ * @ptr: The current pointer, pass NULL for the first step
  *
- * When pushing a new key-value-pair into the table, the key is hashed and
- * the new entry consisting of the key and value memory is pushed with a next
- * value into the table-buffer. The entry will then be put into one of the
- * buckets depending on the hash and attached to the last entry in the bucket by
- * updating it's next value.
+ * Returns: A pointer to the next entry or NULL if there are no more entries
+ */
+PA_API void *paIterateSmallList(struct pa_small_list *lst, void *ptr);
+
+/*
+ * -----------------------------------------------------------------------------
  *
- * The table-buffer looks like this:
+ *      COLUMN-LIST
  *
- *   ... <next><hash><key><value> <next><hash><key><value> ...
+ * The column-list stores every field of an entry in its own column instead of
+ * storing whole entries one after another(structure of arrays). Iterating over
+ * a single field then only touches the memory of that field. All columns share
+ * the same count and capacity and live in a single memory-buffer:
  *
- * The next-value is a short, the hash is an unsigned short, the key and the 
- * value-size is set during initialization.
+ *   <column 0: field 0 of all rows> <column 1: field 1 of all rows> ...
  *
- * To mark a entry-slot as not-used the next is set to -1. To identify the
- * end of the bucket, the next is set to -(bucket_number + 2).
+ * Every column starts at an address aligned to PA_COLUMN_ALIGN bytes, so
+ * the columns can be processed using SIMD-instructions.
  *
- * To search for an entry in the dictionary, we again hash the key, determine
- * the right bucket and then jump from entry to entry to find the right one like
- * in a linked list.
+ * Rows are passed in and out as packed rows, where the fields are written
+ * one after another in the order of the columns without any padding.
  */
 
+#define PA_COLUMNS_MAX          16
+#define PA_COLUMN_ALIGN         16
 
-#define PA_TBL_NEXT_SIZE 2
-#define PA_TBL_HASH_SIZE 2
-#define PA_TBL_HEAD_SIZE (PA_TBL_NEXT_SIZE+PA_TBL_HASH_SIZE)
-#define PA_TBL_BUCKETS   8
-
-struct pa_table {
+struct pa_column_list {
         struct pa_memory *memory;
         enum pa_memory_mode mode;
 
-        s32 key_size;   /* The size of the key in bytes */
-        s32 value_size; /* The size of the value-part in bytes */
-        s32 entry_size; /* The size of the header, key and value in bytes */
-
-        s16 number;   /* Number of active entries in the table */
-        s16 alloc;    /* Number of slots of entries in the table */  
-        u8 *buffer;   /* Memory-buffer to store the entries */
+        u8 *buffer;     /* The buffer containing all columns */
+        s32 buffer_size;/* The size of the buffer in bytes */
 
-        /* 
-         * All buckets containing the index for their first entry in the
-         * table-buffer.
-         */
-        s16 buckets[PA_TBL_BUCKETS];
-};
+        s16 columns;                    /* The number of columns */
+        s16 sizes[PA_COLUMNS_MAX];      /* The size of a field in bytes */
+        u8 *data[PA_COLUMNS_MAX];       /* Pointers to the columns */
+        s16 row_size;   /* The size of a packed row in bytes */
 
-struct pa_table_entry {
-        void *key;
-        void *value;
+        s16 count;  /* Number of used rows */
+        s16 alloc;  /* Number of allocated rows */
 };
 
 /*
- * Initialize the table, link to the memory-manager and preallocate the
- * specified number of entries.
+ * Initialize the column-list and preallocate the requested number of rows.
+ * The list will scale to fit all new rows. After use call
+ * paDestroyColumnList() to prevent memory leaks.
  *
- * @tbl: Pointer to the table
+ * Example on how to store the parent and the name of elements:
+ * ...
+ * struct pa_column_list lst;
+ * s16 sizes[2] = {sizeof(s16), PA_ELEMENT_NAME_MAX};
+ * paInitColumnList(&lst, &mem, sizes, 2, 128);
+ * ...
+ *
+ * @lst: Pointer to the column-list
  * @mem: Pointer to the memory-manager
- * @key_sz: The size of the key in bytes
- * @value_sz: The size of the value in bytes
- * @alloc: The number of entries to preallocate
+ * @sizes: The size of the field in every column in bytes
+ * @columns: The number of columns
+ * @alloc: The initial number of rows to preallocate
  *
  * Returns: 0 on success or -1 if an error occurred
  */
-PA_API s8 paInitTable(struct pa_table *tbl, struct pa_memory *mem,
-                s32 key_sz, s32 value_sz, s16 alloc);
+PA_API s8 paInitColumnList(struct pa_column_list *lst, struct pa_memory *mem,
+                s16 *sizes, s16 columns, s16 alloc);
 
 /*
- * Initialize the table using static memory, and prepare the
- * table-buffer.
+ * Create a static column-list on top of the given buffer. The number of rows
+ * is calculated from the size of the buffer.
+ * After use call paDestroyColumnList() and then free the memory yourself.
  *
- * @dic: Pointer to the table
- * @buffer: The buffer to use to store the entries
- * @buf_sz: The size of the buffer in bytes
- * @value_sz: The size of the value-part in bytes
+ * @lst: Pointer to the column-list
+ * @sizes: The size of the field in every column in bytes
+ * @columns: The number of columns
+ * @buf: The buffer to store the columns in
+ * @buf_sz: The size of the given buffer in bytes
  *
  * Returns: 0 on success or -1 if an error occurred
  */
-PA_API s8 paInitTableFixed(struct pa_table *tbl, void *buffer,
-                s32 buf_sz, s32 key_sz, s32 value_sz);
+PA_API s8 paInitColumnListFixed(struct pa_column_list *lst, s16 *sizes,
+                s16 columns, void *buf, s32 buf_sz);
 
 /*
- * Destroy the table, reset all attributes and if configured as dynamic,
- * free the allocated memory.
+ * Destroy the column-list and free the allocated memory.
  *
- * @tbl: Pointer to the table
+ * @lst: Pointer to the column-list
  */
-PA_API void paDestroyTable(struct pa_table *tbl);
+PA_API void paDestroyColumnList(struct pa_column_list *lst);
 
 /*
- * Set a key-value-pair in the table. If the key already exists then
- * overwrite it. If it does not yet exist, create it. This function will copy
- * over the memory into the buffer.
- *
- * @tbl: Pointer to the table
- * @key: Pointer to the key
- * @value: Pointer to the value
+ * Remove all rows from the column-list. This will not free memory.
  *
- * Returns: Either 0 on success or -1 if an error occurred
+ * @lst: Pointer to the column-list
+ */
+PA_API void paClearColumnList(struct pa_column_list *lst);
+
+/*
+ * Append a packed row to the end of the column-list. If the list is configured
+ * as dynamic, it will scale to fit the new row. Note that this will move the
+ * columns, so pointers from paGetColumn() become invalid.
+ *
+ * @lst: Pointer to the column-list
+ * @src: Pointer to the packed row
+ *
+ * Returns: 1 if the row has been written and 0 if the list is full
+ */
+PA_API s8 paPushColumnList(struct pa_column_list *lst, void *src);
+
+/*
+ * Pop the last row from the column-list and write it to the given pointer as
+ * a packed row.
+ *
+ * @lst: Pointer to the column-list
+ * @[dst]: A pointer to write the packed row to
+ *
+ * Returns: 1 if a row has been popped and 0 if the list is empty
+ */
+PA_API s8 paPopColumnList(struct pa_column_list *lst, void *dst);
+
+/*
+ * Remove a row from the column-list by moving the last row into the gap. This
+ * is O(1) but it will change the order of the rows.
+ *
+ * @lst: Pointer to the column-list
+ * @idx: The index of the row to remove
+ * @[dst]: A pointer to write the packed row to
+ *
+ * Returns: 1 if the row has been removed and 0 if the index is out of range
+ */
+PA_API s8 paRemoveColumnList(struct pa_column_list *lst, s16 idx, void *dst);
+
+/*
+ * Copy a whole row from the column-list without removing it.
+ *
+ * @lst: Pointer to the column-list
+ * @dst: A pointer to write the packed row to
+ * @idx: The index of the row
+ *
+ * Returns: 1 if the row has been copied and 0 if the index is out of range
+ */
+PA_API s8 paPeekColumnList(struct pa_column_list *lst, void *dst, s16 idx);
+
+/*
+ * Overwrite a whole row in the column-list.
+ *
+ * @lst: Pointer to the column-list
+ * @src: Pointer to the packed row
+ * @idx: The index of the row
+ *
+ * Returns: 1 if the row has been written and 0 if the index is out of range
+ */
+PA_API s8 paWriteColumnList(struct pa_column_list *lst, void *src, s16 idx);
+
+/*
+ * Get a pointer to the beginning of a column. The fields of all rows are
+ * stored one after another, so the column can be used like an array. The
+ * pointer is valid until the list scales to fit new rows.
+ *
+ * @lst: Pointer to the column-list
+ * @col: The index of the column
+ *
+ * Returns: A pointer to the column or NULL if the column doesn't exist
+ */
+PA_API void *paGetColumn(struct pa_column_list *lst, s16 col);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      WORKER-POOL
+ *
+ * The worker-pool is used to call a callback-function on the entries of a list
+ * in parallel. The list is split into one range per thread and every thread
+ * processes its range in pieces of grain entries. Once a thread is done with
+ * its own range, it steals the back half of the biggest range left, so uneven
+ * callbacks are balanced out. Every entry is passed to exactly one call.
+ *
+ * Threads are only used if the framework is compiled with PA_PTHREADS defined
+ * and linked against pthreads. Otherwise the pool has no threads and all
+ * functions will just work serially.
+ */
+
+#define PA_WORKER_GRAIN         64
+
+struct pa_worker_pool {
+        struct pa_memory *memory;
+
+        s16 number;     /* The number of worker threads */
+        s32 grain;      /* The number of entries to process in one piece */
+
+        void *state;    /* Internal state shared with the threads */
+};
+
+/*
+ * Initialize the worker-pool and start the requested number of threads. The
+ * calling thread will also take part in the work, so for N cores request N-1
+ * threads.
+ *
+ * @pool: Pointer to the worker-pool
+ * @mem: Pointer to the memory-manager
+ * @threads: The number of worker threads to start
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitWorkerPool(struct pa_worker_pool *pool, struct pa_memory *mem,
+                s16 threads);
+
+/*
+ * Stop all threads and free the allocated memory.
+ *
+ * @pool: Pointer to the worker-pool
+ */
+PA_API void paDestroyWorkerPool(struct pa_worker_pool *pool);
+
+/*
+ * Call a callback-function on every entry in the list using all threads of the
+ * worker-pool. The order of the calls is undefined and calls happen at the same
+ * time, so the callback-function must only modify the entry it's given. If the
+ * callback-function returns 1, no new pieces will be started, but pieces
+ * already in progress are finished. Otherwise the callback-function should
+ * always return 0. The function returns once all calls are done.
+ *
+ * @lst: Pointer to the list
+ * @pool: Pointer to the worker-pool
+ * @fnc: The callback function
+ * @pass: A pointer that will be passed onto every function-call
+ */
+PA_API void paApplyListParallel(struct pa_list *lst,
+                struct pa_worker_pool *pool, pa_list_func fnc, void *pass);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      CHUNK-LIST
+ *
+ * The chunk-list stores its entries in fixed-size chunks instead of a single
+ * buffer. If more memory is needed, a new chunk is appended, so the existing
+ * entries never have to be moved and pointers to them stay valid until they're
+ * removed from the list.
+ *
+ * The pointers to the chunks are kept in a list:
+ *
+ *   chunks: <chunk 0><chunk 1><chunk 2>...
+ *
+ * Every chunk holds the same number of entries. The entry with the index i
+ * therefore lives in chunk (i / chunk_entries) at slot (i % chunk_entries).
+ * Chunks are never freed when removing entries, they're reused instead.
+ */
+
+struct pa_chunk_list {
+        struct pa_memory *memory;
+        enum pa_memory_mode mode;
+
+        struct pa_list chunks;  /* Pointers to all allocated chunks */
+
+        s16 entry_size;    /* The size of a slot in bytes */
+        s16 chunk_entries; /* The number of slots in a single chunk */
+
+        s16 count;         /* Number of used slots */
+};
+
+/*
+ * Initialize the chunk-list and preallocate enough chunks to fit the requested
+ * number of entries. The list will append new chunks to fit all new entries.
+ * After use call paDestroyChunkList() to prevent memory leaks.
+ *
+ * @lst: Pointer to the chunk-list
+ * @mem: Pointer to the memory-manager
+ * @size: The size of a single entry in bytes
+ * @chunk: The number of entries in a single chunk
+ * @alloc: The initial number of entries to preallocate
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitChunkList(struct pa_chunk_list *lst, struct pa_memory *mem,
+                s16 size, s16 chunk, s16 alloc);
+
+/*
+ * Create a static chunk-list on top of the given buffer. The buffer will be
+ * split up into as many chunks as fit, and no more chunks will be added once
+ * all of them are full.
+ * After use call paDestroyChunkList() and then free the memory yourself.
+ *
+ * @lst: Pointer to the chunk-list
+ * @size: The size of a single entry in bytes
+ * @chunk: The number of entries in a single chunk
+ * @buf: The buffer to store the chunks in
+ * @buf_sz: The size of the given buffer in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitChunkListFixed(struct pa_chunk_list *lst, s16 size, s16 chunk,
+                void *buf, s32 buf_sz);
+
+/*
+ * Destroy the chunk-list and free all allocated chunks.
+ *
+ * @lst: Pointer to the chunk-list
+ */
+PA_API void paDestroyChunkList(struct pa_chunk_list *lst);
+
+/*
+ * Remove all entries from the chunk-list. The chunks will be kept for reuse.
+ *
+ * @lst: Pointer to the chunk-list
+ */
+PA_API void paClearChunkList(struct pa_chunk_list *lst);
+
+/*
+ * Append entries to the end of the chunk-list. If the list is configured as
+ * dynamic, new chunks will be allocated to fit all entries. The entries already
+ * in the list will not be moved.
+ *
+ * @lst: Pointer to the chunk-list
+ * @src: Pointer to the data to write to the list
+ * @num: The number of entries to push to the list
+ *
+ * Returns: The number of entries written to the list or -1 if an error occurred
+ */
+PA_API s16 paPushChunkList(struct pa_chunk_list *lst, void *src, s16 num);
+
+/*
+ * Pop entries from the end of the chunk-list and write them to the given
+ * pointer.
+ *
+ * @lst: Pointer to the chunk-list
+ * @dst: A pointer to write the entries to
+ * @num: The number of entries to pop from the list
+ *
+ * Returns: The number of entries popped from the list or -1 if an error
+ *          occurred
+ */
+PA_API s16 paPopChunkList(struct pa_chunk_list *lst, void *dst, s16 num);
+
+/*
+ * Get a pointer to the entry at the given index. The pointer stays valid until
+ * the entry is popped from the list.
+ *
+ * @lst: Pointer to the chunk-list
+ * @idx: The index of the entry
+ *
+ * Returns: A pointer to the entry or NULL if the index is out of range
+ */
+PA_API void *paIndexChunkList(struct pa_chunk_list *lst, s16 idx);
+
+/*
+ * Get a pointer to the beginning of a chunk and the number of used entries in
+ * it. The entries in a chunk are contiguous, so this can be used to process the
+ * list chunk by chunk.
+ *
+ * @lst: Pointer to the chunk-list
+ * @chunk: The number of the chunk
+ * @num: A pointer to write the number of used entries in the chunk to
+ *
+ * Returns: A pointer to the first entry in the chunk or NULL if the chunk is
+ *          empty
+ */
+PA_API void *paSpanChunkList(struct pa_chunk_list *lst, s16 chunk, s16 *num);
+
+/*
+ * Get a pointer to the next entry in the chunk-list. As the chunks are not
+ * contiguous, the handle is used to keep track of the position. Before the
+ * first step, set the pointer of the handle to NULL.
+ * Example on how to iterate through the whole list:
+ * ...
+ * struct pa_chunk_list lst;
+ * struct pa_handle hdl;
+ * void *ptr;
+ * ...
+ * hdl.pointer = NULL;
+ * while((ptr = paIterateChunkList(&lst, &hdl))) {
+ *      ..Do something with ptr..
+ * }
+ * ...
+ *
+ * @lst: Pointer to the chunk-list
+ * @hdl: The handle used to keep track of the position
+ *
+ * Returns: A pointer to the next entry or NULL if there are no more entries
+ */
+PA_API void *paIterateChunkList(struct pa_chunk_list *lst,
+                struct pa_handle *hdl);
+
+/*
+ * Call a callback-function on every entry in the chunk-list. If the
+ * callback-function returns 1 the loop will stop. Otherwise the
+ * callback-function should always return 0.
+ *
+ * @lst: Pointer to the chunk-list
+ * @fnc: The callback function
+ * @pass: A pointer that will be passed onto every function-call
+ */
+PA_API void paApplyChunkList(struct pa_chunk_list *lst, pa_list_func fnc,
+                void *pass);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      SLOTMAP
+ *
+ * The slotmap hands out stable handles for entries, which stay valid no matter
+ * how many other entries are inserted or removed. The entries themselves are
+ * kept densely packed in a list, so iterating over them is as fast as for a
+ * normal list.
+ *
+ * Internally there are three lists:
+ *
+ *   data:  <entry><entry><entry>...          The dense entries
+ *   slots: <index><generation>...            One slot per handed out handle
+ *   owner: <slot><slot><slot>...             The slot for every dense entry
+ *
+ * A used slot contains the index of the entry in the data-list. A free slot
+ * contains the index of the next free slot, or -1 for the end of the
+ * free-list. The generation of a slot is incremented every time the slot is
+ * used or freed, so used slots have an odd generation and free slots an even
+ * one. Old handles to a slot can therefore be detected as stale.
+ *
+ * Entries are removed by moving the last entry into the gap, so removing is
+ * O(1), but pointers to the entries might change. Keep the handles instead!
+ */
+
+#define PA_SLOT_SIZE    4
+
+struct pa_slot {
+        s16     index;          /* Index of the entry or next free slot */
+        u16     generation;     /* Incremented every time the slot is freed */
+};
+
+struct pa_slot_handle {
+        s16     index;          /* The index of the slot */
+        u16     generation;     /* The generation of the slot */
+};
+
+struct pa_slotmap {
+        struct pa_list data;    /* The dense entries */
+        struct pa_list slots;   /* The slots referenced by handles */
+        struct pa_list owner;   /* The slot-index for every dense entry */
+
+        s16 free_head;  /* The first slot in the free-list or -1 */
+};
+
+/*
+ * Initialize the slotmap and preallocate the requested number of entries. The
+ * slotmap will scale to fit all new entries. After use call paDestroySlotMap()
+ * to prevent memory leaks.
+ *
+ * @map: Pointer to the slotmap
+ * @mem: Pointer to the memory-manager
+ * @size: The size of a single entry in bytes
+ * @alloc: The initial number of entries to preallocate
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitSlotMap(struct pa_slotmap *map, struct pa_memory *mem,
+                s16 size, s16 alloc);
+
+/*
+ * Create a static slotmap on top of the given buffer. The buffer will be split
+ * up between the entries, the slots and the owner-indices, so every entry
+ * needs (size + PA_SLOT_SIZE + 2) bytes.
+ * After use call paDestroySlotMap() and then free the memory yourself.
+ *
+ * @map: Pointer to the slotmap
+ * @size: The size of a single entry in bytes
+ * @buf: The buffer to store the slotmap in
+ * @buf_sz: The size of the given buffer in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitSlotMapFixed(struct pa_slotmap *map, s16 size, void *buf,
+                s32 buf_sz);
+
+/*
+ * Destroy the slotmap and free the allocated memory.
+ *
+ * @map: Pointer to the slotmap
+ */
+PA_API void paDestroySlotMap(struct pa_slotmap *map);
+
+/*
+ * Remove all entries from the slotmap. All handles given out so far will be
+ * invalid afterwards. This will not free memory.
+ *
+ * @map: Pointer to the slotmap
+ */
+PA_API void paClearSlotMap(struct pa_slotmap *map);
+
+/*
+ * Copy a new entry into the slotmap and write the handle for it to the given
+ * pointer.
+ *
+ * @map: Pointer to the slotmap
+ * @src: Pointer to the data of the entry
+ * @[out]: A pointer to write the handle to
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInsertSlotMap(struct pa_slotmap *map, void *src,
+                struct pa_slot_handle *out);
+
+/*
+ * Remove the entry referenced by the handle and copy the data to the given
+ * pointer. The last entry will be moved into the gap.
+ *
+ * @map: Pointer to the slotmap
+ * @hdl: The handle of the entry
+ * @[dst]: A pointer to write the entry to
+ *
+ * Returns: 1 if the entry has been removed, 0 if the handle is stale and -1 if
+ *          an error occurred
+ */
+PA_API s8 paRemoveSlotMap(struct pa_slotmap *map, struct pa_slot_handle hdl,
+                void *dst);
+
+/*
+ * Get a pointer to the entry referenced by the handle. The pointer is only
+ * valid until the next insert or remove, so don't store it.
+ *
+ * @map: Pointer to the slotmap
+ * @hdl: The handle of the entry
+ *
+ * Returns: A pointer to the entry or NULL if the handle is stale
+ */
+PA_API void *paLookupSlotMap(struct pa_slotmap *map, struct pa_slot_handle hdl);
+
+/*
+ * Get the handle of an entry from its index in the dense data-list. This is
+ * useful when iterating through the slotmap.
+ *
+ * @map: Pointer to the slotmap
+ * @idx: The index of the entry in the data-list
+ * @out: A pointer to write the handle to
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paHandleSlotMap(struct pa_slotmap *map, s16 idx,
+                struct pa_slot_handle *out);
+
+/*
+ * Get a pointer to the next entry in the slotmap. The entries are stored
+ * densely, so this works the same way as paIterateList(). For the first step
+ * pass NULL for ptr.
+ *
+ * @map: Pointer to the slotmap
+ * @ptr: The current pointer
+ *
+ * Returns: A pointer to the next entry or NULL if there are no more entries
+ */
+PA_API void *paIterateSlotMap(struct pa_slotmap *map, void *ptr);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      HEAP
+ *
+ * The heap is a binary min-heap used as priority-queue. The entry which comes
+ * first according to the compare-function is always on top. The nodes are
+ * stored in a list in the usual array-layout, so the children of the node i
+ * are at 2i+1 and 2i+2.
+ *
+ * Every node looks like this:
+ *
+ *   <entry><padding><slot>
+ *
+ * The node-size is rounded up to keep the entries aligned. Handles work the
+ * same way as for the slotmap: Every pushed entry gets a slot, which contains
+ * the current position of its node, so the key of an entry can be changed
+ * after it has been pushed. Free slots are chained into a free-list. The
+ * generation of a slot is incremented every time the slot is used or freed,
+ * so handles of entries which have already been popped or removed are
+ * detected as stale, even if the slot has been reused since.
+ */
+
+struct pa_heap {
+        struct pa_list nodes;   /* The nodes in heap-order */
+        struct pa_list slots;   /* The slots referenced by handles */
+
+        pa_list_compare compare;
+
+        s16 entry_size; /* The size of an entry in bytes */
+        s16 free_head;  /* The first slot in the free-list or -1 */
+};
+
+/*
+ * Initialize the heap and preallocate the requested number of entries. The
+ * heap will scale to fit all new entries. After use call paDestroyHeap() to
+ * prevent memory leaks.
+ *
+ * @heap: Pointer to the heap
+ * @mem: Pointer to the memory-manager
+ * @size: The size of a single entry in bytes
+ * @alloc: The initial number of entries to preallocate
+ * @cmp: The compare-function used to order the entries
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitHeap(struct pa_heap *heap, struct pa_memory *mem, s16 size,
+                s16 alloc, pa_list_compare cmp);
+
+/*
+ * Create a static heap on top of the given buffer. The buffer is split up
+ * between the nodes and the slots. No more entries can be pushed once the heap
+ * is full.
+ * After use call paDestroyHeap() and then free the memory yourself.
+ *
+ * @heap: Pointer to the heap
+ * @size: The size of a single entry in bytes
+ * @cmp: The compare-function used to order the entries
+ * @buf: The buffer to store the heap in
+ * @buf_sz: The size of the given buffer in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitHeapFixed(struct pa_heap *heap, s16 size, pa_list_compare cmp,
+                void *buf, s32 buf_sz);
+
+/*
+ * Destroy the heap and free the allocated memory.
+ *
+ * @heap: Pointer to the heap
+ */
+PA_API void paDestroyHeap(struct pa_heap *heap);
+
+/*
+ * Remove all entries from the heap. All handles will be invalid afterwards.
+ * This will not free memory.
+ *
+ * @heap: Pointer to the heap
+ */
+PA_API void paClearHeap(struct pa_heap *heap);
+
+/*
+ * Copy a new entry into the heap and write the handle for it to the given
+ * pointer.
+ *
+ * @heap: Pointer to the heap
+ * @src: Pointer to the entry
+ * @[out]: A pointer to write the handle to
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paPushHeap(struct pa_heap *heap, void *src,
+                struct pa_slot_handle *out);
+
+/*
+ * Remove the top entry from the heap and write it to the given pointer. The
+ * handle of the entry is written as well, so it can be dropped by the caller.
+ * Using it afterwards will fail, as it is stale.
+ *
+ * @heap: Pointer to the heap
+ * @[dst]: A pointer to write the entry to
+ * @[out]: A pointer to write the handle of the entry to
+ *
+ * Returns: 1 if an entry has been popped and 0 if the heap is empty
+ */
+PA_API s8 paPopHeap(struct pa_heap *heap, void *dst,
+                struct pa_slot_handle *out);
+
+/*
+ * Copy the top entry without removing it.
+ *
+ * @heap: Pointer to the heap
+ * @dst: A pointer to write the entry to
+ *
+ * Returns: 1 if an entry has been copied and 0 if the heap is empty
+ */
+PA_API s8 paPeekHeap(struct pa_heap *heap, void *dst);
+
+/*
+ * Overwrite the entry referenced by the handle and move it to the right
+ * position. Use this to decrease (or increase) the key of an entry.
+ *
+ * @heap: Pointer to the heap
+ * @hdl: The handle of the entry
+ * @src: Pointer to the new entry
+ *
+ * Returns: 0 on success or -1 if the handle is stale
+ */
+PA_API s8 paUpdateHeap(struct pa_heap *heap, struct pa_slot_handle hdl,
+                void *src);
+
+/*
+ * Remove the entry referenced by the handle from the heap.
+ *
+ * @heap: Pointer to the heap
+ * @hdl: The handle of the entry
+ * @[dst]: A pointer to write the entry to
+ *
+ * Returns: 1 if the entry has been removed, 0 if the handle is stale
+ */
+PA_API s8 paRemoveHeap(struct pa_heap *heap, struct pa_slot_handle hdl,
+                void *dst);
+
+/*
+ * Push many entries at once and restore the heap-order afterwards in O(n)
+ * instead of sifting every single entry.
+ *
+ * @heap: Pointer to the heap
+ * @src: Pointer to the entries
+ * @num: The number of entries
+ * @[out]: An array to write the handle of every pushed entry to
+ *
+ * Returns: The number of entries pushed or -1 if an error occurred
+ */
+PA_API s16 paBuildHeap(struct pa_heap *heap, void *src, s16 num,
+                struct pa_slot_handle *out);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      BITSET
+ *
+ * The bitset stores one bit per index, packed into 32-bit words. It is meant
+ * for flags like dirty- or visibility-markers, which are needed for every
+ * element. Compared to a list of bytes, it only needs an eighth of the memory
+ * and scanning for set bits can skip 32 unset bits at once.
+ *
+ *   words: <bit 0..31><bit 32..63><bit 64..95>...
+ *
+ * In dynamic mode setting a bit beyond the current size will scale the bitset
+ * to fit the index. Reading bits beyond the size will always return 0.
+ */
+
+#define PA_BITSET_WORD          32
+
+struct pa_bitset {
+        struct pa_memory *memory;
+        enum pa_memory_mode mode;
+
+        u32 *words;     /* The buffer containing the bits */
+        s32 count;      /* The number of allocated words */
+};
+
+/*
+ * Initialize the bitset and preallocate enough words for the given number of
+ * bits. All bits start unset. After use call paDestroyBitset() to prevent
+ * memory leaks.
+ *
+ * @set: Pointer to the bitset
+ * @mem: Pointer to the memory-manager
+ * @bits: The initial number of bits to preallocate
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitBitset(struct pa_bitset *set, struct pa_memory *mem, s32 bits);
+
+/*
+ * Create a static bitset on top of the given buffer. The number of bits is
+ * calculated from the size of the buffer. After use call paDestroyBitset() and
+ * then free the memory yourself.
+ *
+ * @set: Pointer to the bitset
+ * @buf: The buffer to store the bits in
+ * @buf_sz: The size of the given buffer in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitBitsetFixed(struct pa_bitset *set, void *buf, s32 buf_sz);
+
+/*
+ * Destroy the bitset and free the allocated memory.
+ *
+ * @set: Pointer to the bitset
+ */
+PA_API void paDestroyBitset(struct pa_bitset *set);
+
+/*
+ * Unset all bits in the bitset. This will not free memory.
+ *
+ * @set: Pointer to the bitset
+ */
+PA_API void paClearBitset(struct pa_bitset *set);
+
+/*
+ * Set a single bit. If the bitset is configured as dynamic, it will scale to
+ * fit the index.
+ *
+ * @set: Pointer to the bitset
+ * @idx: The index of the bit
+ *
+ * Returns: 0 on success or -1 if the index is out of range
+ */
+PA_API s8 paSetBit(struct pa_bitset *set, s32 idx);
+
+/*
+ * Unset a single bit.
+ *
+ * @set: Pointer to the bitset
+ * @idx: The index of the bit
+ */
+PA_API void paClearBit(struct pa_bitset *set, s32 idx);
+
+/*
+ * Check if a single bit is set.
+ *
+ * @set: Pointer to the bitset
+ * @idx: The index of the bit
+ *
+ * Returns: 1 if the bit is set and 0 if not
+ */
+PA_API s8 paTestBit(struct pa_bitset *set, s32 idx);
+
+/*
+ * Count the number of set bits.
+ *
+ * @set: Pointer to the bitset
+ *
+ * Returns: The number of set bits
+ */
+PA_API s32 paCountBitset(struct pa_bitset *set);
+
+/*
+ * Search for the next set bit, starting at the given index.
+ *
+ * @set: Pointer to the bitset
+ * @start: The index to start searching from
+ *
+ * Returns: The index of the next set bit or -1 if there are no more set bits
+ */
+PA_API s32 paNextBit(struct pa_bitset *set, s32 start);
+
+/*
+ * Get the index of the next set bit. For the first step pass -1 for idx.
+ *
+ * Example on how to process all dirty elements:
+ * ...
+ * s32 idx = -1;
+ *
+ * while((idx = paIterateBitset(&dirty, idx)) >= 0) {
+ *         ...
+ * }
+ * ...
+ *
+ * @set: Pointer to the bitset
+ * @idx: The current index
+ *
+ * Returns: The index of the next set bit or -1 if there are no more set bits
+ */
+PA_API s32 paIterateBitset(struct pa_bitset *set, s32 idx);
+
+/*
+ * Only keep the bits, which are set in both bitsets.
+ *
+ * @dst: Pointer to the bitset to write the result to
+ * @src: Pointer to the second bitset
+ */
+PA_API void paAndBitset(struct pa_bitset *dst, struct pa_bitset *src);
+
+/*
+ * Set all bits, which are set in the second bitset. If the destination is
+ * configured as dynamic, it will scale to fit all bits of the source.
+ *
+ * @dst: Pointer to the bitset to write the result to
+ * @src: Pointer to the second bitset
+ *
+ * Returns: 0 on success or -1 if not all bits fit into the destination
+ */
+PA_API s8 paOrBitset(struct pa_bitset *dst, struct pa_bitset *src);
+
+/*
+ * Unset all bits, which are set in the second bitset.
+ *
+ * @dst: Pointer to the bitset to write the result to
+ * @src: Pointer to the second bitset
+ */
+PA_API void paAndNotBitset(struct pa_bitset *dst, struct pa_bitset *src);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      BLOOM-FILTER
+ *
+ * The dictionary and the table can use a bloom-filter to answer lookups for
+ * keys they don't contain without searching the buckets. The filter is split
+ * into blocks of PA_BLOOM_BLOCK words, which is the size of a cache-line. All
+ * bits of a key are set in the same block, so a lookup only touches a single
+ * cache-line.
+ *
+ * Removing a key can't clear its bits, as they might be shared with other
+ * keys. Instead the filter is rebuilt once too many keys have been removed or
+ * the dictionary or table has grown beyond the capacity of the filter.
+ */
+
+#define PA_BLOOM_BLOCK  16
+
+struct pa_bloom {
+        u32 *bits;      /* The blocks of the filter or NULL if disabled */
+        s32 blocks;     /* The number of blocks */
+        s16 hashes;     /* The number of bits set for every key */
+        s32 capacity;   /* The number of keys the filter is sized for */
+        s32 stale;      /* The number of removed keys still in the filter */
+        f32 rate;       /* The target false-positive rate */
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      HASH-STATS
+ *
+ * Statistics about the buckets of a dictionary or table, to see how well the
+ * keys are spread and how long lookups take. Everything except the hit- and
+ * miss-counters is computed from the current content when the statistics
+ * are requested, so collecting them doesn't slow down the lookups.
+ */
+
+#define PA_STATS_CHAINS 8
+
+struct pa_hash_stats {
+        s32 entries;    /* The number of entries */
+        s32 slots;      /* The number of allocated entry-slots */
+        s32 buckets;    /* The number of buckets */
+        f32 load;       /* The number of entries per bucket */
+
+        /*
+         * The number of buckets for every chain-length, so chains[0] are the
+         * empty buckets. The last element also counts all longer chains.
+         */
+        s32 chains[PA_STATS_CHAINS];
+        s32 longest;    /* The length of the longest chain */
+
+        f32 probe_hit;  /* Average entries compared to find a used key */
+        f32 probe_miss; /* Average entries compared for a missing key */
+
+        s32 collisions; /* Entries sharing their 16-bit hash with another */
+
+        u32 hits;       /* Lookups that found the key since the last reset */
+        u32 misses;     /* Lookups that didn't since the last reset */
+
+        u32 filter_checks;  /* Lookups checked with the bloom-filter */
+        u32 filter_rejects; /* Lookups answered by the bloom-filter */
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      Dictionary
+ *
+ * When pushing a new key-value-pair into the dictionary, the key is hashed and
+ * the new entry consisting of the key and value memory is pushed with a next
+ * value into the dictionary-buffer. The entry will then be put into one of the
+ * buckets depending on the hash and attached to the last entry in the bucket by
+ * updating it's next value.
+ *
+ * The dictionary-buffer looks like this:
+ *
+ *   ... <next><hash><key><value> <next><hash><key><value> ...
+ *
+ * The next-value is a short, the hash is an unsigned short, the key is the
+ * offset of the key in the key-buffer and the value-size is set during
+ * initialization. The keys can have any length and are stored one after
+ * another in a separate key-buffer:
+ *
+ *   ... <slot><size><key> <slot><size><key> ...
+ *
+ * Every record contains the slot of its entry and the size of the record, so
+ * once the key-buffer is full, the records of removed keys can be reclaimed by
+ * moving the remaining records to the front.
+ *
+ * To mark a entry-slot as not-used the next is set to -1. To identify the
+ * end of the bucket, the next is set to -(bucket_number + 2). All not-used
+ * slots are linked together in a free-list, with the hash-field of a slot
+ * containing the index of the next free slot, so finding an open slot doesn't
+ * require searching the buffer.
+ *
+ * To search for an entry in the dictionary, we again hash the key, determine
+ * the right bucket and then jump from entry to entry to find the right one like
+ * in a linked list.
+ *
+ * Once the number of entries exceeds PA_DICT_LOAD times the number of buckets,
+ * the number of buckets is doubled and all entries are redistributed, so the
+ * chains stay short. In dynamic mode the dictionary-buffer also scales when all
+ * slots are used. In fixed mode the buckets are stored behind the entries in
+ * the given buffer and their number is set once during initialization.
+ *
+ * In ordered mode new entries are always appended behind the last used slot,
+ * so the dictionary-buffer holds the entries in the order they have been added
+ * and the buckets just index into it. Removed entries leave a hole, which is
+ * only reclaimed once the end of the buffer is reached, by moving all used
+ * entries to the front. Iterating is then a linear scan over the buffer.
+ */
+
+#define PA_DICT_NEXT_SIZE 2
+#define PA_DICT_HASH_SIZE 2
+#define PA_DICT_KEY_SIZE  4
+#define PA_DICT_HEAD_SIZE (PA_DICT_NEXT_SIZE+PA_DICT_HASH_SIZE+PA_DICT_KEY_SIZE)
+#define PA_DICT_KEY_HEAD  4
+#define PA_DICT_KEY_AVG   16
+#define PA_DICT_BUCKETS   8
+#define PA_DICT_BUCKETS_MAX 16384
+#define PA_DICT_LOAD      0.75
+
+struct pa_dictionary {
+        struct pa_memory *memory;
+        enum pa_memory_mode mode;
+
+        s32 value_size; /* The size of the value-part in bytes */
+        s32 entry_size; /* The size of the header and value */
+
+        s16 number;   /* Number of active entries in the dictionary */
+        s16 alloc;    /* Number of slots of entries in the dictionary */  
+        u8 *buffer;   /* Memory-buffer to store the entries */
+        s16 free_head;/* Index of the first free slot or -1 */
+
+        s8 ordered;   /* 1 if the entries are kept in insertion order */
+        s16 tail;     /* In ordered mode the index behind the last used slot */
+
+        u8 *keys;       /* Memory-buffer to store the keys */
+        s32 keys_size;  /* The size of the key-buffer in bytes */
+        s32 keys_used;  /* Number of bytes written to the key-buffer */
+        s32 keys_dead;  /* Number of bytes of removed keys */
+
+        /* 
+         * All buckets containing the index for their first entry in the
+         * dictionary-buffer. The number of buckets is always a power of two.
+         */
+        s16 bucket_count;
+        s16 *buckets;
+
+        struct pa_bloom filter; /* Optional filter for missing keys */
+
+        u32 hits;       /* Lookups that found the key */
+        u32 misses;     /* Lookups that didn't */
+
+        /* Kept outside the filter, so rebuilding it doesn't reset them */
+        u32 filter_checks;  /* Lookups checked with the filter */
+        u32 filter_rejects; /* Lookups answered by the filter */
+};
+
+struct pa_dictionary_entry {
+        char *key;      /* Valid until the dictionary is modified */
+        void *value;
+};
+
+/*
+ * Initialize the dictionary, link to the memory-manager and preallocate the
+ * specified number of entries.
+ *
+ * @dct: Pointer to the dictionary
+ * @mem: Pointer to the memory-manager
+ * @size: The size of the value-part in bytes
+ * @alloc: The number of entries to preallocate
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitDictionary(struct pa_dictionary *dct, struct pa_memory *mem,
+                s32 size, s16 alloc);
+
+/*
+ * Initialize the dictionary using static memory, and prepare the
+ * dictionary-buffer. The buffer is shared by the entries, the buckets and the
+ * keys, with PA_DICT_KEY_AVG bytes reserved for every key.
+ *
+ * @dic: Pointer to the dictionary
+ * @buffer: The buffer to use to store the entries
+ * @buf_sz: The size of the buffer in bytes
+ * @value_sz: The size of the value-part in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitDictionaryFixed(struct pa_dictionary *dct, void *buffer,
+                s32 buf_sz, s32 value_sz);
+
+/*
+ * Destroy the dictionary, reset all attributes and if configured as dynamic,
+ * free the allocated memory.
+ *
+ * @dct: Pointer to the dictionary
+ */
+PA_API void paDestroyDictionary(struct pa_dictionary *dct);
+
+/*
+ * Set a key-value-pair in the dictionary. If the key already exists then
+ * overwrite it. If it does not yet exist, create it. This function will copy
+ * over the memory into the buffer.
+ *
+ * @dct: Pointer to the dictionary
+ * @key: Pointer to the key
+ * @value: Pointer to the value
+ *
+ * Returns: Either 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSetDictionary(struct pa_dictionary *dct, char *key, void *value);
+
+/*
+ * Retrieve an entry from the dictionary by searching for the key. To do so, the
+ * key will be hashed and the proper bucket determined. Then the function will
+ * go through all entries in the bucked until the requested entry is found.
+ *
+ * @dct: Pointer to the dictionary
+ * @key: Pointer to the key to look for
+ * @dst: A pointer to write the entry for the key to
+ *
+ * Returns: 1 if the entry has been found, 0 if not and -1 if an error occurred
+ */
+PA_API s8 paGetDictionary(struct pa_dictionary *dct, char *key, void *out);
+
+/*
+ * Remove an entry from the dictionary and open up the slot. The memory in the
+ * entry will be lost!
+ *
+ * @dct: Pointer to the dictionary
+ * @key: The key of the entry
+ */
+PA_API void paRemoveDictionary(struct pa_dictionary *dct, char *key);
+
+/*
+ * Enable a bloom-filter in front of the buckets, so most lookups for keys not
+ * in the dictionary can be answered without searching a bucket. The filter is
+ * sized for the current number of slots and rebuilt when the dictionary grows.
+ * This is only possible in dynamic mode.
+ *
+ * @dct: Pointer to the dictionary
+ * @rate: The target false-positive rate, or 0 to disable the filter
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paEnableDictionaryFilter(struct pa_dictionary *dct, f32 rate);
+
+/*
+ * Collect statistics about the buckets and lookups of the dictionary.
+ *
+ * @dct: Pointer to the dictionary
+ * @stats: A pointer to write the statistics to
+ */
+PA_API void paGetDictionaryStats(struct pa_dictionary *dct,
+                struct pa_hash_stats *stats);
+
+/*
+ * Reset the hit- and miss-counters of the dictionary and its bloom-filter.
+ *
+ * @dct: Pointer to the dictionary
+ */
+PA_API void paResetDictionaryStats(struct pa_dictionary *dct);
+
+/*
+ * Switch the insertion-ordered mode on or off. When switching, all used
+ * entries are moved to the front of the dictionary-buffer, keeping their
+ * current order. Entries added from then on in ordered mode come after the
+ * existing ones.
+ *
+ * @dct: Pointer to the dictionary
+ * @ordered: 1 to keep the entries in insertion order and 0 to reuse free slots
+ */
+PA_API void paSetDictionaryOrdered(struct pa_dictionary *dct, s8 ordered);
+
+/*
+ * This function allows the iteration of every entry in every bucket. The basic
+ * principal is passing a pointer to the current entry and getting the
+ * entry-data and pointer for the next entry. Note that this function goes from
+ * bucket to bucket, so it will not return the entries in respect to when they
+ * have been added, unless the dictionary is in ordered mode. Then the entries
+ * are returned in the order they have been added.
+ *
+ * Here's an example of how to use the function:
+ * ...
+ * struct pa_dictionary dict;
+ * struct pa_dictionary_entry ent;
+ * void *ptr = NULL;
+ * ...
+ * while((ptr = paIterateDictionary(&dict, ptr, &ent))) {
+ *      ..Do something with the entry...
+ * }
+ * ...
+ *
+ * @dct: Pointer to the dictionary
+ * @ptr: The runing pointer used to iterate(pass NULL at the start)
+ * @ent: A pointer to write the entry data to
+ *
+ * Returns: The pointer for the current entry in the dictionary-buffer or NULL
+ *          if this is the last entry in the dictionary
+ */
+PA_API void *paIterateDictionary(struct pa_dictionary *dct, void *ptr, 
+                struct pa_dictionary_entry *ent);
+
+/*
+ * Iterate through all entries in a bucket.
+ *
+ * Here's an example of how to use the function to iterate through bucket 2:
+ * ...
+ * struct pa_dictionary dict;
+ * struct pa_dictionary_entry ent;
+ * void *ptr = NULL;
+ * ...
+ * while((ptr = paIterateDictionaryBucket(&dict, 2, ptr, &ent))) {
+ *      ..Do something with the entry...
+ * }
+ * ...
+ *
+ * @dct: Pointer to the dictionary
+ * @bucket: The bucket to iterate through
+ * @ptr: The running pointer used to iterate(pass NULL at start)
+ * @ent: A pointer to write the entry data to
+ *
+ * Returns: The pointer for the current entry in the dictionary-buffer or NULL
+ *          if this is the last entry in the bucket
+ */
+PA_API void *paIterateDictionaryBucket(struct pa_dictionary *dct, s16 bucket,
+                void *ptr, struct pa_dictionary_entry *ent);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      TABLE
+ *
+ * When pushing a new key-value-pair into the table, the key is hashed and
+ * the new entry consisting of the key and value memory is pushed with a next
+ * value into the table-buffer. The entry will then be put into one of the
+ * buckets depending on the hash and attached to the last entry in the bucket by
+ * updating it's next value.
+ *
+ * The table-buffer looks like this:
+ *
+ *   ... <next><hash><key><value> <next><hash><key><value> ...
+ *
+ * The next-value is a short, the hash is an unsigned short, the key and the 
+ * value-size is set during initialization.
+ *
+ * To mark a entry-slot as not-used the next is set to -1. To identify the
+ * end of the bucket, the next is set to -(bucket_number + 2). All not-used
+ * slots are linked together in a free-list, with the hash-field of a slot
+ * containing the index of the next free slot, so finding an open slot doesn't
+ * require searching the buffer.
+ *
+ * To search for an entry in the dictionary, we again hash the key, determine
+ * the right bucket and then jump from entry to entry to find the right one like
+ * in a linked list.
+ *
+ * Once the number of entries exceeds PA_TBL_LOAD times the number of buckets,
+ * the number of buckets is doubled and all entries are redistributed, so the
+ * chains stay short. In dynamic mode the table-buffer also scales when all
+ * slots are used. In fixed mode the buckets are stored behind the entries in
+ * the given buffer and their number is set once during initialization.
+ *
+ * As the entries and buckets only reference each other by index, a table can
+ * be saved to a file and mapped back into memory later without any fixups.
+ * The file contains a short header followed by the table-buffer and the
+ * buckets, laid out the same way as in fixed mode:
+ *
+ *   <head> <entries...> <buckets...>
+ */
+
+
+#define PA_TBL_NEXT_SIZE 2
+#define PA_TBL_HASH_SIZE 2
+#define PA_TBL_HEAD_SIZE (PA_TBL_NEXT_SIZE+PA_TBL_HASH_SIZE)
+#define PA_TBL_BUCKETS   8
+#define PA_TBL_BUCKETS_MAX 16384
+#define PA_TBL_LOAD      0.75
+#define PA_TBL_BATCH     16
+
+struct pa_table {
+        struct pa_memory *memory;
+        enum pa_memory_mode mode;
+
+        s32 key_size;   /* The size of the key in bytes */
+        s32 value_size; /* The size of the value-part in bytes */
+        s32 entry_size; /* The size of the header, key and value in bytes */
+
+        s16 number;   /* Number of active entries in the table */
+        s16 alloc;    /* Number of slots of entries in the table */  
+        u8 *buffer;   /* Memory-buffer to store the entries */
+        s16 free_head;/* Index of the first free slot or -1 */
+
+        /* 
+         * All buckets containing the index for their first entry in the
+         * table-buffer. The number of buckets is always a power of two.
+         */
+        s16 bucket_count;
+        s16 *buckets;
+
+        struct pa_bloom filter; /* Optional filter for missing keys */
+
+        u32 hits;       /* Lookups that found the key */
+        u32 misses;     /* Lookups that didn't */
+
+        /* Kept outside the filter, so rebuilding it doesn't reset them */
+        u32 filter_checks;  /* Lookups checked with the filter */
+        u32 filter_rejects; /* Lookups answered by the filter */
+};
+
+struct pa_table_entry {
+        void *key;
+        void *value;
+};
+
+/*
+ * Initialize the table, link to the memory-manager and preallocate the
+ * specified number of entries.
+ *
+ * @tbl: Pointer to the table
+ * @mem: Pointer to the memory-manager
+ * @key_sz: The size of the key in bytes
+ * @value_sz: The size of the value in bytes
+ * @alloc: The number of entries to preallocate
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitTable(struct pa_table *tbl, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s16 alloc);
+
+/*
+ * Initialize the table using static memory, and prepare the
+ * table-buffer.
+ *
+ * @dic: Pointer to the table
+ * @buffer: The buffer to use to store the entries
+ * @buf_sz: The size of the buffer in bytes
+ * @value_sz: The size of the value-part in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitTableFixed(struct pa_table *tbl, void *buffer,
+                s32 buf_sz, s32 key_sz, s32 value_sz);
+
+/*
+ * Destroy the table, reset all attributes and if configured as dynamic,
+ * free the allocated memory.
+ *
+ * @tbl: Pointer to the table
+ */
+PA_API void paDestroyTable(struct pa_table *tbl);
+
+/*
+ * Set a key-value-pair in the table. If the key already exists then
+ * overwrite it. If it does not yet exist, create it. This function will copy
+ * over the memory into the buffer. Tables mapped with paMapTable() are
+ * read-only and always fail.
+ *
+ * @tbl: Pointer to the table
+ * @key: Pointer to the key
+ * @value: Pointer to the value
+ *
+ * Returns: Either 0 on success or -1 if an error occurred
  */
 PA_API s8 paSetTable(struct pa_table *tbl, void *key, void *value);
 
+/*
+ * Hash a key the same way the table does internally. The hash only depends on
+ * the key and the key-size, so it can be passed to paGetTableHashed() and
+ * paSetTableHashed() for every table with the same key-size, to avoid hashing
+ * the same key over and over again.
+ *
+ * @tbl: Pointer to the table
+ * @key: Pointer to the key
+ *
+ * Returns: The hash of the key
+ */
+PA_API u16 paHashTableKey(struct pa_table *tbl, void *key);
+
+/*
+ * Same as paSetTable(), but using a hash returned by paHashTableKey().
+ *
+ * @tbl: Pointer to the table
+ * @key: Pointer to the key
+ * @hash: The hash of the key
+ * @value: Pointer to the value
+ *
+ * Returns: Either 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSetTableHashed(struct pa_table *tbl, void *key, u16 hash,
+                void *value);
+
+/*
+ * Replace the content of the table with the given key-value-pairs. Instead of
+ * adding the pairs one by one, the table is sized once, the entries are
+ * sorted by bucket with a counting-sort and written so that all entries of a
+ * bucket lie next to each other in the table-buffer. This makes building
+ * faster and later lookups more cache-friendly. If a key appears multiple
+ * times, the last value is kept. In fixed mode the pairs have to fit into the
+ * existing slots.
+ *
+ * @tbl: Pointer to the table
+ * @keys: An array containing the keys one after another
+ * @values: An array containing the values one after another
+ * @num: The number of key-value-pairs
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paBuildTable(struct pa_table *tbl, void *keys, void *values,
+                s16 num);
+
 /*
  * Retrieve an entry from the table by searching for the key. To do so, the
  * key will be hashed and the proper bucket determined. Then the function will
@@ -829,15 +2197,76 @@ PA_API s8 paSetTable(struct pa_table *tbl, void *key, void *value);
  */
 PA_API s8 paGetTable(struct pa_table *tbl, void *key, void *out);
 
+/*
+ * Same as paGetTable(), but using a hash returned by paHashTableKey(). The
+ * hash is too short for the bloom-filter, so the filter is skipped.
+ *
+ * @tbl: Pointer to the table
+ * @key: Pointer to the buffer containing the key
+ * @hash: The hash of the key
+ * @out: A pointer to write the value for the key to
+ *
+ * Returns: 1 if the entry has been found, 0 if not and -1 if an error occurred
+ */
+PA_API s8 paGetTableHashed(struct pa_table *tbl, void *key, u16 hash,
+                void *out);
+
+/*
+ * Look up multiple keys at once. The keys are processed in groups of
+ * PA_TBL_BATCH: first all keys in the group are hashed and the needed buckets
+ * and entries are requested from memory, then the buckets are searched. This
+ * way the memory-latency of the lookups overlaps, instead of waiting for every
+ * lookup one after another.
+ *
+ * @tbl: Pointer to the table
+ * @keys: An array containing the keys one after another
+ * @num: The number of keys
+ * @out: An array to write the values to, one value-slot per key
+ * @[found]: An array to mark for every key, if it has been found
+ *
+ * Returns: The number of keys found
+ */
+PA_API s16 paGetTableBatch(struct pa_table *tbl, void *keys, s16 num,
+                void *out, s8 *found);
+
 /*
  * Remove an entry from the table and open up the slot. The memory in the
- * entry will be lost!
+ * entry will be lost! Tables mapped with paMapTable() are read-only and are
+ * left untouched.
  *
  * @tbl: Pointer to the table
  * @key: Pointer to a buffer containing the key
  */
 PA_API void paRemoveTable(struct pa_table *tbl, void *key);
 
+/*
+ * Enable a bloom-filter in front of the buckets, so most calls of paGetTable()
+ * for keys not in the table can be answered without searching a bucket. The
+ * filter is sized for the current number of slots and rebuilt when the table
+ * grows. This is only possible in dynamic mode.
+ *
+ * @tbl: Pointer to the table
+ * @rate: The target false-positive rate, or 0 to disable the filter
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paEnableTableFilter(struct pa_table *tbl, f32 rate);
+
+/*
+ * Collect statistics about the buckets and lookups of the table.
+ *
+ * @tbl: Pointer to the table
+ * @stats: A pointer to write the statistics to
+ */
+PA_API void paGetTableStats(struct pa_table *tbl, struct pa_hash_stats *stats);
+
+/*
+ * Reset the hit- and miss-counters of the table and its bloom-filter.
+ *
+ * @tbl: Pointer to the table
+ */
+PA_API void paResetTableStats(struct pa_table *tbl);
+
 /*
  * This function allows the iteration of every entry in every bucket. The basic
  * principal is passing a pointer to the current entry and getting the
@@ -891,6 +2320,414 @@ PA_API void *paIterateTable(struct pa_table *tbl, void *ptr,
 PA_API void *paIterateTableBucket(struct pa_table *tbl, s16 bucket,
                 void *ptr, struct pa_table_entry *ent);
 
+/*
+ * Write the table to a file, so it can be mapped back into memory using
+ * paMapTable(). The file is only valid on machines with the same byte-order
+ * and type-sizes.
+ *
+ * @tbl: Pointer to the table
+ * @path: The path of the file to write
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSaveTable(struct pa_table *tbl, char *path);
+
+/*
+ * Map a file written by paSaveTable() into memory and initialize the table to
+ * use it directly, without copying or rebuilding anything. The mapping is
+ * read-only, so the table can be searched and iterated, but setting or
+ * removing entries fails. Files with invalid sizes, indices pointing outside
+ * the table or broken bucket-chains are rejected. Call paDestroyTable() to unmap the file again.
+ *
+ * Mapping requires POSIX and is disabled by defining PA_NO_MMAP, in which case
+ * the function always fails.
+ *
+ * @tbl: Pointer to the table
+ * @path: The path of the file to map
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paMapTable(struct pa_table *tbl, char *path);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      FLAT-TABLE
+ *
+ * The flat-table works like the table, but instead of linking the entries of
+ * a bucket together, all entries are stored directly in an array of slots
+ * (open addressing). Next to the slots there is one control-byte per slot:
+ *
+ *   control: <ctrl><ctrl><ctrl>...               One byte per slot
+ *   slots:   <key><value> <key><value> ...       The key-value-pairs
+ *
+ * A control-byte is either PA_FLAT_EMPTY, PA_FLAT_DELETED or, for a used
+ * slot, the lower 7 bits of the hash of the key. The slots are grouped into
+ * groups of PA_FLAT_GROUP slots. To search for a key, the remaining bits of
+ * the hash select the first group to look at, and the control-bytes of the
+ * whole group are compared with the 7 bits at once. Only the slots with a
+ * matching control-byte have to be compared with the key. If the group
+ * contains an empty slot, the search ends, otherwise the next group in the
+ * probe-sequence is checked.
+ *
+ * When more than 7/8 of the slots are used, the table is rebuilt. In dynamic
+ * mode the number of slots is doubled, in fixed mode only the slots of
+ * removed entries are reclaimed.
+ */
+
+#define PA_FLAT_GROUP           16
+#define PA_FLAT_EMPTY           0x80
+#define PA_FLAT_DELETED         0xFE
+
+struct pa_flat_table {
+        struct pa_memory *memory;
+        enum pa_memory_mode mode;
+
+        s32 key_size;   /* The size of the key in bytes */
+        s32 value_size; /* The size of the value-part in bytes */
+        s32 entry_size; /* The size of the key and value in bytes */
+
+        s32 number;     /* Number of active entries in the table */
+        s32 alloc;      /* Number of slots, always a power of two */
+        s32 growth_left;/* Number of empty slots left before rebuilding */
+
+        u8 *buffer;     /* Memory-buffer containing control-bytes and slots */
+        u8 *control;    /* One control-byte per slot */
+        u8 *slots;      /* The key-value-pairs */
+};
+
+/*
+ * Initialize the flat-table, link to the memory-manager and preallocate
+ * enough slots for the specified number of entries.
+ *
+ * @tbl: Pointer to the flat-table
+ * @mem: Pointer to the memory-manager
+ * @key_sz: The size of the key in bytes
+ * @value_sz: The size of the value in bytes
+ * @alloc: The number of entries to preallocate
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitFlatTable(struct pa_flat_table *tbl, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s32 alloc);
+
+/*
+ * Initialize the flat-table using static memory. The number of slots is the
+ * largest power of two fitting into the buffer.
+ *
+ * @tbl: Pointer to the flat-table
+ * @buffer: The buffer to use to store the control-bytes and slots
+ * @buf_sz: The size of the buffer in bytes
+ * @key_sz: The size of the key in bytes
+ * @value_sz: The size of the value in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitFlatTableFixed(struct pa_flat_table *tbl, void *buffer,
+                s32 buf_sz, s32 key_sz, s32 value_sz);
+
+/*
+ * Destroy the flat-table, reset all attributes and if configured as dynamic,
+ * free the allocated memory.
+ *
+ * @tbl: Pointer to the flat-table
+ */
+PA_API void paDestroyFlatTable(struct pa_flat_table *tbl);
+
+/*
+ * Remove all entries from the flat-table. This will not free memory.
+ *
+ * @tbl: Pointer to the flat-table
+ */
+PA_API void paClearFlatTable(struct pa_flat_table *tbl);
+
+/*
+ * Set a key-value-pair in the flat-table. If the key already exists then
+ * overwrite it. If it does not yet exist, create it. This function will copy
+ * over the memory into the buffer.
+ *
+ * @tbl: Pointer to the flat-table
+ * @key: Pointer to the key
+ * @value: Pointer to the value
+ *
+ * Returns: Either 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSetFlatTable(struct pa_flat_table *tbl, void *key, void *value);
+
+/*
+ * Retrieve an entry from the flat-table by searching for the key.
+ *
+ * @tbl: Pointer to the flat-table
+ * @key: Pointer to the buffer containing the key
+ * @out: A pointer to write the value for the key to
+ *
+ * Returns: 1 if the entry has been found, 0 if not and -1 if an error occurred
+ */
+PA_API s8 paGetFlatTable(struct pa_flat_table *tbl, void *key, void *out);
+
+/*
+ * Remove an entry from the flat-table and open up the slot.
+ *
+ * @tbl: Pointer to the flat-table
+ * @key: Pointer to a buffer containing the key
+ */
+PA_API void paRemoveFlatTable(struct pa_flat_table *tbl, void *key);
+
+/*
+ * Iterate through all entries in the flat-table. The entries are returned in
+ * the order of the slots, which has nothing to do with when they have been
+ * added.
+ *
+ * Here's an example of how to use the function:
+ * ...
+ * struct pa_flat_table tbl;
+ * struct pa_table_entry ent;
+ * void *ptr = NULL;
+ * ...
+ * while((ptr = paIterateFlatTable(&tbl, ptr, &ent))) {
+ *      ..Do something with the entry...
+ * }
+ * ...
+ *
+ * @tbl: Pointer to the flat-table
+ * @ptr: The running pointer used to iterate(pass NULL at the start)
+ * @ent: A pointer to write the entry data to
+ *
+ * Returns: The pointer for the current slot or NULL if there are no more
+ *          entries in the flat-table
+ */
+PA_API void *paIterateFlatTable(struct pa_flat_table *tbl, void *ptr,
+                struct pa_table_entry *ent);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      SHARED-TABLE
+ *
+ * The shared-table is a table that can be read by multiple threads at the same
+ * time while another thread writes to it. It's meant for read-mostly data like
+ * resources and styles, which are looked up all the time but only change
+ * every once in a while.
+ *
+ * The entries are stored in snapshots, which are regular fixed tables and never
+ * change once published. A write copies the current snapshot, applies the
+ * change to the copy and then publishes it, so writes are serialized and cost
+ * a full copy of the table. Lookups don't take any locks and don't write to
+ * any memory shared with other readers. Every reader instead owns a slot in
+ * which it announces the version it's currently reading, so the writer knows
+ * when an old snapshot isn't used anymore and can be freed.
+ *
+ * Writers are only serialized if the framework is compiled with PA_PTHREADS
+ * defined. Otherwise only a single thread may write to the table. Readers on
+ * other threads rely on a full memory barrier between publishing a snapshot
+ * and checking the epochs, which is available with GCC, Clang and MSVC on x86.
+ * Compiling with PA_PTHREADS fails on compilers without such a barrier.
+ */
+
+struct pa_shared_table {
+        struct pa_memory *memory;
+
+        s32 key_size;   /* The size of the key in bytes */
+        s32 value_size; /* The size of the value-part in bytes */
+        s16 readers;    /* The number of reader slots */
+
+        void *state;    /* Internal state shared with the readers */
+};
+
+/*
+ * Initialize the shared-table with an empty snapshot and the given number of
+ * reader slots.
+ *
+ * @tbl: Pointer to the shared-table
+ * @mem: Pointer to the memory-manager
+ * @key_sz: The size of the key in bytes
+ * @value_sz: The size of the value in bytes
+ * @readers: The number of threads reading from the table at the same time
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitSharedTable(struct pa_shared_table *tbl, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s16 readers);
+
+/*
+ * Destroy the shared-table and free all snapshots. No thread may still be
+ * accessing the table.
+ *
+ * @tbl: Pointer to the shared-table
+ */
+PA_API void paDestroySharedTable(struct pa_shared_table *tbl);
+
+/*
+ * Set a key-value-pair in the table. If the key already exists then overwrite
+ * it. The change is visible to all lookups starting after this function
+ * returns.
+ *
+ * @tbl: Pointer to the shared-table
+ * @key: Pointer to the key
+ * @value: Pointer to the value
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSetSharedTable(struct pa_shared_table *tbl, void *key,
+                void *value);
+
+/*
+ * Set multiple key-value-pairs with a single copy of the table. Use this when
+ * loading many entries at once.
+ *
+ * @tbl: Pointer to the shared-table
+ * @keys: An array containing the keys one after another
+ * @values: An array containing the values one after another
+ * @num: The number of key-value-pairs
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSetSharedTableBatch(struct pa_shared_table *tbl, void *keys,
+                void *values, s16 num);
+
+/*
+ * Remove an entry from the table.
+ *
+ * @tbl: Pointer to the shared-table
+ * @key: Pointer to the key
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paRemoveSharedTable(struct pa_shared_table *tbl, void *key);
+
+/*
+ * Retrieve an entry from the table without taking any locks. Every thread
+ * reading at the same time has to use a different reader slot.
+ *
+ * @tbl: Pointer to the shared-table
+ * @reader: The index of the reader slot of the calling thread
+ * @key: Pointer to the key
+ * @out: A pointer to write the value for the key to
+ *
+ * Returns: 1 if the entry has been found and 0 if not
+ */
+PA_API s8 paGetSharedTable(struct pa_shared_table *tbl, s16 reader,
+                void *key, void *out);
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      CACHE
+ *
+ * The cache is a table with a fixed budget of entries. Once the budget is used
+ * up, adding a new entry evicts an old one. The entry to evict is chosen with
+ * the CLOCK algorithm, which approximates least-recently-used: every entry has
+ * a reference-bit, which is set whenever the entry is used. A hand moves over
+ * the slots of the table, clearing the reference-bits it passes, and evicts
+ * the first entry whose bit is already clear. So lookups only set a bit and
+ * evicting an entry takes constant time on average.
+ *
+ * The reference-bit is stored behind the value of every entry in the table,
+ * followed by padding to keep the entries aligned:
+ *
+ *   ... <next><hash><key><value><ref><pad> ...
+ */
+
+/*
+ * Called for an entry right before it's evicted from the cache. The key and
+ * value are only valid during the call.
+ */
+typedef void (*pa_cache_func)(void *key, void *value, void *pass);
+
+struct pa_cache {
+        struct pa_table table;
+
+        s32 value_size;         /* The size of the value-part in bytes */
+        s16 budget;             /* The maximum number of entries */
+        s16 hand;               /* The slot to check next when evicting */
+
+        pa_cache_func evict;    /* Callback for evicted entries or NULL */
+        void *pass;             /* Passed onto the callback */
+
+        u32 hits;               /* Number of lookups that found the key */
+        u32 misses;             /* Number of lookups that didn't */
+        u32 evictions;          /* Number of evicted entries */
+};
+
+/*
+ * Initialize the cache and allocate memory for the given budget of entries.
+ *
+ * @cache: Pointer to the cache
+ * @mem: Pointer to the memory-manager
+ * @key_sz: The size of the key in bytes
+ * @value_sz: The size of the value in bytes
+ * @budget: The maximum number of entries in the cache
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitCache(struct pa_cache *cache, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s16 budget);
+
+/*
+ * Initialize the cache using static memory. The budget is the number of entries
+ * that fit into the buffer.
+ *
+ * @cache: Pointer to the cache
+ * @buffer: The buffer to use to store the entries
+ * @buf_sz: The size of the buffer in bytes
+ * @key_sz: The size of the key in bytes
+ * @value_sz: The size of the value in bytes
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paInitCacheFixed(struct pa_cache *cache, void *buffer,
+                s32 buf_sz, s32 key_sz, s32 value_sz);
+
+/*
+ * Destroy the cache and if configured as dynamic, free the allocated memory.
+ * The eviction-callback is not called for the remaining entries.
+ *
+ * @cache: Pointer to the cache
+ */
+PA_API void paDestroyCache(struct pa_cache *cache);
+
+/*
+ * Set the callback-function to call for every entry evicted from the cache.
+ *
+ * @cache: Pointer to the cache
+ * @fnc: The callback-function or NULL
+ * @pass: A pointer that will be passed onto every function-call
+ */
+PA_API void paSetCacheCallback(struct pa_cache *cache, pa_cache_func fnc,
+                void *pass);
+
+/*
+ * Set a key-value-pair in the cache. If the key already exists then overwrite
+ * it. Otherwise, if the budget is used up, evict an entry to make room.
+ *
+ * @cache: Pointer to the cache
+ * @key: Pointer to the key
+ * @value: Pointer to the value
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_API s8 paSetCache(struct pa_cache *cache, void *key, void *value);
+
+/*
+ * Look up a key in the cache and mark the entry as used. Updates the hit- and
+ * miss-counters.
+ *
+ * @cache: Pointer to the cache
+ * @key: Pointer to the key
+ * @out: A pointer to write the value for the key to
+ *
+ * Returns: 1 if the entry has been found and 0 if not
+ */
+PA_API s8 paGetCache(struct pa_cache *cache, void *key, void *out);
+
+/*
+ * Remove an entry from the cache without calling the eviction-callback.
+ *
+ * @cache: Pointer to the cache
+ * @key: Pointer to the key
+ */
+PA_API void paRemoveCache(struct pa_cache *cache, void *key);
+
 /*
  * -----------------------------------------------------------------------------
  *
@@ -901,6 +2738,14 @@ PA_API void *paIterateTableBucket(struct pa_table *tbl, s16 bucket,
  * parse and process any amount of terms as it's just used for providing the
  * necessary resources for parsing and processing. A single flex-term is just a
  * container for an instance of a size-expression.
+ *
+ * After parsing, the term is compiled by evaluating it with symbolic values.
+ * Every value is kept as a linear form a + b * relative + c * font, so
+ * constant subexpressions fold together, for example "10px + 5px" becomes
+ * "15px" and "2 * 3pct" becomes "0.06 * relative". If the whole term is such
+ * a linear form, the three coefficients are stored in the flex-term and the
+ * tokens are replaced by the shortest equivalent term. Terms multiplying or
+ * dividing by a reference, or dividing by zero, are kept as they are.
  */
 
 #define PA_FLX_READ_BUFFER_SIZE        64
@@ -940,6 +2785,11 @@ struct pa_flex_helper {
 struct pa_flex {
         struct pa_flex_helper   *helper;
         struct pa_list          tokens;
+
+        s8                      linear;   /* 1 if compiled to a linear form */
+        f32                     constant; /* The constant part */
+        f32                     relative; /* The factor for the relative size */
+        f32                     font;     /* The factor for the font-size */
 };
 
 struct pa_flex_reference {
@@ -1054,7 +2904,10 @@ PA_API void paClearFlex(struct pa_flex *flx);
  *
  *
  * Parse an input-term by first tokenizing the input and then converting it to
- * postfix-notation using Dijkstra's shunting yard algortihm.
+ * postfix-notation using Dijkstra's shunting yard algortihm. Afterwards the
+ * term is compiled and constant subexpressions are folded. Compiling needs
+ * room for three values per token in the value-buffer of the flex-helper,
+ * otherwise the term is left as it is.
  * If the flex-handler is configured as static, the function will only write as
  * many tokens to the flex-handler, as the limit allows. If the flex-handler is
  * configured as dynamic, the token-list will be scaled according the the
@@ -1069,7 +2922,10 @@ PA_API void paClearFlex(struct pa_flex *flx);
 PA_API s16 paParseFlex(struct pa_flex *flx, char *str);
 
 /*
- * Process the flex-term using the given set of references.
+ * Process the flex-term using the given set of references. If the term was
+ * compiled to a linear form, the result is calculated directly from the three
+ * coefficients without touching the tokens or the value-buffer. Otherwise the
+ * postfix-term is interpreted.
  *
  * @flx: Pointer to the flex
  * @ref: Pointer to the set of references
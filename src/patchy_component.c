@@ -3,6 +3,17 @@
 
 #include <stdio.h>
 
+#ifdef PA_PTHREADS
+#include <pthread.h>
+#endif
+
+#ifdef PA_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  *
@@ -662,7 +673,7 @@ PA_LIB s16 paInsertList(struct pa_list *lst, void *src, s16 start, s16 num)
 
         /* Move entries back to make space */
         move_sz = (lst->count - start) * lst->entry_size;
-        move_off = (lst->count * lst->entry_size) - move_sz;
+        move_off = offset + size;
         pa_mem_move(lst->data + move_off, lst->data + offset, move_sz);
 
         /* Copy over the entries from the source */
@@ -808,758 +819,5474 @@ PA_API void paApplyListBack(struct pa_list *lst, pa_list_func fnc, void *pass)
 }
 
 /*
- * -----------------------------------------------------------------------------
- *
- *      DICTIONARY
- *
+ * Get a pointer to the entry at the given index.
  */
+PA_INTERN u8 *lst_at(struct pa_list *lst, s32 idx)
+{
+        return lst->data + idx * lst->entry_size;
+}
 
-/* Source: https://stackoverflow.com/a/21001712 */
-PA_INTERN u16 dct_hash(char *key)
+/*
+ * Swap two entries byte by byte, so no temporary entry is needed.
+ */
+PA_INTERN void lst_swap(struct pa_list *lst, s32 a, s32 b)
 {
-        u32 byte;
-        u32 crc;
-        u32 mask;
-        s32 i = 0;
-        s32 j;
+        u8 *pa = lst_at(lst, a);
+        u8 *pb = lst_at(lst, b);
+        u8 tmp;
+        s32 i;
 
-        crc = 0xFFFFFFFF;
-        while(key[i] != 0) {
-                byte = key[i];
-                crc = crc ^ byte;
-                for (j = 7; j >= 0; j--) {
-                        mask = -(crc & 1);
-                        crc = (crc >> 1) ^ (0xEDB88320 & mask);
-                }
-                i++;
+        if(a == b)
+                return;
+
+        for(i = 0; i < lst->entry_size; i++) {
+                tmp = pa[i];
+                pa[i] = pb[i];
+                pb[i] = tmp;
         }
-        return (~crc) % 0xFFFF;
 }
 
-PA_INTERN s16 dct_find_open(struct pa_dictionary *dct)
+PA_INTERN void lst_insertion_sort(struct pa_list *lst, s32 lo, s32 hi,
+                pa_list_compare cmp)
 {
-        s16 i;
+        s32 i;
+        s32 j;
 
-        for(i = 0; i < dct->alloc; i++) {
-                if(*(s16 *)(dct->buffer + i * dct->entry_size) == -1)
-                        return i;
-        }
+        for(i = lo + 1; i <= hi; i++) {
+                for(j = i; j > lo; j--) {
+                        if(cmp(lst_at(lst, j - 1), lst_at(lst, j)) <= 0)
+                                break;
 
-        return -1;
+                        lst_swap(lst, j - 1, j);
+                }
+        }
 }
 
-PA_INTERN u8 *dct_next_bucket(struct pa_dictionary *dct, s16 bucket, u8 *ptr)
+PA_INTERN void lst_sift_down(struct pa_list *lst, s32 lo, s32 root, s32 num,
+                pa_list_compare cmp)
 {
-        s16 next_idx = -1;
+        s32 child;
 
-        if(dct->buckets[bucket] < 0)
-                return NULL;
+        while((child = 2 * root + 1) < num) {
+                if(child + 1 < num && cmp(lst_at(lst, lo + child),
+                                        lst_at(lst, lo + child + 1)) < 0)
+                        child++;
 
-        /*
-         * On the first call ptr will be NULL, so we have to find the first
-         * entry in the dictionary.
-         */
-        if(!ptr) {
-                return dct->buffer + (dct->buckets[bucket] * dct->entry_size);
+                if(cmp(lst_at(lst, lo + root), lst_at(lst, lo + child)) >= 0)
+                        return;
+
+                lst_swap(lst, lo + root, lo + child);
+                root = child;
         }
+}
 
-        /*
-         * Otherwise we have to get a pointer to the next entry.
-         */
-        if((next_idx = *(s16 *)ptr) < 0) {
-                return NULL;
+PA_INTERN void lst_heap_sort(struct pa_list *lst, s32 lo, s32 hi,
+                pa_list_compare cmp)
+{
+        s32 num = hi - lo + 1;
+        s32 i;
+
+        for(i = num / 2 - 1; i >= 0; i--)
+                lst_sift_down(lst, lo, i, num, cmp);
+
+        for(i = num - 1; i > 0; i--) {
+                lst_swap(lst, lo, lo + i);
+                lst_sift_down(lst, lo, 0, i, cmp);
         }
+}
 
-        /* Return a pointer to the entry */
-        return dct->buffer + (next_idx * dct->entry_size);
+/*
+ * Move the median of the first, middle and last entry to the front, so it can
+ * be used as pivot.
+ */
+PA_INTERN void lst_median_to_front(struct pa_list *lst, s32 lo, s32 hi,
+                pa_list_compare cmp)
+{
+        s32 mid = lo + (hi - lo) / 2;
 
+        if(cmp(lst_at(lst, mid), lst_at(lst, lo)) < 0)
+                lst_swap(lst, mid, lo);
+        if(cmp(lst_at(lst, hi), lst_at(lst, lo)) < 0)
+                lst_swap(lst, hi, lo);
+        if(cmp(lst_at(lst, hi), lst_at(lst, mid)) < 0)
+                lst_swap(lst, hi, mid);
 
+        /* Now lo <= mid <= hi, so use mid as pivot */
+        lst_swap(lst, lo, mid);
 }
 
-PA_INTERN u8 *dct_next(struct pa_dictionary *dct, u8 *ptr)
+PA_INTERN void lst_intro_sort(struct pa_list *lst, s32 lo, s32 hi, s32 depth,
+                pa_list_compare cmp)
 {
-        s16 idx = -1;
-        s16 next_idx = -1;
-        s16 bucket_num;
+        s32 i;
+        s32 j;
 
-        /*
-         * On the first call ptr will be NULL, so we have to find the first
-         * entry in the dictionary.
-         */
-        if(!ptr) {
-                bucket_num = 0;
-                while(bucket_num < PA_DICT_BUCKETS) {
-                        if(dct->buckets[bucket_num] >= 0) {
-                                idx = dct->buckets[bucket_num];
-                                ptr = dct->buffer + (idx * dct->entry_size);
-                                break;
-                        }
-                        bucket_num++;
+        while(hi - lo > 16) {
+                if(depth-- == 0) {
+                        lst_heap_sort(lst, lo, hi, cmp);
+                        return;
                 }
 
-                return ptr;
-        }
-
-        /*
-         * Otherwise we have to get a pointer to the next entry.
-         */
-        next_idx = *(s16 *)ptr;
-        if(next_idx <= -2) {
-                bucket_num = (-1 * next_idx) - 2 + 1;
-                while(bucket_num < PA_DICT_BUCKETS) {
-                        if(dct->buckets[bucket_num] >= 0) {
-                                next_idx = dct->buckets[bucket_num];
-                                break;
-                        }
-                        bucket_num++;
+                /*
+                 * Partition around the pivot at lo. Both sides stop on equal
+                 * entries, so lists with many equal entries are split evenly.
+                 */
+                lst_median_to_front(lst, lo, hi, cmp);
+                i = lo;
+                j = hi + 1;
+                while(1) {
+                        while(cmp(lst_at(lst, ++i), lst_at(lst, lo)) < 0)
+                                if(i == hi) break;
+                        while(cmp(lst_at(lst, lo), lst_at(lst, --j)) < 0)
+                                if(j == lo) break;
+                        if(i >= j) break;
+                        lst_swap(lst, i, j);
                 }
+                lst_swap(lst, lo, j);
 
-                /* No more entries left in the dictionary */
-                if(next_idx <= -2)
-                        return NULL;
+                /* Recurse into the smaller part, loop on the bigger one */
+                if(j - lo < hi - j) {
+                        lst_intro_sort(lst, lo, j - 1, depth, cmp);
+                        lo = j + 1;
+                }
+                else {
+                        lst_intro_sort(lst, j + 1, hi, depth, cmp);
+                        hi = j - 1;
+                }
         }
 
-        /* Return a pointer to the entry */
-        return dct->buffer + (next_idx * dct->entry_size);
+        lst_insertion_sort(lst, lo, hi, cmp);
 }
 
-PA_INTERN u8 *dct_find_key(struct pa_dictionary *dct, char *key, u8 **prev,
-                s16 *bucket_out)
+/*
+ * Read the digit of the key in the given entry. Digit 0 is the least
+ * significant byte. For signed keys the sign-bit is flipped, so negative keys
+ * come first.
+ */
+PA_INTERN u32 lst_key_digit(u8 *ptr, s16 size, s16 digit, s8 sign)
 {
-        u16 hash = dct_hash(key);
-        s16 bucket = hash % PA_DICT_BUCKETS;
-        u8 *ptr = NULL;
-        s16 off = PA_DICT_NEXT_SIZE + PA_DICT_HASH_SIZE;
+        u64 key;
+        u32 byte;
 
-        if(dct->buckets[bucket] < 0)
-                return NULL;
+        switch(size) {
+                case 1: key = *(u8 *)ptr; break;
+                case 2: key = *(u16 *)ptr; break;
+                case 4: key = *(u32 *)ptr; break;
+                default: key = *(u64 *)ptr; break;
+        }
 
-        if(bucket_out) *bucket_out = bucket;
+        byte = (key >> (digit * 8)) & 0xFF;
+        if(sign && digit == size - 1)
+                byte ^= 0x80;
 
-        if(prev) *prev = NULL;
-        while((ptr = dct_next_bucket(dct, bucket, ptr))) {
-                /* Compare the hashes */
-                if(hash == *(u16 *)(ptr + PA_DICT_NEXT_SIZE)) {
-                        if(pa_strcmp(key, (char *)(ptr + off)) == 0) {
-                                return ptr;
+        return byte;
+}
+
+PA_INTERN void lst_radix_insertion(struct pa_list *lst, s32 lo, s32 hi,
+                s16 off, s16 size, s8 sign)
+{
+        s32 i;
+        s32 j;
+        s16 d;
+        u32 da;
+        u32 db;
+
+        for(i = lo + 1; i <= hi; i++) {
+                for(j = i; j > lo; j--) {
+                        /* Compare the keys digit by digit */
+                        for(d = size - 1; d >= 0; d--) {
+                                da = lst_key_digit(lst_at(lst, j - 1) + off,
+                                                size, d, sign);
+                                db = lst_key_digit(lst_at(lst, j) + off,
+                                                size, d, sign);
+                                if(da != db) break;
                         }
+                        if(d < 0 || da < db) break;
+                        lst_swap(lst, j - 1, j);
                 }
-                if(prev) *prev = ptr;
         }
-
-        return NULL;
 }
 
-PA_API s8 paInitDictionary(struct pa_dictionary *dct, struct pa_memory *mem,
-                s32 size, s16 alloc)
+/*
+ * Sort the range [lo, hi) by the given digit in-place and then recurse into
+ * every bucket with the next lower digit (American flag sort).
+ */
+PA_INTERN void lst_radix_sort(struct pa_list *lst, s32 lo, s32 hi, s16 off,
+                s16 size, s16 digit, s8 sign)
 {
-        s32 alloc_sz;
-        s16 i;
+        s32 count[256];
+        s32 head[256];
+        s32 tail[256];
+        s32 i;
+        u32 b;
+        u32 d;
 
-        dct->memory = mem;
-        dct->mode = PA_DYNAMIC;
+        if(hi - lo <= 32) {
+                lst_radix_insertion(lst, lo, hi - 1, off, size, sign);
+                return;
+        }
 
-        dct->value_size = size;
-        dct->entry_size = PA_DICT_HEAD_SIZE + size;
-        dct->number = 0;
-        dct->alloc = alloc;
+        /* Count the entries for every bucket */
+        for(b = 0; b < 256; b++)
+                count[b] = 0;
 
-        alloc_sz = dct->entry_size * dct->alloc;
-        if(!(dct->buffer = pa_mem_alloc(dct->memory, NULL, alloc_sz))) {
-                return -1;
-        }
+        for(i = lo; i < hi; i++)
+                count[lst_key_digit(lst_at(lst, i) + off, size, digit, sign)]++;
 
-        /* Reset all memory slots in the buffer */
-        for(i = 0; i < dct->alloc; i++) {
-                *(s16 *)(dct->buffer + i * dct->entry_size) = -1;
+        head[0] = lo;
+        for(b = 0; b < 256; b++) {
+                if(b > 0) head[b] = tail[b - 1];
+                tail[b] = head[b] + count[b];
         }
 
-        /* Reset all buckets */
-        for(i = 0; i < PA_DICT_BUCKETS; i++) {
-                dct->buckets[i] = -1;
+        /* Move every entry into its bucket by swapping */
+        for(b = 0; b < 256; b++) {
+                while(head[b] < tail[b]) {
+                        d = lst_key_digit(lst_at(lst, head[b]) + off, size,
+                                        digit, sign);
+                        if(d == b) {
+                                head[b]++;
+                        }
+                        else {
+                                lst_swap(lst, head[b], head[d]);
+                                head[d]++;
+                        }
+                }
         }
 
-        return 0;
+        if(digit == 0)
+                return;
+
+        /* Sort every bucket by the next digit */
+        for(b = 0; b < 256; b++) {
+                if(count[b] > 1) {
+                        lst_radix_sort(lst, tail[b] - count[b], tail[b], off,
+                                        size, digit - 1, sign);
+                }
+        }
 }
 
-PA_API s8 paInitDictionaryFixed(struct pa_dictionary *dct, void *buffer,
-                s32 buf_sz, s32 value_sz)
+PA_API void paSortList(struct pa_list *lst, pa_list_compare cmp)
 {
-        s16 i;
+        s32 depth = 0;
+        s32 n;
 
-        dct->memory = NULL;
-        dct->mode = PA_FIXED;
+        if(lst->count < 2)
+                return;
 
-        dct->value_size = value_sz;
-        dct->entry_size = PA_DICT_HEAD_SIZE + value_sz;
-        dct->number = 0;
-        dct->buffer = buffer;
+        /* Fall back to heapsort after 2*log2(n) levels */
+        for(n = lst->count; n > 1; n >>= 1)
+                depth += 2;
 
-        dct->alloc = buf_sz / dct->entry_size;
+        lst_intro_sort(lst, 0, lst->count - 1, depth, cmp);
+}
 
-        /* Reset all entry-slots in the buffer */
-        for(i = 0; i < dct->alloc; i++) {
-                *(s16 *)(dct->buffer + i * dct->entry_size) = -1;
-        }
+PA_API s8 paSortListKey(struct pa_list *lst, s16 off, s16 size, s8 sign)
+{
+        /* Validate input parameters */
+        if(size != 1 && size != 2 && size != 4 && size != 8)
+                return -1;
+        /* u64 is only 4 bytes wide on LLP64 and 32-bit targets */
+        if(size > (s16)sizeof(u64))
+                return -1;
+        if(off < 0 || off + size > lst->entry_size)
+                return -1;
 
-        /* Reset all buckets */
-        for(i = 0; i < PA_DICT_BUCKETS; i++) {
-                dct->buckets[i] = -1;
-        }
+        if(lst->count < 2)
+                return 0;
 
+        lst_radix_sort(lst, 0, lst->count, off, size, size - 1, sign);
         return 0;
 }
 
-PA_API void paDestroyDictionary(struct pa_dictionary *dct)
+PA_API s16 paLowerBoundList(struct pa_list *lst, void *key,
+                pa_list_compare cmp)
 {
-        if(dct->mode == PA_DYNAMIC) {
-                pa_mem_free(dct->memory, dct->buffer);
+        s32 lo = 0;
+        s32 hi = lst->count;
+        s32 mid;
+
+        while(lo < hi) {
+                mid = lo + (hi - lo) / 2;
+                if(cmp(lst_at(lst, mid), key) < 0)
+                        lo = mid + 1;
+                else
+                        hi = mid;
         }
 
-        dct->memory = 0;
-        dct->mode = PA_MEM_UDEF;
-
-        dct->value_size = 0;
-        dct->entry_size = 0;
-        dct->number = 0;
-        dct->alloc = 0;
-        dct->buffer = 0;
+        return lo;
 }
 
-PA_API s8 paSetDictionary(struct pa_dictionary *dct, char *key, void *value)
+PA_API s16 paUpperBoundList(struct pa_list *lst, void *key,
+                pa_list_compare cmp)
 {
-        s16 slot;
-        u16 hash;
-        s16 bucket;
-        u8 *ptr;
-        s32 tmp;
-        s16 next_idx;
-
-
-        /* Validate the input parameters */
-        if(pa_strlen(key) > 32)
-                return -1;
+        s32 lo = 0;
+        s32 hi = lst->count;
+        s32 mid;
+
+        while(lo < hi) {
+                mid = lo + (hi - lo) / 2;
+                if(cmp(lst_at(lst, mid), key) <= 0)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
 
-        /*
-         * If there is already an entry with the keyword in the dictionary, we
-         * can just overwrite it's value and return.
-         */
-        if((ptr = dct_find_key(dct, key, NULL, NULL))) {
-                /* Copy over the content */
-                pa_mem_copy(ptr + PA_DICT_HEAD_SIZE, value, dct->value_size);
-                return 0;
+        return lo;
+}
 
-        }
+PA_API s16 paInsertListSorted(struct pa_list *lst, void *src,
+                pa_list_compare cmp)
+{
+        s16 idx = paUpperBoundList(lst, src, cmp);
 
-        /* Get an open slot in the dictionary-buffer */
-        if((slot = dct_find_open(dct)) < 0)
+        if(paInsertList(lst, src, idx, 1) < 1)
                 return -1;
 
-        /* Hash the key and determine the bucket  */
-        hash = dct_hash(key); 
-        bucket = hash % PA_DICT_BUCKETS;
+        return idx;
+}
 
-        /* 
-         * Write the copy over the data to the dictionary-buffer.
-         */
+PA_API s16 paMergeList(struct pa_list *dst, struct pa_list *a,
+                struct pa_list *b, pa_list_compare cmp)
+{
+        s32 i = 0;
+        s32 j = 0;
+        s16 written = 0;
+        u8 *ptr;
 
-        /* Set the next index */
-        ptr = dct->buffer + (slot * dct->entry_size);
-        *(s16 *)ptr = -(bucket + 2);
-        ptr += PA_DICT_NEXT_SIZE;
+        /* Validate input parameters */
+        if(dst == a || dst == b) return -1;
+        if(a->entry_size != dst->entry_size) return -1;
+        if(b->entry_size != dst->entry_size) return -1;
 
-        /* Copy the hash */
-        *(u16 *)ptr = hash;
-        ptr += PA_DICT_HASH_SIZE;
+        lst_ensure_fit(dst, a->count + b->count);
 
-        /* Copy over the keyword */
-        pa_strcpy((char *)ptr, key);
-        ptr += PA_DICT_KEY_SIZE;
+        while(i < a->count || j < b->count) {
+                /* Take from a on ties, so the merge is stable */
+                if(j >= b->count || (i < a->count &&
+                                        cmp(lst_at(a, i), lst_at(b, j)) <= 0)) {
+                        ptr = lst_at(a, i++);
+                }
+                else {
+                        ptr = lst_at(b, j++);
+                }
 
-        /* Copy over the content */
-        pa_mem_copy(ptr, value, dct->value_size);
+                if(paPushList(dst, ptr, 1) < 1)
+                        break;
 
-        /*
-         * Attach the entry to the bucket.
-         */
-        if(dct->buckets[bucket] < 0) {
-                dct->buckets[bucket] = slot;
-        }
-        else {
-                tmp = dct->buckets[bucket] * dct->entry_size;
-                ptr = dct->buffer + tmp;
-                while((next_idx = *(s16 *)ptr) >= 0) {
-                        ptr = dct->buffer + next_idx * dct->entry_size;
-                }
-                *(s16 *)ptr = slot;
+                written++;
         }
 
-        dct->number++;
-        return 0;
+        return written;
 }
 
-PA_API s8 paGetDictionary(struct pa_dictionary *dct, char *key, void *out)
+/*
+ * Compare two entries, using a single comparison for the common sizes.
+ */
+PA_INTERN s8 lst_equal(u8 *a, u8 *b, s16 size)
 {
-        u8 *ptr;
+        switch(size) {
+                case 1: return *a == *b;
+                case 2: return *(u16 *)a == *(u16 *)b;
+                case 4: return *(u32 *)a == *(u32 *)b;
+                case 8: return ((u32 *)a)[0] == ((u32 *)b)[0] &&
+                                ((u32 *)a)[1] == ((u32 *)b)[1];
+        }
 
-        if(!(ptr = dct_find_key(dct, key, NULL, NULL)))
-                return 0;
+        return pa_mem_compare(a, b, size);
+}
 
-        pa_mem_copy(out, ptr + PA_DICT_HEAD_SIZE, dct->entry_size);
-        return 1;
+PA_INTERN s8 lst_simd_size(s16 size)
+{
+        return size == 1 || size == 2 || size == 4 || size == 8;
 }
 
-PA_API void paRemoveDictionary(struct pa_dictionary *dct, char *key)
+#ifdef PA_SSE2
+
+/*
+ * Repeat the key to fill a whole register.
+ */
+PA_INTERN __m128i lst_broadcast(void *key, s16 size)
 {
-        s16 bucket;
-        u8 *ptr;
-        u8 *prev;
-        s16 next_idx;
+        u8 pattern[16];
+        s16 i;
 
-        if((ptr = dct_find_key(dct, key, &prev, &bucket))) {
-                next_idx = *(s16 *)ptr;
+        for(i = 0; i < 16; i += size)
+                pa_mem_copy(pattern + i, key, size);
 
-                if(!prev && next_idx < 0) {
-                        dct->buckets[bucket] = -1;
-                }
-                else if(!prev && next_idx >= 0) {
-                        dct->buckets[bucket] = next_idx;
-                }
-                else if(prev) {
-                        *(s16 *)prev = *(s16 *)ptr;
-                }
+        return _mm_loadu_si128((__m128i *)pattern);
+}
 
-                *(s16 *)ptr = -1;
-                dct->number--;
+/*
+ * Compare 16 bytes of entries with the key. Every byte of a matching entry
+ * will have its bit set in the returned mask.
+ */
+PA_INTERN u32 lst_match_mask(u8 *ptr, __m128i key, s16 size)
+{
+        __m128i v = _mm_loadu_si128((__m128i *)ptr);
+        __m128i eq;
+
+        switch(size) {
+                case 1: eq = _mm_cmpeq_epi8(v, key); break;
+                case 2: eq = _mm_cmpeq_epi16(v, key); break;
+                case 4: eq = _mm_cmpeq_epi32(v, key); break;
+                default:
+                        /* No 64-bit compare in SSE2, so combine both halves */
+                        eq = _mm_cmpeq_epi32(v, key);
+                        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq,
+                                                _MM_SHUFFLE(2, 3, 0, 1)));
+                        break;
         }
+
+        return _mm_movemask_epi8(eq);
 }
 
-PA_API void *paIterateDictionary(struct pa_dictionary *dct, void *ptr, 
-                struct pa_dictionary_entry *ent)
-{
-        char *tmp;
+#endif /* PA_SSE2 */
 
-        /* Check if the dictionary is empty */
-        if(dct->number < 1)
-                return NULL;
+/*
+ * Find the first entry equal to the key, starting at the given index.
+ */
+PA_INTERN s32 lst_find_from(struct pa_list *lst, void *key, s32 start)
+{
+        s16 size = lst->entry_size;
+        s32 i = start;
+#ifdef PA_SSE2
+        __m128i k;
+        s32 per_block;
+        u32 mask;
 
-        /* Go to the next entry in the dictionary */
-        if(!(ptr = dct_next(dct, ptr)))
-                return NULL;
+        if(lst_simd_size(size)) {
+                k = lst_broadcast(key, size);
+                per_block = 16 / size;
 
-        /* Return the entry-data for the current entry */
-        if(ent) {
-                /* Copy over the key */
-                tmp = (char *)ptr + PA_DICT_NEXT_SIZE + PA_DICT_HASH_SIZE;
-                pa_strcpy(ent->key, tmp);
+                for(; i + per_block <= lst->count; i += per_block) {
+                        mask = lst_match_mask(lst_at(lst, i), k, size);
+                        if(mask)
+                                return i + pa_bit_ctz(mask) / size;
+                }
+        }
+#endif
 
-                /* Set the pointer for the data */
-                ent->value = tmp + PA_DICT_KEY_SIZE;
+        for(; i < lst->count; i++) {
+                if(lst_equal(lst_at(lst, i), key, size))
+                        return i;
         }
 
-        return ptr;
+        return -1;
 }
 
-PA_API void *paIterateDictionaryBucket(struct pa_dictionary *dct, s16 bucket,
-                void *ptr, struct pa_dictionary_entry *ent)
+PA_API s16 paFindList(struct pa_list *lst, void *key, s16 start)
 {
-        char *tmp;
+        if(start < 0)
+                return -1;
 
-        /* Check if the dictionary is empty */
-        if(dct->number < 1)
-                return NULL;
+        return lst_find_from(lst, key, start);
+}
 
-        if(!(ptr = dct_next_bucket(dct, bucket, ptr)))
-                return NULL;
+PA_API s16 paFindListAll(struct pa_list *lst, void *key, struct pa_list *out)
+{
+        s16 number = 0;
+        s16 idx = -1;
 
-        /* Return the data for the current entry */
-        if(ent) {
-                /* Copy over the key */
-                tmp = (char *)ptr + PA_DICT_NEXT_SIZE + PA_DICT_HASH_SIZE;
-                pa_strcpy(ent->key, tmp);
+        if(out->entry_size != sizeof(s16))
+                return -1;
 
-                /* Set the pointer for the data */
-                ent->value = tmp + PA_DICT_KEY_SIZE;
+        while((idx = lst_find_from(lst, key, idx + 1)) >= 0) {
+                if(paPushList(out, &idx, 1) < 1)
+                        break;
+
+                number++;
         }
 
-        return ptr;
+        return number;
 }
 
-/*
- * -----------------------------------------------------------------------------
- *
- *      TABLE
- *
- */
-
-/* Source: https://stackoverflow.com/a/21001712 */
-PA_INTERN u16 tbl_hash(u8 *key, s32 key_sz)
+PA_API s16 paCountList(struct pa_list *lst, void *key)
 {
-        u32 byte;
-        u32 crc;
-        u32 mask;
+        s16 size = lst->entry_size;
+        s32 number = 0;
         s32 i = 0;
-        s32 j;
+#ifdef PA_SSE2
+        __m128i k;
+        s32 per_block;
 
-        crc = 0xFFFFFFFF;
-        while(i < key_sz && key[i] != 0) {
-                byte = key[i];
-                crc = crc ^ byte;
-                for (j = 7; j >= 0; j--) {
-                        mask = -(crc & 1);
-                        crc = (crc >> 1) ^ (0xEDB88320 & mask);
+        if(lst_simd_size(size)) {
+                k = lst_broadcast(key, size);
+                per_block = 16 / size;
+
+                for(; i + per_block <= lst->count; i += per_block) {
+                        number += pa_bit_popcount(lst_match_mask(lst_at(lst, i),
+                                                k, size)) / size;
                 }
-                i++;
         }
-        return (~crc) % 0xFFFF;
-}
-
-PA_INTERN s16 tbl_find_open(struct pa_table *tbl)
-{
-        s16 i;
+#endif
 
-        for(i = 0; i < tbl->alloc; i++) {
-                if(*(s16 *)(tbl->buffer + i * tbl->entry_size) == -1)
-                        return i;
+        for(; i < lst->count; i++) {
+                if(lst_equal(lst_at(lst, i), key, size))
+                        number++;
         }
 
-        return -1;
+        return number;
 }
 
-PA_INTERN u8 *tbl_next_bucket(struct pa_table *tbl, s16 bucket, u8 *ptr)
+PA_API s16 paFillList(struct pa_list *lst, void *src, s16 start, s16 num)
 {
-        s16 next_idx = -1;
+        s32 size = lst->entry_size;
+        s32 done;
+        s32 step;
+        u8 *ptr;
 
-        if(tbl->buckets[bucket] < 0)
-                return NULL;
+        /* Validate input parameters */
+        if(start < 0 || start > lst->count)
+                return -1;
 
-        /*
-         * On the first call ptr will be NULL, so we have to find the first
-         * entry in the table.
-         */
-        if(!ptr) {
-                return tbl->buffer + (tbl->buckets[bucket] * tbl->entry_size);
-        }
+        num = num == PA_ALL ? lst->count - start : num;
 
-        /*
-         * Otherwise we have to get a pointer to the next entry.
-         */
-        if((next_idx = *(s16 *)ptr) < 0) {
-                return NULL;
+        /* If configured as dynamic, scale to fit the range */
+        if(start + num > lst->count)
+                lst_ensure_fit(lst, start + num - lst->count);
+
+        num = PA_MIN(num, lst->alloc - start);
+        if(num < 1)
+                return 0;
+
+        ptr = lst_at(lst, start);
+        if(size == 1) {
+                pa_mem_set(ptr, *(u8 *)src, num);
+        }
+        else {
+                /* Write one entry, then keep doubling the written block */
+                pa_mem_copy(ptr, src, size);
+                done = 1;
+                while(done < num) {
+                        step = PA_MIN(done, num - done);
+                        pa_mem_copy(ptr + done * size, ptr, step * size);
+                        done += step;
+                }
         }
 
-        /* Return a pointer to the entry */
-        return tbl->buffer + (next_idx * tbl->entry_size);
+        if(start + num > lst->count)
+                lst->count = start + num;
+
+        return num;
 }
 
-PA_INTERN u8 *tbl_next(struct pa_table *tbl, u8 *ptr)
+PA_INTERN void lst_minmax_u8(u8 *data, s32 num, u8 *lo, u8 *hi)
 {
-        s16 idx = -1;
-        s16 next_idx = -1;
-        s16 bucket_num;
+        s32 i = 0;
+#ifdef PA_SSE2
+        __m128i vlo;
+        __m128i vhi;
+        __m128i v;
+        u8 buf[2][16];
+        s32 j;
+#endif
 
-        /*
-         * On the first call ptr will be NULL, so we have to find the first
-         * entry in the table.
-         */
-        if(!ptr) {
-                bucket_num = 0;
-                while(bucket_num < PA_TBL_BUCKETS) {
-                        if(tbl->buckets[bucket_num] >= 0) {
-                                idx = tbl->buckets[bucket_num];
-                                ptr = tbl->buffer + (idx * tbl->entry_size);
-                                break;
-                        }
-                        bucket_num++;
+        *lo = *hi = data[0];
+
+#ifdef PA_SSE2
+        if(num >= 16) {
+                vlo = vhi = _mm_loadu_si128((__m128i *)data);
+                for(i = 16; i + 16 <= num; i += 16) {
+                        v = _mm_loadu_si128((__m128i *)(data + i));
+                        vlo = _mm_min_epu8(vlo, v);
+                        vhi = _mm_max_epu8(vhi, v);
                 }
 
-                return ptr;
+                _mm_storeu_si128((__m128i *)buf[0], vlo);
+                _mm_storeu_si128((__m128i *)buf[1], vhi);
+                for(j = 0; j < 16; j++) {
+                        if(buf[0][j] < *lo) *lo = buf[0][j];
+                        if(buf[1][j] > *hi) *hi = buf[1][j];
+                }
         }
+#endif
 
-        /*
-         * Otherwise we have to get a pointer to the next entry.
-         */
-        next_idx = *(s16 *)ptr;
-        if(next_idx <= -2) {
-                bucket_num = (-1 * next_idx) - 2 + 1;
-                while(bucket_num < PA_TBL_BUCKETS) {
-                        if(tbl->buckets[bucket_num] >= 0) {
-                                next_idx = tbl->buckets[bucket_num];
-                                break;
-                        }
-                        bucket_num++;
+        for(; i < num; i++) {
+                if(data[i] < *lo) *lo = data[i];
+                if(data[i] > *hi) *hi = data[i];
+        }
+}
+
+PA_INTERN void lst_minmax_s16(s16 *data, s32 num, s16 *lo, s16 *hi)
+{
+        s32 i = 0;
+#ifdef PA_SSE2
+        __m128i vlo;
+        __m128i vhi;
+        __m128i v;
+        s16 buf[2][8];
+        s32 j;
+#endif
+
+        *lo = *hi = data[0];
+
+#ifdef PA_SSE2
+        if(num >= 8) {
+                vlo = vhi = _mm_loadu_si128((__m128i *)data);
+                for(i = 8; i + 8 <= num; i += 8) {
+                        v = _mm_loadu_si128((__m128i *)(data + i));
+                        vlo = _mm_min_epi16(vlo, v);
+                        vhi = _mm_max_epi16(vhi, v);
                 }
 
-                /* No more entries left in the table */
-                if(next_idx <= -2)
-                        return NULL;
+                _mm_storeu_si128((__m128i *)buf[0], vlo);
+                _mm_storeu_si128((__m128i *)buf[1], vhi);
+                for(j = 0; j < 8; j++) {
+                        if(buf[0][j] < *lo) *lo = buf[0][j];
+                        if(buf[1][j] > *hi) *hi = buf[1][j];
+                }
         }
+#endif
 
-        /* Return a pointer to the entry */
-        return tbl->buffer + (next_idx * tbl->entry_size);
+        for(; i < num; i++) {
+                if(data[i] < *lo) *lo = data[i];
+                if(data[i] > *hi) *hi = data[i];
+        }
 }
 
-PA_INTERN u8 *tbl_find_key(struct pa_table *tbl, u8 *key, u8 **prev,
-                s16 *bucket_out)
+PA_INTERN void lst_minmax_f32(f32 *data, s32 num, f32 *lo, f32 *hi)
 {
-        u16 hash = tbl_hash(key, tbl->key_size);
-        s16 bucket = hash % PA_TBL_BUCKETS;
-        u8 *ptr = NULL;
-        s16 off = PA_TBL_NEXT_SIZE + PA_TBL_HASH_SIZE;
+        s32 i = 0;
+#ifdef PA_SSE2
+        __m128 vlo;
+        __m128 vhi;
+        __m128 v;
+        f32 buf[2][4];
+        s32 j;
+#endif
 
-        if(tbl->buckets[bucket] < 0)
-                return NULL;
+        *lo = *hi = data[0];
 
-        if(bucket_out) *bucket_out = bucket;
+#ifdef PA_SSE2
+        if(num >= 4) {
+                vlo = vhi = _mm_loadu_ps(data);
+                for(i = 4; i + 4 <= num; i += 4) {
+                        v = _mm_loadu_ps(data + i);
+                        vlo = _mm_min_ps(vlo, v);
+                        vhi = _mm_max_ps(vhi, v);
+                }
 
-        if(prev) *prev = NULL;
-        while((ptr = tbl_next_bucket(tbl, bucket, ptr))) {
-                /* Compare the hashes */
-                if(hash == *(u16 *)(ptr + PA_TBL_NEXT_SIZE)) {
-                        if(pa_mem_compare(key, ptr + off, tbl->key_size)) {
-                                return ptr;
-                        }
+                _mm_storeu_ps(buf[0], vlo);
+                _mm_storeu_ps(buf[1], vhi);
+                for(j = 0; j < 4; j++) {
+                        if(buf[0][j] < *lo) *lo = buf[0][j];
+                        if(buf[1][j] > *hi) *hi = buf[1][j];
                 }
-                if(prev) *prev = ptr;
         }
+#endif
 
-        return NULL;
+        for(; i < num; i++) {
+                if(data[i] < *lo) *lo = data[i];
+                if(data[i] > *hi) *hi = data[i];
+        }
 }
 
-PA_API s8 paInitTable(struct pa_table *tbl, struct pa_memory *mem,
-                s32 key_sz, s32 value_sz, s16 alloc)
+PA_INTERN void lst_minmax_f64(f64 *data, s32 num, f64 *lo, f64 *hi)
 {
-        s32 alloc_sz;
-        s16 i;
+        s32 i = 0;
+#ifdef PA_SSE2
+        __m128d vlo;
+        __m128d vhi;
+        __m128d v;
+        f64 buf[2][2];
+        s32 j;
+#endif
 
-        tbl->memory = mem;
-        tbl->mode = PA_DYNAMIC;
+        *lo = *hi = data[0];
 
-        tbl->key_size = key_sz;
-        tbl->value_size = value_sz;
-        tbl->entry_size = PA_TBL_HEAD_SIZE + key_sz + value_sz;
-        tbl->number = 0;
-        tbl->alloc = alloc;
+#ifdef PA_SSE2
+        if(num >= 2) {
+                vlo = vhi = _mm_loadu_pd(data);
+                for(i = 2; i + 2 <= num; i += 2) {
+                        v = _mm_loadu_pd(data + i);
+                        vlo = _mm_min_pd(vlo, v);
+                        vhi = _mm_max_pd(vhi, v);
+                }
 
-        alloc_sz = tbl->entry_size * tbl->alloc;
-        if(!(tbl->buffer = pa_mem_alloc(tbl->memory, NULL, alloc_sz))) {
-                return -1;
+                _mm_storeu_pd(buf[0], vlo);
+                _mm_storeu_pd(buf[1], vhi);
+                for(j = 0; j < 2; j++) {
+                        if(buf[0][j] < *lo) *lo = buf[0][j];
+                        if(buf[1][j] > *hi) *hi = buf[1][j];
+                }
         }
+#endif
 
-        /* Reset all memory slots in the buffer */
-        for(i = 0; i < tbl->alloc; i++) {
-                *(s16 *)(tbl->buffer + i * tbl->entry_size) = -1;
+        for(; i < num; i++) {
+                if(data[i] < *lo) *lo = data[i];
+                if(data[i] > *hi) *hi = data[i];
         }
+}
 
-        /* Reset all buckets */
-        for(i = 0; i < PA_TBL_BUCKETS; i++) {
-                tbl->buckets[i] = -1;
+/*
+ * Scalar min-max for the types without a SIMD-path.
+ */
+#define LST_MINMAX(type, data, num, lo, hi)                             \
+        do {                                                            \
+                type *d_ = (type *)(data);                              \
+                s32 i_;                                                 \
+                *(type *)(lo) = *(type *)(hi) = d_[0];                  \
+                for(i_ = 1; i_ < (num); i_++) {                         \
+                        if(d_[i_] < *(type *)(lo)) *(type *)(lo) = d_[i_]; \
+                        if(d_[i_] > *(type *)(hi)) *(type *)(hi) = d_[i_]; \
+                }                                                       \
+        } while(0)
+
+PA_API s8 paMinMaxList(struct pa_list *lst, enum pa_number_type type,
+                void *min, void *max)
+{
+        /* Use unions to keep the results aligned */
+        union { u8 bytes[8]; f64 f; s64 s; u64 u; } lo;
+        union { u8 bytes[8]; f64 f; s64 s; u64 u; } hi;
+        s16 size = lst->entry_size;
+        u8 *data = lst->data;
+        s32 num = lst->count;
+
+        if(num < 1)
+                return -1;
+
+        if(type == PA_FLOAT) {
+                if(size == 4)
+                        lst_minmax_f32((f32 *)data, num, (f32 *)lo.bytes,
+                                        (f32 *)hi.bytes);
+                else if(size == 8)
+                        lst_minmax_f64((f64 *)data, num, &lo.f, &hi.f);
+                else
+                        return -1;
+        }
+        else if(type == PA_SIGNED) {
+                switch(size) {
+                        case 1: LST_MINMAX(s8, data, num, lo.bytes, hi.bytes);
+                                break;
+                        case 2: lst_minmax_s16((s16 *)data, num,
+                                                (s16 *)lo.bytes,
+                                                (s16 *)hi.bytes);
+                                break;
+                        case 4: LST_MINMAX(s32, data, num, lo.bytes, hi.bytes);
+                                break;
+                        case 8: if(sizeof(s64) != 8) return -1;
+                                LST_MINMAX(s64, data, num, lo.bytes, hi.bytes);
+                                break;
+                        default: return -1;
+                }
+        }
+        else {
+                switch(size) {
+                        case 1: lst_minmax_u8(data, num, lo.bytes, hi.bytes);
+                                break;
+                        case 2: LST_MINMAX(u16, data, num, lo.bytes, hi.bytes);
+                                break;
+                        case 4: LST_MINMAX(u32, data, num, lo.bytes, hi.bytes);
+                                break;
+                        case 8: if(sizeof(u64) != 8) return -1;
+                                LST_MINMAX(u64, data, num, lo.bytes, hi.bytes);
+                                break;
+                        default: return -1;
+                }
         }
 
+        if(min) pa_mem_copy(min, lo.bytes, size);
+        if(max) pa_mem_copy(max, hi.bytes, size);
         return 0;
 }
 
-PA_API s8 paInitTableFixed(struct pa_table *tbl, void *buffer,
-                s32 buf_sz, s32 key_sz, s32 value_sz)
+#undef LST_MINMAX
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      SMALL-LIST
+ *
+ */
+
+/*
+ * Move the entries from the inline buffer to the heap, if the new entries
+ * don't fit into the inline buffer anymore. Once spilled, the wrapped list is
+ * dynamic and scales by itself.
+ */
+PA_INTERN void sml_spill(struct pa_small_list *lst, s32 num)
 {
-        s16 i;
+        struct pa_list *l = &lst->list;
+        s32 new_alloc;
+        s32 new_size;
+        void *p;
 
-        tbl->memory = NULL;
-        tbl->mode = PA_FIXED;
+        if(l->mode != PA_FIXED || !lst->spill)
+                return;
 
-        tbl->key_size = key_sz;
-        tbl->value_size = value_sz;
-        tbl->entry_size = PA_TBL_HEAD_SIZE + value_sz;
-        tbl->number = 0;
-        tbl->buffer = buffer;
+        if(l->count + num <= l->alloc)
+                return;
+
+        new_alloc = PA_MAX(l->count + num, l->alloc) * 2;
+        new_size = new_alloc * l->entry_size;
+
+        if(!(p = pa_mem_alloc(lst->spill, NULL, new_size)))
+                return;
+
+        pa_mem_copy(p, l->data, l->count * l->entry_size);
+
+        l->memory = lst->spill;
+        l->mode = PA_DYNAMIC;
+        l->data = p;
+        l->alloc = new_alloc;
+        l->alloc_size = new_size;
+        l->limit = PA_NOLIM;
+}
+
+PA_API s8 paInitSmallList(struct pa_small_list *lst, struct pa_memory *mem,
+                s16 size)
+{
+        lst->spill = mem;
+
+        return paInitListFixed(&lst->list, size, lst->inline_buffer.bytes,
+                        PA_SMALL_LIST_SIZE);
+}
+
+PA_API void paDestroySmallList(struct pa_small_list *lst)
+{
+        paDestroyList(&lst->list);
+
+        lst->list.mode = PA_MEM_UDEF;
+        lst->list.count = 0;
+}
+
+PA_API void paClearSmallList(struct pa_small_list *lst)
+{
+        lst->list.count = 0;
+}
+
+PA_API s16 paPushSmallList(struct pa_small_list *lst, void *src, s16 num)
+{
+        sml_spill(lst, num);
+        return paPushList(&lst->list, src, num);
+}
+
+PA_API s16 paPopSmallList(struct pa_small_list *lst, void *dst, s16 num)
+{
+        return paPopList(&lst->list, dst, num);
+}
+
+PA_API s16 paInsertSmallList(struct pa_small_list *lst, void *src, s16 start,
+                s16 num)
+{
+        sml_spill(lst, num);
+        return paInsertList(&lst->list, src, start, num);
+}
+
+PA_API void *paIterateSmallList(struct pa_small_list *lst, void *ptr)
+{
+        if(lst->list.count < 1)
+                return NULL;
+
+        return paIterateList(&lst->list, ptr);
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      COLUMN-LIST
+ *
+ */
+
+PA_INTERN s32 col_align(s32 size)
+{
+        return (size + PA_COLUMN_ALIGN - 1) & ~(PA_COLUMN_ALIGN - 1);
+}
+
+/*
+ * Calculate the number of bytes needed to store the given number of rows,
+ * including the padding to align the buffer and the columns.
+ */
+PA_INTERN s32 col_buffer_size(struct pa_column_list *lst, s32 rows)
+{
+        s32 size = PA_COLUMN_ALIGN;
+        s16 i;
+
+        for(i = 0; i < lst->columns; i++)
+                size += col_align(rows * lst->sizes[i]);
+
+        return size;
+}
+
+/*
+ * Set the column-pointers for the given buffer and number of rows.
+ */
+PA_INTERN void col_layout(struct pa_column_list *lst, u8 *buf, s32 rows,
+                u8 **data)
+{
+        u8 *ptr = buf;
+        s16 i;
+
+        /* Align the first column */
+        ptr += (PA_COLUMN_ALIGN - ((unsigned long)ptr % PA_COLUMN_ALIGN)) %
+                PA_COLUMN_ALIGN;
+
+        for(i = 0; i < lst->columns; i++) {
+                data[i] = ptr;
+                ptr += col_align(rows * lst->sizes[i]);
+        }
+}
+
+/*
+ * Scale the column-list to fit the given number of new rows. As all columns
+ * share one buffer, the columns have to be copied one by one into the new
+ * buffer.
+ */
+PA_INTERN void col_ensure_fit(struct pa_column_list *lst, s32 num)
+{
+        s32 new_num = lst->count + num;
+        s32 new_alloc;
+        s32 new_size;
+        u8 *data[PA_COLUMNS_MAX];
+        u8 *p;
+        s16 i;
+
+        if(lst->mode != PA_DYNAMIC)
+                return;
+
+        if(new_num <= lst->alloc)
+                return;
+
+        new_alloc = new_num * 1.5;
+        new_size = col_buffer_size(lst, new_alloc);
+
+        if(!(p = pa_mem_alloc(lst->memory, NULL, new_size)))
+                return;
+
+        col_layout(lst, p, new_alloc, data);
+        for(i = 0; i < lst->columns; i++) {
+                pa_mem_copy(data[i], lst->data[i], lst->count * lst->sizes[i]);
+                lst->data[i] = data[i];
+        }
+
+        pa_mem_free(lst->memory, lst->buffer);
+
+        lst->buffer = p;
+        lst->buffer_size = new_size;
+        lst->alloc = new_alloc;
+}
+
+/*
+ * Copy the fields of a row to the packed row and the other way around.
+ */
+PA_INTERN void col_pack(struct pa_column_list *lst, s16 idx, u8 *dst)
+{
+        s16 i;
+
+        for(i = 0; i < lst->columns; i++) {
+                pa_mem_copy(dst, lst->data[i] + idx * lst->sizes[i],
+                                lst->sizes[i]);
+                dst += lst->sizes[i];
+        }
+}
+
+PA_INTERN void col_unpack(struct pa_column_list *lst, s16 idx, u8 *src)
+{
+        s16 i;
+
+        for(i = 0; i < lst->columns; i++) {
+                pa_mem_copy(lst->data[i] + idx * lst->sizes[i], src,
+                                lst->sizes[i]);
+                src += lst->sizes[i];
+        }
+}
+
+PA_INTERN s8 col_set_columns(struct pa_column_list *lst, s16 *sizes,
+                s16 columns)
+{
+        s16 i;
+
+        if(columns < 1 || columns > PA_COLUMNS_MAX)
+                return -1;
+
+        lst->columns = columns;
+        lst->row_size = 0;
+        for(i = 0; i < columns; i++) {
+                if(sizes[i] < 1)
+                        return -1;
+
+                lst->sizes[i] = sizes[i];
+                lst->row_size += sizes[i];
+        }
+
+        return 0;
+}
+
+PA_API s8 paInitColumnList(struct pa_column_list *lst, struct pa_memory *mem,
+                s16 *sizes, s16 columns, s16 alloc)
+{
+        if(col_set_columns(lst, sizes, columns) < 0)
+                return -1;
+
+        lst->memory = mem;
+        lst->mode = PA_DYNAMIC;
+        lst->count = 0;
+        lst->alloc = alloc;
+        lst->buffer_size = col_buffer_size(lst, alloc);
+
+        if(!(lst->buffer = pa_mem_alloc(lst->memory, NULL, lst->buffer_size)))
+                return -1;
+
+        col_layout(lst, lst->buffer, lst->alloc, lst->data);
+        return 0;
+}
+
+PA_API s8 paInitColumnListFixed(struct pa_column_list *lst, s16 *sizes,
+                s16 columns, void *buf, s32 buf_sz)
+{
+        s32 rows;
+
+        if(col_set_columns(lst, sizes, columns) < 0)
+                return -1;
+
+        lst->memory = NULL;
+        lst->mode = PA_FIXED;
+        lst->buffer = buf;
+        lst->buffer_size = buf_sz;
+        lst->count = 0;
+
+        /*
+         * Every column might need some padding, so start with an estimate
+         * and reduce the number of rows until everything fits.
+         */
+        rows = buf_sz / lst->row_size;
+        while(rows > 0 && col_buffer_size(lst, rows) > buf_sz)
+                rows--;
+
+        lst->alloc = rows;
+        col_layout(lst, lst->buffer, lst->alloc, lst->data);
+        return 0;
+}
+
+PA_API void paDestroyColumnList(struct pa_column_list *lst)
+{
+        if(lst->mode == PA_DYNAMIC) {
+                pa_mem_free(lst->memory, lst->buffer);
+        }
+
+        lst->mode = PA_MEM_UDEF;
+        lst->buffer = NULL;
+        lst->count = 0;
+        lst->alloc = 0;
+}
+
+PA_API void paClearColumnList(struct pa_column_list *lst)
+{
+        lst->count = 0;
+}
+
+PA_API s8 paPushColumnList(struct pa_column_list *lst, void *src)
+{
+        /* If configured as dynamic, scale to fit the new row */
+        col_ensure_fit(lst, 1);
+
+        if(lst->count >= lst->alloc)
+                return 0;
+
+        col_unpack(lst, lst->count, src);
+        lst->count++;
+        return 1;
+}
+
+PA_API s8 paPopColumnList(struct pa_column_list *lst, void *dst)
+{
+        if(lst->count < 1)
+                return 0;
+
+        lst->count--;
+        if(dst) col_pack(lst, lst->count, dst);
+        return 1;
+}
+
+PA_API s8 paRemoveColumnList(struct pa_column_list *lst, s16 idx, void *dst)
+{
+        s16 last = lst->count - 1;
+        s16 i;
+
+        if(idx < 0 || idx >= lst->count)
+                return 0;
+
+        if(dst) col_pack(lst, idx, dst);
+
+        /* Move the last row into the gap */
+        if(idx != last) {
+                for(i = 0; i < lst->columns; i++) {
+                        pa_mem_copy(lst->data[i] + idx * lst->sizes[i],
+                                        lst->data[i] + last * lst->sizes[i],
+                                        lst->sizes[i]);
+                }
+        }
+
+        lst->count--;
+        return 1;
+}
+
+PA_API s8 paPeekColumnList(struct pa_column_list *lst, void *dst, s16 idx)
+{
+        if(idx < 0 || idx >= lst->count)
+                return 0;
+
+        col_pack(lst, idx, dst);
+        return 1;
+}
+
+PA_API s8 paWriteColumnList(struct pa_column_list *lst, void *src, s16 idx)
+{
+        if(idx < 0 || idx >= lst->count)
+                return 0;
+
+        col_unpack(lst, idx, src);
+        return 1;
+}
+
+PA_API void *paGetColumn(struct pa_column_list *lst, s16 col)
+{
+        if(col < 0 || col >= lst->columns)
+                return NULL;
+
+        return lst->data[col];
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      WORKER-POOL
+ *
+ */
+
+#ifdef PA_PTHREADS
+
+/*
+ * The range of entries left for a single thread.
+ */
+struct wkp_range {
+        pthread_mutex_t lock;
+        s32             begin;
+        s32             end;
+};
+
+struct wkp_state {
+        pthread_mutex_t lock;
+        pthread_cond_t  wake;   /* Signaled when a new job is started */
+        pthread_cond_t  done;   /* Signaled when the last thread is done */
+
+        pthread_t       *threads;
+        struct wkp_range *ranges; /* One range per thread plus the caller */
+        s16             number;
+        s32             grain;
+
+        u32             job;    /* Incremented for every new job */
+        s16             active; /* Number of threads still working */
+        s8              quit;
+        volatile s8     stop;   /* Set if a callback returned 1 */
+
+        struct pa_list  *list;
+        pa_list_func    func;
+        void            *pass;
+};
+
+struct wkp_arg {
+        struct wkp_state *state;
+        s16             index;
+};
+
+/*
+ * Take the next piece from the given range.
+ *
+ * Returns: 1 if a piece has been taken and 0 if the range is empty
+ */
+PA_INTERN s8 wkp_take(struct wkp_state *st, s16 idx, s32 *begin, s32 *end)
+{
+        struct wkp_range *rng = &st->ranges[idx];
+        s8 ret = 0;
+
+        pthread_mutex_lock(&rng->lock);
+        if(rng->begin < rng->end) {
+                *begin = rng->begin;
+                *end = PA_MIN(rng->begin + st->grain, rng->end);
+                rng->begin = *end;
+                ret = 1;
+        }
+        pthread_mutex_unlock(&rng->lock);
+
+        return ret;
+}
+
+/*
+ * Steal the back half of the biggest range left and make it the range of the
+ * thread with the given index.
+ *
+ * Returns: 1 if something has been stolen and 0 if all work is done
+ */
+PA_INTERN s8 wkp_steal(struct wkp_state *st, s16 idx)
+{
+        struct wkp_range *rng;
+        s32 left;
+        s32 max_left;
+        s32 mid;
+        s32 end;
+        s16 victim;
+        s16 i;
+
+        while(!st->stop) {
+                /* Look for the biggest range without locking */
+                victim = -1;
+                max_left = 0;
+                for(i = 0; i <= st->number; i++) {
+                        left = st->ranges[i].end - st->ranges[i].begin;
+                        if(i != idx && left > max_left) {
+                                max_left = left;
+                                victim = i;
+                        }
+                }
+
+                if(victim < 0)
+                        return 0;
+
+                /* The range might have changed, so check again */
+                rng = &st->ranges[victim];
+                pthread_mutex_lock(&rng->lock);
+                left = rng->end - rng->begin;
+                if(left < 1) {
+                        pthread_mutex_unlock(&rng->lock);
+                        continue;
+                }
+                mid = rng->begin + left / 2;
+                end = rng->end;
+                rng->end = mid;
+                pthread_mutex_unlock(&rng->lock);
+
+                rng = &st->ranges[idx];
+                pthread_mutex_lock(&rng->lock);
+                rng->begin = mid;
+                rng->end = end;
+                pthread_mutex_unlock(&rng->lock);
+                return 1;
+        }
+
+        return 0;
+}
+
+/*
+ * Process pieces until there is nothing left to take or steal.
+ */
+PA_INTERN void wkp_work(struct wkp_state *st, s16 idx)
+{
+        struct pa_handle hdl;
+        struct pa_list *lst = st->list;
+        s32 begin;
+        s32 end;
+        s32 i;
+
+        do {
+                while(!st->stop && wkp_take(st, idx, &begin, &end)) {
+                        for(i = begin; i < end; i++) {
+                                hdl.pointer = lst->data + (i * lst->entry_size);
+                                hdl.index = i;
+                                if(st->func(&hdl, st->pass)) {
+                                        st->stop = 1;
+                                        break;
+                                }
+                        }
+                }
+        } while(wkp_steal(st, idx));
+}
+
+PA_INTERN void *wkp_thread(void *p)
+{
+        struct wkp_arg *arg = p;
+        struct wkp_state *st = arg->state;
+        u32 job = 0;
+
+        while(1) {
+                /* Wait for a new job or the signal to quit */
+                pthread_mutex_lock(&st->lock);
+                while(!st->quit && st->job == job)
+                        pthread_cond_wait(&st->wake, &st->lock);
+
+                if(st->quit) {
+                        pthread_mutex_unlock(&st->lock);
+                        break;
+                }
+                job = st->job;
+                pthread_mutex_unlock(&st->lock);
+
+                wkp_work(st, arg->index);
+
+                pthread_mutex_lock(&st->lock);
+                if(--st->active == 0)
+                        pthread_cond_signal(&st->done);
+                pthread_mutex_unlock(&st->lock);
+        }
+
+        return NULL;
+}
+
+PA_INTERN void wkp_stop(struct wkp_state *st, s16 started)
+{
+        s16 i;
+
+        pthread_mutex_lock(&st->lock);
+        st->quit = 1;
+        pthread_cond_broadcast(&st->wake);
+        pthread_mutex_unlock(&st->lock);
+
+        for(i = 0; i < started; i++)
+                pthread_join(st->threads[i], NULL);
+
+        for(i = 0; i <= st->number; i++)
+                pthread_mutex_destroy(&st->ranges[i].lock);
+
+        pthread_cond_destroy(&st->done);
+        pthread_cond_destroy(&st->wake);
+        pthread_mutex_destroy(&st->lock);
+}
+
+PA_API s8 paInitWorkerPool(struct pa_worker_pool *pool, struct pa_memory *mem,
+                s16 threads)
+{
+        struct wkp_state *st;
+        struct wkp_arg *args;
+        s32 size;
+        s16 i;
+
+        pool->memory = mem;
+        pool->number = threads < 0 ? 0 : threads;
+        pool->grain = PA_WORKER_GRAIN;
+
+        /* Allocate the state, the thread-handles, the ranges and arguments */
+        size = sizeof(struct wkp_state) +
+                pool->number * sizeof(pthread_t) +
+                (pool->number + 1) * sizeof(struct wkp_range) +
+                pool->number * sizeof(struct wkp_arg);
+
+        if(!(st = pa_mem_alloc(mem, NULL, size)))
+                return -1;
+
+        st->threads = (pthread_t *)(st + 1);
+        st->ranges = (struct wkp_range *)(st->threads + pool->number);
+        args = (struct wkp_arg *)(st->ranges + pool->number + 1);
+
+        st->number = pool->number;
+        st->grain = pool->grain;
+        st->job = 0;
+        st->active = 0;
+        st->quit = 0;
+        st->stop = 0;
+
+        pthread_mutex_init(&st->lock, NULL);
+        pthread_cond_init(&st->wake, NULL);
+        pthread_cond_init(&st->done, NULL);
+
+        for(i = 0; i <= st->number; i++) {
+                pthread_mutex_init(&st->ranges[i].lock, NULL);
+                st->ranges[i].begin = 0;
+                st->ranges[i].end = 0;
+        }
+
+        for(i = 0; i < st->number; i++) {
+                args[i].state = st;
+                args[i].index = i;
+                if(pthread_create(&st->threads[i], NULL, &wkp_thread,
+                                        &args[i]) != 0) {
+                        wkp_stop(st, i);
+                        pa_mem_free(mem, st);
+                        return -1;
+                }
+        }
+
+        pool->state = st;
+        return 0;
+}
+
+PA_API void paDestroyWorkerPool(struct pa_worker_pool *pool)
+{
+        struct wkp_state *st = pool->state;
+
+        if(!st)
+                return;
+
+        wkp_stop(st, st->number);
+        pa_mem_free(pool->memory, st);
+
+        pool->state = NULL;
+        pool->number = 0;
+}
+
+PA_API void paApplyListParallel(struct pa_list *lst,
+                struct pa_worker_pool *pool, pa_list_func fnc, void *pass)
+{
+        struct wkp_state *st = pool->state;
+        s32 per_thread;
+        s16 i;
+
+        /* Not worth waking up the threads */
+        if(!st || st->number < 1 || lst->count <= pool->grain) {
+                paApplyList(lst, fnc, pass);
+                return;
+        }
+
+        /* Split the list evenly, the caller takes the last range */
+        st->grain = PA_MAX(pool->grain, 1);
+        per_thread = lst->count / (st->number + 1);
+        for(i = 0; i <= st->number; i++) {
+                st->ranges[i].begin = i * per_thread;
+                st->ranges[i].end = (i == st->number) ?
+                        lst->count : (i + 1) * per_thread;
+        }
+
+        st->list = lst;
+        st->func = fnc;
+        st->pass = pass;
+        st->stop = 0;
+
+        /* Wake up all threads */
+        pthread_mutex_lock(&st->lock);
+        st->active = st->number;
+        st->job++;
+        pthread_cond_broadcast(&st->wake);
+        pthread_mutex_unlock(&st->lock);
+
+        wkp_work(st, st->number);
+
+        /* Wait for all threads to finish */
+        pthread_mutex_lock(&st->lock);
+        while(st->active > 0)
+                pthread_cond_wait(&st->done, &st->lock);
+        pthread_mutex_unlock(&st->lock);
+}
+
+#else /* PA_PTHREADS */
+
+PA_API s8 paInitWorkerPool(struct pa_worker_pool *pool, struct pa_memory *mem,
+                s16 threads)
+{
+        PA_IGNORE(threads);
+
+        pool->memory = mem;
+        pool->number = 0;
+        pool->grain = PA_WORKER_GRAIN;
+        pool->state = NULL;
+        return 0;
+}
+
+PA_API void paDestroyWorkerPool(struct pa_worker_pool *pool)
+{
+        pool->state = NULL;
+        pool->number = 0;
+}
+
+PA_API void paApplyListParallel(struct pa_list *lst,
+                struct pa_worker_pool *pool, pa_list_func fnc, void *pass)
+{
+        PA_IGNORE(pool);
+
+        paApplyList(lst, fnc, pass);
+}
+
+#endif /* PA_PTHREADS */
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      CHUNK-LIST
+ *
+ */
+
+PA_INTERN u8 *chl_chunk(struct pa_chunk_list *lst, s16 chunk)
+{
+        return *(u8 **)(lst->chunks.data + chunk * sizeof(u8 *));
+}
+
+PA_INTERN u8 *chl_entry(struct pa_chunk_list *lst, s16 idx)
+{
+        s16 chunk = idx / lst->chunk_entries;
+        s16 slot = idx % lst->chunk_entries;
+
+        return chl_chunk(lst, chunk) + slot * lst->entry_size;
+}
+
+/*
+ * Append a new chunk to the list. This only works if the list is dynamic.
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_INTERN s8 chl_add_chunk(struct pa_chunk_list *lst)
+{
+        u8 *chunk;
+        s32 size = lst->chunk_entries * lst->entry_size;
+
+        if(lst->mode != PA_DYNAMIC)
+                return -1;
+
+        if(!(chunk = pa_mem_alloc(lst->memory, NULL, size)))
+                return -1;
+
+        if(paPushList(&lst->chunks, &chunk, 1) < 1) {
+                pa_mem_free(lst->memory, chunk);
+                return -1;
+        }
+
+        return 0;
+}
+
+PA_API s8 paInitChunkList(struct pa_chunk_list *lst, struct pa_memory *mem,
+                s16 size, s16 chunk, s16 alloc)
+{
+        s16 num;
+
+        if(size < 1 || chunk < 1)
+                return -1;
+
+        lst->memory = mem;
+        lst->mode = PA_DYNAMIC;
+        lst->entry_size = size;
+        lst->chunk_entries = chunk;
+        lst->count = 0;
+
+        num = (alloc + chunk - 1) / chunk;
+        if(paInitList(&lst->chunks, mem, sizeof(u8 *), PA_MAX(num, 4),
+                                PA_NOLIM) < 0)
+                return -1;
+
+        while(num-- > 0) {
+                if(chl_add_chunk(lst) < 0) {
+                        paDestroyChunkList(lst);
+                        return -1;
+                }
+        }
+
+        return 0;
+}
+
+PA_API s8 paInitChunkListFixed(struct pa_chunk_list *lst, s16 size, s16 chunk,
+                void *buf, s32 buf_sz)
+{
+        u8 *ptr = buf;
+        u8 *chunk_ptr;
+        s32 chunk_sz;
+        s32 table_sz;
+        s32 num;
+        s16 i;
+
+        if(size < 1 || chunk < 1 || buf_sz < 8)
+                return -1;
+
+        lst->memory = NULL;
+        lst->mode = PA_FIXED;
+        lst->entry_size = size;
+        lst->chunk_entries = chunk;
+        lst->count = 0;
+
+        /*
+         * The chunk-pointers are stored at the beginning of the buffer,
+         * followed by the chunks aligned to 8 bytes.
+         */
+        chunk_sz = chunk * size;
+        num = (buf_sz - 8) / (chunk_sz + (s32)sizeof(u8 *));
+        if(num < 1)
+                return -1;
+
+        if(num > 0x7FFF)
+                num = 0x7FFF;
+
+        table_sz = (num * sizeof(u8 *) + 7) & ~7;
+        paInitListFixed(&lst->chunks, sizeof(u8 *), ptr, table_sz);
+
+        for(i = 0; i < num; i++) {
+                chunk_ptr = ptr + table_sz + i * chunk_sz;
+                paPushList(&lst->chunks, &chunk_ptr, 1);
+        }
+
+        return 0;
+}
+
+PA_API void paDestroyChunkList(struct pa_chunk_list *lst)
+{
+        s16 i;
+
+        if(lst->mode == PA_DYNAMIC) {
+                for(i = 0; i < lst->chunks.count; i++)
+                        pa_mem_free(lst->memory, chl_chunk(lst, i));
+        }
+
+        paDestroyList(&lst->chunks);
+
+        lst->mode = PA_MEM_UDEF;
+        lst->count = 0;
+}
+
+PA_API void paClearChunkList(struct pa_chunk_list *lst)
+{
+        lst->count = 0;
+}
+
+PA_API s16 paPushChunkList(struct pa_chunk_list *lst, void *src, s16 num)
+{
+        s16 written = 0;
+        s16 slot;
+        s16 entry_number;
+        u8 *ptr = src;
+
+        while(written < num) {
+                /* Append a new chunk if all chunks are full */
+                if(lst->count >= lst->chunks.count * lst->chunk_entries) {
+                        if(chl_add_chunk(lst) < 0)
+                                break;
+                }
+
+                /* Fill up the current chunk as much as possible */
+                slot = lst->count % lst->chunk_entries;
+                entry_number = PA_MIN(num - written, lst->chunk_entries - slot);
+                pa_mem_copy(chl_entry(lst, lst->count), ptr,
+                                entry_number * lst->entry_size);
+
+                ptr += entry_number * lst->entry_size;
+                written += entry_number;
+                lst->count += entry_number;
+        }
+
+        return written;
+}
+
+PA_API s16 paPopChunkList(struct pa_chunk_list *lst, void *dst, s16 num)
+{
+        s16 entry_number;
+        s16 start;
+        s16 idx;
+        s16 copy_num;
+        u8 *ptr = dst;
+
+        /* Figure out how many entries can be returned */
+        entry_number = num > lst->count ? lst->count : num;
+        start = lst->count - entry_number;
+
+        /* Copy the entries chunk by chunk, keeping their order */
+        idx = start;
+        while(idx < lst->count) {
+                copy_num = lst->chunk_entries - (idx % lst->chunk_entries);
+                copy_num = PA_MIN(copy_num, lst->count - idx);
+                pa_mem_copy(ptr, chl_entry(lst, idx),
+                                copy_num * lst->entry_size);
+
+                ptr += copy_num * lst->entry_size;
+                idx += copy_num;
+        }
+
+        lst->count = start;
+        return entry_number;
+}
+
+PA_API void *paIndexChunkList(struct pa_chunk_list *lst, s16 idx)
+{
+        if(idx < 0 || idx >= lst->count)
+                return NULL;
+
+        return chl_entry(lst, idx);
+}
+
+PA_API void *paSpanChunkList(struct pa_chunk_list *lst, s16 chunk, s16 *num)
+{
+        s16 start = chunk * lst->chunk_entries;
+
+        if(chunk < 0 || start >= lst->count) {
+                *num = 0;
+                return NULL;
+        }
+
+        *num = PA_MIN(lst->chunk_entries, lst->count - start);
+        return chl_chunk(lst, chunk);
+}
+
+PA_API void *paIterateChunkList(struct pa_chunk_list *lst,
+                struct pa_handle *hdl)
+{
+        /* First step, start with the first entry */
+        if(hdl->pointer == NULL) {
+                hdl->index = 0;
+        }
+        else {
+                hdl->index++;
+        }
+
+        if(hdl->index >= lst->count) {
+                hdl->pointer = NULL;
+                return NULL;
+        }
+
+        /* Only jump to the next chunk if the current one is done */
+        if(hdl->index % lst->chunk_entries == 0) {
+                hdl->pointer = chl_chunk(lst, hdl->index / lst->chunk_entries);
+        }
+        else {
+                hdl->pointer = (u8 *)hdl->pointer + lst->entry_size;
+        }
+
+        return hdl->pointer;
+}
+
+PA_API void paApplyChunkList(struct pa_chunk_list *lst, pa_list_func fnc,
+                void *pass)
+{
+        struct pa_handle hdl;
+
+        hdl.pointer = NULL;
+        while(paIterateChunkList(lst, &hdl)) {
+                if(fnc(&hdl, pass)) return;
+        }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      SLOTMAP
+ *
+ */
+
+PA_INTERN struct pa_slot *smp_slot(struct pa_slotmap *map, s16 idx)
+{
+        return (struct pa_slot *)(map->slots.data + idx * PA_SLOT_SIZE);
+}
+
+PA_INTERN s16 *smp_owner(struct pa_slotmap *map, s16 idx)
+{
+        return (s16 *)(map->owner.data + idx * sizeof(s16));
+}
+
+/*
+ * Check if the handle still references a used slot.
+ */
+PA_INTERN struct pa_slot *smp_resolve(struct pa_slotmap *map,
+                struct pa_slot_handle hdl)
+{
+        struct pa_slot *slot;
+
+        if(hdl.index < 0 || hdl.index >= map->slots.count)
+                return NULL;
+
+        /* Used slots always have an odd generation */
+        slot = smp_slot(map, hdl.index);
+        if(slot->generation != hdl.generation || slot->generation % 2 == 0)
+                return NULL;
+
+        return slot;
+}
+
+PA_API s8 paInitSlotMap(struct pa_slotmap *map, struct pa_memory *mem,
+                s16 size, s16 alloc)
+{
+        if(paInitList(&map->data, mem, size, alloc, PA_NOLIM) < 0)
+                return -1;
+
+        if(paInitList(&map->slots, mem, PA_SLOT_SIZE, alloc, PA_NOLIM) < 0)
+                goto err_destroy_data;
+
+        if(paInitList(&map->owner, mem, sizeof(s16), alloc, PA_NOLIM) < 0)
+                goto err_destroy_slots;
+
+        map->free_head = -1;
+        return 0;
+
+err_destroy_slots:
+        paDestroyList(&map->slots);
+
+err_destroy_data:
+        paDestroyList(&map->data);
+
+        return -1;
+}
+
+PA_API s8 paInitSlotMapFixed(struct pa_slotmap *map, s16 size, void *buf,
+                s32 buf_sz)
+{
+        u8 *ptr = buf;
+        s32 num;
+        s32 slots_sz;
+        s32 owner_sz;
+        s32 head_sz;
+
+        /*
+         * The slots and owner-indices come first, followed by the entries,
+         * which are aligned to 8 bytes.
+         */
+        if(buf_sz < 8)
+                return -1;
+
+        num = (buf_sz - 8) / (size + PA_SLOT_SIZE + (s32)sizeof(s16));
+        if(num < 1)
+                return -1;
+
+        if(num > 0x7FFF)
+                num = 0x7FFF;
+
+        slots_sz = num * PA_SLOT_SIZE;
+        owner_sz = num * sizeof(s16);
+        head_sz = (slots_sz + owner_sz + 7) & ~7;
+
+        paInitListFixed(&map->slots, PA_SLOT_SIZE, ptr, slots_sz);
+        paInitListFixed(&map->owner, sizeof(s16), ptr + slots_sz, owner_sz);
+        paInitListFixed(&map->data, size, ptr + head_sz, num * size);
+
+        map->free_head = -1;
+        return 0;
+}
+
+PA_API void paDestroySlotMap(struct pa_slotmap *map)
+{
+        paDestroyList(&map->data);
+        paDestroyList(&map->slots);
+        paDestroyList(&map->owner);
+
+        map->free_head = -1;
+}
+
+PA_API void paClearSlotMap(struct pa_slotmap *map)
+{
+        struct pa_slot *slot;
+        s16 i;
+
+        /*
+         * Keep the slots, so the generations are preserved, but free all of
+         * them so old handles become invalid.
+         */
+        map->free_head = -1;
+        for(i = map->slots.count - 1; i >= 0; i--) {
+                slot = smp_slot(map, i);
+                if(slot->generation % 2 == 1)
+                        slot->generation++;
+
+                slot->index = map->free_head;
+                map->free_head = i;
+        }
+
+        map->data.count = 0;
+        map->owner.count = 0;
+}
+
+PA_API s8 paInsertSlotMap(struct pa_slotmap *map, void *src,
+                struct pa_slot_handle *out)
+{
+        struct pa_slot new_slot;
+        struct pa_slot *slot;
+        s16 slot_idx;
+        s16 data_idx = map->data.count;
+
+        /* Write the entry to the end of the dense list */
+        if(paPushList(&map->data, src, 1) < 1)
+                return -1;
+
+        /* Reuse a free slot if there is one, otherwise create a new one */
+        if(map->free_head >= 0) {
+                slot_idx = map->free_head;
+                slot = smp_slot(map, slot_idx);
+                map->free_head = slot->index;
+        }
+        else {
+                new_slot.index = -1;
+                new_slot.generation = 0;
+
+                slot_idx = map->slots.count;
+                if(paPushList(&map->slots, &new_slot, 1) < 1)
+                        goto err_pop_data;
+
+                slot = smp_slot(map, slot_idx);
+        }
+
+        if(paPushList(&map->owner, &slot_idx, 1) < 1)
+                goto err_free_slot;
+
+        slot->index = data_idx;
+        slot->generation++;
+
+        if(out) {
+                out->index = slot_idx;
+                out->generation = slot->generation;
+        }
+
+        return 0;
+
+err_free_slot:
+        slot->index = map->free_head;
+        map->free_head = slot_idx;
+
+err_pop_data:
+        map->data.count--;
+        return -1;
+}
+
+PA_API s8 paRemoveSlotMap(struct pa_slotmap *map, struct pa_slot_handle hdl,
+                void *dst)
+{
+        struct pa_slot *slot;
+        s16 data_idx;
+        s16 last_idx;
+        s16 last_slot;
+        s32 size = map->data.entry_size;
+
+        if(!(slot = smp_resolve(map, hdl)))
+                return 0;
+
+        data_idx = slot->index;
+        last_idx = map->data.count - 1;
+
+        if(dst) {
+                pa_mem_copy(dst, map->data.data + data_idx * size, size);
+        }
+
+        /* Move the last entry into the gap and update its slot */
+        if(data_idx != last_idx) {
+                pa_mem_copy(map->data.data + data_idx * size,
+                                map->data.data + last_idx * size, size);
+
+                last_slot = *smp_owner(map, last_idx);
+                *smp_owner(map, data_idx) = last_slot;
+                smp_slot(map, last_slot)->index = data_idx;
+        }
+
+        map->data.count--;
+        map->owner.count--;
+
+        /* Invalidate all handles and push the slot onto the free-list */
+        slot->generation++;
+        slot->index = map->free_head;
+        map->free_head = hdl.index;
+
+        return 1;
+}
+
+PA_API void *paLookupSlotMap(struct pa_slotmap *map, struct pa_slot_handle hdl)
+{
+        struct pa_slot *slot;
+
+        if(!(slot = smp_resolve(map, hdl)))
+                return NULL;
+
+        return map->data.data + slot->index * map->data.entry_size;
+}
+
+PA_API s8 paHandleSlotMap(struct pa_slotmap *map, s16 idx,
+                struct pa_slot_handle *out)
+{
+        s16 slot_idx;
+
+        if(idx < 0 || idx >= map->data.count)
+                return -1;
+
+        slot_idx = *smp_owner(map, idx);
+        out->index = slot_idx;
+        out->generation = smp_slot(map, slot_idx)->generation;
+        return 0;
+}
+
+PA_API void *paIterateSlotMap(struct pa_slotmap *map, void *ptr)
+{
+        if(map->data.count < 1)
+                return NULL;
+
+        return paIterateList(&map->data, ptr);
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      HEAP
+ *
+ */
+
+/*
+ * Calculate the size of a node, so the entries stay aligned.
+ */
+PA_INTERN s16 hep_node_size(s16 size)
+{
+        s16 align = size >= 8 ? 8 : (size >= 4 ? 4 : 2);
+
+        return (size + sizeof(s16) + align - 1) / align * align;
+}
+
+PA_INTERN s16 *hep_handle(struct pa_heap *heap, s32 pos)
+{
+        s32 off = heap->nodes.entry_size - sizeof(s16);
+
+        return (s16 *)(lst_at(&heap->nodes, pos) + off);
+}
+
+PA_INTERN struct pa_slot *hep_slot(struct pa_heap *heap, s16 idx)
+{
+        return (struct pa_slot *)lst_at(&heap->slots, idx);
+}
+
+PA_INTERN s32 hep_compare(struct pa_heap *heap, s32 a, s32 b)
+{
+        return heap->compare(lst_at(&heap->nodes, a), lst_at(&heap->nodes, b));
+}
+
+/*
+ * Swap two nodes and update the positions in their slots.
+ */
+PA_INTERN void hep_swap(struct pa_heap *heap, s32 a, s32 b)
+{
+        lst_swap(&heap->nodes, a, b);
+
+        hep_slot(heap, *hep_handle(heap, a))->index = a;
+        hep_slot(heap, *hep_handle(heap, b))->index = b;
+}
+
+PA_INTERN s32 hep_sift_up(struct pa_heap *heap, s32 pos)
+{
+        s32 parent;
+
+        while(pos > 0) {
+                parent = (pos - 1) / 2;
+                if(hep_compare(heap, pos, parent) >= 0)
+                        break;
+
+                hep_swap(heap, pos, parent);
+                pos = parent;
+        }
+
+        return pos;
+}
+
+PA_INTERN s32 hep_sift_down(struct pa_heap *heap, s32 pos)
+{
+        s32 num = heap->nodes.count;
+        s32 child;
+
+        while((child = 2 * pos + 1) < num) {
+                if(child + 1 < num && hep_compare(heap, child + 1, child) < 0)
+                        child++;
+
+                if(hep_compare(heap, child, pos) >= 0)
+                        break;
+
+                hep_swap(heap, pos, child);
+                pos = child;
+        }
+
+        return pos;
+}
+
+/*
+ * Check if the handle still references a used slot.
+ */
+PA_INTERN struct pa_slot *hep_resolve(struct pa_heap *heap,
+                struct pa_slot_handle hdl)
+{
+        struct pa_slot *slot;
+
+        if(hdl.index < 0 || hdl.index >= heap->slots.count)
+                return NULL;
+
+        /* Used slots always have an odd generation */
+        slot = hep_slot(heap, hdl.index);
+        if(slot->generation != hdl.generation || slot->generation % 2 == 0)
+                return NULL;
+
+        return slot;
+}
+
+/*
+ * Attach a slot to the node at the given position, either from the free-list
+ * or by appending a new one, and write the handle for it.
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_INTERN s8 hep_take_slot(struct pa_heap *heap, s32 pos,
+                struct pa_slot_handle *out)
+{
+        struct pa_slot new_slot;
+        struct pa_slot *slot;
+        s16 idx;
+
+        if(heap->free_head >= 0) {
+                idx = heap->free_head;
+                slot = hep_slot(heap, idx);
+                heap->free_head = slot->index;
+        }
+        else {
+                new_slot.index = -1;
+                new_slot.generation = 0;
+
+                idx = heap->slots.count;
+                if(paPushList(&heap->slots, &new_slot, 1) < 1)
+                        return -1;
+
+                slot = hep_slot(heap, idx);
+        }
+
+        slot->index = pos;
+        slot->generation++;
+        *hep_handle(heap, pos) = idx;
+
+        if(out) {
+                out->index = idx;
+                out->generation = slot->generation;
+        }
+
+        return 0;
+}
+
+/*
+ * Remove the node at the given position by moving the last node into the gap.
+ * The slot of the node is freed, so all handles to it become stale.
+ */
+PA_INTERN void hep_remove_at(struct pa_heap *heap, s32 pos, void *dst,
+                struct pa_slot_handle *out)
+{
+        struct pa_slot *slot;
+        s32 last = heap->nodes.count - 1;
+        s16 idx = *hep_handle(heap, pos);
+
+        if(dst) {
+                pa_mem_copy(dst, lst_at(&heap->nodes, pos), heap->entry_size);
+        }
+
+        slot = hep_slot(heap, idx);
+        if(out) {
+                out->index = idx;
+                out->generation = slot->generation;
+        }
+
+        /* Invalidate all handles and push the slot onto the free-list */
+        slot->generation++;
+        slot->index = heap->free_head;
+        heap->free_head = idx;
+
+        if(pos != last) {
+                pa_mem_copy(lst_at(&heap->nodes, pos),
+                                lst_at(&heap->nodes, last),
+                                heap->nodes.entry_size);
+                hep_slot(heap, *hep_handle(heap, pos))->index = pos;
+        }
+
+        heap->nodes.count--;
+
+        if(pos != last) {
+                if(hep_sift_up(heap, pos) == pos)
+                        hep_sift_down(heap, pos);
+        }
+}
+
+PA_API s8 paInitHeap(struct pa_heap *heap, struct pa_memory *mem, s16 size,
+                s16 alloc, pa_list_compare cmp)
+{
+        s16 node_sz = hep_node_size(size);
+
+        if(paInitList(&heap->nodes, mem, node_sz, alloc, PA_NOLIM) < 0)
+                return -1;
+
+        if(paInitList(&heap->slots, mem, PA_SLOT_SIZE, alloc, PA_NOLIM) < 0) {
+                paDestroyList(&heap->nodes);
+                return -1;
+        }
+
+        heap->compare = cmp;
+        heap->entry_size = size;
+        heap->free_head = -1;
+        return 0;
+}
+
+PA_API s8 paInitHeapFixed(struct pa_heap *heap, s16 size, pa_list_compare cmp,
+                void *buf, s32 buf_sz)
+{
+        u8 *ptr = buf;
+        s16 node_sz = hep_node_size(size);
+        s32 num;
+
+        /* The nodes come first, followed by the slots */
+        num = buf_sz / (node_sz + PA_SLOT_SIZE);
+        if(num < 1)
+                return -1;
+
+        if(num > 0x7FFF)
+                num = 0x7FFF;
+
+        paInitListFixed(&heap->nodes, node_sz, ptr, num * node_sz);
+        paInitListFixed(&heap->slots, PA_SLOT_SIZE, ptr + num * node_sz,
+                        num * PA_SLOT_SIZE);
+
+        heap->compare = cmp;
+        heap->entry_size = size;
+        heap->free_head = -1;
+        return 0;
+}
+
+PA_API void paDestroyHeap(struct pa_heap *heap)
+{
+        paDestroyList(&heap->nodes);
+        paDestroyList(&heap->slots);
+
+        heap->free_head = -1;
+}
+
+PA_API void paClearHeap(struct pa_heap *heap)
+{
+        struct pa_slot *slot;
+        s16 i;
+
+        /*
+         * Keep the slots, so the generations are preserved, but free all of
+         * them so old handles become invalid.
+         */
+        heap->free_head = -1;
+        for(i = heap->slots.count - 1; i >= 0; i--) {
+                slot = hep_slot(heap, i);
+                if(slot->generation % 2 == 1)
+                        slot->generation++;
+
+                slot->index = heap->free_head;
+                heap->free_head = i;
+        }
+
+        heap->nodes.count = 0;
+}
+
+PA_API s8 paPushHeap(struct pa_heap *heap, void *src,
+                struct pa_slot_handle *out)
+{
+        s32 pos = heap->nodes.count;
+
+        /* Make room for the node before attaching a slot to it */
+        lst_ensure_fit(&heap->nodes, 1);
+        if(pos >= heap->nodes.alloc)
+                return -1;
+
+        if(hep_take_slot(heap, pos, out) < 0)
+                return -1;
+
+        /* Append the node to the end, then move it up */
+        pa_mem_copy(lst_at(&heap->nodes, pos), src, heap->entry_size);
+        heap->nodes.count++;
+
+        hep_sift_up(heap, pos);
+        return 0;
+}
+
+PA_API s8 paPopHeap(struct pa_heap *heap, void *dst,
+                struct pa_slot_handle *out)
+{
+        if(heap->nodes.count < 1)
+                return 0;
+
+        hep_remove_at(heap, 0, dst, out);
+        return 1;
+}
+
+PA_API s8 paPeekHeap(struct pa_heap *heap, void *dst)
+{
+        if(heap->nodes.count < 1)
+                return 0;
+
+        pa_mem_copy(dst, heap->nodes.data, heap->entry_size);
+        return 1;
+}
+
+PA_API s8 paUpdateHeap(struct pa_heap *heap, struct pa_slot_handle hdl,
+                void *src)
+{
+        struct pa_slot *slot;
+        s16 pos;
+
+        if(!(slot = hep_resolve(heap, hdl)))
+                return -1;
+
+        pos = slot->index;
+        pa_mem_copy(lst_at(&heap->nodes, pos), src, heap->entry_size);
+
+        if(hep_sift_up(heap, pos) == pos)
+                hep_sift_down(heap, pos);
+
+        return 0;
+}
+
+PA_API s8 paRemoveHeap(struct pa_heap *heap, struct pa_slot_handle hdl,
+                void *dst)
+{
+        struct pa_slot *slot;
+
+        if(!(slot = hep_resolve(heap, hdl)))
+                return 0;
+
+        hep_remove_at(heap, slot->index, dst, NULL);
+        return 1;
+}
+
+PA_API s16 paBuildHeap(struct pa_heap *heap, void *src, s16 num,
+                struct pa_slot_handle *out)
+{
+        u8 *ptr = src;
+        s16 written = 0;
+        s32 pos;
+        s32 i;
+
+        lst_ensure_fit(&heap->nodes, num);
+
+        /* Append all nodes without ordering them */
+        while(written < num && heap->nodes.count < heap->nodes.alloc) {
+                pos = heap->nodes.count;
+                if(hep_take_slot(heap, pos, out ? out + written : NULL) < 0)
+                        break;
+
+                pa_mem_copy(lst_at(&heap->nodes, pos), ptr, heap->entry_size);
+                heap->nodes.count++;
+
+                ptr += heap->entry_size;
+                written++;
+        }
+
+        /* Restore the heap-order bottom-up */
+        for(i = heap->nodes.count / 2 - 1; i >= 0; i--)
+                hep_sift_down(heap, i);
+
+        return written;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      BITSET
+ *
+ */
+
+#define BST_WORD(idx)           ((idx) / PA_BITSET_WORD)
+#define BST_MASK(idx)           ((u32)1 << ((idx) % PA_BITSET_WORD))
+
+/*
+ * Scale the bitset to fit the given number of words. The new words are
+ * unset.
+ */
+PA_INTERN s8 bst_ensure_fit(struct pa_bitset *set, s32 num)
+{
+        s32 new_count;
+        u32 *p;
+
+        if(num <= set->count)
+                return 0;
+
+        if(set->mode != PA_DYNAMIC)
+                return -1;
+
+        new_count = num * 1.5;
+        if(!(p = pa_mem_alloc(set->memory, set->words,
+                                        new_count * sizeof(u32))))
+                return -1;
+
+        pa_mem_zero(p + set->count, (new_count - set->count) * sizeof(u32));
+
+        set->words = p;
+        set->count = new_count;
+        return 0;
+}
+
+PA_API s8 paInitBitset(struct pa_bitset *set, struct pa_memory *mem, s32 bits)
+{
+        s32 count = (bits + PA_BITSET_WORD - 1) / PA_BITSET_WORD;
+
+        if(count < 1)
+                count = 1;
+
+        set->memory = mem;
+        set->mode = PA_DYNAMIC;
+        set->count = count;
+
+        if(!(set->words = pa_mem_alloc(mem, NULL, count * sizeof(u32))))
+                return -1;
+
+        pa_mem_zero(set->words, count * sizeof(u32));
+        return 0;
+}
+
+PA_API s8 paInitBitsetFixed(struct pa_bitset *set, void *buf, s32 buf_sz)
+{
+        u8 *ptr = buf;
+        s32 pad;
+
+        /* Align the words to 4 bytes */
+        pad = (sizeof(u32) - ((unsigned long)ptr % sizeof(u32))) %
+                sizeof(u32);
+        if(buf_sz - pad < (s32)sizeof(u32))
+                return -1;
+
+        set->memory = NULL;
+        set->mode = PA_FIXED;
+        set->words = (u32 *)(ptr + pad);
+        set->count = (buf_sz - pad) / sizeof(u32);
+
+        pa_mem_zero(set->words, set->count * sizeof(u32));
+        return 0;
+}
+
+PA_API void paDestroyBitset(struct pa_bitset *set)
+{
+        if(set->mode == PA_DYNAMIC) {
+                pa_mem_free(set->memory, set->words);
+        }
+
+        set->mode = PA_MEM_UDEF;
+        set->words = NULL;
+        set->count = 0;
+}
+
+PA_API void paClearBitset(struct pa_bitset *set)
+{
+        pa_mem_zero(set->words, set->count * sizeof(u32));
+}
+
+PA_API s8 paSetBit(struct pa_bitset *set, s32 idx)
+{
+        if(idx < 0)
+                return -1;
+
+        if(bst_ensure_fit(set, BST_WORD(idx) + 1) < 0)
+                return -1;
+
+        set->words[BST_WORD(idx)] |= BST_MASK(idx);
+        return 0;
+}
+
+PA_API void paClearBit(struct pa_bitset *set, s32 idx)
+{
+        if(idx < 0 || BST_WORD(idx) >= set->count)
+                return;
+
+        set->words[BST_WORD(idx)] &= ~BST_MASK(idx);
+}
+
+PA_API s8 paTestBit(struct pa_bitset *set, s32 idx)
+{
+        if(idx < 0 || BST_WORD(idx) >= set->count)
+                return 0;
+
+        return (set->words[BST_WORD(idx)] & BST_MASK(idx)) != 0;
+}
+
+PA_API s32 paCountBitset(struct pa_bitset *set)
+{
+        s32 num = 0;
+        s32 i;
+
+        for(i = 0; i < set->count; i++)
+                num += pa_bit_popcount(set->words[i]);
+
+        return num;
+}
+
+PA_API s32 paNextBit(struct pa_bitset *set, s32 start)
+{
+        s32 i;
+        u32 word;
+
+        if(start < 0)
+                start = 0;
+
+        if((i = BST_WORD(start)) >= set->count)
+                return -1;
+
+        /* Mask out the bits before the start in the first word */
+        word = set->words[i] & ~(BST_MASK(start) - 1);
+
+        while(!word) {
+                if(++i >= set->count)
+                        return -1;
+
+                word = set->words[i];
+        }
+
+        return i * PA_BITSET_WORD + pa_bit_ctz(word);
+}
+
+PA_API s32 paIterateBitset(struct pa_bitset *set, s32 idx)
+{
+        return paNextBit(set, idx + 1);
+}
+
+PA_API void paAndBitset(struct pa_bitset *dst, struct pa_bitset *src)
+{
+        s32 num = dst->count < src->count ? dst->count : src->count;
+        s32 i;
+
+        for(i = 0; i < num; i++)
+                dst->words[i] &= src->words[i];
+
+        /* Bits beyond the source are unset in the source */
+        if(dst->count > num) {
+                pa_mem_zero(dst->words + num,
+                                (dst->count - num) * sizeof(u32));
+        }
+}
+
+PA_API s8 paOrBitset(struct pa_bitset *dst, struct pa_bitset *src)
+{
+        s32 num = src->count;
+        s8 r = 0;
+        s32 i;
+
+        /* Only scale if the additional words actually contain set bits */
+        while(num > dst->count && !src->words[num - 1])
+                num--;
+
+        if(bst_ensure_fit(dst, num) < 0) {
+                num = dst->count;
+                r = -1;
+        }
+
+        for(i = 0; i < num; i++)
+                dst->words[i] |= src->words[i];
+
+        return r;
+}
+
+PA_API void paAndNotBitset(struct pa_bitset *dst, struct pa_bitset *src)
+{
+        s32 num = dst->count < src->count ? dst->count : src->count;
+        s32 i;
+
+        for(i = 0; i < num; i++)
+                dst->words[i] &= ~src->words[i];
+}
+
+#undef BST_WORD
+#undef BST_MASK
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      HASH-STATS
+ *
+ */
+
+/*
+ * Walk all buckets and collect the chain-lengths, probe-lengths and
+ * collisions. The dictionary and the table both start their entries with the
+ * next-index and the 16-bit hash, so this works for both. Entries with the
+ * same hash always end up in the same bucket, so only the chains have to be
+ * searched for collisions.
+ */
+PA_INTERN void hst_collect(struct pa_hash_stats *stats, u8 *buffer,
+                s32 entry_size, s16 *buckets, s16 bucket_count)
+{
+        s32 probes = 0;
+        s32 len;
+        s16 idx;
+        s16 other;
+        u16 hash;
+        s16 i;
+
+        pa_mem_zero(stats, sizeof(struct pa_hash_stats));
+        stats->buckets = bucket_count;
+
+        for(i = 0; i < bucket_count; i++) {
+                len = 0;
+                for(idx = buckets[i]; idx >= 0;
+                                idx = *(s16 *)(buffer + idx * entry_size)) {
+                        len++;
+                        probes += len;
+
+                        /* Look for another entry with the same hash */
+                        hash = *(u16 *)(buffer + idx * entry_size +
+                                        sizeof(s16));
+                        for(other = buckets[i]; other >= 0; other =
+                                        *(s16 *)(buffer + other * entry_size)) {
+                                if(other != idx && hash == *(u16 *)(buffer +
+                                                other * entry_size +
+                                                sizeof(s16))) {
+                                        stats->collisions++;
+                                        break;
+                                }
+                        }
+                }
+
+                stats->entries += len;
+                stats->chains[PA_MIN(len, PA_STATS_CHAINS - 1)]++;
+                if(len > stats->longest)
+                        stats->longest = len;
+        }
+
+        if(bucket_count > 0) {
+                stats->load = (f32)stats->entries / bucket_count;
+                stats->probe_miss = stats->load;
+        }
+
+        if(stats->entries > 0)
+                stats->probe_hit = (f32)probes / stats->entries;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      DICTIONARY
+ *
+ */
+
+/*
+ * Hash the key. The lower 16 bits are stored with the entry to skip most
+ * key-comparisons, all 32 bits are used by the bloom-filter.
+ */
+PA_INTERN u32 dct_hash(char *key)
+{
+        return pa_hash(key, pa_strlen(key));
+}
+
+/*
+ * Mark the entry-slots in the given range as not-used and push them onto the
+ * free-list. Free slots don't need a hash, so the hash-field is used to store
+ * the index of the next free slot.
+ */
+PA_INTERN void dct_reset_slots(struct pa_dictionary *dct, s16 from, s16 to)
+{
+        u8 *ptr;
+        s16 i;
+
+        for(i = to - 1; i >= from; i--) {
+                ptr = dct->buffer + i * dct->entry_size;
+                *(s16 *)ptr = -1;
+                *(s16 *)(ptr + PA_DICT_NEXT_SIZE) = dct->free_head;
+                dct->free_head = i;
+        }
+}
+
+/*
+ * Pop the next open slot from the free-list. In ordered mode the free-list is
+ * not used and the slot behind the last used one is taken instead.
+ */
+PA_INTERN s16 dct_find_open(struct pa_dictionary *dct)
+{
+        s16 slot;
+
+        if(dct->ordered) {
+                if(dct->tail >= dct->alloc)
+                        return -1;
+
+                return dct->tail++;
+        }
+
+        if((slot = dct->free_head) < 0)
+                return -1;
+
+        dct->free_head = *(s16 *)(dct->buffer + slot * dct->entry_size +
+                        PA_DICT_NEXT_SIZE);
+        return slot;
+}
+
+/*
+ * Get a pointer to the key of an entry in the key-buffer.
+ */
+PA_INTERN char *dct_key(struct pa_dictionary *dct, u8 *ptr)
+{
+        s32 off = *(s32 *)(ptr + PA_DICT_NEXT_SIZE + PA_DICT_HASH_SIZE);
+
+        return (char *)(dct->keys + off + PA_DICT_KEY_HEAD);
+}
+
+/*
+ * Move the keys of all used entries to the front of the key-buffer and update
+ * the offsets in the entries. The records are visited in the order they are
+ * stored, so they only ever move towards the front and this can be done in
+ * place.
+ */
+PA_INTERN void dct_compact_keys(struct pa_dictionary *dct)
+{
+        s32 read = 0;
+        s32 write = 0;
+        s16 slot;
+        s16 size;
+        u8 *ptr;
+
+        while(read < dct->keys_used) {
+                slot = *(s16 *)(dct->keys + read);
+                size = *(s16 *)(dct->keys + read + sizeof(s16));
+
+                if(slot >= 0) {
+                        pa_mem_move(dct->keys + write, dct->keys + read, size);
+
+                        ptr = dct->buffer + slot * dct->entry_size;
+                        ptr += PA_DICT_NEXT_SIZE + PA_DICT_HASH_SIZE;
+                        *(s32 *)ptr = write;
+
+                        write += size;
+                }
+
+                read += size;
+        }
+
+        dct->keys_used = write;
+        dct->keys_dead = 0;
+}
+
+/*
+ * Append the key to the key-buffer and return the offset of the record. The
+ * records of removed keys are reclaimed once the key-buffer is full. In
+ * dynamic mode this only happens if at least half of the buffer is unused,
+ * otherwise the key-buffer is scaled instead.
+ */
+PA_INTERN s32 dct_store_key(struct pa_dictionary *dct, char *key, s16 slot)
+{
+        s32 len = pa_strlen(key) + 1;
+        s32 size = (PA_DICT_KEY_HEAD + len + 1) & ~1;
+        s32 new_size;
+        s32 off;
+        u8 *p;
+
+        if(size > 0x7FFF)
+                return -1;
+
+        if(dct->keys_used + size > dct->keys_size && dct->keys_dead > 0) {
+                if(dct->mode != PA_DYNAMIC ||
+                                dct->keys_dead >= dct->keys_used / 2)
+                        dct_compact_keys(dct);
+        }
+
+        if(dct->keys_used + size > dct->keys_size) {
+                if(dct->mode != PA_DYNAMIC)
+                        return -1;
+
+                new_size = (dct->keys_used + size) * 1.5;
+                if(!(p = pa_mem_alloc(dct->memory, dct->keys, new_size)))
+                        return -1;
+
+                dct->keys = p;
+                dct->keys_size = new_size;
+        }
+
+        /* Write the record: <slot><size><key> */
+        off = dct->keys_used;
+        *(s16 *)(dct->keys + off) = slot;
+        *(s16 *)(dct->keys + off + sizeof(s16)) = size;
+        pa_mem_copy(dct->keys + off + PA_DICT_KEY_HEAD, key, len);
+
+        dct->keys_used += size;
+        return off;
+}
+
+/*
+ * Get the number of buckets needed to keep the load factor for the given
+ * number of entries below PA_DICT_LOAD.
+ */
+PA_INTERN s16 dct_bucket_num(s32 num)
+{
+        s32 buckets = PA_DICT_BUCKETS;
+
+        while(buckets < PA_DICT_BUCKETS_MAX && num > buckets * PA_DICT_LOAD)
+                buckets *= 2;
+
+        return buckets;
+}
+
+/*
+ * Get the number of bytes needed to store the given number of entries
+ * followed by the buckets and the key-buffer in a single buffer.
+ */
+PA_INTERN s32 dct_fixed_size(struct pa_dictionary *dct, s32 num)
+{
+        s32 size = (num * dct->entry_size + 1) & ~1;
+
+        size += dct_bucket_num(num) * sizeof(s16);
+        return size + num * PA_DICT_KEY_AVG;
+}
+
+/*
+ * Reset the buckets and attach all used entries to the bucket for their hash
+ * again. Going backwards and attaching every entry at the front of the bucket
+ * keeps the entries in each bucket in slot-order.
+ */
+PA_INTERN void dct_rehash(struct pa_dictionary *dct)
+{
+        s16 mask = dct->bucket_count - 1;
+        s16 bucket;
+        u8 *ptr;
+        s16 i;
+
+        for(i = 0; i < dct->bucket_count; i++)
+                dct->buckets[i] = -1;
+
+        for(i = dct->alloc - 1; i >= 0; i--) {
+                ptr = dct->buffer + i * dct->entry_size;
+                if(*(s16 *)ptr == -1)
+                        continue;
+
+                bucket = *(u16 *)(ptr + PA_DICT_NEXT_SIZE) & mask;
+                if(dct->buckets[bucket] < 0)
+                        *(s16 *)ptr = -(bucket + 2);
+                else
+                        *(s16 *)ptr = dct->buckets[bucket];
+
+                dct->buckets[bucket] = i;
+        }
+}
+
+/*
+ * Move all used entries to the front of the dictionary-buffer, keeping their
+ * order, and rebuild the free-list and the buckets. The records in the
+ * key-buffer are updated to point to the new slots.
+ */
+PA_INTERN void dct_compact_slots(struct pa_dictionary *dct)
+{
+        s16 write = 0;
+        u8 *src;
+        u8 *dst;
+        u8 *rec;
+        s16 i;
+
+        for(i = 0; i < dct->alloc; i++) {
+                src = dct->buffer + i * dct->entry_size;
+                if(*(s16 *)src == -1)
+                        continue;
+
+                if(i != write) {
+                        dst = dct->buffer + write * dct->entry_size;
+                        pa_mem_copy(dst, src, dct->entry_size);
+
+                        rec = (u8 *)dct_key(dct, dst) - PA_DICT_KEY_HEAD;
+                        *(s16 *)rec = write;
+                }
+
+                write++;
+        }
+
+        dct->tail = write;
+        dct->free_head = -1;
+        dct_reset_slots(dct, write, dct->alloc);
+        dct_rehash(dct);
+}
+
+/*
+ * Create the bloom-filter anew with the given false-positive rate, sized for
+ * the current number of slots, and add all keys.
+ */
+PA_INTERN s8 dct_build_filter(struct pa_dictionary *dct, f32 rate)
+{
+        u8 *ptr;
+        s16 i;
+
+        pa_bloom_destroy(&dct->filter, dct->memory);
+        if(pa_bloom_init(&dct->filter, dct->memory, dct->alloc, rate) < 0)
+                return -1;
+
+        for(i = 0; i < dct->alloc; i++) {
+                ptr = dct->buffer + i * dct->entry_size;
+                if(*(s16 *)ptr != -1)
+                        pa_bloom_add(&dct->filter, dct_hash(dct_key(dct, ptr)));
+        }
+
+        return 0;
+}
+
+/*
+ * If configured as dynamic, scale the dictionary-buffer to fit one more entry
+ * and double the number of buckets if the load factor would be exceeded.
+ *
+ * In ordered mode, the holes left by removed entries are reclaimed once the
+ * last slot has been used. In dynamic mode this only happens if at least a
+ * third of the slots are holes, otherwise the dictionary-buffer is scaled.
+ */
+PA_INTERN s8 dct_ensure_fit(struct pa_dictionary *dct)
+{
+        s32 new_alloc;
+        s16 new_count;
+        s16 *buckets;
+        u8 *p;
+
+        if(dct->ordered && dct->tail >= dct->alloc &&
+                        dct->number < dct->alloc) {
+                if(dct->mode != PA_DYNAMIC ||
+                                dct->alloc - dct->number >= dct->alloc / 3)
+                        dct_compact_slots(dct);
+        }
+
+        if(dct->mode != PA_DYNAMIC)
+                return 0;
+
+        if((dct->ordered ? dct->tail : dct->number) >= dct->alloc) {
+                new_alloc = dct->alloc * 1.5 + 1;
+                if(new_alloc > 0x7FFF)
+                        new_alloc = 0x7FFF;
+
+                if(new_alloc <= dct->alloc)
+                        return -1;
+
+                if(!(p = pa_mem_alloc(dct->memory, dct->buffer,
+                                                new_alloc * dct->entry_size)))
+                        return -1;
+
+                dct->buffer = p;
+                dct_reset_slots(dct, dct->alloc, new_alloc);
+                dct->alloc = new_alloc;
+
+                /* The filter would fill up, so size it for the new slots */
+                if(dct->filter.bits &&
+                                dct_build_filter(dct, dct->filter.rate) < 0)
+                        return -1;
+        }
+
+        if((new_count = dct_bucket_num(dct->number + 1)) > dct->bucket_count) {
+                if(!(buckets = pa_mem_alloc(dct->memory, dct->buckets,
+                                                new_count * sizeof(s16))))
+                        return -1;
+
+                dct->buckets = buckets;
+                dct->bucket_count = new_count;
+                dct_rehash(dct);
+        }
+
+        return 0;
+}
+PA_INTERN u8 *dct_next_bucket(struct pa_dictionary *dct, s16 bucket, u8 *ptr)
+{
+        s16 next_idx = -1;
+
+        if(bucket < 0 || bucket >= dct->bucket_count)
+                return NULL;
+
+        if(dct->buckets[bucket] < 0)
+                return NULL;
+
+        /*
+         * On the first call ptr will be NULL, so we have to find the first
+         * entry in the dictionary.
+         */
+        if(!ptr) {
+                return dct->buffer + (dct->buckets[bucket] * dct->entry_size);
+        }
+
+        /*
+         * Otherwise we have to get a pointer to the next entry.
+         */
+        if((next_idx = *(s16 *)ptr) < 0) {
+                return NULL;
+        }
+
+        /* Return a pointer to the entry */
+        return dct->buffer + (next_idx * dct->entry_size);
+
+
+}
+
+PA_INTERN u8 *dct_next(struct pa_dictionary *dct, u8 *ptr)
+{
+        s16 idx = -1;
+        s16 next_idx = -1;
+        s16 bucket_num;
+
+        /*
+         * On the first call ptr will be NULL, so we have to find the first
+         * entry in the dictionary.
+         */
+        if(!ptr) {
+                bucket_num = 0;
+                while(bucket_num < dct->bucket_count) {
+                        if(dct->buckets[bucket_num] >= 0) {
+                                idx = dct->buckets[bucket_num];
+                                ptr = dct->buffer + (idx * dct->entry_size);
+                                break;
+                        }
+                        bucket_num++;
+                }
+
+                return ptr;
+        }
+
+        /*
+         * Otherwise we have to get a pointer to the next entry.
+         */
+        next_idx = *(s16 *)ptr;
+        if(next_idx <= -2) {
+                bucket_num = (-1 * next_idx) - 2 + 1;
+                while(bucket_num < dct->bucket_count) {
+                        if(dct->buckets[bucket_num] >= 0) {
+                                next_idx = dct->buckets[bucket_num];
+                                break;
+                        }
+                        bucket_num++;
+                }
+
+                /* No more entries left in the dictionary */
+                if(next_idx <= -2)
+                        return NULL;
+        }
+
+        /* Return a pointer to the entry */
+        return dct->buffer + (next_idx * dct->entry_size);
+}
+
+PA_INTERN u8 *dct_find_key(struct pa_dictionary *dct, char *key, u32 hash,
+                u8 **prev, s16 *bucket_out)
+{
+        s16 bucket = hash & (dct->bucket_count - 1);
+        u8 *ptr = NULL;
+
+        if(dct->buckets[bucket] < 0)
+                return NULL;
+
+        if(bucket_out) *bucket_out = bucket;
+
+        if(prev) *prev = NULL;
+        while((ptr = dct_next_bucket(dct, bucket, ptr))) {
+                /* Compare the hashes */
+                if((hash & 0xFFFF) == *(u16 *)(ptr + PA_DICT_NEXT_SIZE)) {
+                        if(pa_strcmp(key, dct_key(dct, ptr)) == 0) {
+                                return ptr;
+                        }
+                }
+                if(prev) *prev = ptr;
+        }
+
+        return NULL;
+}
+
+PA_API s8 paInitDictionary(struct pa_dictionary *dct, struct pa_memory *mem,
+                s32 size, s16 alloc)
+{
+        s32 alloc_sz;
+        s16 i;
+
+        dct->memory = mem;
+        dct->mode = PA_DYNAMIC;
+
+        dct->value_size = size;
+        dct->entry_size = (PA_DICT_HEAD_SIZE + size + 3) & ~3;
+        dct->number = 0;
+        dct->alloc = alloc;
+        dct->ordered = 0;
+        dct->tail = 0;
+        dct->bucket_count = dct_bucket_num(alloc);
+        dct->keys_size = (alloc > 0 ? alloc : 1) * PA_DICT_KEY_AVG;
+        dct->keys_used = 0;
+        dct->keys_dead = 0;
+
+        alloc_sz = dct->entry_size * dct->alloc;
+        if(!(dct->buffer = pa_mem_alloc(dct->memory, NULL, alloc_sz))) {
+                return -1;
+        }
+
+        alloc_sz = dct->bucket_count * sizeof(s16);
+        if(!(dct->buckets = pa_mem_alloc(dct->memory, NULL, alloc_sz))) {
+                goto err_free_buffer;
+        }
+
+        if(!(dct->keys = pa_mem_alloc(dct->memory, NULL, dct->keys_size))) {
+                goto err_free_buckets;
+        }
+
+        /* Reset all memory slots in the buffer */
+        dct->free_head = -1;
+        dct_reset_slots(dct, 0, dct->alloc);
+        pa_mem_zero(&dct->filter, sizeof(struct pa_bloom));
+        dct->hits = 0;
+        dct->misses = 0;
+        dct->filter_checks = 0;
+        dct->filter_rejects = 0;
+
+        /* Reset all buckets */
+        for(i = 0; i < dct->bucket_count; i++) {
+                dct->buckets[i] = -1;
+        }
+
+        return 0;
+
+err_free_buckets:
+        pa_mem_free(dct->memory, dct->buckets);
+
+err_free_buffer:
+        pa_mem_free(dct->memory, dct->buffer);
+        return -1;
+}
+
+PA_API s8 paInitDictionaryFixed(struct pa_dictionary *dct, void *buffer,
+                s32 buf_sz, s32 value_sz)
+{
+        s32 num;
+        s16 i;
+
+        dct->memory = NULL;
+        dct->mode = PA_FIXED;
+
+        dct->value_size = value_sz;
+        dct->entry_size = (PA_DICT_HEAD_SIZE + value_sz + 3) & ~3;
+        dct->number = 0;
+        dct->ordered = 0;
+        dct->tail = 0;
+        dct->buffer = buffer;
+
+        /*
+         * The entries come first, followed by the buckets and the key-buffer,
+         * which gets all the remaining memory. Start with as many entries as
+         * fit into the buffer and reduce the number until the buckets and
+         * PA_DICT_KEY_AVG bytes per key fit as well.
+         */
+        num = buf_sz / dct->entry_size;
+        if(num > 0x7FFF)
+                num = 0x7FFF;
+
+        while(num > 0 && dct_fixed_size(dct, num) > buf_sz)
+                num--;
+
+        if(num < 1)
+                return -1;
+
+        dct->alloc = num;
+        dct->bucket_count = dct_bucket_num(num);
+        dct->buckets = (s16 *)(dct->buffer +
+                        ((num * dct->entry_size + 1) & ~1));
+
+        dct->keys = (u8 *)(dct->buckets + dct->bucket_count);
+        dct->keys_size = (buf_sz - (dct->keys - dct->buffer)) & ~1;
+        dct->keys_used = 0;
+        dct->keys_dead = 0;
+
+        /* Reset all entry-slots in the buffer */
+        dct->free_head = -1;
+        dct_reset_slots(dct, 0, dct->alloc);
+        pa_mem_zero(&dct->filter, sizeof(struct pa_bloom));
+        dct->hits = 0;
+        dct->misses = 0;
+        dct->filter_checks = 0;
+        dct->filter_rejects = 0;
+
+        /* Reset all buckets */
+        for(i = 0; i < dct->bucket_count; i++) {
+                dct->buckets[i] = -1;
+        }
+
+        return 0;
+}
+
+PA_API void paDestroyDictionary(struct pa_dictionary *dct)
+{
+        if(dct->mode == PA_DYNAMIC) {
+                pa_mem_free(dct->memory, dct->buffer);
+                pa_mem_free(dct->memory, dct->buckets);
+                pa_mem_free(dct->memory, dct->keys);
+                pa_bloom_destroy(&dct->filter, dct->memory);
+        }
+
+        dct->memory = 0;
+        dct->mode = PA_MEM_UDEF;
+
+        dct->value_size = 0;
+        dct->entry_size = 0;
+        dct->number = 0;
+        dct->alloc = 0;
+        dct->buffer = 0;
+        dct->ordered = 0;
+        dct->tail = 0;
+        dct->bucket_count = 0;
+        dct->buckets = 0;
+        dct->keys = 0;
+        dct->keys_size = 0;
+        dct->keys_used = 0;
+        dct->keys_dead = 0;
+}
+
+PA_API s8 paSetDictionary(struct pa_dictionary *dct, char *key, void *value)
+{
+        s16 slot;
+        u32 hash;
+        s16 bucket;
+        u8 *ptr;
+        s32 tmp;
+        s32 key_off;
+        s16 next_idx;
+
+        /*
+         * If there is already an entry with the keyword in the dictionary, we
+         * can just overwrite it's value and return.
+         */
+        hash = dct_hash(key);
+        if((ptr = dct_find_key(dct, key, hash, NULL, NULL))) {
+                /* Copy over the content */
+                pa_mem_copy(ptr + PA_DICT_HEAD_SIZE, value, dct->value_size);
+                return 0;
+
+        }
+
+        /* If configured as dynamic, scale to fit the new entry */
+        if(dct_ensure_fit(dct) < 0)
+                return -1;
+
+        /* Get an open slot in the dictionary-buffer */
+        if((slot = dct_find_open(dct)) < 0)
+                return -1;
+
+        /* Write the key to the key-buffer, or give the slot back */
+        if((key_off = dct_store_key(dct, key, slot)) < 0) {
+                if(dct->ordered)
+                        dct->tail--;
+                else
+                        dct_reset_slots(dct, slot, slot + 1);
+                return -1;
+        }
+
+        /* Determine the bucket */
+        bucket = hash & (dct->bucket_count - 1);
+
+        /* 
+         * Write the copy over the data to the dictionary-buffer.
+         */
+
+        /* Set the next index */
+        ptr = dct->buffer + (slot * dct->entry_size);
+        *(s16 *)ptr = -(bucket + 2);
+        ptr += PA_DICT_NEXT_SIZE;
+
+        /* Copy the hash */
+        *(u16 *)ptr = hash & 0xFFFF;
+        ptr += PA_DICT_HASH_SIZE;
+
+        /* Set the offset of the key */
+        *(s32 *)ptr = key_off;
+        ptr += PA_DICT_KEY_SIZE;
+
+        /* Copy over the content */
+        pa_mem_copy(ptr, value, dct->value_size);
+
+        /*
+         * Attach the entry to the bucket.
+         */
+        if(dct->buckets[bucket] < 0) {
+                dct->buckets[bucket] = slot;
+        }
+        else {
+                tmp = dct->buckets[bucket] * dct->entry_size;
+                ptr = dct->buffer + tmp;
+                while((next_idx = *(s16 *)ptr) >= 0) {
+                        ptr = dct->buffer + next_idx * dct->entry_size;
+                }
+                *(s16 *)ptr = slot;
+        }
+
+        if(dct->filter.bits)
+                pa_bloom_add(&dct->filter, hash);
+
+        dct->number++;
+        return 0;
+}
+
+PA_API s8 paGetDictionary(struct pa_dictionary *dct, char *key, void *out)
+{
+        u32 hash = dct_hash(key);
+        u8 *ptr;
+
+        if(dct->filter.bits) {
+                dct->filter_checks++;
+                if(!pa_bloom_test(&dct->filter, hash)) {
+                        dct->filter_rejects++;
+                        dct->misses++;
+                        return 0;
+                }
+        }
+
+        if(!(ptr = dct_find_key(dct, key, hash, NULL, NULL))) {
+                dct->misses++;
+                return 0;
+        }
+
+        pa_mem_copy(out, ptr + PA_DICT_HEAD_SIZE, dct->value_size);
+        dct->hits++;
+        return 1;
+}
+
+PA_API void paRemoveDictionary(struct pa_dictionary *dct, char *key)
+{
+        s16 bucket;
+        u8 *ptr;
+        u8 *prev;
+        u8 *rec;
+        s16 next_idx;
+
+        if((ptr = dct_find_key(dct, key, dct_hash(key), &prev, &bucket))) {
+                next_idx = *(s16 *)ptr;
+
+                if(!prev && next_idx < 0) {
+                        dct->buckets[bucket] = -1;
+                }
+                else if(!prev && next_idx >= 0) {
+                        dct->buckets[bucket] = next_idx;
+                }
+                else if(prev) {
+                        *(s16 *)prev = *(s16 *)ptr;
+                }
+
+                /* Mark the record in the key-buffer as unused */
+                rec = (u8 *)dct_key(dct, ptr) - PA_DICT_KEY_HEAD;
+                *(s16 *)rec = -1;
+                dct->keys_dead += *(s16 *)(rec + sizeof(s16));
+
+                /* Push the slot onto the free-list */
+                *(s16 *)ptr = -1;
+                *(s16 *)(ptr + PA_DICT_NEXT_SIZE) = dct->free_head;
+                dct->free_head = (ptr - dct->buffer) / dct->entry_size;
+                dct->number--;
+
+                /*
+                 * The bits of the key stay in the filter, so rebuild it once
+                 * too many are left. If that fails, just go without it.
+                 */
+                if(dct->filter.bits && ++dct->filter.stale >
+                                dct->filter.capacity / 2) {
+                        if(dct_build_filter(dct, dct->filter.rate) < 0)
+                                pa_bloom_destroy(&dct->filter, dct->memory);
+                }
+        }
+}
+
+PA_API s8 paEnableDictionaryFilter(struct pa_dictionary *dct, f32 rate)
+{
+        if(dct->mode != PA_DYNAMIC)
+                return -1;
+
+        if(rate <= 0) {
+                pa_bloom_destroy(&dct->filter, dct->memory);
+                return 0;
+        }
+
+        return dct_build_filter(dct, rate);
+}
+
+PA_API void paGetDictionaryStats(struct pa_dictionary *dct,
+                struct pa_hash_stats *stats)
+{
+        hst_collect(stats, dct->buffer, dct->entry_size, dct->buckets,
+                        dct->bucket_count);
+
+        stats->slots = dct->alloc;
+        stats->hits = dct->hits;
+        stats->misses = dct->misses;
+        stats->filter_checks = dct->filter_checks;
+        stats->filter_rejects = dct->filter_rejects;
+}
+
+PA_API void paResetDictionaryStats(struct pa_dictionary *dct)
+{
+        dct->hits = 0;
+        dct->misses = 0;
+        dct->filter_checks = 0;
+        dct->filter_rejects = 0;
+}
+
+PA_API void paSetDictionaryOrdered(struct pa_dictionary *dct, s8 ordered)
+{
+        /* Either way the free-list and the tail have to be rebuilt */
+        dct_compact_slots(dct);
+        dct->ordered = ordered ? 1 : 0;
+}
+
+PA_API void *paIterateDictionary(struct pa_dictionary *dct, void *ptr, 
+                struct pa_dictionary_entry *ent)
+{
+        s16 idx = 0;
+
+        /* Check if the dictionary is empty */
+        if(dct->number < 1)
+                return NULL;
+
+        if(dct->ordered) {
+                /* Scan the buffer and skip the holes of removed entries */
+                if(ptr)
+                        idx = ((u8 *)ptr - dct->buffer) / dct->entry_size + 1;
+
+                for(; idx < dct->tail; idx++) {
+                        ptr = dct->buffer + idx * dct->entry_size;
+                        if(*(s16 *)ptr != -1)
+                                break;
+                }
+
+                if(idx >= dct->tail)
+                        return NULL;
+        }
+        /* Go to the next entry in the dictionary */
+        else if(!(ptr = dct_next(dct, ptr))) {
+                return NULL;
+        }
+
+        /* Return the entry-data for the current entry */
+        if(ent) {
+                ent->key = dct_key(dct, ptr);
+                ent->value = (u8 *)ptr + PA_DICT_HEAD_SIZE;
+        }
+
+        return ptr;
+}
+
+PA_API void *paIterateDictionaryBucket(struct pa_dictionary *dct, s16 bucket,
+                void *ptr, struct pa_dictionary_entry *ent)
+{
+        /* Check if the dictionary is empty */
+        if(dct->number < 1)
+                return NULL;
+
+        if(!(ptr = dct_next_bucket(dct, bucket, ptr)))
+                return NULL;
+
+        /* Return the data for the current entry */
+        if(ent) {
+                ent->key = dct_key(dct, ptr);
+                ent->value = (u8 *)ptr + PA_DICT_HEAD_SIZE;
+        }
+
+        return ptr;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      TABLE
+ *
+ */
+
+/*
+ * Hash the whole key and fold the result into 16 bits, which are stored with
+ * the entry to skip most key-comparisons.
+ */
+PA_INTERN u16 tbl_hash(u8 *key, s32 key_sz)
+{
+        return pa_hash(key, key_sz) & 0xFFFF;
+}
+
+/*
+ * Mark the entry-slots in the given range as not-used and push them onto the
+ * free-list. Free slots don't need a hash, so the hash-field is used to store
+ * the index of the next free slot.
+ */
+PA_INTERN void tbl_reset_slots(struct pa_table *tbl, s16 from, s16 to)
+{
+        u8 *ptr;
+        s16 i;
+
+        for(i = to - 1; i >= from; i--) {
+                ptr = tbl->buffer + i * tbl->entry_size;
+                *(s16 *)ptr = -1;
+                *(s16 *)(ptr + PA_TBL_NEXT_SIZE) = tbl->free_head;
+                tbl->free_head = i;
+        }
+}
+
+/*
+ * Pop the next open slot from the free-list.
+ */
+PA_INTERN s16 tbl_find_open(struct pa_table *tbl)
+{
+        s16 slot;
+
+        if((slot = tbl->free_head) < 0)
+                return -1;
+
+        tbl->free_head = *(s16 *)(tbl->buffer + slot * tbl->entry_size +
+                        PA_TBL_NEXT_SIZE);
+        return slot;
+}
+/*
+ * Get the number of buckets needed to keep the load factor for the given
+ * number of entries below PA_TBL_LOAD.
+ */
+PA_INTERN s16 tbl_bucket_num(s32 num)
+{
+        s32 buckets = PA_TBL_BUCKETS;
+
+        while(buckets < PA_TBL_BUCKETS_MAX && num > buckets * PA_TBL_LOAD)
+                buckets *= 2;
+
+        return buckets;
+}
+
+/*
+ * Get the number of bytes needed to store the given number of entries
+ * followed by the buckets in a single buffer.
+ */
+PA_INTERN s32 tbl_fixed_size(struct pa_table *tbl, s32 num)
+{
+        s32 size = (num * tbl->entry_size + 1) & ~1;
+
+        return size + tbl_bucket_num(num) * sizeof(s16);
+}
+
+/*
+ * Reset the buckets and attach all used entries to the bucket for their hash
+ * again. Going backwards and attaching every entry at the front of the bucket
+ * keeps the entries in each bucket in slot-order.
+ */
+PA_INTERN void tbl_rehash(struct pa_table *tbl)
+{
+        s16 mask = tbl->bucket_count - 1;
+        s16 bucket;
+        u8 *ptr;
+        s16 i;
+
+        for(i = 0; i < tbl->bucket_count; i++)
+                tbl->buckets[i] = -1;
+
+        for(i = tbl->alloc - 1; i >= 0; i--) {
+                ptr = tbl->buffer + i * tbl->entry_size;
+                if(*(s16 *)ptr == -1)
+                        continue;
+
+                bucket = *(u16 *)(ptr + PA_TBL_NEXT_SIZE) & mask;
+                if(tbl->buckets[bucket] < 0)
+                        *(s16 *)ptr = -(bucket + 2);
+                else
+                        *(s16 *)ptr = tbl->buckets[bucket];
+
+                tbl->buckets[bucket] = i;
+        }
+}
+
+/*
+ * Create the bloom-filter anew with the given false-positive rate, sized for
+ * the current number of slots, and add all keys.
+ */
+PA_INTERN s8 tbl_build_filter(struct pa_table *tbl, f32 rate)
+{
+        u8 *ptr;
+        s16 i;
+
+        pa_bloom_destroy(&tbl->filter, tbl->memory);
+        if(pa_bloom_init(&tbl->filter, tbl->memory, tbl->alloc, rate) < 0)
+                return -1;
+
+        for(i = 0; i < tbl->alloc; i++) {
+                ptr = tbl->buffer + i * tbl->entry_size;
+                if(*(s16 *)ptr == -1)
+                        continue;
+
+                ptr += PA_TBL_HEAD_SIZE;
+                pa_bloom_add(&tbl->filter, pa_hash(ptr, tbl->key_size));
+        }
+
+        return 0;
+}
+
+/*
+ * If configured as dynamic, scale the table-buffer to fit one more entry
+ * and double the number of buckets if the load factor would be exceeded.
+ */
+PA_INTERN s8 tbl_ensure_fit(struct pa_table *tbl)
+{
+        s32 new_alloc;
+        s16 new_count;
+        s16 *buckets;
+        u8 *p;
+
+        if(tbl->mode != PA_DYNAMIC)
+                return 0;
+
+        if(tbl->number >= tbl->alloc) {
+                new_alloc = tbl->alloc * 1.5 + 1;
+                if(new_alloc > 0x7FFF)
+                        new_alloc = 0x7FFF;
+
+                if(new_alloc <= tbl->alloc)
+                        return -1;
+
+                if(!(p = pa_mem_alloc(tbl->memory, tbl->buffer,
+                                                new_alloc * tbl->entry_size)))
+                        return -1;
+
+                tbl->buffer = p;
+                tbl_reset_slots(tbl, tbl->alloc, new_alloc);
+                tbl->alloc = new_alloc;
+
+                /* The filter would fill up, so size it for the new slots */
+                if(tbl->filter.bits &&
+                                tbl_build_filter(tbl, tbl->filter.rate) < 0)
+                        return -1;
+        }
+
+        if((new_count = tbl_bucket_num(tbl->number + 1)) > tbl->bucket_count) {
+                if(!(buckets = pa_mem_alloc(tbl->memory, tbl->buckets,
+                                                new_count * sizeof(s16))))
+                        return -1;
+
+                tbl->buckets = buckets;
+                tbl->bucket_count = new_count;
+                tbl_rehash(tbl);
+        }
+
+        return 0;
+}
+
+PA_INTERN u8 *tbl_next_bucket(struct pa_table *tbl, s16 bucket, u8 *ptr)
+{
+        s16 next_idx = -1;
+
+        if(bucket < 0 || bucket >= tbl->bucket_count)
+                return NULL;
+
+        if(tbl->buckets[bucket] < 0)
+                return NULL;
+
+        /*
+         * On the first call ptr will be NULL, so we have to find the first
+         * entry in the table.
+         */
+        if(!ptr) {
+                return tbl->buffer + (tbl->buckets[bucket] * tbl->entry_size);
+        }
+
+        /*
+         * Otherwise we have to get a pointer to the next entry.
+         */
+        if((next_idx = *(s16 *)ptr) < 0) {
+                return NULL;
+        }
+
+        /* Return a pointer to the entry */
+        return tbl->buffer + (next_idx * tbl->entry_size);
+}
+
+PA_INTERN u8 *tbl_next(struct pa_table *tbl, u8 *ptr)
+{
+        s16 idx = -1;
+        s16 next_idx = -1;
+        s16 bucket_num;
+
+        /*
+         * On the first call ptr will be NULL, so we have to find the first
+         * entry in the table.
+         */
+        if(!ptr) {
+                bucket_num = 0;
+                while(bucket_num < tbl->bucket_count) {
+                        if(tbl->buckets[bucket_num] >= 0) {
+                                idx = tbl->buckets[bucket_num];
+                                ptr = tbl->buffer + (idx * tbl->entry_size);
+                                break;
+                        }
+                        bucket_num++;
+                }
+
+                return ptr;
+        }
+
+        /*
+         * Otherwise we have to get a pointer to the next entry.
+         */
+        next_idx = *(s16 *)ptr;
+        if(next_idx <= -2) {
+                bucket_num = (-1 * next_idx) - 2 + 1;
+                while(bucket_num < tbl->bucket_count) {
+                        if(tbl->buckets[bucket_num] >= 0) {
+                                next_idx = tbl->buckets[bucket_num];
+                                break;
+                        }
+                        bucket_num++;
+                }
+
+                /* No more entries left in the table */
+                if(next_idx <= -2)
+                        return NULL;
+        }
+
+        /* Return a pointer to the entry */
+        return tbl->buffer + (next_idx * tbl->entry_size);
+}
+
+PA_INTERN u8 *tbl_find_key(struct pa_table *tbl, u8 *key, u16 hash,
+                u8 **prev, s16 *bucket_out)
+{
+        s16 bucket = hash & (tbl->bucket_count - 1);
+        u8 *ptr = NULL;
+        s16 off = PA_TBL_NEXT_SIZE + PA_TBL_HASH_SIZE;
+
+        if(tbl->buckets[bucket] < 0)
+                return NULL;
+
+        if(bucket_out) *bucket_out = bucket;
+
+        if(prev) *prev = NULL;
+        while((ptr = tbl_next_bucket(tbl, bucket, ptr))) {
+                /* Compare the hashes */
+                if(hash == *(u16 *)(ptr + PA_TBL_NEXT_SIZE)) {
+                        if(pa_mem_compare(key, ptr + off, tbl->key_size)) {
+                                return ptr;
+                        }
+                }
+                if(prev) *prev = ptr;
+        }
+
+        return NULL;
+}
+
+/*
+ * Get the entry for the key, or create a new one if the key isn't in the table
+ * yet. The value of a new entry is left for the caller to write.
+ *
+ * Returns: A pointer to the entry or NULL if an error occurred
+ */
+PA_INTERN u8 *tbl_insert(struct pa_table *tbl, void *key, u16 hash)
+{
+        s16 slot;
+        s16 bucket;
+        u8 *ptr;
+        u8 *ent;
+        s32 tmp;
+        s16 next_idx;
+
+        /* A mapped table is read-only */
+        if(tbl->mode == PA_MAPPED)
+                return NULL;
+
+        /* If there is already an entry with the key, just return it */
+        if((ptr = tbl_find_key(tbl, key, hash, NULL, NULL)))
+                return ptr;
+
+        /* If configured as dynamic, scale to fit the new entry */
+        if(tbl_ensure_fit(tbl) < 0)
+                return NULL;
+
+        /* Get an open slot in the table-buffer */
+        if((slot = tbl_find_open(tbl)) < 0)
+                return NULL;
+
+        /* Determine the bucket */
+        bucket = hash & (tbl->bucket_count - 1);
+
+        /* 
+         * Write the copy over the data to the table-buffer.
+         */
+
+        /* Set the next index */
+        ent = ptr = tbl->buffer + (slot * tbl->entry_size);
+        *(s16 *)ptr = -(bucket + 2);
+        ptr += PA_TBL_NEXT_SIZE;
+
+        /* Copy the hash */
+        *(u16 *)ptr = hash;
+        ptr += PA_TBL_HASH_SIZE;
+
+        /* Copy over the keyword */
+        pa_mem_copy(ptr, key, tbl->key_size);
+
+        /*
+         * Attach the entry to the bucket.
+         */
+        if(tbl->buckets[bucket] < 0) {
+                tbl->buckets[bucket] = slot;
+        }
+        else {
+                tmp = tbl->buckets[bucket] * tbl->entry_size;
+                ptr = tbl->buffer + tmp;
+                while((next_idx = *(s16 *)ptr) >= 0) {
+                        ptr = tbl->buffer + next_idx * tbl->entry_size;
+                }
+                *(s16 *)ptr = slot;
+        }
+
+        if(tbl->filter.bits)
+                pa_bloom_add(&tbl->filter, pa_hash(key, tbl->key_size));
+
+        tbl->number++;
+        return ent;
+}
+
+/*
+ * Link the entries of a bucket written next to each other by paBuildTable().
+ * Duplicate keys are dropped, keeping the value of the last one, and their
+ * slots are pushed onto the free-list.
+ *
+ * Returns: The number of entries in the bucket
+ */
+PA_INTERN s16 tbl_link_bucket(struct pa_table *tbl, s16 bucket, s16 from,
+                s16 to)
+{
+        s16 val_off = PA_TBL_HEAD_SIZE + tbl->key_size;
+        s16 last = -1;
+        s16 number = 0;
+        u8 *a;
+        u8 *b;
+        s16 i;
+        s16 j;
+
+        for(i = from; i < to; i++) {
+                a = tbl->buffer + i * tbl->entry_size;
+                if(*(s16 *)a == -1)
+                        continue;
+
+                for(j = i + 1; j < to; j++) {
+                        b = tbl->buffer + j * tbl->entry_size;
+                        if(*(s16 *)b == -1 || *(u16 *)(a + PA_TBL_NEXT_SIZE) !=
+                                        *(u16 *)(b + PA_TBL_NEXT_SIZE))
+                                continue;
+
+                        if(pa_mem_compare(a + PA_TBL_HEAD_SIZE,
+                                                b + PA_TBL_HEAD_SIZE,
+                                                tbl->key_size)) {
+                                pa_mem_copy(a + val_off, b + val_off,
+                                                tbl->value_size);
+                                *(s16 *)b = -1;
+                        }
+                }
+        }
+
+        /* Going backwards, so every entry links to the one behind it */
+        for(i = to - 1; i >= from; i--) {
+                a = tbl->buffer + i * tbl->entry_size;
+                if(*(s16 *)a == -1) {
+                        tbl_reset_slots(tbl, i, i + 1);
+                        continue;
+                }
+
+                *(s16 *)a = last < 0 ? -(bucket + 2) : last;
+                last = i;
+                number++;
+        }
+
+        tbl->buckets[bucket] = last;
+        return number;
+}
+
+/*
+ * The header at the start of a file written by paSaveTable().
+ */
+#define TBL_FILE_MAGIC  0x4C425450      /* "PTBL" */
+
+struct tbl_file_head {
+        u32 magic;
+        s32 key_size;
+        s32 value_size;
+        s32 entry_size;
+        s16 number;
+        s16 alloc;
+        s16 free_head;
+        s16 bucket_count;
+};
+
+/*
+ * Get the number of bytes of the table-buffer and buckets in a file, which are
+ * laid out like in a fixed table.
+ */
+PA_INTERN s32 tbl_file_size(struct pa_table *tbl)
+{
+        s32 size = (tbl->alloc * tbl->entry_size + 1) & ~1;
+
+        return size + tbl->bucket_count * sizeof(s16);
+}
+
+/*
+ * Unmap the file of a mapped table.
+ */
+PA_INTERN void tbl_unmap(struct pa_table *tbl)
+{
+#ifdef PA_MMAP
+        u8 *map = tbl->buffer - sizeof(struct tbl_file_head);
+
+        munmap(map, sizeof(struct tbl_file_head) + tbl_file_size(tbl));
+#else
+        PA_IGNORE(tbl);
+#endif
+}
+
+PA_API s8 paInitTable(struct pa_table *tbl, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s16 alloc)
+{
+        s32 alloc_sz;
+        s16 i;
+
+        tbl->memory = mem;
+        tbl->mode = PA_DYNAMIC;
+
+        tbl->key_size = key_sz;
+        tbl->value_size = value_sz;
+        tbl->entry_size = PA_TBL_HEAD_SIZE + key_sz + value_sz;
+        tbl->number = 0;
+        tbl->alloc = alloc;
+        tbl->bucket_count = tbl_bucket_num(alloc);
+
+        alloc_sz = tbl->entry_size * tbl->alloc;
+        if(!(tbl->buffer = pa_mem_alloc(tbl->memory, NULL, alloc_sz))) {
+                return -1;
+        }
+
+        alloc_sz = tbl->bucket_count * sizeof(s16);
+        if(!(tbl->buckets = pa_mem_alloc(tbl->memory, NULL, alloc_sz))) {
+                goto err_free_buffer;
+        }
+
+        /* Reset all memory slots in the buffer */
+        tbl->free_head = -1;
+        tbl_reset_slots(tbl, 0, tbl->alloc);
+        pa_mem_zero(&tbl->filter, sizeof(struct pa_bloom));
+        tbl->hits = 0;
+        tbl->misses = 0;
+        tbl->filter_checks = 0;
+        tbl->filter_rejects = 0;
+
+        /* Reset all buckets */
+        for(i = 0; i < tbl->bucket_count; i++) {
+                tbl->buckets[i] = -1;
+        }
+
+        return 0;
+
+err_free_buffer:
+        pa_mem_free(tbl->memory, tbl->buffer);
+        return -1;
+}
+
+PA_API s8 paInitTableFixed(struct pa_table *tbl, void *buffer,
+                s32 buf_sz, s32 key_sz, s32 value_sz)
+{
+        s32 num;
+        s16 i;
+
+        tbl->memory = NULL;
+        tbl->mode = PA_FIXED;
+
+        tbl->key_size = key_sz;
+        tbl->value_size = value_sz;
+        tbl->entry_size = PA_TBL_HEAD_SIZE + key_sz + value_sz;
+        tbl->number = 0;
+        tbl->buffer = buffer;
+
+        /*
+         * The entries come first, followed by the buckets. Start with as many
+         * entries as fit into the buffer and reduce the number until the
+         * buckets fit as well.
+         */
+        num = buf_sz / tbl->entry_size;
+        if(num > 0x7FFF)
+                num = 0x7FFF;
+
+        while(num > 0 && tbl_fixed_size(tbl, num) > buf_sz)
+                num--;
+
+        if(num < 1)
+                return -1;
+
+        tbl->alloc = num;
+        tbl->bucket_count = tbl_bucket_num(num);
+        tbl->buckets = (s16 *)(tbl->buffer +
+                        ((num * tbl->entry_size + 1) & ~1));
+
+        /* Reset all entry-slots in the buffer */
+        tbl->free_head = -1;
+        tbl_reset_slots(tbl, 0, tbl->alloc);
+        pa_mem_zero(&tbl->filter, sizeof(struct pa_bloom));
+        tbl->hits = 0;
+        tbl->misses = 0;
+        tbl->filter_checks = 0;
+        tbl->filter_rejects = 0;
+
+        /* Reset all buckets */
+        for(i = 0; i < tbl->bucket_count; i++) {
+                tbl->buckets[i] = -1;
+        }
+
+        return 0;
+}
+
+PA_API void paDestroyTable(struct pa_table *tbl)
+{
+        if(tbl->mode == PA_DYNAMIC) {
+                pa_mem_free(tbl->memory, tbl->buffer);
+                pa_mem_free(tbl->memory, tbl->buckets);
+                pa_bloom_destroy(&tbl->filter, tbl->memory);
+        }
+        else if(tbl->mode == PA_MAPPED) {
+                tbl_unmap(tbl);
+        }
+
+        tbl->memory = 0;
+        tbl->mode = PA_MEM_UDEF;
+
+        tbl->value_size = 0;
+        tbl->entry_size = 0;
+        tbl->number = 0;
+        tbl->alloc = 0;
+        tbl->buffer = 0;
+        tbl->bucket_count = 0;
+        tbl->buckets = 0;
+}
+
+PA_API u16 paHashTableKey(struct pa_table *tbl, void *key)
+{
+        return tbl_hash(key, tbl->key_size);
+}
+
+PA_API s8 paSetTable(struct pa_table *tbl, void *key, void *value)
+{
+        return paSetTableHashed(tbl, key, tbl_hash(key, tbl->key_size), value);
+}
+
+PA_API s8 paSetTableHashed(struct pa_table *tbl, void *key, u16 hash,
+                void *value)
+{
+        u8 *ptr;
+
+        if(tbl->mode == PA_MAPPED)
+                return -1;
+
+        if(!(ptr = tbl_insert(tbl, key, hash)))
+                return -1;
+
+        /* Copy over the content */
+        pa_mem_copy(ptr + PA_TBL_HEAD_SIZE + tbl->key_size, value,
+                        tbl->value_size);
+        return 0;
+}
+
+PA_API s8 paBuildTable(struct pa_table *tbl, void *keys, void *values,
+                s16 num)
+{
+        u8 *key_ptr = keys;
+        u8 *val_ptr = values;
+        s16 count;
+        s16 start;
+        s16 end;
+        s16 mask;
+        s16 bucket;
+        s16 *buckets;
+        u16 hash;
+        u8 *ptr;
+        s16 i;
+
+        if(num < 0 || tbl->mode == PA_MAPPED)
+                return -1;
+
+        /* Size the table once for all entries */
+        if(tbl->mode == PA_DYNAMIC) {
+                if(num > tbl->alloc) {
+                        if(!(ptr = pa_mem_alloc(tbl->memory, tbl->buffer,
+                                                        num * tbl->entry_size)))
+                                return -1;
+
+                        tbl->buffer = ptr;
+                        tbl->alloc = num;
+                }
+
+                if((count = tbl_bucket_num(num)) > tbl->bucket_count) {
+                        if(!(buckets = pa_mem_alloc(tbl->memory, tbl->buckets,
+                                                        count * sizeof(s16))))
+                                return -1;
+
+                        tbl->buckets = buckets;
+                        tbl->bucket_count = count;
+                }
+        }
+        else if(num > tbl->alloc) {
+                return -1;
+        }
+
+        mask = tbl->bucket_count - 1;
+
+        /* Count the entries for every bucket */
+        for(i = 0; i < tbl->bucket_count; i++)
+                tbl->buckets[i] = 0;
+
+        for(i = 0; i < num; i++)
+                tbl->buckets[tbl_hash(key_ptr + i * tbl->key_size,
+                                tbl->key_size) & mask]++;
+
+        /* Turn the counts into the first slot of every bucket */
+        for(i = 0, start = 0; i < tbl->bucket_count; i++) {
+                count = tbl->buckets[i];
+                tbl->buckets[i] = start;
+                start += count;
+        }
+
+        /*
+         * Write the entries in the order they are given, using the buckets as
+         * cursors. Afterwards every bucket points behind its last entry, which
+         * is the first entry of the next bucket.
+         */
+        for(i = 0; i < num; i++) {
+                hash = tbl_hash(key_ptr, tbl->key_size);
+                bucket = hash & mask;
+
+                ptr = tbl->buffer + tbl->buckets[bucket]++ * tbl->entry_size;
+                *(s16 *)ptr = 0;
+                *(u16 *)(ptr + PA_TBL_NEXT_SIZE) = hash;
+                pa_mem_copy(ptr + PA_TBL_HEAD_SIZE, key_ptr, tbl->key_size);
+                pa_mem_copy(ptr + PA_TBL_HEAD_SIZE + tbl->key_size, val_ptr,
+                                tbl->value_size);
+
+                key_ptr += tbl->key_size;
+                val_ptr += tbl->value_size;
+        }
+
+        /* Link the entries and mark the remaining slots as free */
+        tbl->free_head = -1;
+        tbl_reset_slots(tbl, num, tbl->alloc);
+
+        tbl->number = 0;
+        for(i = 0, start = 0; i < tbl->bucket_count; i++) {
+                end = tbl->buckets[i];
+                tbl->number += tbl_link_bucket(tbl, i, start, end);
+                start = end;
+        }
+
+        if(tbl->filter.bits && tbl_build_filter(tbl, tbl->filter.rate) < 0)
+                pa_bloom_destroy(&tbl->filter, tbl->memory);
+
+        return 0;
+}
+
+PA_API s8 paGetTable(struct pa_table *tbl, void *key, void *out)
+{
+        u32 hash;
+
+        if(!tbl->filter.bits)
+                return paGetTableHashed(tbl, key, tbl_hash(key, tbl->key_size),
+                                out);
+
+        hash = pa_hash(key, tbl->key_size);
+        tbl->filter_checks++;
+        if(!pa_bloom_test(&tbl->filter, hash)) {
+                tbl->filter_rejects++;
+                tbl->misses++;
+                return 0;
+        }
+
+        return paGetTableHashed(tbl, key, hash & 0xFFFF, out);
+}
+
+PA_API s8 paGetTableHashed(struct pa_table *tbl, void *key, u16 hash,
+                void *out)
+{
+        u8 *ptr;
+        s16 off = PA_TBL_HEAD_SIZE + tbl->key_size;
+
+        if(!(ptr = tbl_find_key(tbl, key, hash, NULL, NULL))) {
+                tbl->misses++;
+                return 0;
+        }
+
+        pa_mem_copy(out, ptr + off, tbl->value_size);
+        tbl->hits++;
+        return 1;
+}
+
+PA_API s16 paGetTableBatch(struct pa_table *tbl, void *keys, s16 num,
+                void *out, s8 *found)
+{
+        u16 hashes[PA_TBL_BATCH];
+        s16 heads[PA_TBL_BATCH];
+        u8 *key_ptr = keys;
+        u8 *out_ptr = out;
+        s16 off = PA_TBL_HEAD_SIZE + tbl->key_size;
+        s16 mask = tbl->bucket_count - 1;
+        s16 number = 0;
+        s16 batch;
+        s16 i;
+        s16 j;
+        u8 *ptr;
+
+        for(i = 0; i < num; i += batch) {
+                batch = num - i < PA_TBL_BATCH ? num - i : PA_TBL_BATCH;
+
+                /* Hash all keys and request the bucket-heads */
+                for(j = 0; j < batch; j++) {
+                        hashes[j] = tbl_hash(key_ptr + j * tbl->key_size,
+                                        tbl->key_size);
+                        PA_PREFETCH(&tbl->buckets[hashes[j] & mask]);
+                }
+
+                /* Request the first entry of every bucket */
+                for(j = 0; j < batch; j++) {
+                        heads[j] = tbl->buckets[hashes[j] & mask];
+                        if(heads[j] >= 0)
+                                PA_PREFETCH(tbl->buffer +
+                                                heads[j] * tbl->entry_size);
+                }
+
+                /* Now walk the buckets, which should be in the cache */
+                for(j = 0; j < batch; j++) {
+                        ptr = NULL;
+                        if(heads[j] >= 0)
+                                ptr = tbl_find_key(tbl, key_ptr, hashes[j],
+                                                NULL, NULL);
+
+                        if(ptr) {
+                                pa_mem_copy(out_ptr, ptr + off,
+                                                tbl->value_size);
+                                number++;
+                        }
+
+                        if(found)
+                                found[i + j] = ptr != NULL;
+
+                        key_ptr += tbl->key_size;
+                        out_ptr += tbl->value_size;
+                }
+        }
+
+        tbl->hits += number;
+        tbl->misses += num - number;
+        return number;
+}
+
+PA_API void paRemoveTable(struct pa_table *tbl, void *key)
+{
+        s16 bucket;
+        u8 *ptr;
+        u8 *prev;
+        s16 next_idx;
+
+        /* A mapped table is read-only */
+        if(tbl->mode == PA_MAPPED)
+                return;
+
+        if((ptr = tbl_find_key(tbl, key, tbl_hash(key, tbl->key_size), &prev,
+                                        &bucket))) {
+                next_idx = *(s16 *)ptr;
+
+                if(!prev && next_idx < 0) {
+                        tbl->buckets[bucket] = -1;
+                }
+                else if(!prev && next_idx >= 0) {
+                        tbl->buckets[bucket] = next_idx;
+                }
+                else if(prev) {
+                        *(s16 *)prev = *(s16 *)ptr;
+                }
+
+                /* Push the slot onto the free-list */
+                *(s16 *)ptr = -1;
+                *(s16 *)(ptr + PA_TBL_NEXT_SIZE) = tbl->free_head;
+                tbl->free_head = (ptr - tbl->buffer) / tbl->entry_size;
+                tbl->number--;
+
+                /*
+                 * The bits of the key stay in the filter, so rebuild it once
+                 * too many are left. If that fails, just go without it.
+                 */
+                if(tbl->filter.bits && ++tbl->filter.stale >
+                                tbl->filter.capacity / 2) {
+                        if(tbl_build_filter(tbl, tbl->filter.rate) < 0)
+                                pa_bloom_destroy(&tbl->filter, tbl->memory);
+                }
+        }
+}
+
+PA_API void paGetTableStats(struct pa_table *tbl, struct pa_hash_stats *stats)
+{
+        hst_collect(stats, tbl->buffer, tbl->entry_size, tbl->buckets,
+                        tbl->bucket_count);
+
+        stats->slots = tbl->alloc;
+        stats->hits = tbl->hits;
+        stats->misses = tbl->misses;
+        stats->filter_checks = tbl->filter_checks;
+        stats->filter_rejects = tbl->filter_rejects;
+}
+
+PA_API void paResetTableStats(struct pa_table *tbl)
+{
+        tbl->hits = 0;
+        tbl->misses = 0;
+        tbl->filter_checks = 0;
+        tbl->filter_rejects = 0;
+}
+
+PA_API s8 paEnableTableFilter(struct pa_table *tbl, f32 rate)
+{
+        if(tbl->mode != PA_DYNAMIC)
+                return -1;
+
+        if(rate <= 0) {
+                pa_bloom_destroy(&tbl->filter, tbl->memory);
+                return 0;
+        }
+
+        return tbl_build_filter(tbl, rate);
+}
+
+PA_API void *paIterateTable(struct pa_table *tbl, void *ptr, 
+                struct pa_table_entry *ent)
+{
+        char *tmp;
+
+        /* Check if the table is empty */
+        if(tbl->number < 1)
+                return NULL;
+
+        /* Go to the next entry in the table */
+        if(!(ptr = tbl_next(tbl, ptr)))
+                return NULL;
+
+        /* Return the entry-data for the current entry */
+        if(ent) {
+                /* Copy over the key */
+                tmp = (char *)ptr + PA_TBL_NEXT_SIZE + PA_TBL_HASH_SIZE;
+
+                /* Set the pointer for the data */
+                ent->key = tmp;
+                ent->value = tmp + tbl->key_size;
+        }
+
+        return ptr;
+}
+
+PA_API void *paIterateTableBucket(struct pa_table *tbl, s16 bucket,
+                void *ptr, struct pa_table_entry *ent)
+{
+        char *tmp;
+
+        /* Check if the table is empty */
+        if(tbl->number < 1)
+                return NULL;
+
+        if(!(ptr = tbl_next_bucket(tbl, bucket, ptr)))
+                return NULL;
+
+        /* Return the data for the current entry */
+        if(ent) {
+                /* Copy over the key */
+                tmp = (char *)ptr + PA_TBL_NEXT_SIZE + PA_TBL_HASH_SIZE;
+
+                /* Set the pointer for the data */
+                ent->key = tmp;
+                ent->value = tmp + tbl->key_size;
+        }
+
+        return ptr;
+}
+
+PA_API s8 paSaveTable(struct pa_table *tbl, char *path)
+{
+        struct tbl_file_head head;
+        s32 size = tbl->alloc * tbl->entry_size;
+        FILE *fp;
+        u8 pad = 0;
+
+        head.magic = TBL_FILE_MAGIC;
+        head.key_size = tbl->key_size;
+        head.value_size = tbl->value_size;
+        head.entry_size = tbl->entry_size;
+        head.number = tbl->number;
+        head.alloc = tbl->alloc;
+        head.free_head = tbl->free_head;
+        head.bucket_count = tbl->bucket_count;
+
+        if(!(fp = fopen(path, "wb")))
+                return -1;
+
+        if(fwrite(&head, sizeof(head), 1, fp) != 1)
+                goto err_close;
+
+        if(size > 0 && fwrite(tbl->buffer, size, 1, fp) != 1)
+                goto err_close;
+
+        /* Keep the buckets aligned */
+        if((size % 2) && fwrite(&pad, 1, 1, fp) != 1)
+                goto err_close;
+
+        if(fwrite(tbl->buckets, sizeof(s16), tbl->bucket_count, fp) !=
+                        (size_t)tbl->bucket_count)
+                goto err_close;
+
+        if(fclose(fp) != 0)
+                return -1;
+
+        return 0;
+
+err_close:
+        fclose(fp);
+        return -1;
+}
+
+/*
+ * Check that every index stored in a mapped table stays inside of it, so a
+ * damaged file can't send lookups or iterations outside the mapping. Entries
+ * in use link to the next entry or end with -(bucket + 2), open slots are
+ * marked with -1 and link to the next open slot.
+ *
+ * Afterwards every bucket-chain is walked, to make sure it ends with its own
+ * bucket and doesn't loop. Together all chains have to reach exactly the
+ * number of entries in the table.
+ *
+ * Returns: 0 if all indices are valid or -1 if not
+ */
+PA_INTERN s8 tbl_check_links(struct pa_table *tbl)
+{
+        s16 next_idx;
+        s32 reached = 0;
+        u8 *ptr;
+        s16 i;
+
+        if(tbl->number < 0 || tbl->number > tbl->alloc)
+                return -1;
+
+        if(tbl->free_head < -1 || tbl->free_head >= tbl->alloc)
+                return -1;
+
+        for(i = 0; i < tbl->bucket_count; i++) {
+                if(tbl->buckets[i] < -1 || tbl->buckets[i] >= tbl->alloc)
+                        return -1;
+        }
+
+        for(i = 0; i < tbl->alloc; i++) {
+                ptr = tbl->buffer + i * tbl->entry_size;
+                next_idx = *(s16 *)ptr;
+
+                if(next_idx == -1)
+                        next_idx = *(s16 *)(ptr + PA_TBL_NEXT_SIZE);
+                else if(next_idx < 0 && -(next_idx + 2) < tbl->bucket_count)
+                        continue;
+
+                if(next_idx < -1 || next_idx >= tbl->alloc)
+                        return -1;
+        }
+
+        for(i = 0; i < tbl->bucket_count; i++) {
+                next_idx = tbl->buckets[i];
+
+                while(next_idx >= 0) {
+                        /* More entries than stored means the chain loops */
+                        if(++reached > tbl->number)
+                                return -1;
+
+                        ptr = tbl->buffer + next_idx * tbl->entry_size;
+                        next_idx = *(s16 *)ptr;
+                }
+
+                /* A chain has to end with its own bucket, not an open slot */
+                if(tbl->buckets[i] >= 0 && next_idx != -(i + 2))
+                        return -1;
+        }
+
+        return reached == tbl->number ? 0 : -1;
+}
+
+PA_API s8 paMapTable(struct pa_table *tbl, char *path)
+{
+#ifdef PA_MMAP
+        struct tbl_file_head *head;
+        struct stat st;
+        s32 entry_size;
+        u8 *map;
+        int fd;
+
+        if((fd = open(path, O_RDONLY)) < 0)
+                return -1;
+
+        if(fstat(fd, &st) < 0 ||
+                        st.st_size < (off_t)sizeof(struct tbl_file_head)) {
+                close(fd);
+                return -1;
+        }
+
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if(map == MAP_FAILED)
+                return -1;
+
+        /* Make sure the file is intact before using it */
+        head = (struct tbl_file_head *)map;
+        if(head->key_size < 1 || head->value_size < 0 ||
+                        head->key_size > st.st_size ||
+                        head->value_size > st.st_size)
+                goto err_unmap;
+
+        entry_size = PA_TBL_HEAD_SIZE + head->key_size + head->value_size;
+        if(head->magic != TBL_FILE_MAGIC || head->entry_size != entry_size ||
+                        head->alloc < 1 || head->bucket_count < 1 ||
+                        (head->bucket_count & (head->bucket_count - 1)))
+                goto err_unmap;
+
+        /* Keep alloc * entry_size from overflowing */
+        if((off_t)head->alloc * entry_size > st.st_size)
+                goto err_unmap;
+
+        tbl->memory = NULL;
+        tbl->mode = PA_MAPPED;
+
+        tbl->key_size = head->key_size;
+        tbl->value_size = head->value_size;
+        tbl->entry_size = head->entry_size;
+        tbl->number = head->number;
+        tbl->alloc = head->alloc;
+        tbl->free_head = head->free_head;
+        tbl->bucket_count = head->bucket_count;
+        pa_mem_zero(&tbl->filter, sizeof(struct pa_bloom));
+        tbl->hits = 0;
+        tbl->misses = 0;
+        tbl->filter_checks = 0;
+        tbl->filter_rejects = 0;
+
+        if(st.st_size != (off_t)(sizeof(*head) + tbl_file_size(tbl)))
+                goto err_unmap;
+
+        tbl->buffer = map + sizeof(*head);
+        tbl->buckets = (s16 *)(tbl->buffer +
+                        ((tbl->alloc * tbl->entry_size + 1) & ~1));
+
+        if(tbl_check_links(tbl) < 0)
+                goto err_unmap;
+
+        return 0;
+
+err_unmap:
+        munmap(map, st.st_size);
+        tbl->mode = PA_MEM_UDEF;
+        return -1;
+#else
+        PA_IGNORE(tbl);
+        PA_IGNORE(path);
+        return -1;
+#endif
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      FLAT-TABLE
+ *
+ */
+
+PA_INTERN u8 *ftb_slot(struct pa_flat_table *tbl, s32 idx)
+{
+        return tbl->slots + idx * tbl->entry_size;
+}
+
+/*
+ * Get the number of slots that can be used before the table has to be
+ * rebuilt.
+ */
+PA_INTERN s32 ftb_max_load(s32 alloc)
+{
+        return alloc - alloc / 8;
+}
+
+/*
+ * Get the number of bytes needed for the given number of slots, including
+ * the padding to align the control-bytes. As the number of slots is a
+ * multiple of PA_FLAT_GROUP, this also aligns the slots.
+ */
+PA_INTERN s32 ftb_buffer_size(struct pa_flat_table *tbl, s32 alloc)
+{
+        return PA_FLAT_GROUP + alloc + alloc * tbl->entry_size;
+}
+
+/*
+ * Set the pointers for the given buffer and number of slots and mark all
+ * slots as empty.
+ */
+PA_INTERN void ftb_layout(struct pa_flat_table *tbl, u8 *buf, s32 alloc)
+{
+        buf += (PA_FLAT_GROUP - ((unsigned long)buf % PA_FLAT_GROUP)) %
+                PA_FLAT_GROUP;
+
+        tbl->control = buf;
+        tbl->slots = buf + alloc;
+        tbl->alloc = alloc;
+        tbl->number = 0;
+        tbl->growth_left = ftb_max_load(alloc);
+
+        pa_mem_set(tbl->control, PA_FLAT_EMPTY, alloc);
+}
+
+/*
+ * Get a bitmask with a bit set for every slot in the group, which has the
+ * given control-byte.
+ */
+PA_INTERN u32 ftb_match(u8 *ctrl, u8 value)
+{
+#ifdef PA_SSE2
+        __m128i v = _mm_load_si128((__m128i *)ctrl);
+
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(value)));
+#else
+        u32 mask = 0;
+        s8 i;
+
+        for(i = 0; i < PA_FLAT_GROUP; i++) {
+                if(ctrl[i] == value)
+                        mask |= 1 << i;
+        }
+
+        return mask;
+#endif
+}
+
+/*
+ * Get a bitmask with a bit set for every empty or deleted slot in the group.
+ * Both have the highest bit set, while used slots never do.
+ */
+PA_INTERN u32 ftb_match_free(u8 *ctrl)
+{
+#ifdef PA_SSE2
+        return _mm_movemask_epi8(_mm_load_si128((__m128i *)ctrl));
+#else
+        u32 mask = 0;
+        s8 i;
+
+        for(i = 0; i < PA_FLAT_GROUP; i++) {
+                if(ctrl[i] & 0x80)
+                        mask |= 1 << i;
+        }
+
+        return mask;
+#endif
+}
+
+/*
+ * Search for the slot containing the key. The groups are visited in a
+ * triangular sequence, which reaches every group once as the number of groups
+ * is a power of two.
+ */
+PA_INTERN s32 ftb_find(struct pa_flat_table *tbl, u8 *key, u32 hash)
+{
+        s32 groups = tbl->alloc / PA_FLAT_GROUP;
+        s32 group = (hash >> 7) & (groups - 1);
+        u8 *ctrl;
+        u32 mask;
+        s32 idx;
+        s32 i;
+
+        for(i = 1; i <= groups; i++) {
+                ctrl = tbl->control + group * PA_FLAT_GROUP;
+
+                mask = ftb_match(ctrl, hash & 0x7F);
+                while(mask) {
+                        idx = group * PA_FLAT_GROUP + pa_bit_ctz(mask);
+                        if(pa_mem_compare(key, ftb_slot(tbl, idx),
+                                                tbl->key_size))
+                                return idx;
+
+                        mask &= mask - 1;
+                }
+
+                /* An empty slot ends the probe-sequence */
+                if(ftb_match(ctrl, PA_FLAT_EMPTY))
+                        return -1;
+
+                group = (group + i) & (groups - 1);
+        }
+
+        return -1;
+}
+
+/*
+ * Get the first empty or deleted slot in the probe-sequence for the hash.
+ */
+PA_INTERN s32 ftb_find_free(struct pa_flat_table *tbl, u32 hash)
+{
+        s32 groups = tbl->alloc / PA_FLAT_GROUP;
+        s32 group = (hash >> 7) & (groups - 1);
+        u32 mask;
+        s32 i;
+
+        for(i = 1; i <= groups; i++) {
+                if((mask = ftb_match_free(tbl->control +
+                                                group * PA_FLAT_GROUP)))
+                        return group * PA_FLAT_GROUP + pa_bit_ctz(mask);
+
+                group = (group + i) & (groups - 1);
+        }
+
+        return -1;
+}
+
+PA_INTERN void ftb_swap(struct pa_flat_table *tbl, s32 a, s32 b)
+{
+        u8 *pa = ftb_slot(tbl, a);
+        u8 *pb = ftb_slot(tbl, b);
+        u8 tmp;
+        s32 i;
+
+        for(i = 0; i < tbl->entry_size; i++) {
+                tmp = pa[i];
+                pa[i] = pb[i];
+                pb[i] = tmp;
+        }
+}
+
+/*
+ * Reclaim the slots of removed entries without allocating new memory. First
+ * all used slots are marked as deleted and all deleted slots as empty. Then
+ * every slot marked as deleted is moved to the first free slot in its
+ * probe-sequence. If that slot still has to be moved itself, both slots are
+ * swapped and the current slot is processed again.
+ */
+PA_INTERN void ftb_rehash_in_place(struct pa_flat_table *tbl)
+{
+        u8 *ctrl = tbl->control;
+        s32 target;
+        u32 hash;
+        s32 i;
+
+        for(i = 0; i < tbl->alloc; i++)
+                ctrl[i] = (ctrl[i] & 0x80) ? PA_FLAT_EMPTY : PA_FLAT_DELETED;
+
+        for(i = 0; i < tbl->alloc; i++) {
+                if(ctrl[i] != PA_FLAT_DELETED)
+                        continue;
+
+                hash = pa_hash(ftb_slot(tbl, i), tbl->key_size);
+                target = ftb_find_free(tbl, hash);
+
+                /* The slot is already in the right group */
+                if(target / PA_FLAT_GROUP == i / PA_FLAT_GROUP) {
+                        ctrl[i] = hash & 0x7F;
+                        continue;
+                }
+
+                if(ctrl[target] == PA_FLAT_EMPTY) {
+                        pa_mem_copy(ftb_slot(tbl, target), ftb_slot(tbl, i),
+                                        tbl->entry_size);
+                        ctrl[target] = hash & 0x7F;
+                        ctrl[i] = PA_FLAT_EMPTY;
+                }
+                else {
+                        ftb_swap(tbl, i, target);
+                        ctrl[target] = hash & 0x7F;
+                        i--;
+                }
+        }
+
+        tbl->growth_left = ftb_max_load(tbl->alloc) - tbl->number;
+}
+
+/*
+ * Move all entries into a new buffer with the given number of slots.
+ */
+PA_INTERN s8 ftb_resize(struct pa_flat_table *tbl, s32 alloc)
+{
+        u8 *old_buffer = tbl->buffer;
+        u8 *old_control = tbl->control;
+        u8 *old_slots = tbl->slots;
+        s32 old_alloc = tbl->alloc;
+        s32 number = tbl->number;
+        u8 *src;
+        u32 hash;
+        s32 idx;
+        s32 i;
+        u8 *p;
+
+        if(!(p = pa_mem_alloc(tbl->memory, NULL, ftb_buffer_size(tbl, alloc))))
+                return -1;
+
+        tbl->buffer = p;
+        ftb_layout(tbl, p, alloc);
+
+        for(i = 0; i < old_alloc; i++) {
+                if(old_control[i] & 0x80)
+                        continue;
+
+                src = old_slots + i * tbl->entry_size;
+                hash = pa_hash(src, tbl->key_size);
+                idx = ftb_find_free(tbl, hash);
+
+                tbl->control[idx] = hash & 0x7F;
+                pa_mem_copy(ftb_slot(tbl, idx), src, tbl->entry_size);
+        }
+
+        tbl->number = number;
+        tbl->growth_left -= number;
+
+        pa_mem_free(tbl->memory, old_buffer);
+        return 0;
+}
+
+/*
+ * Make room for a new entry once all usable slots are taken. If most of the
+ * taken slots belong to removed entries, reclaim them. Otherwise double the
+ * number of slots, which is only possible if configured as dynamic.
+ */
+PA_INTERN s8 ftb_rebuild(struct pa_flat_table *tbl)
+{
+        s32 max = ftb_max_load(tbl->alloc);
+
+        if(tbl->mode == PA_DYNAMIC && tbl->number > max / 2)
+                return ftb_resize(tbl, tbl->alloc * 2);
+
+        if(tbl->number >= max)
+                return -1;
+
+        ftb_rehash_in_place(tbl);
+        return 0;
+}
+
+PA_API s8 paInitFlatTable(struct pa_flat_table *tbl, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s32 alloc)
+{
+        s32 slots = PA_FLAT_GROUP;
+
+        if(key_sz < 1 || value_sz < 0)
+                return -1;
+
+        tbl->memory = mem;
+        tbl->mode = PA_DYNAMIC;
+
+        tbl->key_size = key_sz;
+        tbl->value_size = value_sz;
+        tbl->entry_size = key_sz + value_sz;
+
+        while(ftb_max_load(slots) < alloc)
+                slots *= 2;
+
+        if(!(tbl->buffer = pa_mem_alloc(mem, NULL,
+                                        ftb_buffer_size(tbl, slots))))
+                return -1;
+
+        ftb_layout(tbl, tbl->buffer, slots);
+        return 0;
+}
+
+PA_API s8 paInitFlatTableFixed(struct pa_flat_table *tbl, void *buffer,
+                s32 buf_sz, s32 key_sz, s32 value_sz)
+{
+        s32 slots = PA_FLAT_GROUP;
+
+        if(key_sz < 1 || value_sz < 0)
+                return -1;
+
+        tbl->memory = NULL;
+        tbl->mode = PA_FIXED;
+
+        tbl->key_size = key_sz;
+        tbl->value_size = value_sz;
+        tbl->entry_size = key_sz + value_sz;
+
+        if(ftb_buffer_size(tbl, slots) > buf_sz)
+                return -1;
+
+        while(ftb_buffer_size(tbl, slots * 2) <= buf_sz)
+                slots *= 2;
+
+        tbl->buffer = buffer;
+        ftb_layout(tbl, tbl->buffer, slots);
+        return 0;
+}
+
+PA_API void paDestroyFlatTable(struct pa_flat_table *tbl)
+{
+        if(tbl->mode == PA_DYNAMIC) {
+                pa_mem_free(tbl->memory, tbl->buffer);
+        }
+
+        tbl->memory = NULL;
+        tbl->mode = PA_MEM_UDEF;
+
+        tbl->number = 0;
+        tbl->alloc = 0;
+        tbl->growth_left = 0;
+        tbl->buffer = NULL;
+        tbl->control = NULL;
+        tbl->slots = NULL;
+}
+
+PA_API void paClearFlatTable(struct pa_flat_table *tbl)
+{
+        pa_mem_set(tbl->control, PA_FLAT_EMPTY, tbl->alloc);
+
+        tbl->number = 0;
+        tbl->growth_left = ftb_max_load(tbl->alloc);
+}
+
+PA_API s8 paSetFlatTable(struct pa_flat_table *tbl, void *key, void *value)
+{
+        u32 hash = pa_hash(key, tbl->key_size);
+        s32 idx;
+        u8 *ptr;
+
+        /*
+         * If there is already an entry with the key in the table, we can just
+         * overwrite it's value and return.
+         */
+        if((idx = ftb_find(tbl, key, hash)) >= 0) {
+                ptr = ftb_slot(tbl, idx) + tbl->key_size;
+                pa_mem_copy(ptr, value, tbl->value_size);
+                return 0;
+        }
+
+        /* Reusing the slot of a removed entry is always possible */
+        idx = ftb_find_free(tbl, hash);
+        if(tbl->growth_left < 1 && tbl->control[idx] != PA_FLAT_DELETED) {
+                if(ftb_rebuild(tbl) < 0)
+                        return -1;
+
+                idx = ftb_find_free(tbl, hash);
+        }
+
+        if(tbl->control[idx] == PA_FLAT_EMPTY)
+                tbl->growth_left--;
+
+        tbl->control[idx] = hash & 0x7F;
+        tbl->number++;
+
+        /* Copy over the key and value */
+        ptr = ftb_slot(tbl, idx);
+        pa_mem_copy(ptr, key, tbl->key_size);
+        pa_mem_copy(ptr + tbl->key_size, value, tbl->value_size);
+        return 0;
+}
+
+PA_API s8 paGetFlatTable(struct pa_flat_table *tbl, void *key, void *out)
+{
+        s32 idx;
+
+        if((idx = ftb_find(tbl, key, pa_hash(key, tbl->key_size))) < 0)
+                return 0;
+
+        pa_mem_copy(out, ftb_slot(tbl, idx) + tbl->key_size, tbl->value_size);
+        return 1;
+}
+
+PA_API void paRemoveFlatTable(struct pa_flat_table *tbl, void *key)
+{
+        s32 group;
+        s32 idx;
+
+        if((idx = ftb_find(tbl, key, pa_hash(key, tbl->key_size))) < 0)
+                return;
+
+        /*
+         * If the group still has an empty slot, no probe-sequence continues
+         * past this group, so the slot can be marked as empty again. Otherwise
+         * it has to be marked as deleted to keep later entries reachable.
+         */
+        group = idx - idx % PA_FLAT_GROUP;
+        if(ftb_match(tbl->control + group, PA_FLAT_EMPTY)) {
+                tbl->control[idx] = PA_FLAT_EMPTY;
+                tbl->growth_left++;
+        }
+        else {
+                tbl->control[idx] = PA_FLAT_DELETED;
+        }
+
+        tbl->number--;
+}
+
+PA_API void *paIterateFlatTable(struct pa_flat_table *tbl, void *ptr,
+                struct pa_table_entry *ent)
+{
+        s32 idx = 0;
+        s32 group;
+        u32 mask;
+
+        /* Check if the table is empty */
+        if(tbl->number < 1)
+                return NULL;
+
+        if(ptr)
+                idx = ((u8 *)ptr - tbl->slots) / tbl->entry_size + 1;
+
+        /* Skip whole groups of free slots at once */
+        while(idx < tbl->alloc) {
+                group = idx - idx % PA_FLAT_GROUP;
+                mask = ~ftb_match_free(tbl->control + group) & 0xFFFF;
+                mask >>= idx - group;
+
+                if(mask) {
+                        idx += pa_bit_ctz(mask);
+                        ptr = ftb_slot(tbl, idx);
+
+                        if(ent) {
+                                ent->key = ptr;
+                                ent->value = (u8 *)ptr + tbl->key_size;
+                        }
+
+                        return ptr;
+                }
+
+                idx = group + PA_FLAT_GROUP;
+        }
+
+        return NULL;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      SHARED-TABLE
+ *
+ */
+
+/* Size of a cache-line, so reader slots don't share one */
+#define SHR_LINE        64
+
+/*
+ * A published version of the table. The fixed table-buffer follows directly
+ * behind the struct in the same allocation.
+ */
+struct shr_snapshot {
+        struct pa_table table;
+        u32 version;                    /* The version it was published as */
+        struct shr_snapshot *next;      /* The next retired snapshot */
+};
+
+/*
+ * The epoch of a reader and the current snapshot and version are shared
+ * without a lock. The volatile only keeps the compiler from caching them in
+ * registers, the ordering between publishing a snapshot and checking the
+ * epochs of the readers comes from PA_BARRIER().
+ */
+struct shr_reader {
+        volatile u32 epoch;     /* The version being read or 0 if idle */
+        u8 pad[SHR_LINE - sizeof(u32)];
+};
+
+struct shr_state {
+#ifdef PA_PTHREADS
+        pthread_mutex_t lock;
+#endif
+
+        struct shr_snapshot *volatile current;
+        volatile u32 version;
+
+        /* Replaced snapshots which might still be read */
+        struct shr_snapshot *retired;
+
+        struct shr_reader *readers;
+};
+
+PA_INTERN void shr_lock(struct shr_state *st)
+{
+#ifdef PA_PTHREADS
+        pthread_mutex_lock(&st->lock);
+#else
+        PA_IGNORE(st);
+#endif
+}
+
+PA_INTERN void shr_unlock(struct shr_state *st)
+{
+#ifdef PA_PTHREADS
+        pthread_mutex_unlock(&st->lock);
+#else
+        PA_IGNORE(st);
+#endif
+}
+
+/*
+ * Create a new snapshot with room for the given number of entries and copy
+ * over all entries of the old snapshot, if one is given.
+ *
+ * Returns: The new snapshot or NULL if an error occurred
+ */
+PA_INTERN struct shr_snapshot *shr_copy(struct pa_shared_table *tbl,
+                struct shr_snapshot *old, s32 num)
+{
+        struct shr_snapshot *snap;
+        struct pa_table_entry ent;
+        struct pa_table tmp;
+        void *ptr = NULL;
+        s32 buf_sz;
+        u16 hash;
+
+        if(num > 0x7FFF)
+                return NULL;
+
+        tmp.entry_size = PA_TBL_HEAD_SIZE + tbl->key_size + tbl->value_size;
+        buf_sz = tbl_fixed_size(&tmp, PA_MAX(num, 1));
+
+        if(!(snap = pa_mem_alloc(tbl->memory, NULL, sizeof(*snap) + buf_sz)))
+                return NULL;
+
+        if(paInitTableFixed(&snap->table, snap + 1, buf_sz, tbl->key_size,
+                                tbl->value_size) < 0)
+                goto err_free_snap;
+
+        snap->version = 0;
+        snap->next = NULL;
+
+        if(!old)
+                return snap;
+
+        /* The hashes are stored in the entries, so don't hash them again */
+        while((ptr = paIterateTable(&old->table, ptr, &ent))) {
+                hash = *(u16 *)((u8 *)ptr + PA_TBL_NEXT_SIZE);
+                if(paSetTableHashed(&snap->table, ent.key, hash,
+                                        ent.value) < 0)
+                        goto err_free_snap;
+        }
+
+        return snap;
+
+err_free_snap:
+        pa_mem_free(tbl->memory, snap);
+        return NULL;
+}
+
+/*
+ * Free all retired snapshots no reader can see anymore. A reader announcing
+ * version v only ever reads snapshots published as v or later.
+ */
+PA_INTERN void shr_reclaim(struct pa_shared_table *tbl)
+{
+        struct shr_state *st = tbl->state;
+        struct shr_snapshot **link = &st->retired;
+        struct shr_snapshot *snap;
+        u32 oldest = st->version + 1;
+        u32 epoch;
+        s16 i;
+
+        for(i = 0; i < tbl->readers; i++) {
+                epoch = st->readers[i].epoch;
+                if(epoch != 0 && epoch < oldest)
+                        oldest = epoch;
+        }
+
+        while((snap = *link)) {
+                if(snap->version < oldest) {
+                        *link = snap->next;
+                        pa_mem_free(tbl->memory, snap);
+                }
+                else {
+                        link = &snap->next;
+                }
+        }
+}
+
+/*
+ * Replace the current snapshot with the given one and retire the old one. Must
+ * be called with the writer-lock held.
+ */
+PA_INTERN void shr_publish(struct pa_shared_table *tbl,
+                struct shr_snapshot *snap)
+{
+        struct shr_state *st = tbl->state;
+        struct shr_snapshot *old = st->current;
+
+        snap->version = st->version + 1;
+
+        /* The snapshot has to be complete before anyone can see it */
+        PA_BARRIER();
+        st->current = snap;
+        PA_BARRIER();
+        st->version = snap->version;
+
+        /* Make the new version visible before checking the readers */
+        PA_BARRIER();
+
+        old->next = st->retired;
+        st->retired = old;
+
+        shr_reclaim(tbl);
+}
+
+PA_API s8 paInitSharedTable(struct pa_shared_table *tbl, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s16 readers)
+{
+        struct shr_state *st;
+        s32 size;
+        u8 *ptr;
+        s16 i;
+
+        if(readers < 1)
+                return -1;
+
+        tbl->memory = mem;
+        tbl->key_size = key_sz;
+        tbl->value_size = value_sz;
+        tbl->readers = readers;
+
+        /* Allocate the state and the reader slots aligned to a cache-line */
+        size = sizeof(struct shr_state) + (readers + 1) * SHR_LINE;
+        if(!(st = pa_mem_alloc(mem, NULL, size)))
+                return -1;
+
+        ptr = (u8 *)(st + 1);
+        ptr += (SHR_LINE - ((unsigned long)ptr % SHR_LINE)) % SHR_LINE;
+        st->readers = (struct shr_reader *)ptr;
+
+        for(i = 0; i < readers; i++)
+                st->readers[i].epoch = 0;
+
+        st->retired = NULL;
+        st->version = 1;
 
-        tbl->alloc = buf_sz / tbl->entry_size;
+        tbl->state = st;
+        if(!(st->current = shr_copy(tbl, NULL, 0)))
+                goto err_free_state;
 
-        /* Reset all entry-slots in the buffer */
-        for(i = 0; i < tbl->alloc; i++) {
-                *(s16 *)(tbl->buffer + i * tbl->entry_size) = -1;
-        }
+        st->current->version = st->version;
 
-        /* Reset all buckets */
-        for(i = 0; i < PA_TBL_BUCKETS; i++) {
-                tbl->buckets[i] = -1;
-        }
+#ifdef PA_PTHREADS
+        pthread_mutex_init(&st->lock, NULL);
+#endif
 
         return 0;
+
+err_free_state:
+        pa_mem_free(mem, st);
+        tbl->state = NULL;
+        return -1;
 }
 
-PA_API void paDestroyTable(struct pa_table *tbl)
+PA_API void paDestroySharedTable(struct pa_shared_table *tbl)
 {
-        if(tbl->mode == PA_DYNAMIC) {
-                pa_mem_free(tbl->memory, tbl->buffer);
+        struct shr_state *st = tbl->state;
+        struct shr_snapshot *snap;
+
+        if(!st)
+                return;
+
+        while((snap = st->retired)) {
+                st->retired = snap->next;
+                pa_mem_free(tbl->memory, snap);
         }
 
-        tbl->memory = 0;
-        tbl->mode = PA_MEM_UDEF;
+        pa_mem_free(tbl->memory, st->current);
 
-        tbl->value_size = 0;
-        tbl->entry_size = 0;
-        tbl->number = 0;
-        tbl->alloc = 0;
-        tbl->buffer = 0;
+#ifdef PA_PTHREADS
+        pthread_mutex_destroy(&st->lock);
+#endif
+
+        pa_mem_free(tbl->memory, st);
+
+        tbl->state = NULL;
+        tbl->readers = 0;
 }
 
-PA_API s8 paSetTable(struct pa_table *tbl, void *key, void *value)
+PA_API s8 paSetSharedTable(struct pa_shared_table *tbl, void *key,
+                void *value)
 {
-        s16 slot;
-        u16 hash;
-        s16 bucket;
-        u8 *ptr;
-        s32 tmp;
-        s16 next_idx;
+        return paSetSharedTableBatch(tbl, key, value, 1);
+}
 
-        s16 key_off = PA_TBL_HEAD_SIZE;
-        s16 val_off = key_off + tbl->key_size;
-                
-        /*
-         * If there is already an entry with the keyword in the table, we
-         * can just overwrite it's value and return.
-         */
-        if((ptr = tbl_find_key(tbl, key, NULL, NULL))) {
-                /* Copy over the content */
-                pa_mem_copy(ptr + val_off, value, tbl->value_size);
-                return 0;
+PA_API s8 paSetSharedTableBatch(struct pa_shared_table *tbl, void *keys,
+                void *values, s16 num)
+{
+        struct shr_state *st = tbl->state;
+        struct shr_snapshot *snap;
+        u8 *key_ptr = keys;
+        u8 *val_ptr = values;
+        s16 i;
 
-        }
+        shr_lock(st);
 
-        /* Get an open slot in the table-buffer */
-        if((slot = tbl_find_open(tbl)) < 0)
-                return -1;
+        snap = shr_copy(tbl, st->current, st->current->table.number + num);
+        if(!snap)
+                goto err_unlock;
 
-        /* Hash the key and determine the bucket  */
-        hash = tbl_hash(key, tbl->key_size); 
-        bucket = hash % PA_TBL_BUCKETS;
+        for(i = 0; i < num; i++) {
+                if(paSetTable(&snap->table, key_ptr, val_ptr) < 0)
+                        goto err_free_snap;
 
-        /* 
-         * Write the copy over the data to the table-buffer.
-         */
+                key_ptr += tbl->key_size;
+                val_ptr += tbl->value_size;
+        }
 
-        /* Set the next index */
-        ptr = tbl->buffer + (slot * tbl->entry_size);
-        *(s16 *)ptr = -(bucket + 2);
-        ptr += PA_TBL_NEXT_SIZE;
+        shr_publish(tbl, snap);
+        shr_unlock(st);
+        return 0;
 
-        /* Copy the hash */
-        *(u16 *)ptr = hash;
-        ptr += PA_TBL_HASH_SIZE;
+err_free_snap:
+        pa_mem_free(tbl->memory, snap);
 
-        /* Copy over the keyword */
-        pa_mem_copy(ptr, key, tbl->key_size);
-        ptr += tbl->key_size;
+err_unlock:
+        shr_unlock(st);
+        return -1;
+}
 
-        /* Copy over the content */
-        pa_mem_copy(ptr, value, tbl->value_size);
+PA_API s8 paRemoveSharedTable(struct pa_shared_table *tbl, void *key)
+{
+        struct shr_state *st = tbl->state;
+        struct shr_snapshot *snap;
+        u16 hash = tbl_hash(key, tbl->key_size);
 
-        /*
-         * Attach the entry to the bucket.
-         */
-        if(tbl->buckets[bucket] < 0) {
-                tbl->buckets[bucket] = slot;
+        shr_lock(st);
+
+        /* Nothing to do if the key isn't in the table */
+        if(!tbl_find_key(&st->current->table, key, hash, NULL, NULL)) {
+                shr_unlock(st);
+                return 0;
         }
-        else {
-                tmp = tbl->buckets[bucket] * tbl->entry_size;
-                ptr = tbl->buffer + tmp;
-                while((next_idx = *(s16 *)ptr) >= 0) {
-                        ptr = tbl->buffer + next_idx * tbl->entry_size;
-                }
-                *(s16 *)ptr = slot;
+
+        if(!(snap = shr_copy(tbl, st->current, st->current->table.number))) {
+                shr_unlock(st);
+                return -1;
         }
 
-        tbl->number++;
+        paRemoveTable(&snap->table, key);
+
+        shr_publish(tbl, snap);
+        shr_unlock(st);
         return 0;
 }
 
-PA_API s8 paGetTable(struct pa_table *tbl, void *key, void *out)
+PA_API s8 paGetSharedTable(struct pa_shared_table *tbl, s16 reader,
+                void *key, void *out)
 {
+        struct shr_state *st = tbl->state;
+        struct shr_reader *rdr = &st->readers[reader];
+        struct shr_snapshot *snap;
+        u16 hash = tbl_hash(key, tbl->key_size);
+        u32 version;
         u8 *ptr;
-        s16 off = PA_TBL_HEAD_SIZE + tbl->key_size;
+        s8 ret;
 
-        if(!(ptr = tbl_find_key(tbl, key, NULL, NULL)))
-                return 0;
+        /*
+         * Announce the version before reading the snapshot. If the writer
+         * published a new version in the meantime, it might have missed the
+         * announcement, so try again.
+         */
+        do {
+                version = st->version;
+                rdr->epoch = version;
+                PA_BARRIER();
+        } while(st->version != version);
+
+        /* Search directly, so the readers don't share the hit-counters */
+        snap = st->current;
+        ptr = tbl_find_key(&snap->table, key, hash, NULL, NULL);
+        if((ret = ptr != NULL))
+                pa_mem_copy(out, ptr + PA_TBL_HEAD_SIZE + tbl->key_size,
+                                tbl->value_size);
+
+        /* Done reading, the snapshot may be freed from now on */
+        PA_BARRIER();
+        rdr->epoch = 0;
+
+        return ret;
+}
 
-        pa_mem_copy(out, ptr + off, tbl->entry_size);
-        return 1;
+#undef SHR_LINE
+
+/*
+ * -----------------------------------------------------------------------------
+ *
+ *      CACHE
+ *
+ */
+
+/*
+ * Get a pointer to the reference-bit of an entry in the table-buffer.
+ */
+PA_INTERN u8 *cch_ref(struct pa_cache *cache, u8 *ptr)
+{
+        return ptr + PA_TBL_HEAD_SIZE + cache->table.key_size +
+                cache->value_size;
 }
 
-PA_API void paRemoveTable(struct pa_table *tbl, void *key)
+/*
+ * Move the hand over the slots until an entry with a clear reference-bit is
+ * found, clearing the bits of all entries passed, and evict that entry.
+ */
+PA_INTERN void cch_evict(struct pa_cache *cache)
 {
-        s16 bucket;
+        struct pa_table *tbl = &cache->table;
         u8 *ptr;
-        u8 *prev;
-        s16 next_idx;
+        u8 *ref;
 
-        if((ptr = tbl_find_key(tbl, key, &prev, &bucket))) {
-                next_idx = *(s16 *)ptr;
+        while(1) {
+                ptr = tbl->buffer + cache->hand * tbl->entry_size;
+                if(++cache->hand >= tbl->alloc)
+                        cache->hand = 0;
 
-                if(!prev && next_idx < 0) {
-                        tbl->buckets[bucket] = -1;
-                }
-                else if(!prev && next_idx >= 0) {
-                        tbl->buckets[bucket] = next_idx;
-                }
-                else if(prev) {
-                        *(s16 *)prev = *(s16 *)ptr;
+                /* Skip the unused slots */
+                if(*(s16 *)ptr == -1)
+                        continue;
+
+                ref = cch_ref(cache, ptr);
+                if(*ref) {
+                        *ref = 0;
+                        continue;
                 }
 
-                *(s16 *)ptr = -1;
-                tbl->number--;
+                ptr += PA_TBL_HEAD_SIZE;
+                if(cache->evict)
+                        cache->evict(ptr, ptr + tbl->key_size, cache->pass);
+
+                paRemoveTable(tbl, ptr);
+                cache->evictions++;
+                return;
         }
 }
 
-PA_API void *paIterateTable(struct pa_table *tbl, void *ptr, 
-                struct pa_table_entry *ent)
+/*
+ * Get the size of the value-part in the table, with the reference-bit behind
+ * the value and padding to keep the entries aligned to four bytes.
+ */
+PA_INTERN s32 cch_value_size(s32 key_sz, s32 value_sz)
 {
-        char *tmp;
+        return ((key_sz + value_sz + 1 + 3) & ~3) - key_sz;
+}
 
-        /* Check if the table is empty */
-        if(tbl->number < 1)
-                return NULL;
+PA_INTERN void cch_reset(struct pa_cache *cache, s32 value_sz)
+{
+        cache->value_size = value_sz;
+        cache->budget = cache->table.alloc;
+        cache->hand = 0;
+        cache->evict = NULL;
+        cache->pass = NULL;
+        cache->hits = 0;
+        cache->misses = 0;
+        cache->evictions = 0;
+}
 
-        /* Go to the next entry in the table */
-        if(!(ptr = tbl_next(tbl, ptr)))
-                return NULL;
+PA_API s8 paInitCache(struct pa_cache *cache, struct pa_memory *mem,
+                s32 key_sz, s32 value_sz, s16 budget)
+{
+        if(budget < 1)
+                return -1;
 
-        /* Return the entry-data for the current entry */
-        if(ent) {
-                /* Copy over the key */
-                tmp = (char *)ptr + PA_TBL_NEXT_SIZE + PA_TBL_HASH_SIZE;
+        if(paInitTable(&cache->table, mem, key_sz,
+                                cch_value_size(key_sz, value_sz), budget) < 0)
+                return -1;
 
-                /* Set the pointer for the data */
-                ent->key = tmp;
-                ent->value = tmp + tbl->key_size;
-        }
+        cch_reset(cache, value_sz);
+        return 0;
+}
 
-        return ptr;
+PA_API s8 paInitCacheFixed(struct pa_cache *cache, void *buffer,
+                s32 buf_sz, s32 key_sz, s32 value_sz)
+{
+        if(paInitTableFixed(&cache->table, buffer, buf_sz, key_sz,
+                                cch_value_size(key_sz, value_sz)) < 0)
+                return -1;
+
+        cch_reset(cache, value_sz);
+        return 0;
 }
 
-PA_API void *paIterateTableBucket(struct pa_table *tbl, s16 bucket,
-                void *ptr, struct pa_table_entry *ent)
+PA_API void paDestroyCache(struct pa_cache *cache)
 {
-        char *tmp;
+        paDestroyTable(&cache->table);
+        cch_reset(cache, 0);
+}
 
-        /* Check if the table is empty */
-        if(tbl->number < 1)
-                return NULL;
+PA_API void paSetCacheCallback(struct pa_cache *cache, pa_cache_func fnc,
+                void *pass)
+{
+        cache->evict = fnc;
+        cache->pass = pass;
+}
 
-        if(!(ptr = tbl_next_bucket(tbl, bucket, ptr)))
-                return NULL;
+PA_API s8 paSetCache(struct pa_cache *cache, void *key, void *value)
+{
+        struct pa_table *tbl = &cache->table;
+        u16 hash = tbl_hash(key, tbl->key_size);
+        u8 *ptr;
 
-        /* Return the data for the current entry */
-        if(ent) {
-                /* Copy over the key */
-                tmp = (char *)ptr + PA_TBL_NEXT_SIZE + PA_TBL_HASH_SIZE;
+        /* Make room if the key isn't cached yet and the budget is used up */
+        if(tbl->number >= cache->budget &&
+                        !tbl_find_key(tbl, key, hash, NULL, NULL))
+                cch_evict(cache);
 
-                /* Set the pointer for the data */
-                ent->key = tmp;
-                ent->value = tmp + tbl->key_size;
+        if(!(ptr = tbl_insert(tbl, key, hash)))
+                return -1;
+
+        pa_mem_copy(ptr + PA_TBL_HEAD_SIZE + tbl->key_size, value,
+                        cache->value_size);
+        *cch_ref(cache, ptr) = 1;
+        return 0;
+}
+
+PA_API s8 paGetCache(struct pa_cache *cache, void *key, void *out)
+{
+        struct pa_table *tbl = &cache->table;
+        u8 *ptr;
+
+        if(!(ptr = tbl_find_key(tbl, key, tbl_hash(key, tbl->key_size), NULL,
+                                        NULL))) {
+                cache->misses++;
+                return 0;
         }
 
-        return ptr;
+        pa_mem_copy(out, ptr + PA_TBL_HEAD_SIZE + tbl->key_size,
+                        cache->value_size);
+        *cch_ref(cache, ptr) = 1;
+        cache->hits++;
+        return 1;
+}
+
+PA_API void paRemoveCache(struct pa_cache *cache, void *key)
+{
+        paRemoveTable(&cache->table, key);
 }
 
 /*
@@ -1647,22 +6374,26 @@ PA_INTERN s8 flx_parse_token(u8 opt, char *s, struct pa_flex_token *tok)
                 buf[tail] = 0;
 
                 if(tail != 0) {
-                        if(pa_strcmp(buf, "px") == 0) {
-                                /* A pixel-value has to be an integer */
-                                tok->value = (s32)tok->value;
-                                tok->code = 0x12;
-                        }
-                        else if(pa_strcmp(buf, "pct") == 0) {
-                                tok->value /= 100.0;
+                        switch(pa_kwd_find(&pa_kwd_unit, buf, tail)) {
+                                case 0x12:
+                                        /* A pixel-value has to be an integer */
+                                        tok->value = (s32)tok->value;
+                                        tok->code = 0x12;
+                                        break;
 
-                                tok->code = 0x13;
-                        }
-                        else if(pa_strcmp(buf, "em") == 0) {
-                                tok->code = 0x14;
-                        }
-                        else {
-                                /* Unit invalid */
-                                return -1;
+                                case 0x13:
+                                        tok->value /= 100.0;
+
+                                        tok->code = 0x13;
+                                        break;
+
+                                case 0x14:
+                                        tok->code = 0x14;
+                                        break;
+
+                                default:
+                                        /* Unit invalid */
+                                        return -1;
                         }
                 }
 
@@ -1891,6 +6622,149 @@ err_return:
         return -1;
 }
 
+/*
+ * Combine two linear forms a + b * relative + c * font with an operator. The
+ * result is only a linear form again if at most one side contains references
+ * when multiplying, and if the divisor is a constant other than zero.
+ *
+ * @code: The operator-code
+ * @lft: The left operand
+ * @rgt: The right operand
+ * @out: A pointer to write the resulting linear form to
+ *
+ * Returns: 0 on success or -1 if the result is not a linear form
+ */
+PA_INTERN s8 flx_fold(u8 code, f32 *lft, f32 *rgt, f32 *out)
+{
+        s8 lft_const = lft[1] == 0 && lft[2] == 0;
+        s8 rgt_const = rgt[1] == 0 && rgt[2] == 0;
+        s8 i;
+
+        for(i = 0; i < 3; i++) {
+                switch(code) {
+                        case 0x03:
+                                if(rgt_const)
+                                        out[i] = lft[i] * rgt[0];
+                                else if(lft_const)
+                                        out[i] = lft[0] * rgt[i];
+                                else
+                                        return -1;
+                                break;
+
+                        case 0x04: out[i] = lft[i] + rgt[i]; break;
+                        case 0x05: out[i] = lft[i] - rgt[i]; break;
+
+                        case 0x06:
+                                if(!rgt_const || rgt[0] == 0)
+                                        return -1;
+                                out[i] = lft[i] / rgt[0];
+                                break;
+
+                        default: return -1;
+                }
+        }
+
+        return 0;
+}
+
+/*
+ * Replace the tokens of the flex-term with the shortest term for its linear
+ * form. This never needs more tokens than the original term, as every part of
+ * the linear form has to come from at least one operand.
+ */
+PA_INTERN void flx_emit(struct pa_flex *flx)
+{
+        struct pa_flex_token tok;
+        f32 parts[3];
+        u8 codes[3] = {0x11, 0x13, 0x14};
+        s8 num = 0;
+        s8 i;
+
+        parts[0] = flx->constant;
+        parts[1] = flx->relative;
+        parts[2] = flx->font;
+
+        paClearList(&flx->tokens);
+
+        for(i = 0; i < 3; i++) {
+                /* An empty form is still written as the constant zero */
+                if(parts[i] == 0 && (i > 0 || parts[1] != 0 || parts[2] != 0))
+                        continue;
+
+                tok.code = codes[i];
+                tok.value = parts[i];
+                paPushList(&flx->tokens, &tok, 1);
+
+                if(num++ > 0) {
+                        tok.code = 0x04;
+                        tok.value = 0;
+                        paPushList(&flx->tokens, &tok, 1);
+                }
+        }
+}
+
+/*
+ * Evaluate the postfix-term with every value kept as the linear form
+ * a + b * relative + c * font. If the whole term folds into a single linear
+ * form, store it and replace the tokens.
+ */
+PA_INTERN void flx_compile(struct pa_flex *flx)
+{
+        struct pa_list *values = &flx->helper->values;
+        struct pa_flex_token tok;
+        f32 lft[3];
+        f32 rgt[3];
+        f32 form[3];
+        s16 depth = 0;
+        u16 i = 0;
+
+        flx->linear = 0;
+        paClearList(values);
+
+        while(paPeekList(&flx->tokens, &tok, i++, 1)) {
+                /* Operands become a linear form with a single part */
+                if(tok.code > 0x06) {
+                        form[0] = form[1] = form[2] = 0;
+                        switch(tok.code) {
+                                case 0x13: form[1] = tok.value; break;
+                                case 0x14: form[2] = tok.value; break;
+                                default:   form[0] = tok.value; break;
+                        }
+                }
+                /* Operators combine the two topmost forms */
+                else {
+                        if(depth < 2)
+                                goto out_clear;
+
+                        paPopList(values, rgt, 3);
+                        paPopList(values, lft, 3);
+                        depth -= 2;
+
+                        if(flx_fold(tok.code, lft, rgt, form) < 0)
+                                goto out_clear;
+                }
+
+                if(paPushList(values, form, 3) != 3)
+                        goto out_clear;
+
+                depth++;
+        }
+
+        if(depth != 1)
+                goto out_clear;
+
+        paPopList(values, form, 3);
+        flx->constant = form[0];
+        flx->relative = form[1];
+        flx->font = form[2];
+        flx->linear = 1;
+
+        flx_emit(flx);
+
+out_clear:
+        paClearList(values);
+}
+
 PA_API s8 paInitFlexHelper(struct pa_flex_helper *hlp, struct pa_memory *mem,
                 s16 tokens)
 {
@@ -1967,6 +6841,7 @@ PA_API s8 paInitFlex(struct pa_flex *flx, struct pa_flex_helper *hlp,
 {
         s32 toksize = sizeof(struct pa_flex_token);
         flx->helper = hlp;
+        flx->linear = 0;
         return paInitList(&flx->tokens, mem, toksize, tokens, PA_NOLIM);
 }
 
@@ -1975,6 +6850,7 @@ PA_API s8 paInitFlexFixed(struct pa_flex *flx, struct pa_flex_helper *hlp,
 {
         s32 toksize = sizeof(struct pa_flex_token);
         flx->helper = hlp;
+        flx->linear = 0;
         return paInitListFixed(&flx->tokens, toksize, tok_buf, tok_buf_sz);
 }
 
@@ -1986,6 +6862,7 @@ PA_API void paDestroyFlex(struct pa_flex *flx)
 PA_API void paClearFlex(struct pa_flex *flx)
 {
         paClearList(&flx->tokens);
+        flx->linear = 0;
 }
 
 PA_API s16 paParseFlex(struct pa_flex *flx, char *str)
@@ -1993,7 +6870,8 @@ PA_API s16 paParseFlex(struct pa_flex *flx, char *str)
         /* Firs we tokenize the input and write the tokens to the parser */
         flx_tokenize(flx->helper, str);
 
-        flx_shunting_yard(flx->helper, flx);
+        if(flx_shunting_yard(flx->helper, flx) == 0)
+                flx_compile(flx);
 
         return 0;
 }
@@ -2006,6 +6884,12 @@ PA_API s32 paProcessFlex(struct pa_flex *flx, struct pa_flex_reference *ref)
         f32 opd[2];
         u16 i = 0;
 
+        if(flx->linear) {
+                value = flx->constant + flx->relative * ref->relative +
+                        flx->font * ref->font;
+                return (s32)value;
+        }
+
         values = &flx->helper->values;
 
         while(paPeekList(&flx->tokens, &tok, i++, 1)) {
@@ -16,3 +16,14 @@ PA_LIB void pa_element_tree_destroy(struct pa_element_tree *tree)
                 return;
 
 }
+
+
+PA_LIB enum pa_tag_type pa_tag_by_name(char *name)
+{
+        s32 type;
+
+        if((type = pa_kwd_find(&pa_kwd_tag, name, pa_strlen(name))) < 0)
+                return PA_UNDEF;
+
+        return (enum pa_tag_type)type;
+}
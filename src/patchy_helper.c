@@ -171,3 +171,266 @@ PA_LIB f64 pa_atof(char *s)
         }
         return a;
 }
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              BIT-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+PA_LIB s8 pa_bit_ctz(u32 x)
+{
+#if defined(__GNUC__)
+        return __builtin_ctz(x);
+#else
+        s8 n = 0;
+
+        while(!(x & 1)) {
+                x >>= 1;
+                n++;
+        }
+
+        return n;
+#endif
+}
+
+PA_LIB s8 pa_bit_popcount(u32 x)
+{
+#if defined(__GNUC__)
+        return __builtin_popcount(x);
+#else
+        x = x - ((x >> 1) & 0x55555555);
+        x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+        x = (x + (x >> 4)) & 0x0F0F0F0F;
+        return (x * 0x01010101) >> 24;
+#endif
+}
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              HASH-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+#define HSH_PRIME1      0x9E3779B1
+#define HSH_PRIME2      0x85EBCA77
+#define HSH_PRIME3      0xC2B2AE3D
+#define HSH_PRIME4      0x27D4EB2F
+#define HSH_PRIME5      0x165667B1
+
+#define HSH_ROTL(x, r)  (((x) << (r)) | ((x) >> (32 - (r))))
+
+/*
+ * Read a little-endian word. Compilers turn this into a single load on
+ * little-endian machines, without requiring the pointer to be aligned.
+ */
+PA_INTERN u32 hsh_read(u8 *p)
+{
+        return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) |
+                ((u32)p[3] << 24);
+}
+
+PA_INTERN u32 hsh_round(u32 acc, u32 input)
+{
+        acc += input * HSH_PRIME2;
+        acc = HSH_ROTL(acc, 13);
+        return acc * HSH_PRIME1;
+}
+
+PA_LIB u32 pa_hash(void *key, s32 size)
+{
+        u8 *p = key;
+        u8 *end = p + size;
+        u32 v1, v2, v3, v4;
+        u32 h;
+
+        if(size >= 16) {
+                v1 = HSH_PRIME1 + HSH_PRIME2;
+                v2 = HSH_PRIME2;
+                v3 = 0;
+                v4 = 0 - HSH_PRIME1;
+
+                while(p + 16 <= end) {
+                        v1 = hsh_round(v1, hsh_read(p));
+                        v2 = hsh_round(v2, hsh_read(p + 4));
+                        v3 = hsh_round(v3, hsh_read(p + 8));
+                        v4 = hsh_round(v4, hsh_read(p + 12));
+                        p += 16;
+                }
+
+                h = HSH_ROTL(v1, 1) + HSH_ROTL(v2, 7) + HSH_ROTL(v3, 12) +
+                        HSH_ROTL(v4, 18);
+        }
+        else {
+                h = HSH_PRIME5;
+        }
+
+        h += (u32)size;
+
+        while(p + 4 <= end) {
+                h += hsh_read(p) * HSH_PRIME3;
+                h = HSH_ROTL(h, 17) * HSH_PRIME4;
+                p += 4;
+        }
+
+        while(p < end) {
+                h += (u32)(*p) * HSH_PRIME5;
+                h = HSH_ROTL(h, 11) * HSH_PRIME1;
+                p++;
+        }
+
+        /* Mix the bits, so every input bit affects every output bit */
+        h ^= h >> 15;
+        h *= HSH_PRIME2;
+        h ^= h >> 13;
+        h *= HSH_PRIME3;
+        h ^= h >> 16;
+        return h;
+}
+
+#undef HSH_PRIME1
+#undef HSH_PRIME2
+#undef HSH_PRIME3
+#undef HSH_PRIME4
+#undef HSH_PRIME5
+#undef HSH_ROTL
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              BLOOM-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+#define BLM_BITS        (PA_BLOOM_BLOCK * 32)
+
+/*
+ * Get the block for a hash. The upper half of the hash is scaled to the
+ * number of blocks, which avoids a division.
+ */
+PA_INTERN u32 *blm_block(struct pa_bloom *flt, u32 hash)
+{
+        return flt->bits + ((hash >> 16) * (u32)flt->blocks >> 16) *
+                PA_BLOOM_BLOCK;
+}
+
+/*
+ * Get the next bit inside a block. The hash is remixed for every bit, so the
+ * bits of a key don't depend on each other.
+ */
+PA_INTERN u32 blm_next(u32 *h)
+{
+        *h ^= *h >> 15;
+        *h *= 0x2C1B3C6D;
+        return *h >> 23;
+}
+
+PA_LIB s8 pa_bloom_init(struct pa_bloom *flt, struct pa_memory *mem,
+                s32 capacity, f32 rate)
+{
+        s32 blocks;
+        s16 hashes = 0;
+        f32 r = rate;
+
+        if(rate <= 0 || rate >= 1)
+                return -1;
+
+        /*
+         * The optimal number of bits per key is log2(1/rate) and the filter
+         * needs about 1.44 bits per key and bit. Use a bit more, as keys are
+         * not spread perfectly evenly over the blocks.
+         */
+        while(r < 1 && hashes < 16) {
+                r *= 2;
+                hashes++;
+        }
+
+        blocks = (PA_MAX(capacity, 1) * hashes * 3 / 2 + BLM_BITS - 1) /
+                BLM_BITS;
+        blocks = PA_MIN(blocks, 0x10000);
+
+        if(!(flt->bits = pa_mem_alloc(mem, NULL, blocks * BLM_BITS / 8)))
+                return -1;
+
+        pa_mem_zero(flt->bits, blocks * BLM_BITS / 8);
+
+        flt->blocks = blocks;
+        flt->hashes = hashes;
+        flt->capacity = capacity;
+        flt->stale = 0;
+        flt->rate = rate;
+        return 0;
+}
+
+PA_LIB void pa_bloom_destroy(struct pa_bloom *flt, struct pa_memory *mem)
+{
+        if(flt->bits)
+                pa_mem_free(mem, flt->bits);
+
+        pa_mem_zero(flt, sizeof(struct pa_bloom));
+}
+
+PA_LIB void pa_bloom_add(struct pa_bloom *flt, u32 hash)
+{
+        u32 *block = blm_block(flt, hash);
+        u32 bit;
+        s16 i;
+
+        for(i = 0; i < flt->hashes; i++) {
+                bit = blm_next(&hash);
+                block[bit / 32] |= 1U << (bit % 32);
+        }
+}
+
+PA_LIB s8 pa_bloom_test(struct pa_bloom *flt, u32 hash)
+{
+        u32 *block = blm_block(flt, hash);
+        u32 bit;
+        s16 i;
+
+        for(i = 0; i < flt->hashes; i++) {
+                bit = blm_next(&hash);
+                if(!(block[bit / 32] & (1U << (bit % 32))))
+                        return 0;
+        }
+
+        return 1;
+}
+
+#undef BLM_BITS
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              KEYWORD-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+PA_LIB s32 pa_kwd_find(const struct pa_keyword_set *set, char *s, s32 len)
+{
+        u32 hash = pa_hash(s, len);
+        const char *key;
+        s32 i;
+
+        /* Apply the displacement of the bucket, same as in build.py */
+        hash = (hash ^ set->disp[hash % set->buckets]) * 0x85EBCA6B;
+        hash ^= hash >> 13;
+
+        /* Only this slot can contain the keyword */
+        key = set->keys[hash % set->number];
+        for(i = 0; i < len; i++) {
+                if(key[i] != s[i])
+                        return -1;
+        }
+
+        if(key[len] != 0)
+                return -1;
+
+        return set->values[hash % set->number];
+}
@@ -3,6 +3,46 @@
 
 #include "patchy.h"
 
+/*
+ * Use SSE2 if the target supports it, unless it has been disabled by defining
+ * PA_NO_SIMD.
+ */
+#if defined(__SSE2__) && !defined(PA_NO_SIMD)
+#define PA_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * Use mmap() to map files into memory if POSIX is available, unless it has been
+ * disabled by defining PA_NO_MMAP.
+ */
+#if defined(_POSIX_C_SOURCE) && !defined(PA_NO_MMAP)
+#define PA_MMAP
+#endif
+
+/* Hint the CPU to load the memory into the cache ahead of time */
+#if defined(__GNUC__)
+#define PA_PREFETCH(p)  __builtin_prefetch(p)
+#else
+#define PA_PREFETCH(p)
+#endif
+
+/*
+ * Full memory barrier, neither the compiler nor the CPU reorder across it.
+ * Threads sharing data without a lock depend on it, so refuse to build with
+ * threads if there is no barrier. Single-threaded code needs no ordering.
+ */
+#if defined(__GNUC__)
+#define PA_BARRIER()    __sync_synchronize()
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define PA_BARRIER()    _mm_mfence()
+#elif defined(PA_PTHREADS)
+#error "PA_PTHREADS requires a compiler providing a memory barrier"
+#else
+#define PA_BARRIER()
+#endif
+
 
 /* 
  * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
@@ -183,6 +223,138 @@ PA_LIB s64 pa_atoi(char *s);
  */
 PA_LIB f64 pa_atof(char *s);
 
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              BIT-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * Count the trailing zero-bits in a word. Uses the hardware bit-scan if the
+ * compiler supports it.
+ *
+ * @x: The word, must not be 0
+ *
+ * Returns: The index of the lowest set bit
+ */
+PA_LIB s8 pa_bit_ctz(u32 x);
+
+/*
+ * Count the set bits in a word. Uses the hardware popcount if the compiler
+ * supports it.
+ *
+ * @x: The word
+ *
+ * Returns: The number of set bits
+ */
+PA_LIB s8 pa_bit_popcount(u32 x);
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              HASH-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * Hash a block of memory using xxHash32. The input is processed in stripes
+ * of four 32-bit words, so long keys need only a few multiplications per
+ * 16 bytes, while short keys skip straight to the final mixing.
+ *
+ * @key: Pointer to the memory to hash
+ * @size: The number of bytes to hash
+ *
+ * Returns: The 32-bit hash
+ */
+PA_LIB u32 pa_hash(void *key, s32 size);
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              BLOOM-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * Allocate a bloom-filter sized for the given number of keys, so the
+ * false-positive rate stays close to the requested one.
+ *
+ * @flt: Pointer to the bloom-filter
+ * @mem: Pointer to the memory-manager
+ * @capacity: The number of keys the filter should hold
+ * @rate: The target false-positive rate between 0 and 1
+ *
+ * Returns: 0 on success or -1 if an error occurred
+ */
+PA_LIB s8 pa_bloom_init(struct pa_bloom *flt, struct pa_memory *mem,
+                s32 capacity, f32 rate);
+
+/*
+ * Free the memory of the bloom-filter and disable it.
+ *
+ * @flt: Pointer to the bloom-filter
+ * @mem: Pointer to the memory-manager
+ */
+PA_LIB void pa_bloom_destroy(struct pa_bloom *flt, struct pa_memory *mem);
+
+/*
+ * Add a key to the bloom-filter.
+ *
+ * @flt: Pointer to the bloom-filter
+ * @hash: The 32-bit hash of the key
+ */
+PA_LIB void pa_bloom_add(struct pa_bloom *flt, u32 hash);
+
+/*
+ * Check if a key might be in the bloom-filter.
+ *
+ * @flt: Pointer to the bloom-filter
+ * @hash: The 32-bit hash of the key
+ *
+ * Returns: 0 if the key is definitely not in the filter and 1 if it might be
+ */
+PA_LIB s8 pa_bloom_test(struct pa_bloom *flt, u32 hash);
+
+/* 
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ *
+ *              KEYWORD-HELPER
+ *
+ * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ */
+
+/*
+ * A minimal perfect hash table for a fixed set of keywords. The tables are
+ * generated by build.py from patchy_keyword.txt into patchy_keyword.c, so
+ * every keyword maps to its own slot and a lookup needs one hash and one
+ * compare.
+ */
+struct pa_keyword_set {
+        s16 number;             /* The number of keywords */
+        s16 buckets;            /* The number of displacements */
+        const u16 *disp;        /* The displacement for every bucket */
+        const char *const *keys;/* The keyword in every slot */
+        const s32 *values;      /* The value for every slot */
+};
+
+PA_LIB const struct pa_keyword_set pa_kwd_unit;
+PA_LIB const struct pa_keyword_set pa_kwd_tag;
+
+/*
+ * Look up a keyword in a keyword-set.
+ *
+ * @set: Pointer to the keyword-set
+ * @s: The keyword, doesn't have to be null-terminated
+ * @len: The length of the keyword in bytes
+ *
+ * Returns: The value for the keyword or -1 if it's not in the set
+ */
+PA_LIB s32 pa_kwd_find(const struct pa_keyword_set *set, char *s, s32 len);
+
 /* 
  * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
  *
@@ -209,6 +381,16 @@ PA_LIB s8 pa_etr_init(struct pa_element_tree *tree);
 PA_LIB void pa_etr_destroy(struct pa_element_tree *tree);
 
 
+/*
+ * Get the tag-type for the name of a tag.
+ *
+ * @name: The null-terminated name of the tag
+ *
+ * Returns: The tag-type or PA_UNDEF if the name is unknown
+ */
+PA_LIB enum pa_tag_type pa_tag_by_name(char *name);
+
+
 /*
  * Reserve memory for a new element. Nothing will be initialized.
  *
@@ -0,0 +1,62 @@
+/*
+ * Generated by build.py from patchy_keyword.txt, do not edit!
+ */
+
+#include "patchy.h"
+#include "patchy_internal.h"
+
+static const u16 kwd_unit_disp[] = {
+        2,
+        0
+};
+
+static const char *const kwd_unit_keys[] = {
+        "pct",
+        "em",
+        "px"
+};
+
+static const s32 kwd_unit_values[] = {
+        0x13,
+        0x14,
+        0x12
+};
+
+const struct pa_keyword_set pa_kwd_unit = {
+        3, 2,
+        kwd_unit_disp,
+        kwd_unit_keys,
+        kwd_unit_values
+};
+
+static const u16 kwd_tag_disp[] = {
+        0,
+        0,
+        8
+};
+
+static const char *const kwd_tag_keys[] = {
+        "text",
+        "custom",
+        "body",
+        "input",
+        "block",
+        "image"
+};
+
+static const s32 kwd_tag_values[] = {
+        PA_TEXT,
+        PA_CUSTOM,
+        PA_BODY,
+        PA_INPUT,
+        PA_BLOCK,
+        PA_IMAGE
+};
+
+const struct pa_keyword_set pa_kwd_tag = {
+        6, 3,
+        kwd_tag_disp,
+        kwd_tag_keys,
+        kwd_tag_values
+};
+